@@ -69,6 +69,8 @@ LOCAL_SRC_FILES := \
 	bluez/src/shared/gatt-db.c \
 	bluez/src/shared/io-glib.c \
 	bluez/src/shared/timeout-glib.c \
+	bluez/src/shared/timeout.c \
+	bluez/src/shared/aes.c \
 	bluez/src/shared/crypto.c \
 	bluez/src/shared/uhid.c \
 	bluez/src/shared/att.c \
@@ -359,6 +361,7 @@ LOCAL_SRC_FILES := \
 	bluez/monitor/broadcom.c \
 	bluez/src/shared/util.c \
 	bluez/src/shared/queue.c \
+	bluez/src/shared/aes.c \
 	bluez/src/shared/crypto.c \
 	bluez/src/shared/btsnoop.c \
 	bluez/src/shared/mainloop.c \
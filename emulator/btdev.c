@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <alloca.h>
+#include <time.h>
 #include <sys/uio.h>
 #include <stdint.h>
 
@@ -39,9 +40,11 @@
 
 #include "src/shared/util.h"
 #include "src/shared/timeout.h"
+#include "src/shared/queue.h"
 #include "src/shared/crypto.h"
 #include "src/shared/ecc.h"
 #include "monitor/bt.h"
+#include "phy.h"
 #include "btdev.h"
 
 #define has_bredr(btdev)	(!((btdev)->features[4] & 0x20))
@@ -50,6 +53,10 @@
 #define ACL_HANDLE 42
 #define ISO_HANDLE 44
 
+/* Handles of LE links made while the device already has a link */
+#define LE_LINK_HANDLE_MIN 0x0200
+#define LE_LINK_HANDLE_MAX 0x0eff
+
 struct hook {
 	btdev_hook_func handler;
 	void *user_data;
@@ -59,10 +66,30 @@ struct hook {
 
 #define MAX_HOOK_ENTRIES 16
 
+struct btdev;
+
+struct addr_entry {
+	struct btdev *btdev;
+	const uint8_t *addr;
+	struct addr_entry *next;
+	bool linked;
+};
+
+struct addr_index {
+	struct addr_entry **buckets;
+	unsigned int size;
+	unsigned int count;
+};
+
 struct btdev {
 	enum btdev_type type;
 
+	int index;
+	struct addr_entry bdaddr_entry;
+	struct addr_entry random_entry;
+
 	struct btdev *conn;
+	struct queue *le_links;
 
 	bool auth_init;
 	uint8_t link_key[16];
@@ -82,6 +109,12 @@ struct btdev {
 	unsigned int inquiry_id;
 	unsigned int inquiry_timeout_id;
 
+	struct bt_phy_link link;
+	struct queue *link_queue;
+	unsigned int link_id;
+	uint64_t link_anchor;
+	uint32_t link_seed;
+
 	struct hook *hook_list[MAX_HOOK_ENTRIES];
 
 	struct bt_crypto *crypto;
@@ -159,6 +192,17 @@ struct btdev {
 	uint16_t le_ext_adv_type;
 };
 
+/*
+ * Each LE link is known by its handle on both ends, so that a central
+ * can keep several peripherals connected.  The conn pointer keeps the
+ * first remote for the commands that only deal with one link.
+ */
+struct le_link {
+	uint16_t handle;
+	struct btdev *remote;
+	uint16_t remote_handle;
+};
+
 struct inquiry_data {
 	struct btdev *btdev;
 	int num_resp;
@@ -169,13 +213,27 @@ struct inquiry_data {
 
 #define DEFAULT_INQUIRY_INTERVAL 100 /* 100 miliseconds */
 
-#define MAX_BTDEV_ENTRIES 16
+#define BTDEV_LIST_MIN 16
+#define ADDR_INDEX_MIN 16
 
 static const uint8_t LINK_KEY_NONE[16] = { 0 };
 static const uint8_t LINK_KEY_DUMMY[16] = {	0, 1, 2, 3, 4, 5, 6, 7,
 						8, 9, 0, 1, 2, 3, 4, 5 };
 
-static struct btdev *btdev_list[MAX_BTDEV_ENTRIES] = { };
+/*
+ * Emulated controllers are kept in a list that grows on demand, so the
+ * index of a controller stays stable for its lifetime and is reused once
+ * it is destroyed.  Lookups by address go through hash indexes instead
+ * of scanning the whole list.
+ */
+static struct btdev **btdev_list;
+static int btdev_list_len;
+static int btdev_list_free;
+
+static struct addr_index bdaddr_index;
+static struct addr_index random_index;
+
+static struct bt_phy_link default_link;
 
 static int get_hook_index(struct btdev *btdev, enum btdev_hook_type type,
 								uint16_t opcode)
@@ -205,69 +263,192 @@ static bool run_hooks(struct btdev *btdev, enum btdev_hook_type type,
 					btdev->hook_list[index]->user_data);
 }
 
-static inline int add_btdev(struct btdev *btdev)
+static unsigned int addr_hash(const uint8_t *addr)
 {
-	int i, index = -1;
+	unsigned int hash = 2166136261u;
+	int i;
 
-	for (i = 0; i < MAX_BTDEV_ENTRIES; i++) {
-		if (btdev_list[i] == NULL) {
-			index = i;
-			btdev_list[index] = btdev;
-			break;
+	for (i = 0; i < 6; i++) {
+		hash ^= addr[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static bool addr_index_resize(struct addr_index *index, unsigned int size)
+{
+	struct addr_entry **buckets;
+	unsigned int i;
+
+	buckets = calloc(size, sizeof(*buckets));
+	if (!buckets)
+		return false;
+
+	for (i = 0; i < index->size; i++) {
+		struct addr_entry *entry = index->buckets[i];
+
+		while (entry) {
+			struct addr_entry *next = entry->next;
+			unsigned int bucket = addr_hash(entry->addr) & (size - 1);
+
+			entry->next = buckets[bucket];
+			buckets[bucket] = entry;
+			entry = next;
 		}
 	}
 
-	return index;
+	free(index->buckets);
+	index->buckets = buckets;
+	index->size = size;
+
+	return true;
+}
+
+static void addr_index_add(struct addr_index *index, struct addr_entry *entry)
+{
+	unsigned int bucket;
+
+	if (entry->linked)
+		return;
+
+	if (index->count >= index->size) {
+		unsigned int size = index->size ? index->size * 2 :
+							ADDR_INDEX_MIN;
+
+		/* Keep the current table if it cannot grow */
+		if (!addr_index_resize(index, size) && !index->size)
+			return;
+	}
+
+	bucket = addr_hash(entry->addr) & (index->size - 1);
+
+	entry->next = index->buckets[bucket];
+	index->buckets[bucket] = entry;
+	entry->linked = true;
+	index->count++;
 }
 
-static inline int del_btdev(struct btdev *btdev)
+static void addr_index_del(struct addr_index *index, struct addr_entry *entry)
 {
-	int i, index = -1;
+	struct addr_entry **curr;
+
+	if (!entry->linked)
+		return;
 
-	for (i = 0; i < MAX_BTDEV_ENTRIES; i++) {
-		if (btdev_list[i] == btdev) {
-			index = i;
-			btdev_list[index] = NULL;
+	curr = &index->buckets[addr_hash(entry->addr) & (index->size - 1)];
+
+	for (; *curr; curr = &(*curr)->next) {
+		if (*curr == entry) {
+			*curr = entry->next;
 			break;
 		}
 	}
 
-	return index;
+	entry->next = NULL;
+	entry->linked = false;
+	index->count--;
+
+	if (!index->count) {
+		free(index->buckets);
+		index->buckets = NULL;
+		index->size = 0;
+	}
 }
 
-static inline struct btdev *find_btdev_by_bdaddr(const uint8_t *bdaddr)
+static struct btdev *addr_index_find(struct addr_index *index,
+							const uint8_t *addr)
 {
-	int i;
+	struct addr_entry *entry;
+
+	if (!index->size)
+		return NULL;
+
+	entry = index->buckets[addr_hash(addr) & (index->size - 1)];
 
-	for (i = 0; i < MAX_BTDEV_ENTRIES; i++) {
-		if (btdev_list[i] && !memcmp(btdev_list[i]->bdaddr, bdaddr, 6))
-			return btdev_list[i];
+	for (; entry; entry = entry->next) {
+		if (!memcmp(entry->addr, addr, 6))
+			return entry->btdev;
 	}
 
 	return NULL;
 }
 
-static inline struct btdev *find_btdev_by_bdaddr_type(const uint8_t *bdaddr,
-							uint8_t bdaddr_type)
+static void set_random_addr(struct btdev *btdev, const uint8_t *addr)
 {
-	int i;
+	static const uint8_t addr_none[6] = { };
 
-	for (i = 0; i < MAX_BTDEV_ENTRIES; i++) {
-		int cmp;
+	addr_index_del(&random_index, &btdev->random_entry);
 
-		if (!btdev_list[i])
-			continue;
+	memcpy(btdev->random_addr, addr, 6);
 
-		if (bdaddr_type == 0x01)
-			cmp = memcmp(btdev_list[i]->random_addr, bdaddr, 6);
-		else
-			cmp = memcmp(btdev_list[i]->bdaddr, bdaddr, 6);
+	if (memcmp(btdev->random_addr, addr_none, 6))
+		addr_index_add(&random_index, &btdev->random_entry);
+}
 
-		if (!cmp)
-			return btdev_list[i];
+static int add_btdev(struct btdev *btdev)
+{
+	int index;
+
+	for (index = btdev_list_free; index < btdev_list_len; index++) {
+		if (btdev_list[index] == NULL)
+			break;
 	}
 
-	return NULL;
+	if (index == btdev_list_len) {
+		struct btdev **list;
+		int len = btdev_list_len ? btdev_list_len * 2 : BTDEV_LIST_MIN;
+
+		list = realloc(btdev_list, len * sizeof(*list));
+		if (!list)
+			return -1;
+
+		memset(list + btdev_list_len, 0,
+				(len - btdev_list_len) * sizeof(*list));
+
+		btdev_list = list;
+		btdev_list_len = len;
+	}
+
+	btdev_list[index] = btdev;
+	btdev_list_free = index + 1;
+	btdev->index = index;
+
+	return index;
+}
+
+static int del_btdev(struct btdev *btdev)
+{
+	int index = btdev->index;
+
+	if (index < 0 || index >= btdev_list_len ||
+						btdev_list[index] != btdev)
+		return -1;
+
+	addr_index_del(&bdaddr_index, &btdev->bdaddr_entry);
+	addr_index_del(&random_index, &btdev->random_entry);
+
+	btdev_list[index] = NULL;
+	btdev->index = -1;
+
+	if (index < btdev_list_free)
+		btdev_list_free = index;
+
+	return index;
+}
+
+static inline struct btdev *find_btdev_by_bdaddr(const uint8_t *bdaddr)
+{
+	return addr_index_find(&bdaddr_index, bdaddr);
+}
+
+static inline struct btdev *find_btdev_by_bdaddr_type(const uint8_t *bdaddr,
+							uint8_t bdaddr_type)
+{
+	if (bdaddr_type == 0x01)
+		return addr_index_find(&random_index, bdaddr);
+
+	return addr_index_find(&bdaddr_index, bdaddr);
 }
 
 static void hexdump(const unsigned char *buf, uint16_t len)
@@ -309,12 +490,12 @@ static void hexdump(const unsigned char *buf, uint16_t len)
 	}
 }
 
-static void get_bdaddr(uint16_t id, uint8_t index, uint8_t *bdaddr)
+static void get_bdaddr(uint16_t id, int index, uint8_t *bdaddr)
 {
 	bdaddr[0] = id & 0xff;
 	bdaddr[1] = id >> 8;
-	bdaddr[2] = index;
-	bdaddr[3] = 0x01;
+	bdaddr[2] = index & 0xff;
+	bdaddr[3] = 0x01 + (index >> 8);
 	bdaddr[4] = 0xaa;
 	bdaddr[5] = 0x00;
 }
@@ -764,9 +945,42 @@ struct btdev *btdev_create(enum btdev_type type, uint16_t id)
 
 	get_bdaddr(id, index, btdev->bdaddr);
 
+	btdev->bdaddr_entry.btdev = btdev;
+	btdev->bdaddr_entry.addr = btdev->bdaddr;
+	btdev->random_entry.btdev = btdev;
+	btdev->random_entry.addr = btdev->random_addr;
+
+	addr_index_add(&bdaddr_index, &btdev->bdaddr_entry);
+
+	btdev->link_queue = queue_new();
+	btdev_set_link(btdev, &default_link);
+
+	btdev->le_links = queue_new();
+
 	return btdev;
 }
 
+static bool match_le_link_remote(const void *data, const void *match_data)
+{
+	const struct le_link *link = data;
+
+	return link->remote == match_data;
+}
+
+static void le_link_drop_remote(void *data, void *user_data)
+{
+	struct le_link *link = data;
+	struct btdev *btdev = user_data;
+	struct btdev *remote = link->remote;
+
+	queue_remove_all(remote->le_links, match_le_link_remote, btdev, free);
+
+	if (remote->conn == btdev) {
+		link = queue_peek_head(remote->le_links);
+		remote->conn = link ? link->remote : NULL;
+	}
+}
+
 void btdev_destroy(struct btdev *btdev)
 {
 	if (!btdev)
@@ -775,6 +989,18 @@ void btdev_destroy(struct btdev *btdev)
 	if (btdev->inquiry_id > 0)
 		timeout_remove(btdev->inquiry_id);
 
+	if (btdev->link_id > 0)
+		timeout_remove(btdev->link_id);
+
+	queue_destroy(btdev->link_queue, free);
+
+	/* Remotes must not route to this device anymore */
+	queue_foreach(btdev->le_links, le_link_drop_remote, btdev);
+	queue_destroy(btdev->le_links, free);
+
+	if (btdev->conn && btdev->conn->conn == btdev)
+		btdev->conn->conn = NULL;
+
 	bt_crypto_unref(btdev->crypto);
 	del_btdev(btdev);
 
@@ -946,6 +1172,118 @@ static void le_meta_event(struct btdev *btdev, uint8_t event,
 	send_event(btdev, BT_HCI_EVT_LE_META_EVENT, pkt_data, 1 + len);
 }
 
+static bool match_le_link_handle(const void *data, const void *match_data)
+{
+	const struct le_link *link = data;
+
+	return link->handle == PTR_TO_UINT(match_data);
+}
+
+static struct le_link *le_link_find(struct btdev *btdev, uint16_t handle)
+{
+	return queue_find(btdev->le_links, match_le_link_handle,
+							UINT_TO_PTR(handle));
+}
+
+static uint16_t le_link_handle(struct btdev *btdev)
+{
+	uint16_t handle;
+
+	/* The first link keeps the handle that single link setups expect */
+	if (!btdev->conn && !le_link_find(btdev, ACL_HANDLE))
+		return ACL_HANDLE;
+
+	for (handle = LE_LINK_HANDLE_MIN; handle <= LE_LINK_HANDLE_MAX;
+								handle++) {
+		if (!le_link_find(btdev, handle))
+			return handle;
+	}
+
+	return 0;
+}
+
+static bool le_link_add(struct btdev *central, struct btdev *peripheral,
+			uint16_t *central_handle, uint16_t *peripheral_handle)
+{
+	struct le_link *link, *remote_link;
+
+	*central_handle = le_link_handle(central);
+	*peripheral_handle = le_link_handle(peripheral);
+
+	if (!*central_handle || !*peripheral_handle)
+		return false;
+
+	link = new0(struct le_link, 1);
+	link->handle = *central_handle;
+	link->remote = peripheral;
+	link->remote_handle = *peripheral_handle;
+
+	remote_link = new0(struct le_link, 1);
+	remote_link->handle = *peripheral_handle;
+	remote_link->remote = central;
+	remote_link->remote_handle = *central_handle;
+
+	queue_push_tail(central->le_links, link);
+	queue_push_tail(peripheral->le_links, remote_link);
+
+	if (!central->conn)
+		central->conn = peripheral;
+
+	if (!peripheral->conn)
+		peripheral->conn = central;
+
+	return true;
+}
+
+static void le_link_remove(struct btdev *btdev, struct le_link *link)
+{
+	struct btdev *remote = link->remote;
+	struct le_link *remote_link;
+
+	remote_link = le_link_find(remote, link->remote_handle);
+	if (remote_link) {
+		queue_remove(remote->le_links, remote_link);
+		free(remote_link);
+	}
+
+	queue_remove(btdev->le_links, link);
+	free(link);
+
+	/* Fall back to any other link for the single link commands */
+	if (btdev->conn == remote) {
+		link = queue_peek_head(btdev->le_links);
+		btdev->conn = link ? link->remote : NULL;
+	}
+
+	if (remote->conn == btdev) {
+		link = queue_peek_head(remote->le_links);
+		remote->conn = link ? link->remote : NULL;
+	}
+}
+
+/*
+ * Remote end of the link with the given handle and the handle it has
+ * there.  Other than LE links, there only ever is the one conn link.
+ */
+static struct btdev *link_remote(struct btdev *btdev, uint16_t handle,
+						uint16_t *remote_handle)
+{
+	struct le_link *link = le_link_find(btdev, handle);
+
+	if (link) {
+		*remote_handle = link->remote_handle;
+		return link->remote;
+	}
+
+	*remote_handle = handle;
+
+	/* Unknown handles must not end up on one of the LE links */
+	if (queue_find(btdev->le_links, match_le_link_remote, btdev->conn))
+		return NULL;
+
+	return btdev->conn;
+}
+
 static void num_completed_packets(struct btdev *btdev, uint16_t handle)
 {
 	if (btdev->conn) {
@@ -960,6 +1298,287 @@ static void num_completed_packets(struct btdev *btdev, uint16_t handle)
 	}
 }
 
+static void send_acl(struct btdev *conn, uint16_t handle, const void *data,
+								uint16_t len)
+{
+	struct bt_hci_acl_hdr hdr;
+	struct iovec iov[3];
+	uint8_t flags;
+
+	/* Packet type */
+	iov[0].iov_base = (void *) data;
+	iov[0].iov_len = 1;
+
+	/* ACL_START_NO_FLUSH is only allowed from host to controller.
+	 * From controller to host this should be converted to ACL_START.
+	 */
+	memcpy(&hdr, data + 1, sizeof(hdr));
+	flags = acl_flags(le16_to_cpu(hdr.handle));
+	if (flags == ACL_START_NO_FLUSH)
+		flags = ACL_START;
+
+	/* The link is known by another handle on the receiving end */
+	hdr.handle = cpu_to_le16(acl_handle_pack(handle, flags));
+
+	iov[1].iov_base = &hdr;
+	iov[1].iov_len = sizeof(hdr);
+
+	iov[2].iov_base = (void *) (data + 1 + sizeof(hdr));
+	iov[2].iov_len = len - 1 - sizeof(hdr);
+
+	send_packet(conn, iov, 3);
+}
+
+/*
+ * With a link timing model set, ACL packets from the host are held back
+ * and only forwarded to the remote once all of their LL PDUs have been
+ * exchanged in the connection events of the emulated link.
+ */
+struct link_packet {
+	uint16_t len;
+	uint16_t remaining;
+	uint8_t data[0];
+};
+
+static uint64_t link_get_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool link_lost(struct btdev *btdev)
+{
+	if (!btdev->link.loss)
+		return false;
+
+	btdev->link_seed = btdev->link_seed * 1103515245 + 12345;
+
+	return (btdev->link_seed >> 16) % 100 < btdev->link.loss;
+}
+
+static bool link_event(void *user_data);
+
+static void link_schedule(struct btdev *btdev)
+{
+	uint64_t interval = btdev->link.interval * 1250;
+	uint64_t now, next;
+
+	/* Connection events happen on a fixed grid from the anchor */
+	now = link_get_usec();
+	next = btdev->link_anchor +
+			((now - btdev->link_anchor) / interval + 1) * interval;
+
+	btdev->link_id = timeout_add((next - now + 999) / 1000, link_event,
+								btdev, NULL);
+}
+
+static uint16_t acl_pkt_handle(const void *data)
+{
+	const struct bt_hci_acl_hdr *hdr = data + 1;
+
+	return acl_handle(le16_to_cpu(hdr->handle));
+}
+
+static void link_complete(struct btdev *btdev, struct link_packet *pkt)
+{
+	uint16_t handle = acl_pkt_handle(pkt->data);
+	uint16_t remote_handle;
+	struct btdev *remote;
+
+	remote = link_remote(btdev, handle, &remote_handle);
+	if (remote)
+		send_acl(remote, remote_handle, pkt->data, pkt->len);
+
+	num_completed_packets(btdev, handle);
+
+	free(pkt);
+}
+
+static bool link_event(void *user_data)
+{
+	struct btdev *btdev = user_data;
+	const struct bt_phy_link *link = &btdev->link;
+	uint32_t budget = link->interval * 1250;
+	uint32_t used = 0;
+	unsigned int pdus = 0;
+	unsigned int pending;
+
+	btdev->link_id = 0;
+
+	/*
+	 * Packets the host sends in response to completions of this event
+	 * can only make it into the next one.
+	 */
+	pending = queue_length(btdev->link_queue);
+
+	while (pending) {
+		struct link_packet *pkt = queue_peek_head(btdev->link_queue);
+		uint16_t octets;
+		uint32_t time;
+
+		/* Completions may have ended the connection */
+		if (!pkt)
+			break;
+
+		octets = pkt->remaining;
+		if (octets > link->tx_octets)
+			octets = link->tx_octets;
+
+		time = bt_phy_exchange_time(link->phy, octets);
+
+		/* At least one PDU is exchanged in every event */
+		if (pdus && used + time > budget)
+			break;
+
+		if (link->max_pdus && pdus == link->max_pdus)
+			break;
+
+		used += time;
+		pdus++;
+
+		/* A lost PDU takes its slot and is retransmitted */
+		if (link_lost(btdev))
+			continue;
+
+		pkt->remaining -= octets;
+		if (pkt->remaining)
+			continue;
+
+		queue_pop_head(btdev->link_queue);
+		pending--;
+
+		link_complete(btdev, pkt);
+	}
+
+	if (!btdev->link_id && !queue_isempty(btdev->link_queue))
+		link_schedule(btdev);
+
+	return false;
+}
+
+static void link_send_acl(struct btdev *btdev, const void *data, uint16_t len)
+{
+	struct link_packet *pkt;
+
+	if (len < 1 + sizeof(struct bt_hci_acl_hdr))
+		return;
+
+	pkt = malloc(sizeof(*pkt) + len);
+	if (!pkt)
+		return;
+
+	pkt->len = len;
+	pkt->remaining = len - 1 - sizeof(struct bt_hci_acl_hdr);
+	memcpy(pkt->data, data, len);
+
+	queue_push_tail(btdev->link_queue, pkt);
+
+	if (!btdev->link_id)
+		link_schedule(btdev);
+}
+
+static bool match_link_packet_handle(const void *data, const void *match_data)
+{
+	const struct link_packet *pkt = data;
+
+	return acl_pkt_handle(pkt->data) == PTR_TO_UINT(match_data);
+}
+
+static void link_flush(struct btdev *btdev, uint16_t handle)
+{
+	queue_remove_all(btdev->link_queue, match_link_packet_handle,
+						UINT_TO_PTR(handle), free);
+
+	if (btdev->link_id && queue_isempty(btdev->link_queue)) {
+		timeout_remove(btdev->link_id);
+		btdev->link_id = 0;
+	}
+}
+
+/* ACL buffers needed by the host to keep a whole event busy */
+static uint8_t link_acl_pkts(const struct bt_phy_link *link, uint16_t mtu)
+{
+	uint32_t pdus, pkts;
+
+	pdus = link->interval * 1250 /
+			bt_phy_exchange_time(link->phy, link->tx_octets);
+	if (link->max_pdus && pdus > link->max_pdus)
+		pdus = link->max_pdus;
+	if (!pdus)
+		pdus = 1;
+
+	pkts = (pdus * link->tx_octets + mtu - 1) / mtu;
+
+	/* LE Read Buffer Size only has room for 8 bits */
+	if (pkts > UINT8_MAX)
+		pkts = UINT8_MAX;
+
+	return pkts;
+}
+
+void btdev_set_link(struct btdev *btdev, const struct bt_phy_link *link)
+{
+	struct link_packet *pkt;
+
+	if (!btdev)
+		return;
+
+	if (!link || !link->interval) {
+		if (btdev->link_id) {
+			timeout_remove(btdev->link_id);
+			btdev->link_id = 0;
+		}
+
+		/* Deliver whatever is still pending right away */
+		while ((pkt = queue_pop_head(btdev->link_queue)))
+			link_complete(btdev, pkt);
+
+		memset(&btdev->link, 0, sizeof(btdev->link));
+		btdev->acl_max_pkt = 1;
+		return;
+	}
+
+	btdev->link = *link;
+
+	if (btdev->link.tx_octets < 27)
+		btdev->link.tx_octets = 27;
+	else if (btdev->link.tx_octets > 251)
+		btdev->link.tx_octets = 251;
+
+	if (btdev->link.loss > 100)
+		btdev->link.loss = 100;
+
+	/*
+	 * With a single buffer the host could only hand over one packet per
+	 * event.  The host reads the buffer size once on init, so this only
+	 * applies to a link model set before that.
+	 */
+	if (!btdev->link.acl_pkts)
+		btdev->link.acl_pkts = link_acl_pkts(&btdev->link,
+							btdev->acl_mtu);
+
+	btdev->acl_max_pkt = btdev->link.acl_pkts;
+
+	btdev->link_anchor = link_get_usec();
+	btdev->link_seed = btdev->index + 1;
+
+	if (btdev->link_id) {
+		timeout_remove(btdev->link_id);
+		link_schedule(btdev);
+	}
+}
+
+void btdev_set_default_link(const struct bt_phy_link *link)
+{
+	if (link)
+		default_link = *link;
+	else
+		memset(&default_link, 0, sizeof(default_link));
+}
+
 static bool inquiry_callback(void *user_data)
 {
 	struct inquiry_data *data = user_data;
@@ -969,10 +1588,10 @@ static bool inquiry_callback(void *user_data)
 	int i;
 
 	/*Report devices only once and wait for inquiry timeout*/
-	if (data->iter == MAX_BTDEV_ENTRIES)
+	if (data->iter >= btdev_list_len)
 		return true;
 
-	for (i = data->iter; i < MAX_BTDEV_ENTRIES; i++) {
+	for (i = data->iter; i < btdev_list_len; i++) {
 		/*Lets sent 10 inquiry results at once */
 		if (sent + 10 == data->sent_count)
 			break;
@@ -1244,13 +1863,18 @@ static void le_conn_complete(struct btdev *btdev,
 
 	if (!status) {
 		struct btdev *remote;
+		uint16_t handle, remote_handle;
 
 		remote = find_btdev_by_bdaddr_type(lecc->peer_addr,
 							lecc->peer_addr_type);
 
-		btdev->conn = remote;
+		if (!le_link_add(btdev, remote, &handle, &remote_handle)) {
+			le_conn_complete(btdev, lecc,
+					BT_HCI_ERR_MEM_CAPACITY_EXCEEDED);
+			return;
+		}
+
 		btdev->le_adv_enable = 0;
-		remote->conn = btdev;
 		remote->le_adv_enable = 0;
 
 		cc->status = status;
@@ -1261,12 +1885,14 @@ static void le_conn_complete(struct btdev *btdev,
 			memcpy(cc->peer_addr, btdev->bdaddr, 6);
 
 		cc->role = 0x01;
-		cc->handle = cpu_to_le16(ACL_HANDLE);
+		cc->handle = cpu_to_le16(remote_handle);
 		cc->interval = lecc->max_interval;
 		cc->latency = lecc->latency;
 		cc->supv_timeout = lecc->supv_timeout;
 
 		send_event(remote, BT_HCI_EVT_LE_META_EVENT, buf, sizeof(buf));
+
+		cc->handle = cpu_to_le16(handle);
 	}
 
 	cc->status = status;
@@ -1291,13 +1917,18 @@ static void le_ext_conn_complete(struct btdev *btdev,
 
 	if (!status) {
 		struct btdev *remote;
+		uint16_t handle, remote_handle;
 
 		remote = find_btdev_by_bdaddr_type(leecc->peer_addr,
 							leecc->peer_addr_type);
 
-		btdev->conn = remote;
+		if (!le_link_add(btdev, remote, &handle, &remote_handle)) {
+			le_ext_conn_complete(btdev, leecc,
+					BT_HCI_ERR_MEM_CAPACITY_EXCEEDED);
+			return;
+		}
+
 		btdev->le_adv_enable = 0;
-		remote->conn = btdev;
 		remote->le_adv_enable = 0;
 
 		cc->status = status;
@@ -1308,12 +1939,14 @@ static void le_ext_conn_complete(struct btdev *btdev,
 			memcpy(cc->peer_addr, btdev->bdaddr, 6);
 
 		cc->role = 0x01;
-		cc->handle = cpu_to_le16(ACL_HANDLE);
+		cc->handle = cpu_to_le16(remote_handle);
 		cc->interval = lecc->max_interval;
 		cc->latency = lecc->latency;
 		cc->supv_timeout = lecc->supv_timeout;
 
 		send_event(remote, BT_HCI_EVT_LE_META_EVENT, buf, sizeof(buf));
+
+		cc->handle = cpu_to_le16(handle);
 	}
 
 	cc->status = status;
@@ -1489,7 +2122,8 @@ static void conn_request(struct btdev *btdev, const uint8_t *bdaddr)
 static void rej_le_conn_update(struct btdev *btdev, uint16_t handle,
 								uint8_t reason)
 {
-	struct btdev *remote = btdev->conn;
+	uint16_t remote_handle;
+	struct btdev *remote = link_remote(btdev, handle, &remote_handle);
 	struct __packed {
 		uint8_t subevent;
 		struct bt_hci_evt_le_conn_update_complete ev;
@@ -1499,7 +2133,7 @@ static void rej_le_conn_update(struct btdev *btdev, uint16_t handle,
 		return;
 
 	ev.subevent = BT_HCI_EVT_LE_CONN_UPDATE_COMPLETE;
-	ev.ev.handle = cpu_to_le16(handle);
+	ev.ev.handle = cpu_to_le16(remote_handle);
 	ev.ev.status = cpu_to_le16(reason);
 
 	send_event(remote, BT_HCI_EVT_LE_META_EVENT, &ev, sizeof(ev));
@@ -1510,7 +2144,8 @@ static void le_conn_update(struct btdev *btdev, uint16_t handle,
 				uint16_t latency, uint16_t supv_timeout,
 				uint16_t min_length, uint16_t max_length)
 {
-	struct btdev *remote = btdev->conn;
+	uint16_t remote_handle;
+	struct btdev *remote = link_remote(btdev, handle, &remote_handle);
 	struct __packed {
 		uint8_t subevent;
 		struct bt_hci_evt_le_conn_update_complete ev;
@@ -1529,8 +2164,10 @@ static void le_conn_update(struct btdev *btdev, uint16_t handle,
 
 	send_event(btdev, BT_HCI_EVT_LE_META_EVENT, &ev, sizeof(ev));
 
-	if (remote)
+	if (remote) {
+		ev.ev.handle = cpu_to_le16(remote_handle);
 		send_event(remote, BT_HCI_EVT_LE_META_EVENT, &ev, sizeof(ev));
+	}
 }
 
 static void le_conn_param_req(struct btdev *btdev, uint16_t handle,
@@ -1538,7 +2175,8 @@ static void le_conn_param_req(struct btdev *btdev, uint16_t handle,
 				uint16_t latency, uint16_t supv_timeout,
 				uint16_t min_length, uint16_t max_length)
 {
-	struct btdev *remote = btdev->conn;
+	uint16_t remote_handle;
+	struct btdev *remote = link_remote(btdev, handle, &remote_handle);
 	struct __packed {
 		uint8_t subevent;
 		struct bt_hci_evt_le_conn_param_request ev;
@@ -1548,7 +2186,7 @@ static void le_conn_param_req(struct btdev *btdev, uint16_t handle,
 		return;
 
 	ev.subevent = BT_HCI_EVT_LE_CONN_PARAM_REQUEST;
-	ev.ev.handle = cpu_to_le16(handle);
+	ev.ev.handle = cpu_to_le16(remote_handle);
 	ev.ev.min_interval = cpu_to_le16(min_interval);
 	ev.ev.max_interval = cpu_to_le16(max_interval);
 	ev.ev.latency = cpu_to_le16(latency);
@@ -1562,6 +2200,30 @@ static void disconnect_complete(struct btdev *btdev, uint16_t handle,
 {
 	struct bt_hci_evt_disconnect_complete dc;
 	struct btdev *remote = btdev->conn;
+	struct le_link *link = le_link_find(btdev, handle);
+
+	if (link) {
+		uint16_t remote_handle = link->remote_handle;
+
+		remote = link->remote;
+
+		link_flush(btdev, handle);
+		link_flush(remote, remote_handle);
+		le_link_remove(btdev, link);
+
+		dc.status = BT_HCI_ERR_SUCCESS;
+		dc.handle = cpu_to_le16(handle);
+		dc.reason = reason;
+
+		send_event(btdev, BT_HCI_EVT_DISCONNECT_COMPLETE,
+							&dc, sizeof(dc));
+
+		dc.handle = cpu_to_le16(remote_handle);
+
+		send_event(remote, BT_HCI_EVT_DISCONNECT_COMPLETE,
+							&dc, sizeof(dc));
+		return;
+	}
 
 	if (!remote) {
 		dc.status = BT_HCI_ERR_UNKNOWN_CONN_ID;
@@ -1578,6 +2240,9 @@ static void disconnect_complete(struct btdev *btdev, uint16_t handle,
 	dc.reason = reason;
 
 	if (dc.handle == ACL_HANDLE) {
+		link_flush(btdev, ACL_HANDLE);
+		link_flush(remote, ACL_HANDLE);
+
 		btdev->conn = NULL;
 		remote->conn = NULL;
 	}
@@ -2063,8 +2728,10 @@ static void ssp_complete(struct btdev *btdev, const uint8_t *bdaddr,
 	send_event(init, BT_HCI_EVT_AUTH_COMPLETE, &auth, sizeof(auth));
 }
 
-static void le_send_adv_report(struct btdev *btdev, const struct btdev *remote,
-								uint8_t type)
+static void send_adv_report(struct btdev *btdev, uint8_t type,
+					uint8_t addr_type, const uint8_t *addr,
+					const uint8_t *data, uint8_t data_len,
+					int8_t rssi)
 {
 	struct __packed {
 		uint8_t subevent;
@@ -2074,28 +2741,36 @@ static void le_send_adv_report(struct btdev *btdev, const struct btdev *remote,
 		};
 	} meta_event;
 
+	if (data_len > 31)
+		data_len = 31;
+
 	meta_event.subevent = BT_HCI_EVT_LE_ADV_REPORT;
 
 	memset(&meta_event.lar, 0, sizeof(meta_event.lar));
 	meta_event.lar.num_reports = 1;
 	meta_event.lar.event_type = type;
-	meta_event.lar.addr_type = remote->le_adv_own_addr;
-	memcpy(meta_event.lar.addr, adv_addr(remote), 6);
+	meta_event.lar.addr_type = addr_type;
+	memcpy(meta_event.lar.addr, addr, 6);
+	meta_event.lar.data_len = data_len;
+	memcpy(meta_event.lar.data, data, data_len);
+	meta_event.raw[10 + data_len] = rssi;
 
-	/* Scan or advertising response */
-	if (type == 0x04) {
-		meta_event.lar.data_len = remote->le_scan_data_len;
-		memcpy(meta_event.lar.data, remote->le_scan_data,
-						meta_event.lar.data_len);
-	} else {
-		meta_event.lar.data_len = remote->le_adv_data_len;
-		memcpy(meta_event.lar.data, remote->le_adv_data,
-						meta_event.lar.data_len);
-	}
-	/* Not available */
-	meta_event.raw[10 + meta_event.lar.data_len] = 127;
 	send_event(btdev, BT_HCI_EVT_LE_META_EVENT, &meta_event,
-					1 + 10 + meta_event.lar.data_len + 1);
+						1 + 10 + data_len + 1);
+}
+
+static void le_send_adv_report(struct btdev *btdev, const struct btdev *remote,
+								uint8_t type)
+{
+	/* Scan or advertising response */
+	if (type == 0x04)
+		send_adv_report(btdev, type, remote->le_adv_own_addr,
+					adv_addr(remote), remote->le_scan_data,
+					remote->le_scan_data_len, 127);
+	else
+		send_adv_report(btdev, type, remote->le_adv_own_addr,
+					adv_addr(remote), remote->le_adv_data,
+					remote->le_adv_data_len, 127);
 }
 
 static void send_ext_adv(struct btdev *btdev, const struct btdev *remote,
@@ -2176,7 +2851,7 @@ static void le_set_adv_enable_complete(struct btdev *btdev)
 
 	report_type = get_adv_report_type(btdev->le_adv_type);
 
-	for (i = 0; i < MAX_BTDEV_ENTRIES; i++) {
+	for (i = 0; i < btdev_list_len; i++) {
 		if (!btdev_list[i] || btdev_list[i] == btdev)
 			continue;
 
@@ -2204,7 +2879,7 @@ static void le_set_ext_adv_enable_complete(struct btdev *btdev)
 
 	report_type = get_ext_adv_type(btdev->le_ext_adv_type);
 
-	for (i = 0; i < MAX_BTDEV_ENTRIES; i++) {
+	for (i = 0; i < btdev_list_len; i++) {
 		if (!btdev_list[i] || btdev_list[i] == btdev)
 			continue;
 
@@ -2241,7 +2916,7 @@ static void le_set_scan_enable_complete(struct btdev *btdev)
 {
 	int i;
 
-	for (i = 0; i < MAX_BTDEV_ENTRIES; i++) {
+	for (i = 0; i < btdev_list_len; i++) {
 		uint8_t report_type;
 
 		if (!btdev_list[i] || btdev_list[i] == btdev)
@@ -2270,7 +2945,7 @@ static void le_set_ext_scan_enable_complete(struct btdev *btdev)
 {
 	int i;
 
-	for (i = 0; i < MAX_BTDEV_ENTRIES; i++) {
+	for (i = 0; i < btdev_list_len; i++) {
 		uint16_t report_type;
 
 		if (!btdev_list[i] || btdev_list[i] == btdev)
@@ -2304,11 +2979,13 @@ static void le_set_ext_scan_enable_complete(struct btdev *btdev)
 	}
 }
 
-static void le_read_remote_features_complete(struct btdev *btdev)
+static void le_read_remote_features_complete(struct btdev *btdev,
+							uint16_t handle)
 {
 	char buf[1 + sizeof(struct bt_hci_evt_le_remote_features_complete)];
 	struct bt_hci_evt_le_remote_features_complete *ev = (void *) &buf[1];
-	struct btdev *remote = btdev->conn;
+	uint16_t remote_handle;
+	struct btdev *remote = link_remote(btdev, handle, &remote_handle);
 
 	if (!remote) {
 		cmd_status(btdev, BT_HCI_ERR_UNKNOWN_CONN_ID,
@@ -2322,18 +2999,19 @@ static void le_read_remote_features_complete(struct btdev *btdev)
 	memset(buf, 0, sizeof(buf));
 	buf[0] = BT_HCI_EVT_LE_REMOTE_FEATURES_COMPLETE;
 	ev->status = BT_HCI_ERR_SUCCESS;
-	ev->handle = cpu_to_le16(ACL_HANDLE);
+	ev->handle = cpu_to_le16(handle);
 	memcpy(ev->features, remote->le_features, 8);
 
 	send_event(btdev, BT_HCI_EVT_LE_META_EVENT, buf, sizeof(buf));
 }
 
-static void le_start_encrypt_complete(struct btdev *btdev, uint16_t ediv,
-								uint64_t rand)
+static void le_start_encrypt_complete(struct btdev *btdev, uint16_t handle,
+						uint16_t ediv, uint64_t rand)
 {
 	char buf[1 + sizeof(struct bt_hci_evt_le_long_term_key_request)];
 	struct bt_hci_evt_le_long_term_key_request *ev = (void *) &buf[1];
-	struct btdev *remote = btdev->conn;
+	uint16_t remote_handle;
+	struct btdev *remote = link_remote(btdev, handle, &remote_handle);
 
 	if (!remote) {
 		cmd_status(btdev, BT_HCI_ERR_UNKNOWN_CONN_ID,
@@ -2345,21 +3023,22 @@ static void le_start_encrypt_complete(struct btdev *btdev, uint16_t ediv,
 
 	memset(buf, 0, sizeof(buf));
 	buf[0] = BT_HCI_EVT_LE_LONG_TERM_KEY_REQUEST;
-	ev->handle = cpu_to_le16(ACL_HANDLE);
+	ev->handle = cpu_to_le16(remote_handle);
 	ev->ediv = ediv;
 	ev->rand = rand;
 
 	send_event(remote, BT_HCI_EVT_LE_META_EVENT, buf, sizeof(buf));
 }
 
-static void le_encrypt_complete(struct btdev *btdev)
+static void le_encrypt_complete(struct btdev *btdev, uint16_t handle)
 {
 	struct bt_hci_evt_encrypt_change ev;
 	struct bt_hci_rsp_le_ltk_req_reply rp;
-	struct btdev *remote = btdev->conn;
+	uint16_t remote_handle;
+	struct btdev *remote = link_remote(btdev, handle, &remote_handle);
 
 	memset(&rp, 0, sizeof(rp));
-	rp.handle = cpu_to_le16(ACL_HANDLE);
+	rp.handle = cpu_to_le16(handle);
 
 	if (!remote) {
 		rp.status = BT_HCI_ERR_UNKNOWN_CONN_ID;
@@ -2381,20 +3060,22 @@ static void le_encrypt_complete(struct btdev *btdev)
 		ev.encr_mode = 0x01;
 	}
 
-	ev.handle = cpu_to_le16(ACL_HANDLE);
-
+	ev.handle = cpu_to_le16(handle);
 	send_event(btdev, BT_HCI_EVT_ENCRYPT_CHANGE, &ev, sizeof(ev));
+
+	ev.handle = cpu_to_le16(remote_handle);
 	send_event(remote, BT_HCI_EVT_ENCRYPT_CHANGE, &ev, sizeof(ev));
 }
 
-static void ltk_neg_reply_complete(struct btdev *btdev)
+static void ltk_neg_reply_complete(struct btdev *btdev, uint16_t handle)
 {
 	struct bt_hci_rsp_le_ltk_req_neg_reply rp;
 	struct bt_hci_evt_encrypt_change ev;
-	struct btdev *remote = btdev->conn;
+	uint16_t remote_handle;
+	struct btdev *remote = link_remote(btdev, handle, &remote_handle);
 
 	memset(&rp, 0, sizeof(rp));
-	rp.handle = cpu_to_le16(ACL_HANDLE);
+	rp.handle = cpu_to_le16(handle);
 
 	if (!remote) {
 		rp.status = BT_HCI_ERR_UNKNOWN_CONN_ID;
@@ -2408,7 +3089,7 @@ static void ltk_neg_reply_complete(struct btdev *btdev)
 
 	memset(&ev, 0, sizeof(ev));
 	ev.status = BT_HCI_ERR_PIN_OR_KEY_MISSING;
-	ev.handle = cpu_to_le16(ACL_HANDLE);
+	ev.handle = cpu_to_le16(remote_handle);
 
 	send_event(remote, BT_HCI_EVT_ENCRYPT_CHANGE, &ev, sizeof(ev));
 }
@@ -2498,6 +3179,8 @@ static void default_cmd(struct btdev *btdev, uint16_t opcode,
 	const struct bt_hci_cmd_le_set_scan_enable *lsse;
 	const struct bt_hci_cmd_le_start_encrypt *lse;
 	const struct bt_hci_cmd_le_ltk_req_reply *llrr;
+	const struct bt_hci_cmd_le_ltk_req_neg_reply *llrnr;
+	const struct bt_hci_cmd_le_read_remote_features *lrrf;
 	const struct bt_hci_cmd_le_encrypt *lenc_cmd;
 	const struct bt_hci_cmd_le_generate_dhkey *dh;
 	const struct bt_hci_cmd_le_conn_param_req_reply *lcprr_cmd;
@@ -3410,7 +4093,7 @@ static void default_cmd(struct btdev *btdev, uint16_t opcode,
 		if (btdev->type == BTDEV_TYPE_BREDR)
 			goto unsupported;
 		lsra = data;
-		memcpy(btdev->random_addr, lsra->addr, 6);
+		set_random_addr(btdev, lsra->addr);
 		status = BT_HCI_ERR_SUCCESS;
 		cmd_complete(btdev, opcode, &status, sizeof(status));
 		break;
@@ -3606,7 +4289,9 @@ static void default_cmd(struct btdev *btdev, uint16_t opcode,
 	case BT_HCI_CMD_LE_READ_REMOTE_FEATURES:
 		if (btdev->type == BTDEV_TYPE_BREDR)
 			goto unsupported;
-		le_read_remote_features_complete(btdev);
+		lrrf = data;
+		le_read_remote_features_complete(btdev,
+						le16_to_cpu(lrrf->handle));
 		break;
 
 	case BT_HCI_CMD_LE_START_ENCRYPT:
@@ -3614,7 +4299,8 @@ static void default_cmd(struct btdev *btdev, uint16_t opcode,
 			goto unsupported;
 		lse = data;
 		memcpy(btdev->le_ltk, lse->ltk, 16);
-		le_start_encrypt_complete(btdev, lse->ediv, lse->rand);
+		le_start_encrypt_complete(btdev, le16_to_cpu(lse->handle),
+							lse->ediv, lse->rand);
 		break;
 
 	case BT_HCI_CMD_LE_LTK_REQ_REPLY:
@@ -3622,13 +4308,14 @@ static void default_cmd(struct btdev *btdev, uint16_t opcode,
 			goto unsupported;
 		llrr = data;
 		memcpy(btdev->le_ltk, llrr->ltk, 16);
-		le_encrypt_complete(btdev);
+		le_encrypt_complete(btdev, le16_to_cpu(llrr->handle));
 		break;
 
 	case BT_HCI_CMD_LE_LTK_REQ_NEG_REPLY:
 		if (btdev->type == BTDEV_TYPE_BREDR)
 			goto unsupported;
-		ltk_neg_reply_complete(btdev);
+		llrnr = data;
+		ltk_neg_reply_complete(btdev, le16_to_cpu(llrnr->handle));
 		break;
 
 	case BT_HCI_CMD_SETUP_SYNC_CONN:
@@ -3715,7 +4402,7 @@ static void default_cmd(struct btdev *btdev, uint16_t opcode,
 			goto unsupported;
 
 		lsasra = data;
-		memcpy(btdev->random_addr, lsasra->bdaddr, 6);
+		set_random_addr(btdev, lsasra->bdaddr);
 		status = BT_HCI_ERR_SUCCESS;
 		cmd_complete(btdev, opcode, &status, sizeof(status));
 		break;
@@ -4289,31 +4976,6 @@ static void process_cmd(struct btdev *btdev, const void *data, uint16_t len)
 	}
 }
 
-static void send_acl(struct btdev *conn, const void *data, uint16_t len)
-{
-	struct bt_hci_acl_hdr hdr;
-	struct iovec iov[3];
-
-	/* Packet type */
-	iov[0].iov_base = (void *) data;
-	iov[0].iov_len = 1;
-
-	/* ACL_START_NO_FLUSH is only allowed from host to controller.
-	 * From controller to host this should be converted to ACL_START.
-	 */
-	memcpy(&hdr, data + 1, sizeof(hdr));
-	if (acl_flags(hdr.handle) == ACL_START_NO_FLUSH)
-		hdr.handle = acl_handle_pack(acl_handle(hdr.handle), ACL_START);
-
-	iov[1].iov_base = &hdr;
-	iov[1].iov_len = sizeof(hdr);
-
-	iov[2].iov_base = (void *) (data + 1 + sizeof(hdr));
-	iov[2].iov_len = len - 1 - sizeof(hdr);
-
-	send_packet(conn, iov, 3);
-}
-
 static void send_iso(struct btdev *conn, const void *data, uint16_t len)
 {
 	struct iovec iov;
@@ -4326,6 +4988,8 @@ static void send_iso(struct btdev *conn, const void *data, uint16_t len)
 
 void btdev_receive_h4(struct btdev *btdev, const void *data, uint16_t len)
 {
+	struct btdev *remote;
+	uint16_t handle, remote_handle;
 	uint8_t pkt_type;
 
 	if (!btdev)
@@ -4341,9 +5005,20 @@ void btdev_receive_h4(struct btdev *btdev, const void *data, uint16_t len)
 		process_cmd(btdev, data + 1, len - 1);
 		break;
 	case BT_H4_ACL_PKT:
-		if (btdev->conn)
-			send_acl(btdev->conn, data, len);
-		num_completed_packets(btdev, ACL_HANDLE);
+		if (len < 1 + sizeof(struct bt_hci_acl_hdr))
+			break;
+
+		handle = acl_pkt_handle(data);
+		remote = link_remote(btdev, handle, &remote_handle);
+
+		if (remote && btdev->link.interval) {
+			link_send_acl(btdev, data, len);
+			break;
+		}
+
+		if (remote)
+			send_acl(remote, remote_handle, data, len);
+		num_completed_packets(btdev, handle);
 		break;
 	case BT_H4_ISO_PKT:
 		num_completed_packets(btdev, ISO_HANDLE);
@@ -4409,3 +5084,20 @@ bool btdev_del_hook(struct btdev *btdev, enum btdev_hook_type type,
 
 	return false;
 }
+
+/*
+ * Report advertising from a peer that is not an emulated controller, for
+ * generating scan results at a rate and from an address space of choice.
+ */
+bool btdev_send_adv_report(struct btdev *btdev, uint8_t type,
+					uint8_t addr_type, const uint8_t *addr,
+					const uint8_t *data, uint8_t data_len,
+					int8_t rssi)
+{
+	if (!btdev->le_scan_enable)
+		return false;
+
+	send_adv_report(btdev, type, addr_type, addr, data, data_len, rssi);
+
+	return true;
+}
@@ -75,6 +75,7 @@ enum btdev_hook_type {
 };
 
 struct btdev;
+struct bt_phy_link;
 
 struct btdev *btdev_create(enum btdev_type type, uint16_t id);
 void btdev_destroy(struct btdev *btdev);
@@ -88,6 +89,9 @@ uint8_t btdev_get_le_scan_enable(struct btdev *btdev);
 
 void btdev_set_le_states(struct btdev *btdev, const uint8_t *le_states);
 
+void btdev_set_link(struct btdev *btdev, const struct bt_phy_link *link);
+void btdev_set_default_link(const struct bt_phy_link *link);
+
 void btdev_set_command_handler(struct btdev *btdev, btdev_command_func handler,
 							void *user_data);
 
@@ -101,3 +105,8 @@ int btdev_add_hook(struct btdev *btdev, enum btdev_hook_type type,
 
 bool btdev_del_hook(struct btdev *btdev, enum btdev_hook_type type,
 							uint16_t opcode);
+
+bool btdev_send_adv_report(struct btdev *btdev, uint8_t type,
+					uint8_t addr_type, const uint8_t *addr,
+					const uint8_t *data, uint8_t data_len,
+					int8_t rssi);
@@ -213,6 +213,8 @@ struct bthost {
 	void *cmd_complete_data;
 	bthost_new_conn_cb new_conn_cb;
 	void *new_conn_data;
+	bthost_disconn_cb disconn_cb;
+	void *disconn_data;
 	struct rfcomm_connection_data *rfcomm_conn_data;
 	struct l2cap_conn_cb_data *new_l2cap_conn_data;
 	struct rfcomm_conn_cb_data *new_rfcomm_conn_data;
@@ -841,6 +843,8 @@ static void evt_cmd_complete(struct bthost *bthost, const void *data,
 		break;
 	case BT_HCI_CMD_LE_SET_ADV_DATA:
 		break;
+	case BT_HCI_CMD_LE_SET_SCAN_RSP_DATA:
+		break;
 	case BT_HCI_CMD_LE_SET_EXT_ADV_PARAMS:
 		break;
 	case BT_HCI_CMD_LE_SET_EXT_ADV_DATA:
@@ -975,6 +979,9 @@ static void evt_disconn_complete(struct bthost *bthost, const void *data,
 			curr = &conn->next;
 		}
 	}
+
+	if (bthost->disconn_cb)
+		bthost->disconn_cb(handle, bthost->disconn_data);
 }
 
 static void evt_num_completed_packets(struct bthost *bthost, const void *data,
@@ -2351,6 +2358,13 @@ void bthost_set_connect_cb(struct bthost *bthost, bthost_new_conn_cb cb,
 	bthost->new_conn_data = user_data;
 }
 
+void bthost_set_disconnect_cb(struct bthost *bthost, bthost_disconn_cb cb,
+							void *user_data)
+{
+	bthost->disconn_cb = cb;
+	bthost->disconn_data = user_data;
+}
+
 void bthost_hci_connect(struct bthost *bthost, const uint8_t *bdaddr,
 							uint8_t addr_type)
 {
@@ -2447,6 +2461,21 @@ void bthost_set_adv_data(struct bthost *bthost, const uint8_t *data,
 							sizeof(adv_cp));
 }
 
+void bthost_set_scan_rsp_data(struct bthost *bthost, const uint8_t *data,
+								uint8_t len)
+{
+	struct bt_hci_cmd_le_set_scan_rsp_data rsp_cp;
+
+	memset(rsp_cp.data, 0, 31);
+
+	rsp_cp.len = len;
+	if (len)
+		memcpy(rsp_cp.data, data, len);
+
+	send_command(bthost, BT_HCI_CMD_LE_SET_SCAN_RSP_DATA, &rsp_cp,
+							sizeof(rsp_cp));
+}
+
 void bthost_set_ext_adv_data(struct bthost *bthost, const uint8_t *data,
 								uint8_t len)
 {
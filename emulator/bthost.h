@@ -53,6 +53,11 @@ typedef void (*bthost_new_conn_cb) (uint16_t handle, void *user_data);
 void bthost_set_connect_cb(struct bthost *bthost, bthost_new_conn_cb cb,
 							void *user_data);
 
+typedef void (*bthost_disconn_cb) (uint16_t handle, void *user_data);
+
+void bthost_set_disconnect_cb(struct bthost *bthost, bthost_disconn_cb cb,
+							void *user_data);
+
 void bthost_hci_connect(struct bthost *bthost, const uint8_t *bdaddr,
 							uint8_t addr_type);
 
@@ -85,6 +90,8 @@ void bthost_write_scan_enable(struct bthost *bthost, uint8_t scan);
 void bthost_set_adv_data(struct bthost *bthost, const uint8_t *data,
 								uint8_t len);
 void bthost_set_adv_enable(struct bthost *bthost, uint8_t enable);
+void bthost_set_scan_rsp_data(struct bthost *bthost, const uint8_t *data,
+								uint8_t len);
 
 void bthost_set_ext_adv_data(struct bthost *bthost, const uint8_t *data,
 								uint8_t len);
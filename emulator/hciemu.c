@@ -459,6 +459,15 @@ void hciemu_set_master_le_states(struct hciemu *hciemu, const uint8_t *le_states
 	btdev_set_le_states(hciemu->master_dev, le_states);
 }
 
+void hciemu_set_link(struct hciemu *hciemu, const struct bt_phy_link *link)
+{
+	if (!hciemu)
+		return;
+
+	btdev_set_link(hciemu->master_dev, link);
+	btdev_set_link(hciemu->client_dev, link);
+}
+
 bool hciemu_add_master_post_command_hook(struct hciemu *hciemu,
 			hciemu_command_func_t function, void *user_data)
 {
@@ -25,6 +25,7 @@
 #include <stdint.h>
 
 struct hciemu;
+struct bt_phy_link;
 
 enum hciemu_type {
 	HCIEMU_TYPE_BREDRLE,
@@ -62,6 +63,8 @@ uint8_t hciemu_get_master_le_scan_enable(struct hciemu *hciemu);
 void hciemu_set_master_le_states(struct hciemu *hciemu,
 						const uint8_t *le_states);
 
+void hciemu_set_link(struct hciemu *hciemu, const struct bt_phy_link *link);
+
 typedef void (*hciemu_command_func_t)(uint16_t opcode, const void *data,
 						uint8_t len, void *user_data);
 
@@ -28,15 +28,20 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <getopt.h>
+#include <sys/uio.h>
 
 #include "src/shared/mainloop.h"
+#include "phy.h"
+#include "btdev.h"
 #include "serial.h"
 #include "server.h"
 #include "vhci.h"
 #include "amp.h"
 #include "le.h"
+#include "population.h"
 
 static void signal_callback(int signum, void *user_data)
 {
@@ -62,9 +67,71 @@ static void usage(void)
 		"\t-B                    Create BR/EDR only controller\n"
 		"\t-A                    Create AMP controller\n"
 		"\t-T[num]               Number of test AMP controllers\n"
+		"\t-P[num]               Number of emulated LE peripherals\n"
+		"\t-p, --population <file>\n"
+		"\t                      Emulated LE peripherals script\n"
+		"\t-m, --link <params>   Connection timing model, e.g.\n"
+		"\t                      interval=24,octets=251,phy=2M,\n"
+		"\t                      loss=1,pdus=4,bufs=8\n"
 		"\t-h, --help            Show help options\n");
 }
 
+static bool parse_link(const char *arg, struct bt_phy_link *link)
+{
+	char *str, *tok, *ptr = NULL;
+	bool result = true;
+
+	memset(link, 0, sizeof(*link));
+	link->interval = 24;
+	link->tx_octets = 27;
+	link->phy = BT_PHY_LE_1M;
+
+	str = strdup(arg);
+	if (!str)
+		return false;
+
+	for (tok = strtok_r(str, ",", &ptr); tok;
+					tok = strtok_r(NULL, ",", &ptr)) {
+		char *value = strchr(tok, '=');
+
+		if (!value) {
+			result = false;
+			break;
+		}
+
+		*value++ = '\0';
+
+		if (!strcmp(tok, "interval"))
+			link->interval = atoi(value);
+		else if (!strcmp(tok, "octets"))
+			link->tx_octets = atoi(value);
+		else if (!strcmp(tok, "loss"))
+			link->loss = atoi(value);
+		else if (!strcmp(tok, "pdus"))
+			link->max_pdus = atoi(value);
+		else if (!strcmp(tok, "bufs"))
+			link->acl_pkts = atoi(value);
+		else if (!strcmp(tok, "phy") && !strcasecmp(value, "1M"))
+			link->phy = BT_PHY_LE_1M;
+		else if (!strcmp(tok, "phy") && !strcasecmp(value, "2M"))
+			link->phy = BT_PHY_LE_2M;
+		else if (!strcmp(tok, "phy") && !strcasecmp(value, "coded"))
+			link->phy = BT_PHY_LE_CODED;
+		else {
+			result = false;
+			break;
+		}
+	}
+
+	free(str);
+
+	/* Connection interval range is 7.5 ms to 4 s */
+	if (link->interval < 0x0006 || link->interval > 0x0c80)
+		result = false;
+
+	return result;
+}
+
 static const struct option main_options[] = {
 	{ "serial",  no_argument,       NULL, 'S' },
 	{ "server",  no_argument,       NULL, 's' },
@@ -74,6 +141,9 @@ static const struct option main_options[] = {
 	{ "amp",     no_argument,       NULL, 'A' },
 	{ "letest",  optional_argument, NULL, 'U' },
 	{ "amptest", optional_argument, NULL, 'T' },
+	{ "peripherals", optional_argument, NULL, 'P' },
+	{ "population", required_argument, NULL, 'p' },
+	{ "link",    required_argument, NULL, 'm' },
 	{ "version", no_argument,	NULL, 'v' },
 	{ "help",    no_argument,	NULL, 'h' },
 	{ }
@@ -91,6 +161,9 @@ int main(int argc, char *argv[])
 	int letest_count = 0;
 	int amptest_count = 0;
 	int vhci_count = 0;
+	int peripheral_count = 0;
+	const char *population_script = NULL;
+	struct bt_phy_link link;
 	enum vhci_type vhci_type = VHCI_TYPE_BREDRLE;
 	int i;
 
@@ -99,7 +172,7 @@ int main(int argc, char *argv[])
 	for (;;) {
 		int opt;
 
-		opt = getopt_long(argc, argv, "Ssl::LBAU::T::vh",
+		opt = getopt_long(argc, argv, "Ssl::LBAU::T::P::p:m:vh",
 						main_options, NULL);
 		if (opt < 0)
 			break;
@@ -138,6 +211,23 @@ int main(int argc, char *argv[])
 			else
 				amptest_count = 1;
 			break;
+		case 'P':
+			if (optarg)
+				peripheral_count = atoi(optarg);
+			else
+				peripheral_count = 1;
+			break;
+		case 'p':
+			population_script = optarg;
+			break;
+		case 'm':
+			if (!parse_link(optarg, &link)) {
+				fprintf(stderr, "Invalid link parameters\n");
+				return EXIT_FAILURE;
+			}
+
+			btdev_set_default_link(&link);
+			break;
 		case 'v':
 			printf("%s\n", VERSION);
 			return EXIT_SUCCESS;
@@ -149,8 +239,9 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (letest_count < 1 && amptest_count < 1 &&
-			vhci_count < 1 && !server_enabled && !serial_enabled) {
+	if (letest_count < 1 && amptest_count < 1 && vhci_count < 1 &&
+			peripheral_count < 1 && !population_script &&
+			!server_enabled && !serial_enabled) {
 		fprintf(stderr, "No emulator specified\n");
 		return EXIT_FAILURE;
 	}
@@ -187,6 +278,20 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (peripheral_count > 0 || population_script) {
+		struct population *pop;
+
+		pop = population_new(population_script,
+					peripheral_count > 0 ? peripheral_count : 0);
+		if (!pop) {
+			fprintf(stderr, "Failed to create LE peripherals\n");
+			return EXIT_FAILURE;
+		}
+
+		printf("Emulating %u LE peripherals\n",
+						population_get_count(pop));
+	}
+
 	if (serial_enabled) {
 		struct serial *serial;
 
@@ -45,6 +45,52 @@ typedef void (*bt_phy_callback_func_t)(uint16_t type, const void *data,
 bool bt_phy_register(struct bt_phy *phy, bt_phy_callback_func_t callback,
 							void *user_data);
 
+#define BT_PHY_LE_1M		0x01
+#define BT_PHY_LE_2M		0x02
+#define BT_PHY_LE_CODED		0x03
+
+/* Inter frame space in microseconds */
+#define BT_PHY_T_IFS		150
+
+/*
+ * Timing model of a connection.  Data is only exchanged at connection
+ * events, each carrying as many PDUs of at most tx_octets as fit into
+ * the interval (or max_pdus if set), and every PDU is lost with the
+ * given probability and retransmitted in the next slot.  Unless set,
+ * the number of ACL buffers advertised to the host is sized so that
+ * a whole event can be filled.
+ */
+struct bt_phy_link {
+	uint16_t interval;		/* 1.25 ms units, 0 = disabled */
+	uint16_t tx_octets;		/* Maximum LL payload size */
+	uint8_t  phy;			/* BT_PHY_LE_* */
+	uint8_t  loss;			/* Percent of lost PDUs */
+	uint8_t  max_pdus;		/* PDUs per event, 0 = unlimited */
+	uint8_t  acl_pkts;		/* ACL buffers, 0 = fill an event */
+};
+
+/* Air time in microseconds of a data channel PDU with the given payload */
+static inline uint32_t bt_phy_air_time(uint8_t phy, uint16_t octets)
+{
+	switch (phy) {
+	case BT_PHY_LE_2M:
+		/* Preamble, access address, header, payload and CRC */
+		return (2 + 4 + 2 + octets + 3) * 4;
+	case BT_PHY_LE_CODED:
+		/* S=8: preamble, AA, CI and TERM1 plus coded PDU and TERM2 */
+		return 80 + 256 + 16 + 24 + (2 + octets + 3) * 64 + 24;
+	default:
+		return (1 + 4 + 2 + octets + 3) * 8;
+	}
+}
+
+/* Time taken by one PDU and the empty acknowledgment of the peer */
+static inline uint32_t bt_phy_exchange_time(uint8_t phy, uint16_t octets)
+{
+	return bt_phy_air_time(phy, octets) + BT_PHY_T_IFS +
+				bt_phy_air_time(phy, 0) + BT_PHY_T_IFS;
+}
+
 #define BT_PHY_PKT_NULL		0x0000
 
 #define BT_PHY_PKT_ADV		0x0001
@@ -0,0 +1,870 @@
+/*
+ *
+ *  BlueZ - Bluetooth protocol stack for Linux
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Population of emulated LE peripherals.
+ *
+ * Every peripheral is a btdev controller driven by its own bthost stack,
+ * advertising the configured AD payload and serving a GATT database over
+ * the fixed ATT channel.  Peripherals are described in a script with one
+ * directive per line:
+ *
+ *	peripheral <count>		start a new group of <count> devices
+ *	name <prefix>			device name, suffixed with "-<num>"
+ *	adv <hex>			advertising data
+ *	scan-rsp <hex>			scan response data
+ *	service <uuid>			add a primary service
+ *	characteristic <uuid> <props> [<hex>]
+ *					add a characteristic to the last
+ *					service, props is a comma separated
+ *					list of read, write, write-without-
+ *					response, notify and indicate
+ *
+ * Empty lines and lines starting with '#' are ignored.  Groups without an
+ * adv directive advertise flags and their complete local name.
+ *
+ * The btdev and bthost of a peripheral are wired directly to each other
+ * so that even thousands of peripherals only need a single file
+ * descriptor; only an active link needs a socket pair for its ATT bearer.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <errno.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+
+#include "lib/bluetooth.h"
+#include "lib/hci.h"
+#include "lib/uuid.h"
+
+#include "src/shared/util.h"
+#include "src/shared/queue.h"
+#include "src/shared/mainloop.h"
+#include "src/shared/att.h"
+#include "src/shared/gatt-db.h"
+#include "src/shared/gatt-server.h"
+#include "monitor/bt.h"
+#include "btdev.h"
+#include "bthost.h"
+#include "population.h"
+
+#define POPULATION_ID		0x50
+#define DEFAULT_NAME		"btvirt"
+#define MAX_NAME_LEN		20
+#define ATT_CID			0x0004
+
+struct chrc_template {
+	bt_uuid_t uuid;
+	uint8_t props;
+	uint8_t *value;
+	size_t value_len;
+};
+
+struct service_template {
+	bt_uuid_t uuid;
+	struct queue *chrcs;
+};
+
+struct template {
+	unsigned int count;
+	char name[MAX_NAME_LEN + 1];
+	uint8_t adv_data[31];
+	uint8_t adv_data_len;
+	bool has_adv_data;
+	uint8_t scan_rsp[31];
+	uint8_t scan_rsp_len;
+	struct queue *services;
+};
+
+struct peripheral {
+	struct population *pop;
+	const struct template *tmpl;
+	unsigned int num;
+	char name[MAX_NAME_LEN + 12];
+	struct btdev *btdev;
+	struct bthost *bthost;
+	struct gatt_db *db;
+	uint16_t handle;
+	int att_fd;
+	struct bt_att *att;
+	struct bt_gatt_server *server;
+};
+
+struct population {
+	struct queue *templates;
+	struct queue *peripherals;
+	struct queue *packets;
+	int event_fd;
+};
+
+/*
+ * Packets between a btdev and its bthost.  Handing them over from the
+ * main loop instead of calling into the other side right away keeps
+ * command and event exchanges from recursing into each other.
+ */
+struct packet {
+	struct peripheral *per;
+	bool to_host;
+	uint16_t len;
+	uint8_t data[0];
+};
+
+static void chrc_template_free(void *data)
+{
+	struct chrc_template *chrc = data;
+
+	free(chrc->value);
+	free(chrc);
+}
+
+static void service_template_free(void *data)
+{
+	struct service_template *service = data;
+
+	queue_destroy(service->chrcs, chrc_template_free);
+	free(service);
+}
+
+static void template_free(void *data)
+{
+	struct template *tmpl = data;
+
+	queue_destroy(tmpl->services, service_template_free);
+	free(tmpl);
+}
+
+static struct template *template_new(unsigned int count)
+{
+	struct template *tmpl;
+
+	tmpl = new0(struct template, 1);
+	tmpl->count = count;
+	strcpy(tmpl->name, DEFAULT_NAME);
+	tmpl->services = queue_new();
+
+	return tmpl;
+}
+
+static ssize_t parse_hex(const char *str, uint8_t *buf, size_t size)
+{
+	size_t len = strlen(str);
+	size_t i;
+
+	if (len % 2 || len / 2 > size)
+		return -EINVAL;
+
+	for (i = 0; i < len / 2; i++) {
+		unsigned int val;
+
+		if (!isxdigit(str[i * 2]) || !isxdigit(str[i * 2 + 1]))
+			return -EINVAL;
+
+		if (sscanf(str + i * 2, "%2x", &val) != 1)
+			return -EINVAL;
+
+		buf[i] = val;
+	}
+
+	return len / 2;
+}
+
+static const struct {
+	const char *str;
+	uint8_t prop;
+} chrc_props[] = {
+	{ "read",			BT_GATT_CHRC_PROP_READ		},
+	{ "write-without-response",	BT_GATT_CHRC_PROP_WRITE_WITHOUT_RESP },
+	{ "write",			BT_GATT_CHRC_PROP_WRITE		},
+	{ "notify",			BT_GATT_CHRC_PROP_NOTIFY	},
+	{ "indicate",			BT_GATT_CHRC_PROP_INDICATE	},
+	{ }
+};
+
+static bool parse_props(char *str, uint8_t *props)
+{
+	char *saveptr = NULL;
+	char *tok;
+
+	*props = 0;
+
+	for (tok = strtok_r(str, ",", &saveptr); tok;
+					tok = strtok_r(NULL, ",", &saveptr)) {
+		int i;
+
+		for (i = 0; chrc_props[i].str; i++) {
+			if (!strcmp(tok, chrc_props[i].str))
+				break;
+		}
+
+		if (!chrc_props[i].str)
+			return false;
+
+		*props |= chrc_props[i].prop;
+	}
+
+	return *props != 0;
+}
+
+static bool parse_characteristic(struct template *tmpl, char **saveptr)
+{
+	struct service_template *service;
+	struct chrc_template *chrc;
+	uint8_t value[BT_ATT_MAX_VALUE_LEN];
+	char *uuid, *props, *hex;
+	ssize_t len = 0;
+
+	service = queue_peek_tail(tmpl->services);
+	if (!service)
+		return false;
+
+	uuid = strtok_r(NULL, " \t", saveptr);
+	props = strtok_r(NULL, " \t", saveptr);
+	hex = strtok_r(NULL, " \t", saveptr);
+
+	if (!uuid || !props)
+		return false;
+
+	if (hex) {
+		len = parse_hex(hex, value, sizeof(value));
+		if (len < 0)
+			return false;
+	}
+
+	chrc = new0(struct chrc_template, 1);
+
+	if (bt_string_to_uuid(&chrc->uuid, uuid) < 0 ||
+					!parse_props(props, &chrc->props)) {
+		free(chrc);
+		return false;
+	}
+
+	if (len) {
+		chrc->value = malloc(len);
+		memcpy(chrc->value, value, len);
+		chrc->value_len = len;
+	}
+
+	queue_push_tail(service->chrcs, chrc);
+
+	return true;
+}
+
+static bool parse_line(struct population *pop, char *line)
+{
+	struct template *tmpl = queue_peek_tail(pop->templates);
+	struct service_template *service;
+	char *saveptr = NULL;
+	char *cmd, *arg;
+	ssize_t len;
+
+	cmd = strtok_r(line, " \t", &saveptr);
+	if (!cmd || cmd[0] == '#')
+		return true;
+
+	if (!strcmp(cmd, "peripheral")) {
+		int count = 1;
+
+		arg = strtok_r(NULL, " \t", &saveptr);
+		if (arg)
+			count = atoi(arg);
+
+		if (count < 1)
+			return false;
+
+		queue_push_tail(pop->templates, template_new(count));
+		return true;
+	}
+
+	/* Everything else configures the current group */
+	if (!tmpl)
+		return false;
+
+	if (!strcmp(cmd, "characteristic"))
+		return parse_characteristic(tmpl, &saveptr);
+
+	arg = strtok_r(NULL, " \t", &saveptr);
+	if (!arg)
+		return false;
+
+	if (!strcmp(cmd, "name")) {
+		snprintf(tmpl->name, sizeof(tmpl->name), "%s", arg);
+		return true;
+	}
+
+	if (!strcmp(cmd, "adv")) {
+		len = parse_hex(arg, tmpl->adv_data, sizeof(tmpl->adv_data));
+		if (len < 0)
+			return false;
+
+		tmpl->adv_data_len = len;
+		tmpl->has_adv_data = true;
+		return true;
+	}
+
+	if (!strcmp(cmd, "scan-rsp")) {
+		len = parse_hex(arg, tmpl->scan_rsp, sizeof(tmpl->scan_rsp));
+		if (len < 0)
+			return false;
+
+		tmpl->scan_rsp_len = len;
+		return true;
+	}
+
+	if (!strcmp(cmd, "service")) {
+		service = new0(struct service_template, 1);
+
+		if (bt_string_to_uuid(&service->uuid, arg) < 0) {
+			free(service);
+			return false;
+		}
+
+		service->chrcs = queue_new();
+		queue_push_tail(tmpl->services, service);
+		return true;
+	}
+
+	return false;
+}
+
+static bool load_script(struct population *pop, const char *path)
+{
+	char line[1024];
+	unsigned int lineno = 0;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		fprintf(stderr, "Failed to open %s: %s\n", path,
+							strerror(errno));
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+
+		line[strcspn(line, "\r\n")] = '\0';
+
+		if (!parse_line(pop, line)) {
+			fprintf(stderr, "%s:%u: invalid directive\n", path,
+								lineno);
+			fclose(fp);
+			return false;
+		}
+	}
+
+	fclose(fp);
+
+	return true;
+}
+
+static void packet_queue(struct peripheral *per, bool to_host,
+					const struct iovec *iov, int iovlen)
+{
+	struct population *pop = per->pop;
+	struct packet *pkt;
+	size_t len = 0;
+	uint64_t val = 1;
+	ssize_t written;
+	int i;
+
+	for (i = 0; i < iovlen; i++)
+		len += iov[i].iov_len;
+
+	if (len > UINT16_MAX)
+		return;
+
+	pkt = malloc(sizeof(*pkt) + len);
+	if (!pkt)
+		return;
+
+	pkt->per = per;
+	pkt->to_host = to_host;
+	pkt->len = 0;
+
+	for (i = 0; i < iovlen; i++) {
+		memcpy(pkt->data + pkt->len, iov[i].iov_base, iov[i].iov_len);
+		pkt->len += iov[i].iov_len;
+	}
+
+	/* Only the first packet of a batch needs to wake up the loop */
+	if (queue_isempty(pop->packets)) {
+		written = write(pop->event_fd, &val, sizeof(val));
+		if (written < 0) {
+			free(pkt);
+			return;
+		}
+	}
+
+	queue_push_tail(pop->packets, pkt);
+}
+
+static void dev_write_callback(const struct iovec *iov, int iovlen,
+							void *user_data)
+{
+	packet_queue(user_data, true, iov, iovlen);
+}
+
+static void host_write_callback(const struct iovec *iov, int iovlen,
+							void *user_data)
+{
+	packet_queue(user_data, false, iov, iovlen);
+}
+
+static void packet_deliver(struct packet *pkt)
+{
+	struct peripheral *per = pkt->per;
+
+	if (pkt->to_host) {
+		bthost_receive_h4(per->bthost, pkt->data, pkt->len);
+		return;
+	}
+
+	switch (pkt->data[0]) {
+	case BT_H4_CMD_PKT:
+	case BT_H4_ACL_PKT:
+	case BT_H4_SCO_PKT:
+	case BT_H4_ISO_PKT:
+		btdev_receive_h4(per->btdev, pkt->data, pkt->len);
+		break;
+	}
+}
+
+static void event_callback(int fd, uint32_t events, void *user_data)
+{
+	struct population *pop = user_data;
+	struct packet *pkt;
+	uint64_t val;
+	ssize_t len;
+
+	if (events & (EPOLLERR | EPOLLHUP))
+		return;
+
+	len = read(fd, &val, sizeof(val));
+	if (len < 0)
+		return;
+
+	/* Packets queued by the deliveries are handled in the same run */
+	while ((pkt = queue_pop_head(pop->packets))) {
+		packet_deliver(pkt);
+		free(pkt);
+	}
+}
+
+static bool match_packet_peripheral(const void *data, const void *match_data)
+{
+	const struct packet *pkt = data;
+
+	return pkt->per == match_data;
+}
+
+static void att_read_callback(int fd, uint32_t events, void *user_data)
+{
+	struct peripheral *per = user_data;
+	unsigned char buf[BT_ATT_MAX_LE_MTU];
+	ssize_t len;
+
+	if (events & (EPOLLERR | EPOLLHUP))
+		return;
+
+	len = read(fd, buf, sizeof(buf));
+	if (len < 1)
+		return;
+
+	bthost_send_cid(per->bthost, per->handle, ATT_CID, buf, len);
+}
+
+static void att_cid_hook(const void *data, uint16_t len, void *user_data)
+{
+	struct peripheral *per = user_data;
+	ssize_t written;
+
+	if (per->att_fd < 0)
+		return;
+
+	written = write(per->att_fd, data, len);
+	if (written < 0)
+		return;
+}
+
+static void att_close(struct peripheral *per)
+{
+	bt_gatt_server_unref(per->server);
+	per->server = NULL;
+
+	bt_att_unref(per->att);
+	per->att = NULL;
+
+	if (per->att_fd >= 0) {
+		mainloop_remove_fd(per->att_fd);
+		close(per->att_fd);
+		per->att_fd = -1;
+	}
+
+	per->handle = 0;
+}
+
+/*
+ * The ATT PDUs of the link are passed through a socket pair so that a
+ * regular bt_att and bt_gatt_server can serve the database.
+ */
+static void new_conn_callback(uint16_t handle, void *user_data)
+{
+	struct peripheral *per = user_data;
+	int sv[2];
+
+	if (per->att)
+		return;
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+								0, sv) < 0)
+		return;
+
+	per->att = bt_att_new(sv[1], false);
+	if (!per->att) {
+		close(sv[0]);
+		close(sv[1]);
+		return;
+	}
+
+	bt_att_set_close_on_unref(per->att, true);
+
+	per->server = bt_gatt_server_new(per->db, per->att, 0, 0);
+	if (!per->server)
+		goto failed;
+
+	if (mainloop_add_fd(sv[0], EPOLLIN, att_read_callback, per,
+								NULL) < 0)
+		goto failed;
+
+	per->att_fd = sv[0];
+	per->handle = handle;
+
+	bthost_add_cid_hook(per->bthost, handle, ATT_CID, att_cid_hook, per);
+
+	return;
+
+failed:
+	bt_gatt_server_unref(per->server);
+	per->server = NULL;
+	bt_att_unref(per->att);
+	per->att = NULL;
+	close(sv[0]);
+}
+
+static void disconn_callback(uint16_t handle, void *user_data)
+{
+	struct peripheral *per = user_data;
+
+	if (handle != per->handle)
+		return;
+
+	att_close(per);
+
+	/* Peripherals become discoverable again once the link is gone */
+	bthost_set_adv_enable(per->bthost, 0x01);
+}
+
+static void populate_gap(struct peripheral *per)
+{
+	struct gatt_db_attribute *service, *attr;
+	bt_uuid_t uuid;
+
+	bt_uuid16_create(&uuid, 0x1800);
+	service = gatt_db_add_service(per->db, &uuid, true, 3);
+
+	bt_uuid16_create(&uuid, GATT_CHARAC_DEVICE_NAME);
+	attr = gatt_db_service_add_characteristic(service, &uuid,
+						BT_ATT_PERM_READ,
+						BT_GATT_CHRC_PROP_READ,
+						NULL, NULL, NULL);
+	gatt_db_attribute_write(attr, 0, (void *) per->name,
+					strlen(per->name), 0, NULL, NULL,
+					NULL);
+
+	gatt_db_service_set_active(service, true);
+}
+
+static void populate_service(void *data, void *user_data)
+{
+	const struct service_template *tmpl = data;
+	struct peripheral *per = user_data;
+	const struct queue_entry *entry;
+	struct gatt_db_attribute *service, *attr;
+	uint16_t num_handles = 1;
+	bt_uuid_t uuid;
+
+	for (entry = queue_get_entries(tmpl->chrcs); entry;
+							entry = entry->next) {
+		const struct chrc_template *chrc = entry->data;
+
+		num_handles += 2;
+
+		if (chrc->props & (BT_GATT_CHRC_PROP_NOTIFY |
+						BT_GATT_CHRC_PROP_INDICATE))
+			num_handles++;
+	}
+
+	service = gatt_db_add_service(per->db, &tmpl->uuid, true,
+								num_handles);
+	if (!service)
+		return;
+
+	for (entry = queue_get_entries(tmpl->chrcs); entry;
+							entry = entry->next) {
+		const struct chrc_template *chrc = entry->data;
+		uint32_t perm = 0;
+
+		if (chrc->props & BT_GATT_CHRC_PROP_READ)
+			perm |= BT_ATT_PERM_READ;
+
+		if (chrc->props & (BT_GATT_CHRC_PROP_WRITE |
+				BT_GATT_CHRC_PROP_WRITE_WITHOUT_RESP))
+			perm |= BT_ATT_PERM_WRITE;
+
+		attr = gatt_db_service_add_characteristic(service,
+						&chrc->uuid, perm,
+						chrc->props, NULL, NULL, NULL);
+		if (!attr)
+			continue;
+
+		if (chrc->value_len)
+			gatt_db_attribute_write(attr, 0, chrc->value,
+						chrc->value_len, 0, NULL,
+						NULL, NULL);
+
+		if (!(chrc->props & (BT_GATT_CHRC_PROP_NOTIFY |
+						BT_GATT_CHRC_PROP_INDICATE)))
+			continue;
+
+		bt_uuid16_create(&uuid, GATT_CLIENT_CHARAC_CFG_UUID);
+		gatt_db_service_add_descriptor(service, &uuid,
+					BT_ATT_PERM_READ | BT_ATT_PERM_WRITE,
+					NULL, NULL, NULL);
+	}
+
+	gatt_db_service_set_active(service, true);
+}
+
+static uint8_t default_adv_data(const char *name, uint8_t *data)
+{
+	size_t len = strlen(name);
+
+	/* Flags: LE General Discoverable, BR/EDR Not Supported */
+	data[0] = 0x02;
+	data[1] = 0x01;
+	data[2] = 0x06;
+
+	if (len > 31 - 5)
+		len = 31 - 5;
+
+	data[3] = len + 1;
+	data[4] = 0x09;
+	memcpy(data + 5, name, len);
+
+	return len + 5;
+}
+
+static void peripheral_free(void *data)
+{
+	struct peripheral *per = data;
+
+	att_close(per);
+
+	queue_remove_all(per->pop->packets, match_packet_peripheral, per,
+									free);
+
+	bthost_destroy(per->bthost);
+	btdev_destroy(per->btdev);
+	gatt_db_unref(per->db);
+
+	free(per);
+}
+
+static struct peripheral *peripheral_new(struct population *pop,
+					const struct template *tmpl,
+					unsigned int num)
+{
+	struct peripheral *per;
+	uint8_t adv_data[31];
+	uint8_t adv_data_len;
+
+	per = new0(struct peripheral, 1);
+	per->pop = pop;
+	per->tmpl = tmpl;
+	per->num = num;
+	per->att_fd = -1;
+
+	snprintf(per->name, sizeof(per->name), "%s-%u", tmpl->name, num);
+
+	per->btdev = btdev_create(BTDEV_TYPE_LE, POPULATION_ID);
+	if (!per->btdev)
+		goto failed;
+
+	per->bthost = bthost_create();
+	if (!per->bthost)
+		goto failed;
+
+	per->db = gatt_db_new();
+	populate_gap(per);
+	queue_foreach(tmpl->services, populate_service, per);
+
+	btdev_set_send_handler(per->btdev, dev_write_callback, per);
+	bthost_set_send_handler(per->bthost, host_write_callback, per);
+	bthost_set_connect_cb(per->bthost, new_conn_callback, per);
+	bthost_set_disconnect_cb(per->bthost, disconn_callback, per);
+
+	if (tmpl->has_adv_data) {
+		memcpy(adv_data, tmpl->adv_data, tmpl->adv_data_len);
+		adv_data_len = tmpl->adv_data_len;
+	} else {
+		adv_data_len = default_adv_data(per->name, adv_data);
+	}
+
+	bthost_start(per->bthost);
+	bthost_set_adv_data(per->bthost, adv_data, adv_data_len);
+
+	if (tmpl->scan_rsp_len)
+		bthost_set_scan_rsp_data(per->bthost, tmpl->scan_rsp,
+							tmpl->scan_rsp_len);
+
+	bthost_set_adv_enable(per->bthost, 0x01);
+
+	return per;
+
+failed:
+	bthost_destroy(per->bthost);
+	btdev_destroy(per->btdev);
+	gatt_db_unref(per->db);
+	free(per);
+
+	return NULL;
+}
+
+struct population *population_new(const char *path, unsigned int count)
+{
+	struct population *pop;
+	const struct queue_entry *entry;
+	unsigned int num = 0;
+
+	pop = new0(struct population, 1);
+	pop->templates = queue_new();
+	pop->peripherals = queue_new();
+	pop->packets = queue_new();
+
+	pop->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (pop->event_fd < 0) {
+		pop->event_fd = -1;
+		goto failed;
+	}
+
+	if (mainloop_add_fd(pop->event_fd, EPOLLIN, event_callback,
+							pop, NULL) < 0) {
+		close(pop->event_fd);
+		pop->event_fd = -1;
+		goto failed;
+	}
+
+	if (path && !load_script(pop, path))
+		goto failed;
+
+	if (count) {
+		struct template *tmpl = template_new(count);
+		struct service_template *service;
+		struct chrc_template *chrc;
+
+		/* Battery Service with a notifiable Battery Level */
+		service = new0(struct service_template, 1);
+		bt_uuid16_create(&service->uuid, 0x180f);
+		service->chrcs = queue_new();
+
+		chrc = new0(struct chrc_template, 1);
+		bt_uuid16_create(&chrc->uuid, 0x2a19);
+		chrc->props = BT_GATT_CHRC_PROP_READ | BT_GATT_CHRC_PROP_NOTIFY;
+		chrc->value = malloc(1);
+		chrc->value[0] = 100;
+		chrc->value_len = 1;
+
+		queue_push_tail(service->chrcs, chrc);
+		queue_push_tail(tmpl->services, service);
+		queue_push_tail(pop->templates, tmpl);
+	}
+
+	for (entry = queue_get_entries(pop->templates); entry;
+							entry = entry->next) {
+		const struct template *tmpl = entry->data;
+		unsigned int i;
+
+		for (i = 0; i < tmpl->count; i++) {
+			struct peripheral *per;
+
+			per = peripheral_new(pop, tmpl, num++);
+			if (!per) {
+				fprintf(stderr, "Failed to create peripheral "
+							"%u\n", num - 1);
+				goto failed;
+			}
+
+			queue_push_tail(pop->peripherals, per);
+		}
+	}
+
+	return pop;
+
+failed:
+	population_free(pop);
+	return NULL;
+}
+
+void population_free(struct population *pop)
+{
+	if (!pop)
+		return;
+
+	queue_destroy(pop->peripherals, peripheral_free);
+	queue_destroy(pop->templates, template_free);
+	queue_destroy(pop->packets, free);
+
+	if (pop->event_fd >= 0) {
+		mainloop_remove_fd(pop->event_fd);
+		close(pop->event_fd);
+	}
+
+	free(pop);
+}
+
+unsigned int population_get_count(struct population *pop)
+{
+	if (!pop)
+		return 0;
+
+	return queue_length(pop->peripherals);
+}
@@ -222,6 +222,7 @@ struct GDBusSecurityTable {
 
 void g_dbus_set_flags(int flags);
 int g_dbus_get_flags(void);
+void g_dbus_set_flush_budget(unsigned int budget);
 
 gboolean g_dbus_register_interface(DBusConnection *connection,
 					const char *path, const char *name,
@@ -55,7 +55,7 @@ struct generic_data {
 	GSList *objects;
 	GSList *added;
 	GSList *removed;
-	guint process_id;
+	GList *pending_link;
 	gboolean pending_prop;
 	char *introspect;
 	struct generic_data *parent;
@@ -86,12 +86,50 @@ struct property_data {
 
 static int global_flags = 0;
 static struct generic_data *root;
-static GSList *pending = NULL;
 
-static gboolean process_changes(gpointer user_data);
+/*
+ * Objects with changes waiting to be emitted, in the order they were first
+ * touched.  A single idle source drains the queue, processing at most
+ * flush_budget objects per main loop iteration (0 means no limit).
+ */
+static GQueue pending = G_QUEUE_INIT;
+static guint pending_id = 0;
+static unsigned int flush_budget = 0;
+
+/* Objects appended per main loop iteration by GetManagedObjects */
+#define MANAGED_OBJECTS_CHUNK 64
+
+struct objects_reply {
+	DBusConnection *conn;
+	DBusMessage *message;
+	DBusMessage *reply;
+	DBusMessageIter iter;
+	DBusMessageIter array;
+	GPtrArray *paths;
+	GHashTable *index;
+	unsigned int next;
+	guint id;
+};
+
+static GSList *objects_replies = NULL;
+
+/*
+ * Signals about objects already appended to a GetManagedObjects reply that
+ * is still being built, kept back until no such reply is left on the
+ * connection so that they never arrive ahead of the state they change.
+ */
+struct held_signals {
+	DBusConnection *conn;
+	GQueue signals;
+};
+
+static GSList *held = NULL;
+
+static void process_changes(struct generic_data *data);
 static void process_properties_from_interface(struct generic_data *data,
 						struct interface_data *iface);
 static void process_property_changes(struct generic_data *data);
+static void send_signal(struct generic_data *data, DBusMessage *signal);
 
 static void print_arguments(GString *gstr, const GDBusArgInfo *args,
 						const char *direction)
@@ -590,8 +628,7 @@ static void emit_interfaces_added(struct generic_data *data)
 
 	dbus_message_iter_close_container(&iter, &array);
 
-	/* Use dbus_connection_send to avoid recursive calls to g_dbus_flush */
-	dbus_connection_send(data->conn, signal, NULL);
+	send_signal(data, signal);
 	dbus_message_unref(signal);
 }
 
@@ -633,22 +670,31 @@ static gboolean g_dbus_args_have_signature(const GDBusArgInfo *args,
 	return TRUE;
 }
 
-static void add_pending(struct generic_data *data)
+static gboolean process_pending(gpointer user_data)
 {
-	guint old_id = data->process_id;
+	unsigned int count = 0;
 
-	data->process_id = g_idle_add(process_changes, data);
+	while (pending.head) {
+		if (flush_budget && count++ == flush_budget)
+			return TRUE;
 
-	if (old_id > 0) {
-		/*
-		 * If the element already had an old idler, remove the old one,
-		 * no need to re-add it to the pending list.
-		 */
-		g_source_remove(old_id);
-		return;
+		process_changes(pending.head->data);
 	}
 
-	pending = g_slist_append(pending, data);
+	pending_id = 0;
+
+	return FALSE;
+}
+
+static void add_pending(struct generic_data *data)
+{
+	if (data->pending_link == NULL) {
+		g_queue_push_tail(&pending, data);
+		data->pending_link = pending.tail;
+	}
+
+	if (pending_id == 0)
+		pending_id = g_idle_add(process_pending, NULL);
 }
 
 static gboolean remove_interface(struct generic_data *data, const char *name)
@@ -984,25 +1030,115 @@ static void emit_interfaces_removed(struct generic_data *data)
 
 	dbus_message_iter_close_container(&iter, &array);
 
-	/* Use dbus_connection_send to avoid recursive calls to g_dbus_flush */
-	dbus_connection_send(data->conn, signal, NULL);
+	send_signal(data, signal);
 	dbus_message_unref(signal);
 }
 
 static void remove_pending(struct generic_data *data)
 {
-	if (data->process_id > 0) {
-		g_source_remove(data->process_id);
-		data->process_id = 0;
+	if (data->pending_link == NULL)
+		return;
+
+	g_queue_delete_link(&pending, data->pending_link);
+	data->pending_link = NULL;
+}
+
+static struct held_signals *find_held(DBusConnection *conn)
+{
+	GSList *l;
+
+	for (l = held; l; l = l->next) {
+		struct held_signals *h = l->data;
+
+		if (h->conn == conn)
+			return h;
 	}
 
-	pending = g_slist_remove(pending, data);
+	return NULL;
 }
 
-static gboolean process_changes(gpointer user_data)
+static gint objects_reply_holds(gconstpointer a, gconstpointer b)
 {
-	struct generic_data *data = user_data;
+	const struct objects_reply *rsp = a;
+	const struct generic_data *obj = b;
+	gpointer pos;
+
+	if (rsp->conn != obj->conn)
+		return 1;
+
+	/*
+	 * Objects still to be appended are read with their current state, any
+	 * other object either is already in the reply or was not part of the
+	 * tree when the reply was started.
+	 */
+	pos = g_hash_table_lookup(rsp->index, obj->path);
+	if (pos != NULL && GPOINTER_TO_UINT(pos) > rsp->next)
+		return 1;
+
+	return 0;
+}
+
+static void hold_signal(DBusConnection *conn, DBusMessage *signal)
+{
+	struct held_signals *h = find_held(conn);
+
+	if (h == NULL) {
+		h = g_new0(struct held_signals, 1);
+		h->conn = dbus_connection_ref(conn);
+		g_queue_init(&h->signals);
+		held = g_slist_prepend(held, h);
+	}
+
+	g_queue_push_tail(&h->signals, dbus_message_ref(signal));
+}
+
+/* Use dbus_connection_send to avoid recursive calls to g_dbus_flush */
+static void send_signal(struct generic_data *data, DBusMessage *signal)
+{
+	/* Once a signal is held back all later ones queue up behind it */
+	if (find_held(data->conn) == NULL &&
+			g_slist_find_custom(objects_replies, data,
+						objects_reply_holds) == NULL) {
+		dbus_connection_send(data->conn, signal, NULL);
+		return;
+	}
+
+	hold_signal(data->conn, signal);
+}
+
+static gint objects_reply_match_conn(gconstpointer a, gconstpointer b)
+{
+	const struct objects_reply *rsp = a;
+
+	return rsp->conn == b ? 0 : 1;
+}
+
+static void release_signals(DBusConnection *conn)
+{
+	struct held_signals *h;
+	DBusMessage *signal;
+
+	if (g_slist_find_custom(objects_replies, conn,
+					objects_reply_match_conn) != NULL)
+		return;
 
+	h = find_held(conn);
+	if (h == NULL)
+		return;
+
+	held = g_slist_remove(held, h);
+
+	while ((signal = g_queue_pop_head(&h->signals))) {
+		dbus_connection_send(h->conn, signal, NULL);
+		dbus_message_unref(signal);
+	}
+
+	dbus_connection_unref(h->conn);
+	g_free(h);
+}
+
+static void process_changes(struct generic_data *data)
+{
 	remove_pending(data);
 
 	if (data->added != NULL)
@@ -1014,10 +1150,6 @@ static gboolean process_changes(gpointer user_data)
 
 	if (data->removed != NULL)
 		emit_interfaces_removed(data);
-
-	data->process_id = 0;
-
-	return FALSE;
 }
 
 static void generic_unregister(DBusConnection *connection, void *user_data)
@@ -1028,11 +1160,8 @@ static void generic_unregister(DBusConnection *connection, void *user_data)
 	if (parent != NULL)
 		parent->objects = g_slist_remove(parent->objects, data);
 
-	if (data->process_id > 0) {
-		g_source_remove(data->process_id);
-		data->process_id = 0;
+	if (data->pending_link != NULL)
 		process_changes(data);
-	}
 
 	g_slist_foreach(data->objects, reset_parent, data->parent);
 	g_slist_free(data->objects);
@@ -1113,10 +1242,9 @@ static void append_interfaces(struct generic_data *data, DBusMessageIter *iter)
 	dbus_message_iter_close_container(iter, &array);
 }
 
-static void append_object(gpointer data, gpointer user_data)
+static void append_object_entry(struct generic_data *child,
+						DBusMessageIter *array)
 {
-	struct generic_data *child = data;
-	DBusMessageIter *array = user_data;
 	DBusMessageIter entry;
 
 	dbus_message_iter_open_container(array, DBUS_TYPE_DICT_ENTRY, NULL,
@@ -1125,25 +1253,40 @@ static void append_object(gpointer data, gpointer user_data)
 								&child->path);
 	append_interfaces(child, &entry);
 	dbus_message_iter_close_container(array, &entry);
+}
+
+static void append_object(gpointer data, gpointer user_data)
+{
+	struct generic_data *child = data;
+
+	append_object_entry(child, user_data);
 
 	g_slist_foreach(child->objects, append_object, user_data);
 }
 
-static DBusMessage *get_objects(DBusConnection *connection,
-				DBusMessage *message, void *user_data)
+static void collect_path(gpointer data, gpointer user_data)
+{
+	struct generic_data *child = data;
+	GPtrArray *paths = user_data;
+
+	g_ptr_array_add(paths, g_strdup(child->path));
+
+	g_slist_foreach(child->objects, collect_path, user_data);
+}
+
+static DBusMessage *objects_reply_new(DBusMessage *message,
+							DBusMessageIter *iter,
+							DBusMessageIter *array)
 {
-	struct generic_data *data = user_data;
 	DBusMessage *reply;
-	DBusMessageIter iter;
-	DBusMessageIter array;
 
 	reply = dbus_message_new_method_return(message);
 	if (reply == NULL)
 		return NULL;
 
-	dbus_message_iter_init_append(reply, &iter);
+	dbus_message_iter_init_append(reply, iter);
 
-	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+	dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
 					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
 					DBUS_TYPE_OBJECT_PATH_AS_STRING
 					DBUS_TYPE_ARRAY_AS_STRING
@@ -1156,7 +1299,21 @@ static DBusMessage *get_objects(DBusConnection *connection,
 					DBUS_DICT_ENTRY_END_CHAR_AS_STRING
 					DBUS_DICT_ENTRY_END_CHAR_AS_STRING
 					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
-					&array);
+					array);
+
+	return reply;
+}
+
+static DBusMessage *objects_reply_build(struct generic_data *data,
+							DBusMessage *message)
+{
+	DBusMessage *reply;
+	DBusMessageIter iter;
+	DBusMessageIter array;
+
+	reply = objects_reply_new(message, &iter, &array);
+	if (reply == NULL)
+		return NULL;
 
 	g_slist_foreach(data->objects, append_object, &array);
 
@@ -1165,8 +1322,130 @@ static DBusMessage *get_objects(DBusConnection *connection,
 	return reply;
 }
 
+static void objects_reply_free(struct objects_reply *rsp)
+{
+	objects_replies = g_slist_remove(objects_replies, rsp);
+
+	if (rsp->id > 0)
+		g_source_remove(rsp->id);
+
+	if (rsp->reply)
+		dbus_message_unref(rsp->reply);
+
+	g_hash_table_destroy(rsp->index);
+	g_ptr_array_free(rsp->paths, TRUE);
+	dbus_message_unref(rsp->message);
+	dbus_connection_unref(rsp->conn);
+	g_free(rsp);
+}
+
+static gboolean objects_reply_continue(gpointer user_data)
+{
+	struct objects_reply *rsp = user_data;
+	DBusConnection *conn;
+	DBusMessage *reply;
+	unsigned int count;
+
+	/* Object manager was detached while the reply was being built */
+	if (root == NULL || root->conn != rsp->conn) {
+		reply = g_dbus_create_error(rsp->message,
+					DBUS_ERROR_UNKNOWN_OBJECT,
+					"Object manager no longer available");
+		goto done;
+	}
+
+	for (count = 0; count < MANAGED_OBJECTS_CHUNK &&
+					rsp->next < rsp->paths->len; count++) {
+		const char *path = g_ptr_array_index(rsp->paths, rsp->next);
+		struct generic_data *child = NULL;
+
+		rsp->next++;
+
+		/* Skip objects unregistered before their turn came */
+		if (!dbus_connection_get_object_path_data(rsp->conn, path,
+							(void *) &child) ||
+							child == NULL)
+			continue;
+
+		append_object_entry(child, &rsp->array);
+	}
+
+	if (rsp->next < rsp->paths->len)
+		return TRUE;
+
+	dbus_message_iter_close_container(&rsp->iter, &rsp->array);
+	reply = rsp->reply;
+	rsp->reply = NULL;
+
+done:
+	rsp->id = 0;
+
+	/* Signals flushed ahead of the reply are held back as well */
+	if (reply)
+		g_dbus_send_message(rsp->conn, reply);
+
+	conn = dbus_connection_ref(rsp->conn);
+	objects_reply_free(rsp);
+
+	release_signals(conn);
+	dbus_connection_unref(conn);
+
+	return FALSE;
+}
+
+static DBusMessage *get_objects(DBusConnection *connection,
+				DBusMessage *message, void *user_data)
+{
+	struct generic_data *data = user_data;
+	struct objects_reply *rsp;
+	DBusMessage *reply;
+	GPtrArray *paths;
+	unsigned int i;
+
+	paths = g_ptr_array_new_with_free_func(g_free);
+	g_slist_foreach(data->objects, collect_path, paths);
+
+	/* Small trees are cheap enough to be replied to right away */
+	if (paths->len <= MANAGED_OBJECTS_CHUNK) {
+		g_ptr_array_free(paths, TRUE);
+		reply = objects_reply_build(data, message);
+		goto done;
+	}
+
+	rsp = g_new0(struct objects_reply, 1);
+	rsp->paths = paths;
+	rsp->reply = objects_reply_new(message, &rsp->iter, &rsp->array);
+	if (rsp->reply == NULL) {
+		g_ptr_array_free(paths, TRUE);
+		g_free(rsp);
+		reply = NULL;
+		goto done;
+	}
+
+	/* Position of each path, offset by one so that NULL means unknown */
+	rsp->index = g_hash_table_new(g_str_hash, g_str_equal);
+	for (i = 0; i < paths->len; i++)
+		g_hash_table_insert(rsp->index, g_ptr_array_index(paths, i),
+							GUINT_TO_POINTER(i + 1));
+
+	rsp->conn = dbus_connection_ref(connection);
+	rsp->message = dbus_message_ref(message);
+	rsp->id = g_idle_add(objects_reply_continue, rsp);
+
+	objects_replies = g_slist_prepend(objects_replies, rsp);
+
+	return NULL;
+
+done:
+	if (reply == NULL)
+		return g_dbus_create_error(message, DBUS_ERROR_NO_MEMORY,
+						"Unable to build the reply");
+
+	return reply;
+}
+
 static const GDBusMethodTable manager_methods[] = {
-	{ GDBUS_METHOD("GetManagedObjects", NULL,
+	{ GDBUS_ASYNC_METHOD("GetManagedObjects", NULL,
 		GDBUS_ARGS({ "objects", "a{oa{sa{sv}}}" }), get_objects) },
 	{ }
 };
@@ -1495,9 +1774,9 @@ DBusMessage *g_dbus_create_reply(DBusMessage *message, int type, ...)
 
 static void g_dbus_flush(DBusConnection *connection)
 {
-	GSList *l;
+	GList *l;
 
-	for (l = pending; l;) {
+	for (l = pending.head; l;) {
 		struct generic_data *data = l->data;
 
 		l = l->next;
@@ -1530,6 +1809,14 @@ gboolean g_dbus_send_message(DBusConnection *connection, DBusMessage *message)
 	/* Flush pending signal to guarantee message order */
 	g_dbus_flush(connection);
 
+	/* Keep signals in order with the ones held back */
+	if (dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_SIGNAL &&
+						find_held(connection) != NULL) {
+		hold_signal(connection, message);
+		result = TRUE;
+		goto out;
+	}
+
 	result = dbus_connection_send(connection, message, NULL);
 
 out:
@@ -1727,8 +2014,7 @@ static void process_properties_from_interface(struct generic_data *data,
 	g_slist_free(iface->pending_prop);
 	iface->pending_prop = NULL;
 
-	/* Use dbus_connection_send to avoid recursive calls to g_dbus_flush */
-	dbus_connection_send(data->conn, signal, NULL);
+	send_signal(data, signal);
 	dbus_message_unref(signal);
 }
 
@@ -1847,6 +2133,11 @@ gboolean g_dbus_detach_object_manager(DBusConnection *connection)
 	return TRUE;
 }
 
+void g_dbus_set_flush_budget(unsigned int budget)
+{
+	flush_budget = budget;
+}
+
 void g_dbus_set_flags(int flags)
 {
 	global_flags = flags;
@@ -41,6 +41,8 @@ struct mesh_app_key {
 	uint8_t key_aid;
 	uint8_t new_key[16];
 	uint8_t new_key_aid;
+	struct mesh_crypto_ccm *ccm;
+	struct mesh_crypto_ccm *new_ccm;
 };
 
 static bool match_key_index(const void *a, const void *b)
@@ -51,6 +53,11 @@ static bool match_key_index(const void *a, const void *b)
 	return key->app_idx == idx;
 }
 
+static bool match_key_ptr(const void *a, const void *b)
+{
+	return a == b;
+}
+
 static bool match_bound_key(const void *a, const void *b)
 {
 	const struct mesh_app_key *key = a;
@@ -59,6 +66,33 @@ static bool match_bound_key(const void *a, const void *b)
 	return key->net_idx == idx;
 }
 
+/* Keys are listed under the AID of each of their generations */
+static void aid_index_add(struct mesh_net *net, struct mesh_app_key *key)
+{
+	struct l_queue *aid_keys;
+
+	if (key->key_aid & KEY_ID_AKF) {
+		aid_keys = mesh_net_get_app_key_aid(net, key->key_aid);
+		if (!l_queue_find(aid_keys, match_key_ptr, key))
+			mesh_net_app_key_aid_add(net, key->key_aid, key);
+	}
+
+	if (key->new_key_aid != NET_NID_INVALID) {
+		aid_keys = mesh_net_get_app_key_aid(net, key->new_key_aid);
+		if (!l_queue_find(aid_keys, match_key_ptr, key))
+			mesh_net_app_key_aid_add(net, key->new_key_aid, key);
+	}
+}
+
+static void aid_index_del(struct mesh_net *net, struct mesh_app_key *key)
+{
+	if (key->key_aid & KEY_ID_AKF)
+		mesh_net_app_key_aid_del(net, key->key_aid, key);
+
+	if (key->new_key_aid != NET_NID_INVALID)
+		mesh_net_app_key_aid_del(net, key->new_key_aid, key);
+}
+
 static struct mesh_app_key *app_key_new(void)
 {
 	struct mesh_app_key *key = l_new(struct mesh_app_key, 1);
@@ -70,16 +104,26 @@ static struct mesh_app_key *app_key_new(void)
 static bool set_key(struct mesh_app_key *key, uint16_t app_idx,
 			const uint8_t *key_value, bool is_new)
 {
+	struct mesh_crypto_ccm *ccm;
 	uint8_t key_aid;
 
 	if (!mesh_crypto_k4(key_value, &key_aid))
 		return false;
 
+	ccm = mesh_crypto_ccm_new(key_value);
+	if (!ccm)
+		return false;
+
 	key_aid = KEY_ID_AKF | (key_aid << KEY_AID_SHIFT);
-	if (!is_new)
+	if (!is_new) {
 		key->key_aid = key_aid;
-	else
+		mesh_crypto_ccm_free(key->ccm);
+		key->ccm = ccm;
+	} else {
 		key->new_key_aid = key_aid;
+		mesh_crypto_ccm_free(key->new_ccm);
+		key->new_ccm = ccm;
+	}
 
 	memcpy(is_new ? key->new_key : key->key, key_value, 16);
 
@@ -93,6 +137,8 @@ void appkey_key_free(void *data)
 	if (!key)
 		return;
 
+	mesh_crypto_ccm_free(key->ccm);
+	mesh_crypto_ccm_free(key->new_ccm);
 	l_free(key);
 }
 
@@ -126,12 +172,13 @@ bool appkey_key_init(struct mesh_net *net, uint16_t net_idx, uint16_t app_idx,
 		return false;
 
 	l_queue_push_tail(app_keys, key);
+	aid_index_add(net, key);
 
 	return true;
 }
 
-const uint8_t *appkey_get_key(struct mesh_net *net, uint16_t app_idx,
-							uint8_t *key_aid)
+static struct mesh_app_key *get_tx_key(struct mesh_net *net, uint16_t app_idx,
+								bool *use_new)
 {
 	struct mesh_app_key *app_key;
 	uint8_t phase;
@@ -151,15 +198,43 @@ const uint8_t *appkey_get_key(struct mesh_net *net, uint16_t app_idx,
 		return NULL;
 
 	if (phase != KEY_REFRESH_PHASE_TWO) {
-		*key_aid = app_key->key_aid;
-		return app_key->key;
+		*use_new = false;
+		return app_key;
 	}
 
 	if (app_key->new_key_aid == NET_NID_INVALID)
 		return NULL;
 
-	*key_aid = app_key->new_key_aid;
-	return app_key->new_key;
+	*use_new = true;
+	return app_key;
+}
+
+const uint8_t *appkey_get_key(struct mesh_net *net, uint16_t app_idx,
+							uint8_t *key_aid)
+{
+	struct mesh_app_key *app_key;
+	bool use_new;
+
+	app_key = get_tx_key(net, app_idx, &use_new);
+	if (!app_key)
+		return NULL;
+
+	*key_aid = use_new ? app_key->new_key_aid : app_key->key_aid;
+	return use_new ? app_key->new_key : app_key->key;
+}
+
+const struct mesh_crypto_ccm *appkey_get_ccm(struct mesh_net *net,
+					uint16_t app_idx, uint8_t *key_aid)
+{
+	struct mesh_app_key *app_key;
+	bool use_new;
+
+	app_key = get_tx_key(net, app_idx, &use_new);
+	if (!app_key)
+		return NULL;
+
+	*key_aid = use_new ? app_key->new_key_aid : app_key->key_aid;
+	return use_new ? app_key->new_ccm : app_key->ccm;
 }
 
 int appkey_get_key_idx(struct mesh_app_key *app_key,
@@ -182,6 +257,17 @@ int appkey_get_key_idx(struct mesh_app_key *app_key,
 	return app_key->app_idx;
 }
 
+void appkey_get_ccm_idx(struct mesh_app_key *app_key,
+				const struct mesh_crypto_ccm **ccm,
+				const struct mesh_crypto_ccm **new_ccm)
+{
+	if (ccm)
+		*ccm = app_key ? app_key->ccm : NULL;
+
+	if (new_ccm)
+		*new_ccm = app_key ? app_key->new_ccm : NULL;
+}
+
 bool appkey_have_key(struct mesh_net *net, uint16_t app_idx)
 {
 	struct mesh_app_key *key;
@@ -247,8 +333,14 @@ int appkey_key_update(struct mesh_net *net, uint16_t net_idx, uint16_t app_idx,
 	if (memcmp(new_key, key->new_key, 16) == 0)
 		return MESH_STATUS_SUCCESS;
 
-	if (!set_key(key, app_idx, new_key, true))
+	aid_index_del(net, key);
+
+	if (!set_key(key, app_idx, new_key, true)) {
+		aid_index_add(net, key);
 		return MESH_STATUS_INSUFF_RESOURCES;
+	}
+
+	aid_index_add(net, key);
 
 	node = mesh_net_node_get(net);
 
@@ -302,6 +394,7 @@ int appkey_key_add(struct mesh_net *net, uint16_t net_idx, uint16_t app_idx,
 	key->net_idx = net_idx;
 	key->app_idx = app_idx;
 	l_queue_push_tail(app_keys, key);
+	aid_index_add(net, key);
 
 	return MESH_STATUS_SUCCESS;
 }
@@ -330,6 +423,7 @@ int appkey_key_delete(struct mesh_net *net, uint16_t net_idx,
 	node_app_key_delete(node, net_idx, app_idx);
 
 	l_queue_remove(app_keys, key);
+	aid_index_del(net, key);
 	appkey_key_free(key);
 
 	if (!mesh_config_app_key_del(node_config_get(node), net_idx, app_idx))
@@ -357,6 +451,7 @@ void appkey_delete_bound_keys(struct mesh_net *net, uint16_t net_idx)
 		node_app_key_delete(node, net_idx, key->app_idx);
 		mesh_config_app_key_del(node_config_get(node), net_idx,
 								key->app_idx);
+		aid_index_del(net, key);
 		appkey_key_free(key);
 
 		key = l_queue_remove_if(app_keys, match_bound_key,
@@ -21,15 +21,21 @@
 #define MAX_APP_KEYS	32
 
 struct mesh_app_key;
+struct mesh_crypto_ccm;
 
 bool appkey_key_init(struct mesh_net *net, uint16_t net_idx, uint16_t app_idx,
 				uint8_t *key_value, uint8_t *new_key_value);
 void appkey_key_free(void *data);
 const uint8_t *appkey_get_key(struct mesh_net *net, uint16_t app_idx,
 							uint8_t *key_id);
+const struct mesh_crypto_ccm *appkey_get_ccm(struct mesh_net *net,
+					uint16_t app_idx, uint8_t *key_aid);
 int appkey_get_key_idx(struct mesh_app_key *app_key,
 				const uint8_t **key, uint8_t *key_aid,
 				const uint8_t **new_key, uint8_t *new_key_aid);
+void appkey_get_ccm_idx(struct mesh_app_key *app_key,
+				const struct mesh_crypto_ccm **ccm,
+				const struct mesh_crypto_ccm **new_ccm);
 bool appkey_have_key(struct mesh_net *net, uint16_t app_idx);
 uint16_t appkey_net_idx(struct mesh_net *net, uint16_t app_idx);
 int appkey_key_add(struct mesh_net *net, uint16_t net_idx, uint16_t app_idx,
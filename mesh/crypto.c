@@ -89,17 +89,71 @@ bool mesh_crypto_aes_cmac(const uint8_t key[16], const uint8_t *msg,
 	return aes_cmac_one(key, msg, msg_len, res);
 }
 
-bool mesh_crypto_aes_ccm_encrypt(const uint8_t nonce[13], const uint8_t key[16],
+struct mesh_crypto_ccm {
+	struct l_aead_cipher *mic32;
+	struct l_aead_cipher *mic64;
+};
+
+struct mesh_crypto_ccm *mesh_crypto_ccm_new(const uint8_t key[16])
+{
+	struct mesh_crypto_ccm *ccm = l_new(struct mesh_crypto_ccm, 1);
+
+	ccm->mic32 = l_aead_cipher_new(L_AEAD_CIPHER_AES_CCM, key, 16, 4);
+	ccm->mic64 = l_aead_cipher_new(L_AEAD_CIPHER_AES_CCM, key, 16, 8);
+
+	if (!ccm->mic32 || !ccm->mic64) {
+		mesh_crypto_ccm_free(ccm);
+		return NULL;
+	}
+
+	return ccm;
+}
+
+/* One-shot users know the MIC size up front and need only that cipher */
+static struct mesh_crypto_ccm *ccm_new_mic(const uint8_t key[16],
+							size_t mic_size)
+{
+	struct mesh_crypto_ccm *ccm = l_new(struct mesh_crypto_ccm, 1);
+	struct l_aead_cipher *cipher;
+
+	cipher = l_aead_cipher_new(L_AEAD_CIPHER_AES_CCM, key, 16, mic_size);
+	if (!cipher) {
+		l_free(ccm);
+		return NULL;
+	}
+
+	if (mic_size == 8)
+		ccm->mic64 = cipher;
+	else
+		ccm->mic32 = cipher;
+
+	return ccm;
+}
+
+void mesh_crypto_ccm_free(struct mesh_crypto_ccm *ccm)
+{
+	if (!ccm)
+		return;
+
+	l_aead_cipher_free(ccm->mic32);
+	l_aead_cipher_free(ccm->mic64);
+	l_free(ccm);
+}
+
+static struct l_aead_cipher *ccm_cipher(const struct mesh_crypto_ccm *ccm,
+							size_t mic_size)
+{
+	return mic_size == 8 ? ccm->mic64 : ccm->mic32;
+}
+
+static bool ccm_encrypt(struct l_aead_cipher *cipher, const uint8_t nonce[13],
 					const uint8_t *aad, uint16_t aad_len,
 					const void *msg, uint16_t msg_len,
 					void *out_msg,
 					void *out_mic, size_t mic_size)
 {
-	void *cipher;
 	bool result;
 
-	cipher = l_aead_cipher_new(L_AEAD_CIPHER_AES_CCM, key, 16, mic_size);
-
 	result = l_aead_cipher_encrypt(cipher, msg, msg_len, aad, aad_len,
 					nonce, 13, out_msg, msg_len + mic_size);
 
@@ -110,23 +164,18 @@ bool mesh_crypto_aes_ccm_encrypt(const uint8_t nonce[13], const uint8_t key[16],
 			*(uint64_t *)out_mic = l_get_be64(out_msg + msg_len);
 	}
 
-	l_aead_cipher_free(cipher);
-
 	return result;
 }
 
-bool mesh_crypto_aes_ccm_decrypt(const uint8_t nonce[13], const uint8_t key[16],
+static bool ccm_decrypt(struct l_aead_cipher *cipher, const uint8_t nonce[13],
 				const uint8_t *aad, uint16_t aad_len,
 				const void *enc_msg, uint16_t enc_msg_len,
 				void *out_msg,
 				void *out_mic, size_t mic_size)
 {
-	void *cipher;
 	bool result;
 	size_t out_msg_len = enc_msg_len - mic_size;
 
-	cipher = l_aead_cipher_new(L_AEAD_CIPHER_AES_CCM, key, 16, mic_size);
-
 	result = l_aead_cipher_decrypt(cipher, enc_msg, enc_msg_len,
 							aad, aad_len, nonce, 13,
 							out_msg, out_msg_len);
@@ -140,6 +189,46 @@ bool mesh_crypto_aes_ccm_decrypt(const uint8_t nonce[13], const uint8_t key[16],
 				l_get_be64(enc_msg + enc_msg_len - mic_size);
 	}
 
+	return result;
+}
+
+bool mesh_crypto_aes_ccm_encrypt(const uint8_t nonce[13], const uint8_t key[16],
+					const uint8_t *aad, uint16_t aad_len,
+					const void *msg, uint16_t msg_len,
+					void *out_msg,
+					void *out_mic, size_t mic_size)
+{
+	void *cipher;
+	bool result;
+
+	cipher = l_aead_cipher_new(L_AEAD_CIPHER_AES_CCM, key, 16, mic_size);
+	if (!cipher)
+		return false;
+
+	result = ccm_encrypt(cipher, nonce, aad, aad_len, msg, msg_len,
+						out_msg, out_mic, mic_size);
+
+	l_aead_cipher_free(cipher);
+
+	return result;
+}
+
+bool mesh_crypto_aes_ccm_decrypt(const uint8_t nonce[13], const uint8_t key[16],
+				const uint8_t *aad, uint16_t aad_len,
+				const void *enc_msg, uint16_t enc_msg_len,
+				void *out_msg,
+				void *out_mic, size_t mic_size)
+{
+	void *cipher;
+	bool result;
+
+	cipher = l_aead_cipher_new(L_AEAD_CIPHER_AES_CCM, key, 16, mic_size);
+	if (!cipher)
+		return false;
+
+	result = ccm_decrypt(cipher, nonce, aad, aad_len, enc_msg, enc_msg_len,
+						out_msg, out_mic, mic_size);
+
 	l_aead_cipher_free(cipher);
 
 	return result;
@@ -481,17 +570,17 @@ static void mesh_crypto_privacy_counter(uint32_t iv_index,
 	memcpy(privacy_counter + 9, payload, 7);
 }
 
-static bool mesh_crypto_pecb(const uint8_t privacy_key[16],
+static bool mesh_crypto_pecb(struct l_cipher *privacy,
 						uint32_t iv_index,
 						const uint8_t *payload,
 						uint8_t pecb[16])
 {
 	mesh_crypto_privacy_counter(iv_index, payload, pecb);
-	return aes_ecb_one(privacy_key, pecb, pecb);
+	return l_cipher_encrypt(privacy, pecb, pecb, 16);
 }
 
 static bool mesh_crypto_network_obfuscate(uint8_t *packet,
-						const uint8_t privacy_key[16],
+						struct l_cipher *privacy,
 						uint32_t iv_index,
 						bool ctl, uint8_t ttl,
 						uint32_t seq, uint16_t src)
@@ -500,7 +589,7 @@ static bool mesh_crypto_network_obfuscate(uint8_t *packet,
 	uint8_t *net_hdr = packet + 1;
 	int i;
 
-	if (!mesh_crypto_pecb(privacy_key, iv_index, packet + 7, pecb))
+	if (!mesh_crypto_pecb(privacy, iv_index, packet + 7, pecb))
 		return false;
 
 	l_put_be16(src, net_hdr + 4);
@@ -514,7 +603,7 @@ static bool mesh_crypto_network_obfuscate(uint8_t *packet,
 }
 
 static bool mesh_crypto_network_clarify(uint8_t *packet,
-						const uint8_t privacy_key[16],
+						struct l_cipher *privacy,
 						uint32_t iv_index,
 						bool *ctl, uint8_t *ttl,
 						uint32_t *seq, uint16_t *src)
@@ -523,7 +612,7 @@ static bool mesh_crypto_network_clarify(uint8_t *packet,
 	uint8_t *net_hdr = packet + 1;
 	int i;
 
-	if (!mesh_crypto_pecb(privacy_key, iv_index, packet + 7, pecb))
+	if (!mesh_crypto_pecb(privacy, iv_index, packet + 7, pecb))
 		return false;
 
 	for (i = 0; i < 6; i++)
@@ -723,16 +812,17 @@ bool mesh_crypto_packet_parse(const uint8_t *packet, uint8_t packet_len,
 	return true;
 }
 
-bool mesh_crypto_payload_encrypt(uint8_t *aad, const uint8_t *payload,
+bool mesh_crypto_payload_encrypt_ccm(uint8_t *aad, const uint8_t *payload,
 				uint8_t *out, uint16_t payload_len,
 				uint16_t src, uint16_t dst, uint8_t key_aid,
 				uint32_t seq, uint32_t iv_index,
 				bool aszmic,
-				const uint8_t app_key[16])
+				const struct mesh_crypto_ccm *ccm)
 {
 	uint8_t nonce[13];
+	size_t mic_size = aszmic ? 8 : 4;
 
-	if (payload_len < 1)
+	if (payload_len < 1 || !ccm)
 		return false;
 
 	if (key_aid == APP_AID_DEV)
@@ -742,29 +832,51 @@ bool mesh_crypto_payload_encrypt(uint8_t *aad, const uint8_t *payload,
 		mesh_crypto_application_nonce(seq, src, dst, iv_index, aszmic,
 									nonce);
 
-	if (!mesh_crypto_aes_ccm_encrypt(nonce, app_key,
+	if (!ccm_encrypt(ccm_cipher(ccm, mic_size), nonce,
 							aad, aad ? 16 : 0,
 							payload, payload_len,
-							out, NULL,
-							aszmic ? 8 : 4))
+							out, NULL, mic_size))
 		return false;
 
 	return true;
 }
 
-bool mesh_crypto_payload_decrypt(uint8_t *aad, uint16_t aad_len,
+bool mesh_crypto_payload_encrypt(uint8_t *aad, const uint8_t *payload,
+				uint8_t *out, uint16_t payload_len,
+				uint16_t src, uint16_t dst, uint8_t key_aid,
+				uint32_t seq, uint32_t iv_index,
+				bool aszmic,
+				const uint8_t app_key[16])
+{
+	struct mesh_crypto_ccm *ccm;
+	bool result;
+
+	ccm = ccm_new_mic(app_key, aszmic ? 8 : 4);
+	if (!ccm)
+		return false;
+
+	result = mesh_crypto_payload_encrypt_ccm(aad, payload, out,
+						payload_len, src, dst, key_aid,
+						seq, iv_index, aszmic, ccm);
+
+	mesh_crypto_ccm_free(ccm);
+
+	return result;
+}
+
+bool mesh_crypto_payload_decrypt_ccm(uint8_t *aad, uint16_t aad_len,
 				const uint8_t *payload, uint16_t payload_len,
 				bool aszmic,
 				uint16_t src, uint16_t dst,
 				uint8_t key_aid, uint32_t seq,
 				uint32_t iv_index, uint8_t *out,
-				const uint8_t app_key[16])
+				const struct mesh_crypto_ccm *ccm)
 {
 	uint8_t nonce[13];
 	uint32_t mic32;
 	uint64_t mic64;
 
-	if (payload_len < 5 || !out)
+	if (payload_len < 5 || !out || !ccm)
 		return false;
 
 	if (key_aid == APP_AID_DEV)
@@ -777,8 +889,7 @@ bool mesh_crypto_payload_decrypt(uint8_t *aad, uint16_t aad_len,
 	memcpy(out, payload, payload_len);
 
 	if (aszmic) {
-		if (!mesh_crypto_aes_ccm_decrypt(nonce, app_key,
-					aad, aad_len,
+		if (!ccm_decrypt(ccm->mic64, nonce, aad, aad_len,
 					payload, payload_len,
 					out, &mic64, sizeof(mic64)))
 			return false;
@@ -789,8 +900,7 @@ bool mesh_crypto_payload_decrypt(uint8_t *aad, uint16_t aad_len,
 		if (mic64)
 			return false;
 	} else {
-		if (!mesh_crypto_aes_ccm_decrypt(nonce, app_key,
-					aad, aad_len,
+		if (!ccm_decrypt(ccm->mic32, nonce, aad, aad_len,
 					payload, payload_len,
 					out, &mic32, sizeof(mic32)))
 			return false;
@@ -805,8 +915,33 @@ bool mesh_crypto_payload_decrypt(uint8_t *aad, uint16_t aad_len,
 	return true;
 }
 
+bool mesh_crypto_payload_decrypt(uint8_t *aad, uint16_t aad_len,
+				const uint8_t *payload, uint16_t payload_len,
+				bool aszmic,
+				uint16_t src, uint16_t dst,
+				uint8_t key_aid, uint32_t seq,
+				uint32_t iv_index, uint8_t *out,
+				const uint8_t app_key[16])
+{
+	struct mesh_crypto_ccm *ccm;
+	bool result;
+
+	ccm = ccm_new_mic(app_key, aszmic ? 8 : 4);
+	if (!ccm)
+		return false;
+
+	result = mesh_crypto_payload_decrypt_ccm(aad, aad_len, payload,
+						payload_len, aszmic, src, dst,
+						key_aid, seq, iv_index, out,
+						ccm);
+
+	mesh_crypto_ccm_free(ccm);
+
+	return result;
+}
+
 static bool mesh_crypto_packet_encrypt(uint8_t *packet, uint8_t packet_len,
-				const uint8_t network_key[16],
+				const struct mesh_crypto_ccm *network,
 				uint32_t iv_index, bool proxy,
 				bool ctl, uint8_t ttl, uint32_t seq,
 				uint16_t src)
@@ -821,14 +956,12 @@ static bool mesh_crypto_packet_encrypt(uint8_t *packet, uint8_t packet_len,
 
 	/* Check for Long net-MIC */
 	if (ctl) {
-		if (!mesh_crypto_aes_ccm_encrypt(nonce, network_key,
-					NULL, 0,
+		if (!ccm_encrypt(network->mic64, nonce, NULL, 0,
 					packet + 7, packet_len - 7 - 8,
 					packet + 7, NULL, 8))
 			return false;
 	} else {
-		if (!mesh_crypto_aes_ccm_encrypt(nonce, network_key,
-					NULL, 0,
+		if (!ccm_encrypt(network->mic32, nonce, NULL, 0,
 					packet + 7, packet_len - 7 - 4,
 					packet + 7, NULL, 4))
 			return false;
@@ -837,10 +970,10 @@ static bool mesh_crypto_packet_encrypt(uint8_t *packet, uint8_t packet_len,
 	return true;
 }
 
-bool mesh_crypto_packet_encode(uint8_t *packet, uint8_t packet_len,
+bool mesh_crypto_packet_encode_ccm(uint8_t *packet, uint8_t packet_len,
 				uint32_t iv_index,
-				const uint8_t network_key[16],
-				const uint8_t privacy_key[16])
+				const struct mesh_crypto_ccm *network,
+				struct l_cipher *privacy)
 {
 	bool ctl;
 	uint8_t ttl;
@@ -848,22 +981,55 @@ bool mesh_crypto_packet_encode(uint8_t *packet, uint8_t packet_len,
 	uint16_t src;
 	uint16_t dst;
 
+	if (!network || !privacy)
+		return false;
+
 	if (!network_header_parse(packet, packet_len,
 						&ctl, &ttl, &seq, &src, &dst))
 		return false;
 
-	if (!mesh_crypto_packet_encrypt(packet, packet_len, network_key,
+	if (!mesh_crypto_packet_encrypt(packet, packet_len, network,
 							iv_index, !dst,
 							ctl, ttl, seq, src))
 
 		return false;
 
-	return mesh_crypto_network_obfuscate(packet, privacy_key, iv_index,
+	return mesh_crypto_network_obfuscate(packet, privacy, iv_index,
 							ctl, ttl, seq, src);
 }
 
-static bool mesh_crypto_packet_decrypt(uint8_t *packet, uint8_t packet_len,
+bool mesh_crypto_packet_encode(uint8_t *packet, uint8_t packet_len,
+				uint32_t iv_index,
 				const uint8_t network_key[16],
+				const uint8_t privacy_key[16])
+{
+	struct mesh_crypto_ccm *network;
+	struct l_cipher *privacy;
+	bool ctl;
+	uint8_t ttl;
+	uint32_t seq;
+	uint16_t src;
+	uint16_t dst;
+	bool result;
+
+	if (!network_header_parse(packet, packet_len,
+						&ctl, &ttl, &seq, &src, &dst))
+		return false;
+
+	network = ccm_new_mic(network_key, ctl ? 8 : 4);
+	privacy = l_cipher_new(L_CIPHER_AES, privacy_key, 16);
+
+	result = mesh_crypto_packet_encode_ccm(packet, packet_len, iv_index,
+							network, privacy);
+
+	l_cipher_free(privacy);
+	mesh_crypto_ccm_free(network);
+
+	return result;
+}
+
+static bool mesh_crypto_packet_decrypt(uint8_t *packet, uint8_t packet_len,
+				const struct mesh_crypto_ccm *network,
 				uint32_t iv_index, bool proxy,
 				bool ctl, uint8_t ttl, uint32_t seq,
 				uint16_t src)
@@ -884,8 +1050,7 @@ static bool mesh_crypto_packet_decrypt(uint8_t *packet, uint8_t packet_len,
 	if (ctl) {
 		uint64_t mic;
 
-		if (!mesh_crypto_aes_ccm_decrypt(nonce, network_key,
-					NULL, 0,
+		if (!ccm_decrypt(network->mic64, nonce, NULL, 0,
 					packet + 7, packet_len - 7,
 					packet + 7, &mic, sizeof(mic)))
 			return false;
@@ -898,8 +1063,7 @@ static bool mesh_crypto_packet_decrypt(uint8_t *packet, uint8_t packet_len,
 	} else {
 		uint32_t mic;
 
-		if (!mesh_crypto_aes_ccm_decrypt(nonce, network_key,
-					NULL, 0,
+		if (!ccm_decrypt(network->mic32, nonce, NULL, 0,
 					packet + 7, packet_len - 7,
 					packet + 7, &mic, sizeof(mic)))
 			return false;
@@ -914,28 +1078,70 @@ static bool mesh_crypto_packet_decrypt(uint8_t *packet, uint8_t packet_len,
 	return true;
 }
 
+bool mesh_crypto_packet_decode_ccm(const uint8_t *packet, uint8_t packet_len,
+				bool proxy, uint8_t *out, uint32_t iv_index,
+				const struct mesh_crypto_ccm *network,
+				struct l_cipher *privacy)
+{
+	bool ctl;
+	uint8_t ttl;
+	uint32_t seq;
+	uint16_t src;
+
+	if (packet_len < 14 || !network || !privacy)
+		return false;
+
+	memcpy(out, packet, packet_len);
+
+	if (!mesh_crypto_network_clarify(out, privacy, iv_index,
+						&ctl, &ttl, &seq, &src))
+		return false;
+
+	return mesh_crypto_packet_decrypt(out, packet_len, network,
+							iv_index, proxy,
+							ctl, ttl, seq, src);
+}
+
 bool mesh_crypto_packet_decode(const uint8_t *packet, uint8_t packet_len,
 				bool proxy, uint8_t *out, uint32_t iv_index,
 				const uint8_t network_key[16],
 				const uint8_t privacy_key[16])
 {
+	struct mesh_crypto_ccm *network = NULL;
+	struct l_cipher *privacy;
 	bool ctl;
 	uint8_t ttl;
 	uint32_t seq;
 	uint16_t src;
+	bool result = false;
 
 	if (packet_len < 14)
 		return false;
 
+	privacy = l_cipher_new(L_CIPHER_AES, privacy_key, 16);
+	if (!privacy)
+		return false;
+
 	memcpy(out, packet, packet_len);
 
-	if (!mesh_crypto_network_clarify(out, privacy_key, iv_index,
+	/* The MIC size is only known once the header is clarified */
+	if (!mesh_crypto_network_clarify(out, privacy, iv_index,
 						&ctl, &ttl, &seq, &src))
-		return false;
+		goto done;
+
+	network = ccm_new_mic(network_key, ctl ? 8 : 4);
+	if (!network)
+		goto done;
 
-	return mesh_crypto_packet_decrypt(out, packet_len, network_key,
+	result = mesh_crypto_packet_decrypt(out, packet_len, network,
 							iv_index, proxy,
 							ctl, ttl, seq, src);
+
+done:
+	l_cipher_free(privacy);
+	mesh_crypto_ccm_free(network);
+
+	return result;
 }
 
 bool mesh_crypto_packet_label(uint8_t *packet, uint8_t packet_len,
@@ -21,6 +21,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+struct l_cipher;
+
+/* AES-CCM contexts for one key, with 32-bit and 64-bit MIC */
+struct mesh_crypto_ccm;
+
+struct mesh_crypto_ccm *mesh_crypto_ccm_new(const uint8_t key[16]);
+void mesh_crypto_ccm_free(struct mesh_crypto_ccm *ccm);
+
 bool mesh_crypto_aes_ccm_encrypt(const uint8_t nonce[13], const uint8_t key[16],
 					const uint8_t *aad, uint16_t aad_len,
 					const void *msg, uint16_t msg_len,
@@ -92,6 +100,12 @@ bool mesh_crypto_payload_encrypt(uint8_t *aad, const uint8_t *payload,
 				uint32_t seq_num, uint32_t iv_index,
 				bool aszmic,
 				const uint8_t application_key[16]);
+bool mesh_crypto_payload_encrypt_ccm(uint8_t *aad, const uint8_t *payload,
+				uint8_t *out, uint16_t payload_len,
+				uint16_t src, uint16_t dst, uint8_t key_aid,
+				uint32_t seq_num, uint32_t iv_index,
+				bool aszmic,
+				const struct mesh_crypto_ccm *ccm);
 bool mesh_crypto_payload_decrypt(uint8_t *aad, uint16_t aad_len,
 				const uint8_t *payload, uint16_t payload_len,
 				bool szmict,
@@ -99,14 +113,29 @@ bool mesh_crypto_payload_decrypt(uint8_t *aad, uint16_t aad_len,
 				uint32_t seq_num, uint32_t iv_index,
 				uint8_t *out,
 				const uint8_t application_key[16]);
+bool mesh_crypto_payload_decrypt_ccm(uint8_t *aad, uint16_t aad_len,
+				const uint8_t *payload, uint16_t payload_len,
+				bool szmict,
+				uint16_t src, uint16_t dst, uint8_t key_aid,
+				uint32_t seq_num, uint32_t iv_index,
+				uint8_t *out,
+				const struct mesh_crypto_ccm *ccm);
 bool mesh_crypto_packet_encode(uint8_t *packet, uint8_t packet_len,
 				uint32_t iv_index,
 				const uint8_t network_key[16],
 				const uint8_t privacy_key[16]);
+bool mesh_crypto_packet_encode_ccm(uint8_t *packet, uint8_t packet_len,
+				uint32_t iv_index,
+				const struct mesh_crypto_ccm *network,
+				struct l_cipher *privacy);
 bool mesh_crypto_packet_decode(const uint8_t *packet, uint8_t packet_len,
 				bool proxy, uint8_t *out, uint32_t iv_index,
 				const uint8_t network_key[16],
 				const uint8_t privacy_key[16]);
+bool mesh_crypto_packet_decode_ccm(const uint8_t *packet, uint8_t packet_len,
+				bool proxy, uint8_t *out, uint32_t iv_index,
+				const struct mesh_crypto_ccm *network,
+				struct l_cipher *privacy);
 bool mesh_crypto_packet_label(uint8_t *packet, uint8_t packet_len,
 				uint16_t iv_index, uint8_t network_id);
 
@@ -42,6 +42,206 @@ const char *dev_key_dir = "/dev_keys";
 const char *app_key_dir = "/app_keys";
 const char *net_key_dir = "/net_keys";
 
+/*
+ * Remote device keys are looked up for every device key secured message,
+ * so a bounded copy of them is kept in memory. Slots are recycled with
+ * the clock algorithm once the cache is full.
+ */
+#define DEV_KEY_CACHE_SIZE	1024
+
+struct dev_key_entry {
+	uint16_t unicast;
+	bool used;
+	uint8_t key[16];
+};
+
+struct keyring_cache {
+	struct l_hashmap *dev_keys;
+	struct dev_key_entry *entries;
+	unsigned int hand;
+	bool complete;
+};
+
+static struct dev_key_entry *cache_lookup(struct keyring_cache *cache,
+							uint16_t unicast)
+{
+	struct dev_key_entry *entry;
+
+	if (!cache)
+		return NULL;
+
+	entry = l_hashmap_lookup(cache->dev_keys, L_UINT_TO_PTR(unicast));
+	if (entry)
+		entry->used = true;
+
+	return entry;
+}
+
+static void cache_insert(struct keyring_cache *cache, uint16_t unicast,
+						const uint8_t dev_key[16])
+{
+	struct dev_key_entry *entry;
+
+	if (!cache)
+		return;
+
+	entry = l_hashmap_lookup(cache->dev_keys, L_UINT_TO_PTR(unicast));
+	if (entry)
+		goto done;
+
+	if (!cache->entries)
+		cache->entries = l_new(struct dev_key_entry,
+							DEV_KEY_CACHE_SIZE);
+
+	/* Free slots are taken right away, recently used ones are skipped */
+	for (;;) {
+		entry = &cache->entries[cache->hand];
+		cache->hand = (cache->hand + 1) % DEV_KEY_CACHE_SIZE;
+
+		if (!entry->unicast)
+			break;
+
+		if (!entry->used)
+			break;
+
+		entry->used = false;
+	}
+
+	if (entry->unicast) {
+		l_hashmap_remove(cache->dev_keys,
+					L_UINT_TO_PTR(entry->unicast));
+		cache->complete = false;
+	}
+
+	entry->unicast = unicast;
+	l_hashmap_insert(cache->dev_keys, L_UINT_TO_PTR(unicast), entry);
+
+done:
+	entry->used = true;
+	memcpy(entry->key, dev_key, 16);
+}
+
+static void cache_remove(struct keyring_cache *cache, uint16_t unicast)
+{
+	struct dev_key_entry *entry;
+
+	if (!cache)
+		return;
+
+	entry = l_hashmap_remove(cache->dev_keys, L_UINT_TO_PTR(unicast));
+	if (!entry)
+		return;
+
+	explicit_bzero(entry, sizeof(*entry));
+}
+
+static bool cache_is_reg(int dir_fd, const struct dirent *dirent)
+{
+	struct stat st;
+
+	if (dirent->d_type != DT_UNKNOWN)
+		return dirent->d_type == DT_REG;
+
+	/* Not every filesystem reports the type of the entries */
+	if (fstatat(dir_fd, dirent->d_name, &st, 0) < 0)
+		return false;
+
+	return S_ISREG(st.st_mode);
+}
+
+static void cache_load(struct keyring_cache *cache, const char *node_path)
+{
+	char key_dir[PATH_MAX];
+	struct dirent *dirent;
+	unsigned int count = 0;
+	DIR *dir;
+	int dir_fd;
+
+	snprintf(key_dir, PATH_MAX, "%s%s", node_path, dev_key_dir);
+
+	dir = opendir(key_dir);
+	if (!dir) {
+		/* Nothing stored yet, every key will pass through the cache */
+		cache->complete = errno == ENOENT;
+		return;
+	}
+
+	dir_fd = dirfd(dir);
+	cache->complete = true;
+
+	while ((dirent = readdir(dir)) != NULL) {
+		uint8_t dev_key[16];
+		unsigned long unicast;
+		char *end;
+		int fd;
+
+		unicast = strtoul(dirent->d_name, &end, 16);
+		if (*end || !IS_UNICAST(unicast))
+			continue;
+
+		/*
+		 * Any key file that doesn't make it into the cache has to be
+		 * looked up on disk later.
+		 */
+		if (!cache_is_reg(dir_fd, dirent)) {
+			cache->complete = false;
+			continue;
+		}
+
+		if (count++ == DEV_KEY_CACHE_SIZE) {
+			cache->complete = false;
+			break;
+		}
+
+		fd = openat(dir_fd, dirent->d_name, O_RDONLY);
+		if (fd < 0) {
+			cache->complete = false;
+			continue;
+		}
+
+		if (read(fd, dev_key, 16) == 16)
+			cache_insert(cache, unicast, dev_key);
+		else
+			cache->complete = false;
+
+		close(fd);
+	}
+
+	closedir(dir);
+
+	l_debug("Cached %u Dev Keys", l_hashmap_size(cache->dev_keys));
+}
+
+struct keyring_cache *keyring_cache_new(const char *node_path)
+{
+	struct keyring_cache *cache;
+
+	if (!node_path)
+		return NULL;
+
+	cache = l_new(struct keyring_cache, 1);
+	cache->dev_keys = l_hashmap_new();
+	cache_load(cache, node_path);
+
+	return cache;
+}
+
+void keyring_cache_free(struct keyring_cache *cache)
+{
+	if (!cache)
+		return;
+
+	l_hashmap_destroy(cache->dev_keys, NULL);
+
+	if (cache->entries) {
+		explicit_bzero(cache->entries,
+			DEV_KEY_CACHE_SIZE * sizeof(struct dev_key_entry));
+		l_free(cache->entries);
+	}
+
+	l_free(cache);
+}
+
 bool keyring_put_net_key(struct mesh_node *node, uint16_t net_idx,
 						struct keyring_net_key *key)
 {
@@ -223,6 +423,14 @@ bool keyring_put_remote_dev_key(struct mesh_node *node, uint16_t unicast,
 			close(fd);
 		} else
 			result = false;
+
+		/* Write-through, cache only what made it to storage */
+		if (result)
+			cache_insert(node_get_keyring_cache(node), unicast + i,
+								dev_key);
+		else
+			cache_remove(node_get_keyring_cache(node),
+								unicast + i);
 	}
 
 	return result;
@@ -283,6 +491,8 @@ bool keyring_get_app_key(struct mesh_node *node, uint16_t app_idx,
 bool keyring_get_remote_dev_key(struct mesh_node *node, uint16_t unicast,
 							uint8_t dev_key[16])
 {
+	struct keyring_cache *cache;
+	struct dev_key_entry *entry;
 	const char *node_path;
 	char key_file[PATH_MAX];
 	bool result = false;
@@ -294,6 +504,18 @@ bool keyring_get_remote_dev_key(struct mesh_node *node, uint16_t unicast,
 	if (!node)
 		return false;
 
+	cache = node_get_keyring_cache(node);
+
+	entry = cache_lookup(cache, unicast);
+	if (entry) {
+		memcpy(dev_key, entry->key, 16);
+		return true;
+	}
+
+	/* Every stored key is cached, no need to look any further */
+	if (cache && cache->complete)
+		return false;
+
 	node_path = node_get_storage_dir(node);
 
 	snprintf(key_file, PATH_MAX, "%s%s/%4.4x", node_path, dev_key_dir,
@@ -307,6 +529,9 @@ bool keyring_get_remote_dev_key(struct mesh_node *node, uint16_t unicast,
 		close(fd);
 	}
 
+	if (result)
+		cache_insert(cache, unicast, dev_key);
+
 	return result;
 }
 
@@ -367,6 +592,8 @@ bool keyring_del_remote_dev_key(struct mesh_node *node, uint16_t unicast,
 						dev_key_dir, unicast + i);
 		l_debug("RM Dev Key %s", key_file);
 		remove(key_file);
+
+		cache_remove(node_get_keyring_cache(node), unicast + i);
 	}
 
 	return true;
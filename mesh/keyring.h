@@ -31,6 +31,11 @@ struct keyring_app_key {
 	uint8_t new_key[16];
 };
 
+struct keyring_cache;
+
+struct keyring_cache *keyring_cache_new(const char *node_path);
+void keyring_cache_free(struct keyring_cache *cache);
+
 bool keyring_put_net_key(struct mesh_node *node, uint16_t net_idx,
 						struct keyring_net_key *key);
 bool keyring_get_net_key(struct mesh_node *node, uint16_t net_idx,
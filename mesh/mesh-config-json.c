@@ -28,11 +28,13 @@
 #include <ftw.h>
 #include <libgen.h>
 #include <limits.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
 #include <sys/time.h>
+#include <sys/uio.h>
 
 #include <ell/ell.h>
 #include <json-c/json.h>
@@ -46,6 +48,14 @@
 #define MIN_SEQ_CACHE_VALUE	(2 * 32)
 #define MIN_SEQ_CACHE_TIME	(5 * 60)
 
+/*
+ * Changes are appended to a log next to node.json and folded into it
+ * once the log grows past CONFIG_LOG_MAX or CONFIG_COMPACT_DELAY seconds
+ * after the first change that is not part of node.json yet.
+ */
+#define CONFIG_LOG_MAX		(64 * 1024)
+#define CONFIG_COMPACT_DELAY	30
+
 #define CHECK_KEY_IDX_RANGE(x) ((x) <= 4095)
 
 struct mesh_config {
@@ -55,6 +65,10 @@ struct mesh_config {
 	uint32_t write_seq;
 	struct timeval write_time;
 	struct l_queue *idles;
+	struct l_timeout *compact;
+	char *log_path;
+	int log_fd;
+	size_t log_size;
 };
 
 struct write_info {
@@ -66,6 +80,8 @@ struct write_info {
 static const char *cfgnode_name = "/node.json";
 static const char *bak_ext = ".bak";
 static const char *tmp_ext = ".tmp";
+static const char *log_ext = ".log";
+static const char *log_model_key = "elementModel";
 
 static bool save_config(json_object *jnode, const char *fname)
 {
@@ -91,6 +107,265 @@ static bool save_config(json_object *jnode, const char *fname)
 	return result;
 }
 
+/* The change log belongs to node.json, also when loading the backup */
+static char *get_log_path(const char *fname)
+{
+	size_t len = strlen(fname);
+	size_t ext_len = strlen(bak_ext);
+
+	if (len > ext_len && !strcmp(fname + len - ext_len, bak_ext))
+		len -= ext_len;
+
+	return l_strdup_printf("%.*s%s", (int) len, fname, log_ext);
+}
+
+static const char *get_model_id(json_object *jmodel)
+{
+	json_object *jvalue;
+
+	if (!json_object_object_get_ex(jmodel, "modelId", &jvalue))
+		return NULL;
+
+	return json_object_get_string(jvalue);
+}
+
+/* Replace the model with the same ID in the given element */
+static void replay_model(json_object *jnode, json_object *jentry)
+{
+	json_object *jelements, *jelement, *jmodels, *jmodel, *jvalue;
+	const char *id;
+	int i, ele_idx;
+
+	if (!json_object_object_get_ex(jentry, "element", &jvalue))
+		return;
+
+	ele_idx = json_object_get_int(jvalue);
+
+	if (!json_object_object_get_ex(jentry, "model", &jmodel))
+		return;
+
+	id = get_model_id(jmodel);
+	if (!id)
+		return;
+
+	if (!json_object_object_get_ex(jnode, "elements", &jelements))
+		return;
+
+	jelement = json_object_array_get_idx(jelements, ele_idx);
+	if (!jelement)
+		return;
+
+	if (!json_object_object_get_ex(jelement, "models", &jmodels))
+		return;
+
+	for (i = 0; i < json_object_array_length(jmodels); i++) {
+		const char *str;
+
+		str = get_model_id(json_object_array_get_idx(jmodels, i));
+		if (!str || strcmp(str, id))
+			continue;
+
+		json_object_array_put_idx(jmodels, i, json_object_get(jmodel));
+		return;
+	}
+}
+
+/*
+ * Each log record is an object holding the new value of top level keys,
+ * or of one model of an element under log_model_key.
+ */
+static void replay_record(json_object *jnode, json_object *jrecord)
+{
+	json_object_object_foreach(jrecord, key, jvalue) {
+		if (!strcmp(key, log_model_key)) {
+			replay_model(jnode, jvalue);
+			continue;
+		}
+
+		json_object_object_del(jnode, key);
+
+		if (jvalue)
+			json_object_object_add(jnode, key,
+						json_object_get(jvalue));
+	}
+}
+
+/* Returns the size of the log, which is non-zero if it needs compaction */
+static size_t replay_log(json_object *jnode, const char *log_path)
+{
+	char *str, *line, *next;
+	struct stat st;
+	size_t count = 0;
+	ssize_t sz;
+	int fd;
+
+	fd = open(log_path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	if (fstat(fd, &st) < 0 || !st.st_size) {
+		close(fd);
+		return 0;
+	}
+
+	str = l_malloc(st.st_size + 1);
+	sz = read(fd, str, st.st_size);
+	close(fd);
+
+	if (sz < 0)
+		sz = 0;
+
+	str[sz] = '\0';
+
+	for (line = str; line && *line; line = next) {
+		json_object *jrecord;
+
+		next = strchr(line, '\n');
+
+		/* A record without newline was cut short by a crash */
+		if (!next)
+			break;
+
+		*next++ = '\0';
+
+		jrecord = json_tokener_parse(line);
+		if (!jrecord || !json_object_is_type(jrecord,
+							json_type_object)) {
+			json_object_put(jrecord);
+			break;
+		}
+
+		replay_record(jnode, jrecord);
+		json_object_put(jrecord);
+		count++;
+	}
+
+	l_free(str);
+
+	l_debug("Replayed %zu changes from %s", count, log_path);
+
+	return st.st_size;
+}
+
+static void compact_timeout(struct l_timeout *timeout, void *user_data)
+{
+	struct mesh_config *cfg = user_data;
+
+	l_timeout_remove(timeout);
+	cfg->compact = NULL;
+
+	mesh_config_save(cfg, true, NULL, NULL);
+}
+
+static bool append_log(struct mesh_config *cfg, const char *str)
+{
+	struct iovec iov[2];
+	size_t len = strlen(str);
+	ssize_t written;
+
+	if (cfg->log_fd < 0) {
+		cfg->log_fd = open(cfg->log_path, O_WRONLY | O_CREAT |
+						O_APPEND | O_CLOEXEC,
+						S_IRUSR | S_IWUSR);
+		if (cfg->log_fd < 0)
+			return false;
+	}
+
+	iov[0].iov_base = (void *) str;
+	iov[0].iov_len = len;
+	iov[1].iov_base = "\n";
+	iov[1].iov_len = 1;
+
+	written = writev(cfg->log_fd, iov, 2);
+	if (written < 0)
+		return false;
+
+	cfg->log_size += written;
+
+	return (size_t) written == len + 1;
+}
+
+/* Append the record to the log and schedule folding it into node.json */
+static bool save_record(struct mesh_config *cfg, json_object *jrecord)
+{
+	bool result;
+
+	result = append_log(cfg, json_object_to_json_string_ext(jrecord,
+						JSON_C_TO_STRING_PLAIN));
+	json_object_put(jrecord);
+
+	/* Fall back to writing everything out right away */
+	if (!result)
+		return mesh_config_save(cfg, true, NULL, NULL);
+
+	gettimeofday(&cfg->write_time, NULL);
+
+	if (cfg->log_size >= CONFIG_LOG_MAX) {
+		if (l_queue_isempty(cfg->idles))
+			mesh_config_save(cfg, false, NULL, NULL);
+	} else if (!cfg->compact) {
+		cfg->compact = l_timeout_create(CONFIG_COMPACT_DELAY,
+						compact_timeout, cfg, NULL);
+	}
+
+	return true;
+}
+
+/*
+ * Record the current value of the given top level keys of the node. Only
+ * the changed keys are serialized, the full node.json is rewritten later
+ * at most once for all changes made in the meantime.
+ */
+static bool save_node(struct mesh_config *cfg, const char *key, ...)
+{
+	json_object *jrecord;
+	va_list args;
+
+	jrecord = json_object_new_object();
+	if (!jrecord)
+		return false;
+
+	va_start(args, key);
+
+	for (; key; key = va_arg(args, const char *)) {
+		json_object *jvalue = NULL;
+
+		if (json_object_object_get_ex(cfg->jnode, key, &jvalue))
+			json_object_get(jvalue);
+
+		json_object_object_add(jrecord, key, jvalue);
+	}
+
+	va_end(args);
+
+	return save_record(cfg, jrecord);
+}
+
+/* Record the current value of a single model of the given element */
+static bool save_model(struct mesh_config *cfg, int ele_idx,
+							json_object *jmodel)
+{
+	json_object *jrecord, *jentry;
+
+	jrecord = json_object_new_object();
+	if (!jrecord)
+		return false;
+
+	jentry = json_object_new_object();
+	if (!jentry) {
+		json_object_put(jrecord);
+		return false;
+	}
+
+	json_object_object_add(jentry, "element",
+					json_object_new_int(ele_idx));
+	json_object_object_add(jentry, "model", json_object_get(jmodel));
+	json_object_object_add(jrecord, log_model_key, jentry);
+
+	return save_record(cfg, jrecord);
+}
+
+
 static bool get_int(json_object *jobj, const char *keyword, int *value)
 {
 	json_object *jvalue;
@@ -636,7 +911,7 @@ bool mesh_config_net_key_add(struct mesh_config *cfg, uint16_t idx,
 
 	json_object_array_add(jarray, jentry);
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "netKeys", NULL);
 
 fail:
 	if (jentry)
@@ -678,7 +953,7 @@ bool mesh_config_net_key_update(struct mesh_config *cfg, uint16_t idx,
 	json_object_object_add(jentry, "keyRefresh",
 				json_object_new_int(KEY_REFRESH_PHASE_ONE));
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "netKeys", NULL);
 }
 
 bool mesh_config_net_key_del(struct mesh_config *cfg, uint16_t idx)
@@ -698,7 +973,7 @@ bool mesh_config_net_key_del(struct mesh_config *cfg, uint16_t idx)
 	if (!json_object_array_length(jarray))
 		json_object_object_del(jnode, "netKeys");
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "netKeys", NULL);
 }
 
 bool mesh_config_write_device_key(struct mesh_config *cfg, uint8_t *key)
@@ -706,7 +981,7 @@ bool mesh_config_write_device_key(struct mesh_config *cfg, uint8_t *key)
 	if (!cfg || !add_key_value(cfg->jnode, "deviceKey", key))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "deviceKey", NULL);
 }
 
 bool mesh_config_write_token(struct mesh_config *cfg, uint8_t *token)
@@ -714,7 +989,7 @@ bool mesh_config_write_token(struct mesh_config *cfg, uint8_t *token)
 	if (!cfg || !add_u64_value(cfg->jnode, "token", token))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "token", NULL);
 }
 
 bool mesh_config_app_key_add(struct mesh_config *cfg, uint16_t net_idx,
@@ -757,7 +1032,7 @@ bool mesh_config_app_key_add(struct mesh_config *cfg, uint16_t net_idx,
 
 	json_object_array_add(jarray, jentry);
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "appKeys", NULL);
 
 fail:
 
@@ -799,7 +1074,7 @@ bool mesh_config_app_key_update(struct mesh_config *cfg, uint16_t app_idx,
 	if (!add_key_value(jentry, "key", key))
 		return false;
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "appKeys", NULL);
 }
 
 bool mesh_config_app_key_del(struct mesh_config *cfg, uint16_t net_idx,
@@ -820,7 +1095,7 @@ bool mesh_config_app_key_del(struct mesh_config *cfg, uint16_t net_idx,
 	if (!json_object_array_length(jarray))
 		json_object_object_del(jnode, "appKeys");
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "appKeys", NULL);
 }
 
 bool mesh_config_model_binding_add(struct mesh_config *cfg, uint16_t ele_addr,
@@ -865,7 +1140,7 @@ bool mesh_config_model_binding_add(struct mesh_config *cfg, uint16_t ele_addr,
 
 	json_object_array_add(jarray, jstring);
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_model(cfg, ele_idx, jmodel);
 }
 
 bool mesh_config_model_binding_del(struct mesh_config *cfg, uint16_t ele_addr,
@@ -899,7 +1174,7 @@ bool mesh_config_model_binding_del(struct mesh_config *cfg, uint16_t ele_addr,
 	if (!json_object_array_length(jarray))
 		json_object_object_del(jmodel, "bind");
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_model(cfg, ele_idx, jmodel);
 }
 
 static void free_model(void *data)
@@ -1489,7 +1764,7 @@ bool mesh_config_write_mode(struct mesh_config *cfg, const char *keyword,
 	if (!cfg || !write_mode(cfg->jnode, keyword, value))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, keyword, NULL);
 }
 
 static bool write_relay_mode(json_object *jobj, uint8_t mode,
@@ -1525,7 +1800,7 @@ bool mesh_config_write_unicast(struct mesh_config *cfg, uint16_t unicast)
 	if (!cfg || !write_uint16_hex(cfg->jnode, "unicastAddress", unicast))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "unicastAddress", NULL);
 }
 
 bool mesh_config_write_relay_mode(struct mesh_config *cfg, uint8_t mode,
@@ -1535,7 +1810,7 @@ bool mesh_config_write_relay_mode(struct mesh_config *cfg, uint8_t mode,
 	if (!cfg || !write_relay_mode(cfg->jnode, mode, count, interval))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "relay", NULL);
 }
 
 bool mesh_config_write_net_transmit(struct mesh_config *cfg, uint8_t cnt,
@@ -1561,7 +1836,7 @@ bool mesh_config_write_net_transmit(struct mesh_config *cfg, uint8_t cnt,
 	json_object_object_del(jnode, "retransmit");
 	json_object_object_add(jnode, "retransmit", jrtx);
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "retransmit", NULL);
 
 fail:
 	json_object_put(jrtx);
@@ -1586,7 +1861,7 @@ bool mesh_config_write_iv_index(struct mesh_config *cfg, uint32_t idx,
 	if (!write_int(jnode, "IVupdate", tmp))
 		return false;
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "IVindex", "IVupdate", NULL);
 }
 
 static void add_model(void *a, void *b)
@@ -1710,6 +1985,8 @@ static struct mesh_config *create_config(const char *cfg_path,
 	cfg->jnode = jnode;
 	memcpy(cfg->uuid, uuid, 16);
 	cfg->node_dir_path = l_strdup(cfg_path);
+	cfg->log_path = get_log_path(cfg_path);
+	cfg->log_fd = -1;
 	cfg->write_seq = node->seq_number;
 	cfg->idles = l_queue_new();
 	gettimeofday(&cfg->write_time, NULL);
@@ -1809,7 +2086,7 @@ bool mesh_config_net_key_set_phase(struct mesh_config *cfg, uint16_t idx,
 		finish_key_refresh(jnode, idx);
 	}
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "netKeys", "appKeys", NULL);
 }
 
 bool mesh_config_model_pub_add(struct mesh_config *cfg, uint16_t ele_addr,
@@ -1872,40 +2149,39 @@ bool mesh_config_model_pub_add(struct mesh_config *cfg, uint16_t ele_addr,
 	json_object_object_add(jpub, "retransmit", jrtx);
 	json_object_object_add(jmodel, "publish", jpub);
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_model(cfg, ele_idx, jmodel);
 
 fail:
 	json_object_put(jpub);
 	return false;
 }
 
-static bool delete_model_property(json_object *jnode, uint16_t ele_addr,
+static bool delete_model_property(struct mesh_config *cfg, uint16_t ele_addr,
 			uint32_t mod_id, bool vendor, const char *keyword)
 {
 	json_object *jmodel;
 	int ele_idx;
 
-	ele_idx = get_element_index(jnode, ele_addr);
+	if (!cfg)
+		return false;
+
+	ele_idx = get_element_index(cfg->jnode, ele_addr);
 	if (ele_idx < 0)
 		return false;
 
-	jmodel = get_element_model(jnode, ele_idx, mod_id, vendor);
+	jmodel = get_element_model(cfg->jnode, ele_idx, mod_id, vendor);
 	if (!jmodel)
 		return false;
 
 	json_object_object_del(jmodel, keyword);
 
-	return true;
+	return save_model(cfg, ele_idx, jmodel);
 }
 
 bool mesh_config_model_pub_del(struct mesh_config *cfg, uint16_t addr,
 						uint32_t mod_id, bool vendor)
 {
-	if (!cfg || !delete_model_property(cfg->jnode, addr, mod_id, vendor,
-								"publish"))
-		return false;
-
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return delete_model_property(cfg, addr, mod_id, vendor, "publish");
 }
 
 static void del_page(json_object *jarray, uint8_t page)
@@ -1965,7 +2241,7 @@ bool mesh_config_comp_page_add(struct mesh_config *cfg, uint8_t page,
 	json_object_array_add(jarray, jstring);
 	l_free(buf);
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_node(cfg, "pages", NULL);
 }
 
 bool mesh_config_comp_page_mv(struct mesh_config *cfg, uint8_t old, uint8_t nw)
@@ -2063,7 +2339,7 @@ bool mesh_config_model_sub_add(struct mesh_config *cfg, uint16_t ele_addr,
 
 	json_object_array_add(jarray, jstring);
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_model(cfg, ele_idx, jmodel);
 }
 
 bool mesh_config_model_sub_del(struct mesh_config *cfg, uint16_t ele_addr,
@@ -2103,17 +2379,13 @@ bool mesh_config_model_sub_del(struct mesh_config *cfg, uint16_t ele_addr,
 	if (!json_object_array_length(jarray))
 		json_object_object_del(jmodel, "subscribe");
 
-	return save_config(jnode, cfg->node_dir_path);
+	return save_model(cfg, ele_idx, jmodel);
 }
 
 bool mesh_config_model_sub_del_all(struct mesh_config *cfg, uint16_t addr,
 						uint32_t mod_id, bool vendor)
 {
-	if (!cfg || !delete_model_property(cfg->jnode, addr, mod_id, vendor,
-								"subscribe"))
-		return false;
-
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return delete_model_property(cfg, addr, mod_id, vendor, "subscribe");
 }
 
 bool mesh_config_model_pub_enable(struct mesh_config *cfg, uint16_t ele_addr,
@@ -2142,7 +2414,7 @@ bool mesh_config_model_pub_enable(struct mesh_config *cfg, uint16_t ele_addr,
 	if (!enable)
 		json_object_object_del(jmodel, "publish");
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_model(cfg, ele_idx, jmodel);
 }
 
 bool mesh_config_model_sub_enable(struct mesh_config *cfg, uint16_t ele_addr,
@@ -2171,7 +2443,7 @@ bool mesh_config_model_sub_enable(struct mesh_config *cfg, uint16_t ele_addr,
 	if (!enable)
 		json_object_object_del(jmodel, "subscribe");
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_model(cfg, ele_idx, jmodel);
 }
 
 bool mesh_config_write_seq_number(struct mesh_config *cfg, uint32_t seq,
@@ -2187,7 +2459,7 @@ bool mesh_config_write_seq_number(struct mesh_config *cfg, uint32_t seq,
 		if (!write_int(cfg->jnode, "sequenceNumber", seq))
 			return false;
 
-		return mesh_config_save(cfg, true, NULL, NULL);
+		return save_node(cfg, "sequenceNumber", NULL);
 	}
 
 	/* If resetting seq to Zero, make sure cached value reset as well */
@@ -2244,7 +2516,7 @@ bool mesh_config_write_seq_number(struct mesh_config *cfg, uint32_t seq,
 		if (!write_int(cfg->jnode, "sequenceNumber", cached))
 		    return false;
 
-		return mesh_config_save(cfg, false, NULL, NULL);
+		return save_node(cfg, "sequenceNumber", NULL);
 	}
 
 	return true;
@@ -2255,7 +2527,7 @@ bool mesh_config_write_ttl(struct mesh_config *cfg, uint8_t ttl)
 	if (!cfg || !write_int(cfg->jnode, "defaultTTL", ttl))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "defaultTTL", NULL);
 }
 
 bool mesh_config_update_company_id(struct mesh_config *cfg, uint16_t cid)
@@ -2263,7 +2535,7 @@ bool mesh_config_update_company_id(struct mesh_config *cfg, uint16_t cid)
 	if (!cfg || !write_uint16_hex(cfg->jnode, "cid", cid))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "cid", NULL);
 }
 
 bool mesh_config_update_product_id(struct mesh_config *cfg, uint16_t pid)
@@ -2271,7 +2543,7 @@ bool mesh_config_update_product_id(struct mesh_config *cfg, uint16_t pid)
 	if (!cfg || !write_uint16_hex(cfg->jnode, "pid", pid))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "pid", NULL);
 }
 
 bool mesh_config_update_version_id(struct mesh_config *cfg, uint16_t vid)
@@ -2279,7 +2551,7 @@ bool mesh_config_update_version_id(struct mesh_config *cfg, uint16_t vid)
 	if (!cfg || !write_uint16_hex(cfg->jnode, "vid", vid))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "vid", NULL);
 }
 
 bool mesh_config_update_crpl(struct mesh_config *cfg, uint16_t crpl)
@@ -2287,7 +2559,7 @@ bool mesh_config_update_crpl(struct mesh_config *cfg, uint16_t crpl)
 	if (!cfg || !write_uint16_hex(cfg->jnode, "crpl", crpl))
 		return false;
 
-	return save_config(cfg->jnode, cfg->node_dir_path);
+	return save_node(cfg, "crpl", NULL);
 }
 
 static bool load_node(const char *fname, const uint8_t uuid[16],
@@ -2300,6 +2572,8 @@ static bool load_node(const char *fname, const uint8_t uuid[16],
 	bool result = false;
 	json_object *jnode;
 	struct mesh_config_node node;
+	char *log_path = NULL;
+	size_t log_size = 0;
 
 	if (!cb) {
 		l_info("Node read callback is required");
@@ -2333,6 +2607,9 @@ static bool load_node(const char *fname, const uint8_t uuid[16],
 	if (!jnode)
 		goto done;
 
+	log_path = get_log_path(fname);
+	log_size = replay_log(jnode, log_path);
+
 	memset(&node, 0, sizeof(node));
 
 	node.elements = l_queue_new();
@@ -2348,16 +2625,25 @@ static bool load_node(const char *fname, const uint8_t uuid[16],
 		cfg->jnode = jnode;
 		memcpy(cfg->uuid, uuid, 16);
 		cfg->node_dir_path = l_strdup(fname);
+		cfg->log_path = log_path;
+		cfg->log_fd = -1;
+		cfg->log_size = log_size;
 		cfg->write_seq = node.seq_number;
 		cfg->idles = l_queue_new();
 		gettimeofday(&cfg->write_time, NULL);
 
+		log_path = NULL;
+
 		result = cb(&node, uuid, cfg, user_data);
 
 		if (!result) {
 			l_free(cfg->idles);
+			l_free(cfg->log_path);
 			l_free(cfg->node_dir_path);
 			l_free(cfg);
+		} else if (log_size) {
+			/* Fold the log into node.json before it gets appended */
+			mesh_config_save(cfg, true, NULL, NULL);
 		}
 	}
 
@@ -2376,6 +2662,8 @@ done:
 	if (str)
 		l_free(str);
 
+	l_free(log_path);
+
 	return result;
 }
 
@@ -2392,7 +2680,12 @@ void mesh_config_release(struct mesh_config *cfg)
 		return;
 
 	l_queue_destroy(cfg->idles, release_idle);
+	l_timeout_remove(cfg->compact);
 
+	if (cfg->log_fd >= 0)
+		close(cfg->log_fd);
+
+	l_free(cfg->log_path);
 	l_free(cfg->node_dir_path);
 	json_object_put(cfg->jnode);
 	l_free(cfg);
@@ -2401,10 +2694,11 @@ void mesh_config_release(struct mesh_config *cfg)
 static void idle_save_config(struct l_idle *idle, void *user_data)
 {
 	struct write_info *info = user_data;
+	struct mesh_config *cfg = info->cfg;
 	char *fname_tmp, *fname_bak, *fname_cfg;
 	bool result = false;
 
-	fname_cfg = info->cfg->node_dir_path;
+	fname_cfg = cfg->node_dir_path;
 	fname_tmp = l_strdup_printf("%s%s", fname_cfg, tmp_ext);
 	fname_bak = l_strdup_printf("%s%s", fname_cfg, bak_ext);
 	remove(fname_tmp);
@@ -2415,6 +2709,21 @@ static void idle_save_config(struct l_idle *idle, void *user_data)
 		remove(fname_bak);
 		rename(fname_cfg, fname_bak);
 		rename(fname_tmp, fname_cfg);
+
+		/* Every logged change is part of node.json now */
+		if (cfg->log_size) {
+			if (cfg->log_fd >= 0)
+				close(cfg->log_fd);
+
+			cfg->log_fd = -1;
+			cfg->log_size = 0;
+
+			if (truncate(cfg->log_path, 0) < 0)
+				l_warn("Failed to reset %s", cfg->log_path);
+		}
+
+		l_timeout_remove(cfg->compact);
+		cfg->compact = NULL;
 	}
 
 	remove(fname_tmp);
@@ -68,6 +68,7 @@ struct mod_forward {
 	const uint8_t *data;
 	uint16_t src;
 	uint16_t dst;
+	struct l_hashmap *subscribers;
 	uint16_t unicast;
 	uint16_t app_idx;
 	uint16_t net_idx;
@@ -80,6 +81,88 @@ struct mod_forward {
 
 static struct l_queue *mesh_virtuals;
 
+/* Virtual address to labels, several labels may hash to the same address */
+static struct l_hashmap *virt_addrs;
+
+/* Group address to the set of models, on any node, subscribed to it */
+static struct l_hashmap *group_subs;
+
+static void index_add(struct l_hashmap *index, uint16_t addr, void *data)
+{
+	struct l_queue *list = l_hashmap_lookup(index, L_UINT_TO_PTR(addr));
+
+	if (!index)
+		return;
+
+	if (!list) {
+		list = l_queue_new();
+		l_hashmap_insert(index, L_UINT_TO_PTR(addr), list);
+	}
+
+	l_queue_push_tail(list, data);
+}
+
+static void index_del(struct l_hashmap *index, uint16_t addr, void *data)
+{
+	struct l_queue *list = l_hashmap_lookup(index, L_UINT_TO_PTR(addr));
+
+	if (!list || !l_queue_remove(list, data) || !l_queue_isempty(list))
+		return;
+
+	l_hashmap_remove(index, L_UINT_TO_PTR(addr));
+	l_queue_destroy(list, NULL);
+}
+
+static void index_destroy(void *data)
+{
+	l_queue_destroy(data, NULL);
+}
+
+static void sub_index_add(uint16_t addr, struct mesh_model *mod)
+{
+	struct l_hashmap *set = l_hashmap_lookup(group_subs,
+							L_UINT_TO_PTR(addr));
+
+	if (!group_subs)
+		return;
+
+	if (!set) {
+		set = l_hashmap_new();
+		l_hashmap_insert(group_subs, L_UINT_TO_PTR(addr), set);
+	}
+
+	l_hashmap_insert(set, mod, mod);
+}
+
+static void sub_index_del(uint16_t addr, struct mesh_model *mod)
+{
+	struct l_hashmap *set = l_hashmap_lookup(group_subs,
+							L_UINT_TO_PTR(addr));
+
+	if (!set || !l_hashmap_remove(set, mod) || l_hashmap_size(set))
+		return;
+
+	l_hashmap_remove(group_subs, L_UINT_TO_PTR(addr));
+	l_hashmap_destroy(set, NULL);
+}
+
+static void sub_index_destroy(void *data)
+{
+	l_hashmap_destroy(data, NULL);
+}
+
+static void clear_subs(struct mesh_model *mod)
+{
+	const struct l_queue_entry *entry;
+
+	entry = l_queue_get_entries(mod->subs);
+
+	for (; entry; entry = entry->next)
+		sub_index_del(L_PTR_TO_UINT(entry->data), mod);
+
+	l_queue_clear(mod->subs, NULL);
+}
+
 static bool is_internal(uint32_t id)
 {
 	if (id == CONFIG_SRV_MODEL || id == CONFIG_CLI_MODEL)
@@ -99,6 +182,7 @@ static void unref_virt(void *data)
 		return;
 
 	l_queue_remove(mesh_virtuals, virt);
+	index_del(virt_addrs, virt->addr, virt);
 	l_free(virt);
 }
 
@@ -372,7 +456,7 @@ static void forward_model(void *a, void *b)
 			dst = virt->addr;
 		}
 	} else {
-		if (l_queue_find(mod->subs, simple_match, L_UINT_TO_PTR(dst)))
+		if (l_hashmap_lookup(fwd->subscribers, mod))
 			fwd->has_dst = true;
 	}
 
@@ -400,15 +484,17 @@ static int app_packet_decrypt(struct mesh_net *net, const uint8_t *data,
 				uint8_t key_aid, uint32_t seq,
 				uint32_t iv_idx, uint8_t *out)
 {
-	struct l_queue *app_keys = mesh_net_get_app_keys(net);
+	struct l_queue *app_keys = mesh_net_get_app_key_aid(net, key_aid);
 	const struct l_queue_entry *entry;
 
 	if (!app_keys)
 		return -1;
 
+	/* Only keys with a matching AID in either generation are listed */
 	for (entry = l_queue_get_entries(app_keys); entry;
 							entry = entry->next) {
 		const uint8_t *old_key = NULL, *new_key = NULL;
+		const struct mesh_crypto_ccm *old_ccm, *new_ccm;
 		uint8_t old_key_aid, new_key_aid;
 		int app_idx;
 		bool decrypted;
@@ -420,10 +506,12 @@ static int app_packet_decrypt(struct mesh_net *net, const uint8_t *data,
 		if (app_idx < 0)
 			continue;
 
-		if (old_key && old_key_aid == key_aid) {
-			decrypted = mesh_crypto_payload_decrypt(virt, virt_size,
-					data, size, szmict, src, dst, key_aid,
-						seq, iv_idx, out, old_key);
+		appkey_get_ccm_idx(entry->data, &old_ccm, &new_ccm);
+
+		if (old_ccm && old_key_aid == key_aid) {
+			decrypted = mesh_crypto_payload_decrypt_ccm(virt,
+					virt_size, data, size, szmict, src, dst,
+					key_aid, seq, iv_idx, out, old_ccm);
 
 			if (decrypted) {
 				print_packet("Used App Key", old_key, 16);
@@ -433,10 +521,10 @@ static int app_packet_decrypt(struct mesh_net *net, const uint8_t *data,
 			print_packet("Failed App Key", old_key, 16);
 		}
 
-		if (new_key && new_key_aid == key_aid) {
-			decrypted = mesh_crypto_payload_decrypt(virt, virt_size,
-					data, size, szmict, src, dst, key_aid,
-						seq, iv_idx, out, new_key);
+		if (new_ccm && new_key_aid == key_aid) {
+			decrypted = mesh_crypto_payload_decrypt_ccm(virt,
+					virt_size, data, size, szmict, src, dst,
+					key_aid, seq, iv_idx, out, new_ccm);
 
 			if (decrypted) {
 				print_packet("Used App Key", new_key, 16);
@@ -483,15 +571,14 @@ static int virt_packet_decrypt(struct mesh_net *net, const uint8_t *data,
 				uint32_t iv_idx, uint8_t *out,
 				struct mesh_virtual **decrypt_virt)
 {
+	struct l_queue *labels = l_hashmap_lookup(virt_addrs,
+							L_UINT_TO_PTR(dst));
 	const struct l_queue_entry *v;
 
-	for (v = l_queue_get_entries(mesh_virtuals); v; v = v->next) {
+	for (v = l_queue_get_entries(labels); v; v = v->next) {
 		struct mesh_virtual *virt = v->data;
 		int decrypt_idx;
 
-		if (virt->addr != dst)
-			continue;
-
 		decrypt_idx = app_packet_decrypt(net, data, size, szmict, src,
 							dst, virt->label, 16,
 							key_aid, seq, iv_idx,
@@ -514,9 +601,11 @@ static bool msg_send(struct mesh_node *node, bool cred, uint16_t src,
 {
 	uint8_t dev_key[16];
 	uint32_t iv_index, seq_num;
-	const uint8_t *key;
+	const uint8_t *key = NULL;
+	const struct mesh_crypto_ccm *ccm = NULL;
 	uint8_t *out;
 	uint8_t key_aid = APP_AID_DEV;
+	bool result;
 	bool szmic = false;
 	bool ret = false;
 	uint16_t out_len = msg_len + sizeof(uint32_t);
@@ -540,8 +629,8 @@ static bool msg_send(struct mesh_node *node, bool cred, uint16_t src,
 
 		key = dev_key;
 	} else {
-		key = appkey_get_key(node_get_net(node), app_idx, &key_aid);
-		if (!key) {
+		ccm = appkey_get_ccm(node_get_net(node), app_idx, &key_aid);
+		if (!ccm) {
 			l_debug("no app key for (%x)", app_idx);
 			return false;
 		}
@@ -553,8 +642,16 @@ static bool msg_send(struct mesh_node *node, bool cred, uint16_t src,
 
 	seq_num = mesh_net_next_seq_num(net);
 
-	if (!mesh_crypto_payload_encrypt(label, msg, out, msg_len, src, dst,
-				key_aid, seq_num, iv_index, szmic, key)) {
+	if (ccm)
+		result = mesh_crypto_payload_encrypt_ccm(label, msg, out,
+						msg_len, src, dst, key_aid,
+						seq_num, iv_index, szmic, ccm);
+	else
+		result = mesh_crypto_payload_encrypt(label, msg, out, msg_len,
+						src, dst, key_aid, seq_num,
+						iv_index, szmic, key);
+
+	if (!result) {
 		l_error("Failed to Encrypt Payload");
 		goto done;
 	}
@@ -696,6 +793,7 @@ static struct mesh_virtual *add_virtual(const uint8_t *v)
 	memcpy(virt->label, v, 16);
 	virt->ref_cnt = 1;
 	l_queue_push_head(mesh_virtuals, virt);
+	index_add(virt_addrs, virt->addr, virt);
 
 	return virt;
 }
@@ -772,6 +870,7 @@ static int add_sub(struct mesh_net *net, struct mesh_model *mod,
 		return MESH_STATUS_INSUFF_RESOURCES;
 
 	l_queue_push_tail(mod->subs, L_UINT_TO_PTR(addr));
+	sub_index_add(addr, mod);
 	mesh_net_dst_reg(net, addr);
 	l_debug("Added group subscription %4.4x", addr);
 
@@ -931,6 +1030,15 @@ bool mesh_model_rx(struct mesh_node *node, bool szmict, uint32_t seq0,
 
 	is_subscription = !(IS_UNICAST(dst));
 
+	if (is_subscription && !decrypt_virt && !IS_FIXED_GROUP_ADDRESS(dst)) {
+		forward.subscribers = l_hashmap_lookup(group_subs,
+							L_UINT_TO_PTR(dst));
+
+		/* No model of any local node is subscribed to the group */
+		if (!forward.subscribers)
+			goto done;
+	}
+
 	for (i = 0; i < num_ele; i++) {
 		struct l_queue *models;
 
@@ -1148,6 +1256,7 @@ void mesh_model_free(void *data)
 	struct mesh_model *mod = data;
 
 	l_queue_destroy(mod->bindings, NULL);
+	clear_subs(mod);
 	l_queue_destroy(mod->subs, NULL);
 	l_queue_destroy(mod->virtuals, unref_virt);
 	l_free(mod->pub);
@@ -1164,7 +1273,7 @@ static void remove_subs(struct mesh_node *node, struct mesh_model *mod)
 	for (; entry; entry = entry->next)
 		mesh_net_dst_unreg(net, (uint16_t) L_PTR_TO_UINT(entry->data));
 
-	l_queue_clear(mod->subs, NULL);
+	clear_subs(mod);
 	l_queue_clear(mod->virtuals, unref_virt);
 }
 
@@ -1497,7 +1606,7 @@ int mesh_model_sub_ovrt(struct mesh_node *node, uint16_t ele_addr, uint32_t id,
 	if (!mod->sub_enabled || (mod->cbs && !(mod->cbs->sub)))
 		return MESH_STATUS_NOT_SUB_MOD;
 
-	l_queue_clear(mod->subs, NULL);
+	clear_subs(mod);
 	l_queue_clear(mod->virtuals, unref_virt);
 
 	add_sub(node_get_net(node), mod, addr);
@@ -1526,7 +1635,7 @@ int mesh_model_virt_sub_ovrt(struct mesh_node *node, uint16_t ele_addr,
 	if (!mod->sub_enabled || (mod->cbs && !(mod->cbs->sub)))
 		return MESH_STATUS_NOT_SUB_MOD;
 
-	l_queue_clear(mod->subs, NULL);
+	clear_subs(mod);
 	l_queue_clear(mod->virtuals, unref_virt);
 
 	status = add_virt_sub(node_get_net(node), mod, label, addr);
@@ -1555,6 +1664,7 @@ int mesh_model_sub_del(struct mesh_node *node, uint16_t ele_addr, uint32_t id,
 		return MESH_STATUS_NOT_SUB_MOD;
 
 	if (l_queue_remove(mod->subs, L_UINT_TO_PTR(addr))) {
+		sub_index_del(addr, mod);
 		mesh_net_dst_unreg(node_get_net(node), addr);
 
 		if (!mod->cbs)
@@ -1594,6 +1704,7 @@ int mesh_model_virt_sub_del(struct mesh_node *node, uint16_t ele_addr,
 	}
 
 	if (l_queue_remove(mod->subs, L_UINT_TO_PTR(*addr))) {
+		sub_index_del(*addr, mod);
 		mesh_net_dst_unreg(node_get_net(node), *addr);
 
 		if (!mod->cbs)
@@ -1965,10 +2076,16 @@ done:
 void mesh_model_init(void)
 {
 	mesh_virtuals = l_queue_new();
+	virt_addrs = l_hashmap_new();
+	group_subs = l_hashmap_new();
 }
 
 void mesh_model_cleanup(void)
 {
+	l_hashmap_destroy(group_subs, sub_index_destroy);
+	group_subs = NULL;
+	l_hashmap_destroy(virt_addrs, index_destroy);
+	virt_addrs = NULL;
 	l_queue_destroy(mesh_virtuals, l_free);
 	mesh_virtuals = NULL;
 }
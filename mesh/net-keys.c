@@ -59,6 +59,8 @@ struct net_key {
 	uint8_t privacy[16];
 	uint8_t beacon[16];
 	uint8_t network[8];
+	struct mesh_crypto_ccm *ccm;
+	struct l_cipher *privacy_cipher;
 };
 
 static struct l_queue *keys = NULL;
@@ -95,6 +97,24 @@ static bool match_network(const void *a, const void *b)
 	return memcmp(key->network, network, sizeof(key->network)) == 0;
 }
 
+static void net_key_free(void *data)
+{
+	struct net_key *key = data;
+
+	mesh_crypto_ccm_free(key->ccm);
+	l_cipher_free(key->privacy_cipher);
+	l_free(key);
+}
+
+/* Cipher contexts are kept for the lifetime of the key */
+static bool net_key_ciphers_init(struct net_key *key)
+{
+	key->ccm = mesh_crypto_ccm_new(key->encrypt);
+	key->privacy_cipher = l_cipher_new(L_CIPHER_AES, key->privacy, 16);
+
+	return key->ccm && key->privacy_cipher;
+}
+
 /* Key added from Provisioning, NetKey Add or NetKey update */
 uint32_t net_key_add(const uint8_t master[16])
 {
@@ -126,12 +146,15 @@ uint32_t net_key_add(const uint8_t master[16])
 	if (!result)
 		goto fail;
 
+	if (!net_key_ciphers_init(key))
+		goto fail;
+
 	key->id = ++last_master_id;
 	l_queue_push_tail(keys, key);
 	return key->id;
 
 fail:
-	l_free(key);
+	net_key_free(key);
 	return 0;
 }
 
@@ -157,8 +180,8 @@ uint32_t net_key_frnd_add(uint32_t master_id, uint16_t lpn, uint16_t frnd,
 	result = mesh_crypto_k2(key->master, p, sizeof(p), &frnd_key->nid,
 				frnd_key->encrypt, frnd_key->privacy);
 
-	if (!result) {
-		l_free(frnd_key);
+	if (!result || !net_key_ciphers_init(frnd_key)) {
+		net_key_free(frnd_key);
 		return 0;
 	}
 
@@ -178,7 +201,7 @@ void net_key_unref(uint32_t id)
 		if (--key->ref_cnt == 0) {
 			l_timeout_remove(key->snb.timeout);
 			l_queue_remove(keys, key);
-			l_free(key);
+			net_key_free(key);
 		}
 	}
 }
@@ -213,9 +236,9 @@ static void decrypt_net_pkt(void *a, void *b)
 	if (cache_id || !key->ref_cnt || (cache_pkt[0] & 0x7f) != key->nid)
 		return;
 
-	result = mesh_crypto_packet_decode(cache_pkt, cache_len, false,
+	result = mesh_crypto_packet_decode_ccm(cache_pkt, cache_len, false,
 						cache_plain, cache_iv_index,
-						key->encrypt, key->privacy);
+						key->ccm, key->privacy_cipher);
 
 	if (result) {
 		cache_id = key->id;
@@ -263,8 +286,8 @@ bool net_key_encrypt(uint32_t id, uint32_t iv_index, uint8_t *pkt, size_t len)
 	if (!key)
 		return false;
 
-	result = mesh_crypto_packet_encode(pkt, len, iv_index, key->encrypt,
-							key->privacy);
+	result = mesh_crypto_packet_encode_ccm(pkt, len, iv_index, key->ccm,
+							key->privacy_cipher);
 
 	if (!result)
 		return false;
@@ -526,6 +549,6 @@ void net_key_beacon_disable(uint32_t id)
 
 void net_key_cleanup(void)
 {
-	l_queue_destroy(keys, l_free);
+	l_queue_destroy(keys, net_key_free);
 	keys = NULL;
 }
@@ -104,6 +104,7 @@ struct mesh_net {
 	struct mesh_node *node;
 	struct mesh_prov *prov;
 	struct l_queue *app_keys;
+	struct l_queue *app_key_aids[KEY_AID_MASK + 1];
 	unsigned int pkt_id;
 	unsigned int bea_id;
 	unsigned int beacon_id;
@@ -647,6 +648,7 @@ struct mesh_net *mesh_net_new(struct mesh_node *node)
 void mesh_net_free(void *user_data)
 {
 	struct mesh_net *net = user_data;
+	int i;
 
 	if (!net)
 		return;
@@ -663,6 +665,9 @@ void mesh_net_free(void *user_data)
 	l_queue_destroy(net->destinations, l_free);
 	l_queue_destroy(net->app_keys, appkey_key_free);
 
+	for (i = 0; i <= KEY_AID_MASK; i++)
+		l_queue_destroy(net->app_key_aids[i], NULL);
+
 	l_free(net);
 }
 
@@ -3461,6 +3466,44 @@ struct l_queue *mesh_net_get_app_keys(struct mesh_net *net)
 	return net->app_keys;
 }
 
+struct l_queue *mesh_net_get_app_key_aid(struct mesh_net *net,
+							uint8_t key_aid)
+{
+	uint8_t aid = (key_aid >> KEY_AID_SHIFT) & KEY_AID_MASK;
+
+	if (!net)
+		return NULL;
+
+	return net->app_key_aids[aid];
+}
+
+void mesh_net_app_key_aid_add(struct mesh_net *net, uint8_t key_aid,
+								void *key)
+{
+	uint8_t aid = (key_aid >> KEY_AID_SHIFT) & KEY_AID_MASK;
+
+	if (!net)
+		return;
+
+	if (!net->app_key_aids[aid])
+		net->app_key_aids[aid] = l_queue_new();
+
+	l_queue_push_tail(net->app_key_aids[aid], key);
+}
+
+void mesh_net_app_key_aid_del(struct mesh_net *net, uint8_t key_aid,
+								void *key)
+{
+	uint8_t aid = (key_aid >> KEY_AID_SHIFT) & KEY_AID_MASK;
+
+	if (!net || !l_queue_remove(net->app_key_aids[aid], key) ||
+				!l_queue_isempty(net->app_key_aids[aid]))
+		return;
+
+	l_queue_destroy(net->app_key_aids[aid], NULL);
+	net->app_key_aids[aid] = NULL;
+}
+
 bool mesh_net_have_key(struct mesh_net *net, uint16_t idx)
 {
 	if (!net)
@@ -87,6 +87,7 @@ struct mesh_node {
 	struct mesh_agent *agent;
 	struct mesh_config *cfg;
 	char *storage_dir;
+	struct keyring_cache *keyring;
 	uint32_t disc_watch;
 	uint32_t seq_number;
 	bool busy;
@@ -304,6 +305,7 @@ static void free_node_resources(void *data)
 	mesh_agent_remove(node->agent);
 	mesh_config_release(node->cfg);
 	mesh_net_free(node->net);
+	keyring_cache_free(node->keyring);
 	l_free(node->storage_dir);
 	l_free(node);
 }
@@ -399,6 +401,7 @@ static bool init_storage_dir(struct mesh_node *node)
 	create_dir(dir_name);
 
 	node->storage_dir = l_strdup(dir_name);
+	node->keyring = keyring_cache_new(node->storage_dir);
 
 	/* Initialize directory for storing RPL info */
 	return rpl_init(node->storage_dir);
@@ -2284,6 +2287,11 @@ const char *node_get_storage_dir(struct mesh_node *node)
 	return node->storage_dir;
 }
 
+struct keyring_cache *node_get_keyring_cache(struct mesh_node *node)
+{
+	return node->keyring;
+}
+
 const char *node_get_app_path(struct mesh_node *node)
 {
 	if (!node)
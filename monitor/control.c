@@ -63,6 +63,8 @@ static struct btsnoop *btsnoop_file = NULL;
 static bool hcidump_fallback = false;
 static bool decode_control = true;
 static uint16_t filter_index = HCI_DEV_NONE;
+static uint16_t filter_handle = CONTROL_HANDLE_NONE;
+static int filter_priority = -1;
 
 struct control_data {
 	uint16_t channel;
@@ -1033,35 +1035,122 @@ static int open_socket(uint16_t channel)
 	return fd;
 }
 
-static void attach_index_filter(int fd, uint16_t index)
+/* Monitor header fields are little endian while BPF loads are big endian */
+#define FILTER_LE16(val) ((uint16_t) ((((val) & 0xff) << 8) | ((val) >> 8)))
+
+#define FILTER_HDR_OPCODE	offsetof(struct mgmt_hdr, opcode)
+#define FILTER_HDR_INDEX	offsetof(struct mgmt_hdr, index)
+#define FILTER_HDR_SIZE		sizeof(struct mgmt_hdr)
+
+#define FILTER_PASS		0x0fffffff
+#define FILTER_REJECT		0
+
+#define MAX_FILTER_LEN		32
+
+static const uint16_t filter_data_opcodes[] = {
+	BTSNOOP_OPCODE_ACL_TX_PKT,
+	BTSNOOP_OPCODE_ACL_RX_PKT,
+	BTSNOOP_OPCODE_SCO_TX_PKT,
+	BTSNOOP_OPCODE_SCO_RX_PKT,
+	BTSNOOP_OPCODE_ISO_TX_PKT,
+	BTSNOOP_OPCODE_ISO_RX_PKT,
+};
+
+static void attach_filter(int fd, uint16_t channel)
 {
-	struct sock_filter filters[] = {
+	struct sock_filter filters[MAX_FILTER_LEN];
+	struct sock_fprog fprog;
+	unsigned int len = 0, i, n;
+
+#define FILTER_STMT(code, k) \
+	filters[len++] = (struct sock_filter) BPF_STMT(code, k)
+#define FILTER_JUMP(code, k, jt, jf) \
+	filters[len++] = (struct sock_filter) BPF_JUMP(code, k, jt, jf)
+
+	if (filter_index != HCI_DEV_NONE) {
 		/* Load MGMT index:
 		 * A <- MGMT index
 		 */
-		BPF_STMT(BPF_LD + BPF_B + BPF_ABS,
-					offsetof(struct mgmt_hdr, index)),
-		/* Accept if index is HCI_DEV_NONE:
-		 * A == HCI_DEV_NONE
+		FILTER_STMT(BPF_LD + BPF_H + BPF_ABS, FILTER_HDR_INDEX);
+		/* Accept if index is HCI_DEV_NONE or index match:
+		 * A == HCI_DEV_NONE || A == index
 		 */
-		BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, HCI_DEV_NONE, 0, 1),
-		/* return */
-		BPF_STMT(BPF_RET|BPF_K, 0x0fffffff), /* pass */
-		/* Accept if index match:
-		 * A == index
+		FILTER_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					FILTER_LE16(HCI_DEV_NONE), 2, 0);
+		FILTER_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					FILTER_LE16(filter_index), 1, 0);
+		/* reject */
+		FILTER_STMT(BPF_RET + BPF_K, FILTER_REJECT);
+	}
+
+	if (channel == HCI_CHANNEL_MONITOR &&
+				filter_handle != CONTROL_HANDLE_NONE) {
+		n = sizeof(filter_data_opcodes) / sizeof(filter_data_opcodes[0]);
+
+		/* Load MGMT opcode:
+		 * A <- MGMT opcode
 		 */
-		BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, index, 0, 1),
-		/* returns */
-		BPF_STMT(BPF_RET|BPF_K, 0x0fffffff), /* pass */
-		BPF_STMT(BPF_RET|BPF_K, 0), /* reject */
-	};
-	struct sock_fprog fprog = {
-		.len = sizeof(filters) / sizeof(filters[0]),
-		/* casting const away: */
-		.filter = filters,
-	};
+		FILTER_STMT(BPF_LD + BPF_H + BPF_ABS, FILTER_HDR_OPCODE);
+		/* Check handle only for ACL, SCO and ISO data packets */
+		for (i = 0; i < n; i++)
+			FILTER_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					FILTER_LE16(filter_data_opcodes[i]),
+					n - i, 0);
+		FILTER_STMT(BPF_JMP + BPF_JA, 4);
+		/* Load connection handle without packet boundary flags:
+		 * A <- handle & 0x0fff
+		 */
+		FILTER_STMT(BPF_LD + BPF_H + BPF_ABS, FILTER_HDR_SIZE);
+		FILTER_STMT(BPF_ALU + BPF_AND + BPF_K, FILTER_LE16(0x0fff));
+		/* Accept if handle match:
+		 * A == handle
+		 */
+		FILTER_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					FILTER_LE16(filter_handle), 1, 0);
+		/* reject */
+		FILTER_STMT(BPF_RET + BPF_K, FILTER_REJECT);
+	}
+
+	/* User logging above the requested priority is never displayed,
+	 * but it still needs to reach the trace file when writing one.
+	 */
+	if (channel == HCI_CHANNEL_MONITOR && filter_priority >= 0 &&
+							!btsnoop_file) {
+		/* Load MGMT opcode:
+		 * A <- MGMT opcode
+		 */
+		FILTER_STMT(BPF_LD + BPF_H + BPF_ABS, FILTER_HDR_OPCODE);
+		FILTER_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+			FILTER_LE16(BTSNOOP_OPCODE_USER_LOGGING), 0, 3);
+		/* Load user logging priority:
+		 * A <- priority
+		 */
+		FILTER_STMT(BPF_LD + BPF_B + BPF_ABS, FILTER_HDR_SIZE);
+		/* Accept if priority is lower or equal:
+		 * A <= priority
+		 */
+		FILTER_JUMP(BPF_JMP + BPF_JGT + BPF_K, filter_priority, 0, 1);
+		/* reject */
+		FILTER_STMT(BPF_RET + BPF_K, FILTER_REJECT);
+	}
+
+#undef FILTER_STMT
+#undef FILTER_JUMP
+
+	/* Nothing to filter */
+	if (!len)
+		return;
+
+	/* pass */
+	filters[len++] = (struct sock_filter) BPF_STMT(BPF_RET + BPF_K,
+								FILTER_PASS);
 
-	setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog));
+	fprog.len = len;
+	fprog.filter = filters;
+
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER,
+						&fprog, sizeof(fprog)) < 0)
+		perror("Failed to attach filter");
 }
 
 static int open_channel(uint16_t channel)
@@ -1081,8 +1170,7 @@ static int open_channel(uint16_t channel)
 		return -1;
 	}
 
-	if (filter_index != HCI_DEV_NONE)
-		attach_index_filter(data->fd, filter_index);
+	attach_filter(data->fd, channel);
 
 	mainloop_add_fd(data->fd, EPOLLIN, data_callback, data, free_data);
 
@@ -1569,3 +1657,13 @@ void control_filter_index(uint16_t index)
 {
 	filter_index = index;
 }
+
+void control_filter_handle(uint16_t handle)
+{
+	filter_handle = handle;
+}
+
+void control_filter_priority(int priority)
+{
+	filter_priority = priority;
+}
@@ -24,6 +24,8 @@
 
 #include <stdint.h>
 
+#define CONTROL_HANDLE_NONE	0xffff
+
 bool control_writer(const char *path);
 void control_reader(const char *path, bool pager);
 void control_server(const char *path);
@@ -32,5 +34,7 @@ int control_rtt(char *jlink, char *rtt);
 int control_tracing(void);
 void control_disable_decoding(void);
 void control_filter_index(uint16_t index);
+void control_filter_handle(uint16_t handle);
+void control_filter_priority(int priority);
 
 void control_message(uint16_t opcode, const void *data, uint16_t size);
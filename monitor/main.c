@@ -66,6 +66,7 @@ static void usage(void)
 		"\t-s, --server <socket>  Start monitor server socket\n"
 		"\t-p, --priority <level> Show only priority or lower\n"
 		"\t-i, --index <num>      Show only specified controller\n"
+		"\t-H, --handle <num>     Show only specified connection handle\n"
 		"\t-d, --tty <tty>        Read data from TTY\n"
 		"\t-B, --tty-speed <rate> Set TTY speed (default 115200)\n"
 		"\t-V, --vendor <compid>  Set default company identifier\n"
@@ -90,6 +91,7 @@ static const struct option main_options[] = {
 	{ "server",    required_argument, NULL, 's' },
 	{ "priority",  required_argument, NULL, 'p' },
 	{ "index",     required_argument, NULL, 'i' },
+	{ "handle",    required_argument, NULL, 'H' },
 	{ "tty",       required_argument, NULL, 'd' },
 	{ "tty-speed", required_argument, NULL, 'B' },
 	{ "vendor",    required_argument, NULL, 'V' },
@@ -132,7 +134,7 @@ int main(int argc, char *argv[])
 		int opt;
 		struct sockaddr_un addr;
 
-		opt = getopt_long(argc, argv, "r:w:a:s:p:i:d:B:V:MtTSAE:PJ:R:vh",
+		opt = getopt_long(argc, argv, "r:w:a:s:p:i:H:d:B:V:MtTSAE:PJ:R:vh",
 							main_options, NULL);
 		if (opt < 0)
 			break;
@@ -168,6 +170,13 @@ int main(int argc, char *argv[])
 			}
 			packet_select_index(atoi(str));
 			break;
+		case 'H':
+			if (!isdigit(*optarg)) {
+				usage();
+				return EXIT_FAILURE;
+			}
+			packet_select_handle(strtoul(optarg, NULL, 0));
+			break;
 		case 'd':
 			tty = optarg;
 			break;
@@ -110,6 +110,7 @@ static time_t time_offset = ((time_t) -1);
 static int priority_level = BTSNOOP_PRIORITY_INFO;
 static unsigned long filter_mask = 0;
 static bool index_filter = false;
+static uint16_t handle_filter = CONTROL_HANDLE_NONE;
 static uint16_t index_current = 0;
 static uint16_t fallback_manufacturer = UNKNOWN_MANUFACTURER;
 
@@ -257,6 +258,8 @@ void packet_set_priority(const char *priority)
 		priority_level = BTSNOOP_PRIORITY_DEBUG;
 	else
 		priority_level = atoi(priority);
+
+	control_filter_priority(priority_level);
 }
 
 void packet_select_index(uint16_t index)
@@ -268,6 +271,35 @@ void packet_select_index(uint16_t index)
 	index_filter = true;
 }
 
+void packet_select_handle(uint16_t handle)
+{
+	handle_filter = acl_handle(handle);
+
+	control_filter_handle(handle_filter);
+}
+
+static bool filter_data_handle(uint16_t opcode, const void *data,
+								uint16_t size)
+{
+	if (handle_filter == CONTROL_HANDLE_NONE)
+		return false;
+
+	switch (opcode) {
+	case BTSNOOP_OPCODE_ACL_TX_PKT:
+	case BTSNOOP_OPCODE_ACL_RX_PKT:
+	case BTSNOOP_OPCODE_SCO_TX_PKT:
+	case BTSNOOP_OPCODE_SCO_RX_PKT:
+	case BTSNOOP_OPCODE_ISO_TX_PKT:
+	case BTSNOOP_OPCODE_ISO_RX_PKT:
+		if (size < 2)
+			return false;
+
+		return acl_handle(get_le16(data)) != handle_filter;
+	}
+
+	return false;
+}
+
 #define print_space(x) printf("%*c", (x), ' ');
 
 #define MAX_INDEX 16
@@ -3896,6 +3928,9 @@ void packet_monitor(struct timeval *tv, struct ucred *cred,
 		return;
 	}
 
+	if (filter_data_handle(opcode, data, size))
+		return;
+
 	if (tv && time_offset == ((time_t) -1))
 		time_offset = tv->tv_sec;
 
@@ -43,6 +43,7 @@ void packet_del_filter(unsigned long filter);
 
 void packet_set_priority(const char *priority);
 void packet_select_index(uint16_t index);
+void packet_select_handle(uint16_t handle);
 void packet_set_fallback_manufacturer(uint16_t manufacturer);
 
 void packet_hexdump(const unsigned char *buf, uint16_t len);
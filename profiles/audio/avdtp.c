@@ -46,6 +46,7 @@
 #include "src/log.h"
 #include "src/shared/util.h"
 #include "src/shared/queue.h"
+#include "src/shared/timeout.h"
 #include "src/adapter.h"
 #include "src/device.h"
 
@@ -311,7 +312,7 @@ struct pending_req {
 	void *data;
 	size_t data_size;
 	struct avdtp_stream *stream; /* Set if the request targeted a stream */
-	guint timeout;
+	unsigned int timeout;
 	gboolean collided;
 };
 
@@ -577,7 +578,7 @@ static void pending_req_free(void *data)
 	struct pending_req *req = data;
 
 	if (req->timeout)
-		g_source_remove(req->timeout);
+		timeout_remove_seconds(req->timeout);
 	g_free(req->data);
 	g_free(req);
 }
@@ -2212,7 +2213,7 @@ static gboolean session_cb(GIOChannel *chan, GIOCondition cond,
 		return TRUE;
 	}
 
-	g_source_remove(session->req->timeout);
+	timeout_remove_seconds(session->req->timeout);
 	session->req->timeout = 0;
 
 	switch (header->message_type) {
@@ -2573,13 +2574,13 @@ done:
 	return err;
 }
 
-static gboolean request_timeout(gpointer user_data)
+static bool request_timeout(void *user_data)
 {
 	struct avdtp *session = user_data;
 
 	cancel_request(session, ETIMEDOUT);
 
-	return FALSE;
+	return false;
 }
 
 static int send_req(struct avdtp *session, gboolean priority,
@@ -2627,7 +2628,8 @@ static int send_req(struct avdtp *session, gboolean priority,
 		timeout = REQ_TIMEOUT;
 	}
 
-	req->timeout = g_timeout_add_seconds(timeout, request_timeout, session);
+	req->timeout = timeout_add_seconds(timeout, request_timeout, session,
+									NULL);
 	return 0;
 
 failed:
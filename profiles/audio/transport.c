@@ -28,6 +28,9 @@
 
 #define _GNU_SOURCE
 #include <errno.h>
+#include <limits.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
 
 #include <glib.h>
 
@@ -55,6 +58,11 @@
 
 #define MEDIA_TRANSPORT_INTERFACE "org.bluez.MediaTransport1"
 
+/* Send queue sampling period and minimum Latency change to signal */
+#define STATS_INTERVAL		20
+#define STATS_LATENCY_DELTA	50
+#define STATS_SIGNAL_SAMPLES	(1000 / STATS_INTERVAL)
+
 typedef enum {
 	TRANSPORT_STATE_IDLE,		/* Not acquired and suspended */
 	TRANSPORT_STATE_PENDING,	/* Playing but not acquired */
@@ -87,6 +95,14 @@ struct a2dp_transport {
 	struct avdtp		*session;
 	uint16_t		delay;
 	int8_t			volume;
+	guint			stats_id;	/* Send queue sampling timer */
+	int			outq;		/* Last send queue depth */
+	uint32_t		drain_rate;	/* Bytes per second */
+	uint16_t		latency;	/* 1/10 of millisecond */
+	unsigned int		empty;		/* Samples with empty queue */
+	uint32_t		underruns;
+	uint32_t		underruns_signalled;
+	unsigned int		signal_samples;	/* Samples since signal */
 };
 
 struct media_transport {
@@ -147,6 +163,159 @@ static gboolean state_in_use(transport_state_t state)
 	return FALSE;
 }
 
+static bool transport_stats_enabled(struct media_transport *transport)
+{
+	/* Statistics are only collected when experimental is enabled */
+	if (!(g_dbus_get_flags() & G_DBUS_FLAG_ENABLE_EXPERIMENTAL))
+		return false;
+
+	/* Only the send queue of a local source can be measured */
+	return transport->sink_watch != 0;
+}
+
+static void transport_update_latency(struct media_transport *transport)
+{
+	struct a2dp_transport *a2dp = transport->data;
+	uint32_t latency = a2dp->delay;
+
+	/* Time needed to flush what is queued at the measured drain rate */
+	if (a2dp->drain_rate)
+		latency += (uint64_t) a2dp->outq * 10000 / a2dp->drain_rate;
+
+	latency = MIN(latency, UINT16_MAX);
+
+	if (latency == a2dp->latency)
+		return;
+
+	/* Avoid signalling every sample, small variations are expected */
+	if (latency && a2dp->latency &&
+			latency + STATS_LATENCY_DELTA > a2dp->latency &&
+			latency < a2dp->latency + STATS_LATENCY_DELTA)
+		return;
+
+	a2dp->latency = latency;
+
+	g_dbus_emit_property_changed(btd_get_dbus_connection(),
+					transport->path,
+					MEDIA_TRANSPORT_INTERFACE, "Latency");
+}
+
+static void transport_signal_underruns(struct media_transport *transport)
+{
+	struct a2dp_transport *a2dp = transport->data;
+
+	a2dp->signal_samples = 0;
+
+	if (a2dp->underruns == a2dp->underruns_signalled)
+		return;
+
+	a2dp->underruns_signalled = a2dp->underruns;
+
+	g_dbus_emit_property_changed(btd_get_dbus_connection(),
+					transport->path,
+					MEDIA_TRANSPORT_INTERFACE, "Underruns");
+}
+
+static void transport_update_underruns(struct media_transport *transport,
+								int outq)
+{
+	struct a2dp_transport *a2dp = transport->data;
+	uint32_t period;
+
+	if (outq) {
+		a2dp->empty = 0;
+		return;
+	}
+
+	/* Nothing was ever queued, or this one was counted already */
+	if (!a2dp->drain_rate || a2dp->empty == UINT_MAX)
+		return;
+
+	a2dp->empty++;
+
+	/*
+	 * A paced sender lets the queue run empty between packets, the
+	 * deadline is only missed if it stays empty for longer than sending
+	 * a packet takes at the rate the queue has been draining.
+	 */
+	period = transport->omtu * 1000 / a2dp->drain_rate;
+	if ((a2dp->empty - 1) * STATS_INTERVAL <= period)
+		return;
+
+	a2dp->underruns++;
+	a2dp->empty = UINT_MAX;
+}
+
+static gboolean transport_stats_sample(gpointer user_data)
+{
+	struct media_transport *transport = user_data;
+	struct a2dp_transport *a2dp = transport->data;
+	uint32_t rate;
+	int outq;
+
+	if (ioctl(transport->fd, SIOCOUTQ, &outq) < 0) {
+		error("%s: SIOCOUTQ: %s (%d)", transport->path,
+						strerror(errno), errno);
+		a2dp->stats_id = 0;
+		return FALSE;
+	}
+
+	/*
+	 * Only the reduction of the queue between two samples is visible,
+	 * so the rate is a lower bound and the latency an upper bound.
+	 */
+	if (outq < a2dp->outq) {
+		rate = (a2dp->outq - outq) * (1000 / STATS_INTERVAL);
+
+		if (a2dp->drain_rate)
+			a2dp->drain_rate = (a2dp->drain_rate * 7 + rate) / 8;
+		else
+			a2dp->drain_rate = rate;
+	}
+
+	transport_update_underruns(transport, outq);
+
+	/* Batch counter updates into one signal per second at most */
+	if (++a2dp->signal_samples >= STATS_SIGNAL_SAMPLES)
+		transport_signal_underruns(transport);
+
+	a2dp->outq = outq;
+
+	transport_update_latency(transport);
+
+	return TRUE;
+}
+
+static void transport_update_stats(struct media_transport *transport)
+{
+	struct a2dp_transport *a2dp = transport->data;
+
+	if (!transport_stats_enabled(transport))
+		return;
+
+	if (transport->state == TRANSPORT_STATE_ACTIVE && transport->fd >= 0) {
+		if (a2dp->stats_id)
+			return;
+
+		a2dp->outq = 0;
+		a2dp->drain_rate = 0;
+		a2dp->empty = 0;
+		a2dp->signal_samples = 0;
+		a2dp->stats_id = g_timeout_add(STATS_INTERVAL,
+						transport_stats_sample,
+						transport);
+		return;
+	}
+
+	if (!a2dp->stats_id)
+		return;
+
+	g_source_remove(a2dp->stats_id);
+	a2dp->stats_id = 0;
+
+	transport_signal_underruns(transport);
+}
+
 static void transport_set_state(struct media_transport *transport,
 							transport_state_t state)
 {
@@ -168,6 +337,8 @@ static void transport_set_state(struct media_transport *transport,
 						transport->path,
 						MEDIA_TRANSPORT_INTERFACE,
 						"State");
+
+	transport_update_stats(transport);
 }
 
 void media_transport_destroy(struct media_transport *transport)
@@ -629,6 +800,46 @@ static gboolean get_delay(const GDBusPropertyTable *property,
 	return TRUE;
 }
 
+static gboolean latency_exists(const GDBusPropertyTable *property,
+								void *data)
+{
+	struct media_transport *transport = data;
+	struct a2dp_transport *a2dp = transport->data;
+
+	return a2dp->latency != 0;
+}
+
+static gboolean get_latency(const GDBusPropertyTable *property,
+					DBusMessageIter *iter, void *data)
+{
+	struct media_transport *transport = data;
+	struct a2dp_transport *a2dp = transport->data;
+
+	dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT16, &a2dp->latency);
+
+	return TRUE;
+}
+
+static gboolean underruns_exists(const GDBusPropertyTable *property,
+								void *data)
+{
+	struct media_transport *transport = data;
+
+	return transport->sink_watch != 0;
+}
+
+static gboolean get_underruns(const GDBusPropertyTable *property,
+					DBusMessageIter *iter, void *data)
+{
+	struct media_transport *transport = data;
+	struct a2dp_transport *a2dp = transport->data;
+
+	dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32,
+							&a2dp->underruns);
+
+	return TRUE;
+}
+
 static gboolean volume_exists(const GDBusPropertyTable *property, void *data)
 {
 	struct media_transport *transport = data;
@@ -732,6 +943,10 @@ static const GDBusPropertyTable transport_properties[] = {
 	{ "Volume", "q", get_volume, set_volume, volume_exists },
 	{ "Endpoint", "o", get_endpoint, NULL, endpoint_exists,
 				G_DBUS_PROPERTY_FLAG_EXPERIMENTAL },
+	{ "Latency", "q", get_latency, NULL, latency_exists,
+				G_DBUS_PROPERTY_FLAG_EXPERIMENTAL },
+	{ "Underruns", "u", get_underruns, NULL, underruns_exists,
+				G_DBUS_PROPERTY_FLAG_EXPERIMENTAL },
 	{ }
 };
 
@@ -739,6 +954,9 @@ static void destroy_a2dp(void *data)
 {
 	struct a2dp_transport *a2dp = data;
 
+	if (a2dp->stats_id)
+		g_source_remove(a2dp->stats_id);
+
 	if (a2dp->session)
 		avdtp_unref(a2dp->session);
 
@@ -923,6 +1141,9 @@ void media_transport_update_delay(struct media_transport *transport,
 	g_dbus_emit_property_changed(btd_get_dbus_connection(),
 					transport->path,
 					MEDIA_TRANSPORT_INTERFACE, "Delay");
+
+	if (transport_stats_enabled(transport))
+		transport_update_latency(transport);
 }
 
 struct btd_device *media_transport_get_dev(struct media_transport *transport)
@@ -36,6 +36,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include <glib.h>
 
@@ -78,7 +80,14 @@
 
 #define HOG_REPORT_MAP_MAX_SIZE        512
 #define HID_INFO_SIZE			4
-#define ATT_NOTIFICATION_HEADER_SIZE	3
+
+struct report_stats {
+	uint64_t		count;		/* Input reports forwarded */
+	uint64_t		total;		/* Sum of latencies (ns) */
+	uint64_t		max;		/* Worst latency (ns) */
+	uint64_t		last;		/* Last report arrival (ns) */
+	uint64_t		max_gap;	/* Longest interval (ns) */
+};
 
 struct bt_hog {
 	int			ref_count;
@@ -108,6 +117,7 @@ struct bt_hog {
 	struct queue		*bas;
 	GSList			*instances;
 	struct queue		*gatt_op;
+	struct report_stats	stats;
 };
 
 struct report {
@@ -118,7 +128,7 @@ struct report {
 	uint16_t		value_handle;
 	uint8_t			properties;
 	uint16_t		ccc_handle;
-	guint			notifyid;
+	unsigned int		notifyid;
 	uint16_t		len;
 	uint8_t			*value;
 };
@@ -289,42 +299,85 @@ static void find_included(struct bt_hog *hog, GAttrib *attrib,
 	free(req);
 }
 
-static void report_value_cb(const guint8 *pdu, guint16 len, gpointer user_data)
+static uint64_t report_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report_stats_update(struct bt_hog *hog, uint64_t start)
+{
+	struct report_stats *stats = &hog->stats;
+	uint64_t end = report_time();
+	uint64_t gap;
+
+	if (stats->count) {
+		gap = start - stats->last;
+		if (gap > stats->max_gap)
+			stats->max_gap = gap;
+	}
+
+	stats->last = start;
+	stats->count++;
+	stats->total += end - start;
+
+	if (end - start > stats->max)
+		stats->max = end - start;
+}
+
+static void report_stats_print(struct bt_hog *hog)
+{
+	struct report_stats *stats = &hog->stats;
+
+	if (!stats->count)
+		return;
+
+	DBG("%s: %" PRIu64 " input reports, latency avg %" PRIu64 " ns "
+			"max %" PRIu64 " ns, max interval %" PRIu64 " us",
+			hog->name, stats->count, stats->total / stats->count,
+			stats->max, stats->max_gap / 1000);
+
+	memset(stats, 0, sizeof(*stats));
+}
+
+/*
+ * Input reports are taken straight from bt_att and written to uHID without
+ * going through GAttrib, so there is no PDU copy on the heap and only the
+ * used part of the uHID event is initialized.
+ */
+static void report_notify_cb(struct bt_att_chan *chan, uint8_t opcode,
+					const void *pdu, uint16_t length,
+					void *user_data)
 {
 	struct report *report = user_data;
 	struct bt_hog *hog = report->hog;
-	struct uhid_event ev;
-	uint8_t *buf;
+	uint64_t start;
 	int err;
 
-	if (len < ATT_NOTIFICATION_HEADER_SIZE) {
-		error("Malformed ATT notification");
+	if (length < 2 || get_le16(pdu) != report->value_handle)
 		return;
-	}
-
-	pdu += ATT_NOTIFICATION_HEADER_SIZE;
-	len -= ATT_NOTIFICATION_HEADER_SIZE;
 
-	memset(&ev, 0, sizeof(ev));
-	ev.type = UHID_INPUT;
-	buf = ev.u.input.data;
-
-	if (hog->has_report_id) {
-		buf[0] = report->id;
-		len = MIN(len, sizeof(ev.u.input.data) - 1);
-		memcpy(buf + 1, pdu, len);
-		ev.u.input.size = ++len;
-	} else {
-		len = MIN(len, sizeof(ev.u.input.data));
-		memcpy(buf, pdu, len);
-		ev.u.input.size = len;
-	}
+	start = report_time();
 
-	err = bt_uhid_send(hog->uhid, &ev);
+	err = bt_uhid_input(hog->uhid, hog->has_report_id ? report->id : 0,
+						pdu + 2, length - 2);
 	if (err < 0) {
-		error("bt_uhid_send: %s (%d)", strerror(-err), -err);
+		error("bt_uhid_input: %s (%d)", strerror(-err), -err);
 		return;
 	}
+
+	report_stats_update(hog, start);
+}
+
+static unsigned int report_register(struct report *report)
+{
+	struct bt_att *att = g_attrib_get_att(report->hog->attrib);
+
+	return bt_att_register(att, BT_ATT_OP_HANDLE_NFY, report_notify_cb,
+							report, NULL);
 }
 
 static void report_ccc_written_cb(guint8 status, const guint8 *pdu,
@@ -332,7 +385,6 @@ static void report_ccc_written_cb(guint8 status, const guint8 *pdu,
 {
 	struct gatt_request *req = user_data;
 	struct report *report = req->user_data;
-	struct bt_hog *hog = report->hog;
 
 	destroy_gatt_req(req);
 
@@ -342,10 +394,7 @@ static void report_ccc_written_cb(guint8 status, const guint8 *pdu,
 		return;
 	}
 
-	report->notifyid = g_attrib_register(hog->attrib,
-					ATT_OP_HANDLE_NOTIFY,
-					report->value_handle,
-					report_value_cb, report, NULL);
+	report->notifyid = report_register(report);
 
 	DBG("Report characteristic descriptor written: notifications enabled");
 }
@@ -1628,10 +1677,7 @@ bool bt_hog_attach(struct bt_hog *hog, void *gatt)
 	for (l = hog->reports; l; l = l->next) {
 		struct report *r = l->data;
 
-		r->notifyid = g_attrib_register(hog->attrib,
-					ATT_OP_HANDLE_NOTIFY,
-					r->value_handle,
-					report_value_cb, r, NULL);
+		r->notifyid = report_register(r);
 	}
 
 	return true;
@@ -1656,11 +1702,14 @@ void bt_hog_detach(struct bt_hog *hog)
 		struct report *r = l->data;
 
 		if (r->notifyid > 0) {
-			g_attrib_unregister(hog->attrib, r->notifyid);
+			bt_att_unregister(g_attrib_get_att(hog->attrib),
+								r->notifyid);
 			r->notifyid = 0;
 		}
 	}
 
+	report_stats_print(hog);
+
 	if (hog->scpp)
 		bt_scpp_detach(hog->scpp);
 
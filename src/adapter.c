@@ -256,6 +256,13 @@ struct btd_adapter {
 	struct discovery_client *client;	/* active discovery client */
 
 	GSList *discovery_found;	/* list of found devices */
+	GQueue *temporary_lru;		/* temporary found devices, least
+					 * recently seen first */
+	GHashTable *temporary_links;	/* device -> temporary_lru link */
+	uint32_t temporary_evicted;	/* temporary devices evicted */
+	guint temporary_signal_id;	/* coalesced property signals */
+	bool temporary_changed;
+	bool temporary_evicted_changed;
 	guint discovery_idle_timeout;	/* timeout between discovery runs */
 	guint passive_scan_timeout;	/* timeout between passive scans */
 
@@ -1186,6 +1193,164 @@ void adapter_service_remove(struct btd_adapter *adapter, uint32_t handle)
 	remove_record_from_server(rec->handle);
 }
 
+/* Number of evictable devices compared when picking an eviction victim */
+#define TEMPORARY_EVICT_WINDOW 8
+
+/* Seconds over which changes of the temporary device counters coalesce */
+#define TEMPORARY_SIGNAL_TIMEOUT 1
+
+static gboolean temporary_signal_timeout(gpointer user_data)
+{
+	struct btd_adapter *adapter = user_data;
+
+	adapter->temporary_signal_id = 0;
+
+	if (adapter->temporary_changed)
+		g_dbus_emit_property_changed(dbus_conn, adapter->path,
+					ADAPTER_INTERFACE, "TemporaryDevices");
+
+	if (adapter->temporary_evicted_changed)
+		g_dbus_emit_property_changed(dbus_conn, adapter->path,
+				ADAPTER_INTERFACE, "TemporaryDevicesEvicted");
+
+	adapter->temporary_changed = false;
+	adapter->temporary_evicted_changed = false;
+
+	return FALSE;
+}
+
+/*
+ * Devices come and go all the time while discovering, so rather than a
+ * signal for each of them the counters are signalled at most once per
+ * TEMPORARY_SIGNAL_TIMEOUT.
+ */
+static void temporary_signal(struct btd_adapter *adapter, bool evicted)
+{
+	if (evicted)
+		adapter->temporary_evicted_changed = true;
+	else
+		adapter->temporary_changed = true;
+
+	if (adapter->temporary_signal_id)
+		return;
+
+	adapter->temporary_signal_id = g_timeout_add_seconds(
+					TEMPORARY_SIGNAL_TIMEOUT,
+					temporary_signal_timeout, adapter);
+}
+
+static void temporary_signal_cancel(struct btd_adapter *adapter)
+{
+	if (adapter->temporary_signal_id > 0) {
+		g_source_remove(adapter->temporary_signal_id);
+		adapter->temporary_signal_id = 0;
+	}
+
+	adapter->temporary_changed = false;
+	adapter->temporary_evicted_changed = false;
+}
+
+static void temporary_touch(struct btd_adapter *adapter,
+						struct btd_device *dev)
+{
+	GList *link;
+
+	link = g_hash_table_lookup(adapter->temporary_links, dev);
+	if (link) {
+		/* Already the most recently seen one */
+		if (link == adapter->temporary_lru->tail)
+			return;
+
+		g_queue_unlink(adapter->temporary_lru, link);
+		g_queue_push_tail_link(adapter->temporary_lru, link);
+		return;
+	}
+
+	g_queue_push_tail(adapter->temporary_lru, dev);
+	g_hash_table_insert(adapter->temporary_links, dev,
+						adapter->temporary_lru->tail);
+
+	temporary_signal(adapter, false);
+}
+
+void adapter_temporary_remove(struct btd_adapter *adapter,
+						struct btd_device *dev)
+{
+	GList *link;
+
+	link = g_hash_table_lookup(adapter->temporary_links, dev);
+	if (!link)
+		return;
+
+	g_hash_table_remove(adapter->temporary_links, dev);
+	g_queue_delete_link(adapter->temporary_lru, link);
+
+	temporary_signal(adapter, false);
+}
+
+static bool temporary_evictable(struct btd_adapter *adapter,
+						struct btd_device *dev)
+{
+	if (btd_device_is_connected(dev) || adapter->connect_le == dev)
+		return false;
+
+	if (device_is_connecting(dev, BDADDR_BREDR) ||
+		device_is_connecting(dev, device_get_le_address_type(dev)))
+		return false;
+
+	if (device_is_bonding(dev, NULL) || device_is_authenticating(dev))
+		return false;
+
+	return true;
+}
+
+/*
+ * Make room for a new temporary device.  Among the least recently seen
+ * evictable devices the one with the weakest signal goes first, devices
+ * with unknown RSSI counting as the weakest.
+ */
+static bool temporary_evict(struct btd_adapter *adapter)
+{
+	struct btd_device *victim = NULL;
+	int victim_rssi = INT8_MAX + 1;
+	unsigned int candidates = 0;
+	GList *l, *next;
+
+	for (l = adapter->temporary_lru->head; l &&
+			candidates < TEMPORARY_EVICT_WINDOW; l = next) {
+		struct btd_device *dev = l->data;
+		int rssi;
+
+		next = l->next;
+
+		if (!temporary_evictable(adapter, dev))
+			continue;
+
+		rssi = device_get_rssi(dev);
+		if (!rssi)
+			rssi = INT8_MIN - 1;
+
+		if (rssi < victim_rssi) {
+			victim = dev;
+			victim_rssi = rssi;
+		}
+
+		candidates++;
+	}
+
+	if (!victim)
+		return false;
+
+	DBG("evicting %s", device_get_path(victim));
+
+	adapter->temporary_evicted++;
+	temporary_signal(adapter, true);
+
+	btd_adapter_remove_device(adapter, victim);
+
+	return true;
+}
+
 static struct btd_device *adapter_create_device(struct btd_adapter *adapter,
 						const bdaddr_t *bdaddr,
 						uint8_t bdaddr_type)
@@ -1236,6 +1401,8 @@ void btd_adapter_remove_device(struct btd_adapter *adapter,
 	adapter->discovery_found = g_slist_remove(adapter->discovery_found,
 									dev);
 
+	adapter_temporary_remove(adapter, dev);
+
 	adapter->connections = g_slist_remove(adapter->connections, dev);
 
 	if (adapter->connect_le == dev)
@@ -3202,6 +3369,30 @@ static gboolean property_get_roles(const GDBusPropertyTable *property,
 	return TRUE;
 }
 
+static gboolean property_get_temporary_devices(
+					const GDBusPropertyTable *property,
+					DBusMessageIter *iter, void *user_data)
+{
+	struct btd_adapter *adapter = user_data;
+	dbus_uint32_t value = adapter->temporary_lru->length;
+
+	dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32, &value);
+
+	return TRUE;
+}
+
+static gboolean property_get_temporary_evicted(
+					const GDBusPropertyTable *property,
+					DBusMessageIter *iter, void *user_data)
+{
+	struct btd_adapter *adapter = user_data;
+	dbus_uint32_t value = adapter->temporary_evicted;
+
+	dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32, &value);
+
+	return TRUE;
+}
+
 static int device_path_cmp(gconstpointer a, gconstpointer b)
 {
 	const struct btd_device *device = a;
@@ -3483,6 +3674,10 @@ static const GDBusPropertyTable adapter_properties[] = {
 	{ "Modalias", "s", property_get_modalias, NULL,
 					property_exists_modalias },
 	{ "Roles", "as", property_get_roles },
+	{ "TemporaryDevices", "u", property_get_temporary_devices, NULL, NULL,
+				G_DBUS_PROPERTY_FLAG_EXPERIMENTAL },
+	{ "TemporaryDevicesEvicted", "u", property_get_temporary_evicted,
+				NULL, NULL, G_DBUS_PROPERTY_FLAG_EXPERIMENTAL },
 	{ }
 };
 
@@ -5253,6 +5448,16 @@ void adapter_auto_connect_remove(struct btd_adapter *adapter,
 	adapter->connect_list = g_slist_remove(adapter->connect_list, device);
 }
 
+static void device_powered_on(gpointer data, gpointer user_data)
+{
+	device_adapter_powered(data, true);
+}
+
+static void device_powered_off(gpointer data, gpointer user_data)
+{
+	device_adapter_powered(data, false);
+}
+
 static void adapter_start(struct btd_adapter *adapter)
 {
 	g_dbus_emit_property_changed(dbus_conn, adapter->path,
@@ -5260,6 +5465,8 @@ static void adapter_start(struct btd_adapter *adapter)
 
 	DBG("adapter %s has been enabled", adapter->path);
 
+	g_slist_foreach(adapter->devices, device_powered_on, NULL);
+
 	trigger_passive_scanning(adapter);
 }
 
@@ -5361,6 +5568,10 @@ static void adapter_free(gpointer user_data)
 	g_queue_foreach(adapter->auths, free_service_auth, NULL);
 	g_queue_free(adapter->auths);
 
+	temporary_signal_cancel(adapter);
+	g_queue_free(adapter->temporary_lru);
+	g_hash_table_destroy(adapter->temporary_links);
+
 	/*
 	 * Unregister all handlers for this specific index since
 	 * the adapter bound to them is no longer valid.
@@ -6326,6 +6537,8 @@ static struct btd_adapter *btd_adapter_new(uint16_t index)
 	DBG("Pairable timeout: %u seconds", adapter->pairable_timeout);
 
 	adapter->auths = g_queue_new();
+	adapter->temporary_lru = g_queue_new();
+	adapter->temporary_links = g_hash_table_new(NULL, NULL);
 
 	return btd_adapter_ref(adapter);
 }
@@ -6340,6 +6553,10 @@ static void adapter_remove(struct btd_adapter *adapter)
 	g_slist_free(adapter->connect_list);
 	adapter->connect_list = NULL;
 
+	g_queue_clear(adapter->temporary_lru);
+	g_hash_table_remove_all(adapter->temporary_links);
+	temporary_signal_cancel(adapter);
+
 	for (l = adapter->devices; l; l = l->next)
 		device_remove(l->data, FALSE);
 
@@ -6469,31 +6686,36 @@ static void confirm_name(struct btd_adapter *adapter, const bdaddr_t *bdaddr,
 }
 
 static void adapter_msd_notify(struct btd_adapter *adapter,
-							struct btd_device *dev,
-							GSList *msd_list)
+					struct btd_device *dev,
+					const struct eir_view *eir)
 {
 	GSList *cb_l, *cb_next;
-	GSList *msd_l, *msd_next;
+	unsigned int i;
 
 	for (cb_l = adapter->msd_callbacks; cb_l != NULL; cb_l = cb_next) {
 		btd_msd_cb_t cb = cb_l->data;
 
 		cb_next = g_slist_next(cb_l);
 
-		for (msd_l = msd_list; msd_l != NULL; msd_l = msd_next) {
-			const struct eir_msd *msd = msd_l->data;
+		for (i = 0; i < eir->num_fields; i++) {
+			const struct eir_field *field = &eir->fields[i];
+			const uint8_t *data = eir->data + field->offset;
 
-			msd_next = g_slist_next(msd_l);
+			if (field->type != EIR_MANUFACTURER_DATA ||
+					field->len < 2 ||
+					field->len > 2 + EIR_MSD_MAX_LEN)
+				continue;
 
-			cb(adapter, dev, msd->company, msd->data,
-								msd->data_len);
+			cb(adapter, dev, get_le16(data), data + 2,
+							field->len - 2);
 		}
 	}
 }
 
-static bool is_filter_match(GSList *discovery_filter, struct eir_data *eir_data,
+static bool is_filter_match(GSList *discovery_filter, struct eir_view *eir,
 								int8_t rssi)
 {
+	int8_t tx_power = eir_view_get_tx_power(eir);
 	GSList *l, *m;
 	bool got_match = false;
 
@@ -6522,6 +6744,9 @@ static bool is_filter_match(GSList *discovery_filter, struct eir_data *eir_data,
 				/* m->data contains string representation of
 				 * uuid.
 				 */
+				struct eir_data *eir_data;
+
+				eir_data = eir_view_get_data(eir);
 				if (g_slist_find_custom(eir_data->services,
 							m->data,
 							g_strcmp) != NULL)
@@ -6534,8 +6759,8 @@ static bool is_filter_match(GSList *discovery_filter, struct eir_data *eir_data,
 			if (item->rssi == DISTANCE_VAL_INVALID ||
 			    item->rssi <= rssi ||
 			    item->pathloss == DISTANCE_VAL_INVALID ||
-			    (eir_data->tx_power != 127 &&
-			     eir_data->tx_power - rssi <= item->pathloss))
+			    (tx_power != 127 &&
+			     tx_power - rssi <= item->pathloss))
 				return true;
 
 			got_match = false;
@@ -6557,7 +6782,7 @@ static void filter_duplicate_data(void *data, void *user_data)
 }
 
 static bool device_is_discoverable(struct btd_adapter *adapter,
-					struct eir_data *eir, const char *addr,
+					struct eir_view *eir, const char *addr,
 					uint8_t bdaddr_type)
 {
 	GSList *l;
@@ -6566,7 +6791,8 @@ static bool device_is_discoverable(struct btd_adapter *adapter,
 	if (bdaddr_type == BDADDR_BREDR || adapter->filtered_discovery)
 		discoverable = true;
 	else
-		discoverable = eir->flags & (EIR_LIM_DISC | EIR_GEN_DISC);
+		discoverable = eir_view_get_flags(eir) &
+						(EIR_LIM_DISC | EIR_GEN_DISC);
 
 	/*
 	 * Mark as not discoverable if no client has requested discovery and
@@ -6579,6 +6805,7 @@ static bool device_is_discoverable(struct btd_adapter *adapter,
 	for (l = adapter->discovery_list; l; l = g_slist_next(l)) {
 		struct discovery_client *client = l->data;
 		struct discovery_filter *filter = client->discovery_filter;
+		const char *name;
 		size_t pattern_len;
 
 		if (!filter || !filter->pattern)
@@ -6594,8 +6821,8 @@ static bool device_is_discoverable(struct btd_adapter *adapter,
 		if (!strncmp(filter->pattern, addr, pattern_len))
 			return true;
 
-		if (eir->name && !strncmp(filter->pattern, eir->name,
-							pattern_len))
+		name = eir_view_get_data(eir)->name;
+		if (name && !strncmp(filter->pattern, name, pattern_len))
 			return true;
 	}
 
@@ -6610,23 +6837,35 @@ static void update_found_devices(struct btd_adapter *adapter,
 					const uint8_t *data, uint8_t data_len)
 {
 	struct btd_device *dev;
-	struct eir_data eir_data;
-	bool name_known, discoverable;
+	struct eir_view eir;
+	struct eir_data *eir_data;
+	bool name_known, discoverable, unchanged;
+	uint8_t flags;
+	int8_t tx_power;
 	char addr[18];
 	bool duplicate = false;
 
-	memset(&eir_data, 0, sizeof(eir_data));
-	eir_parse(&eir_data, data, data_len);
+	eir_view_init(&eir, data, data_len);
 
 	ba2str(bdaddr, addr);
 
-	discoverable = device_is_discoverable(adapter, &eir_data, addr,
+	discoverable = device_is_discoverable(adapter, &eir, addr,
 							bdaddr_type);
 
 	dev = btd_adapter_find_device(adapter, bdaddr, bdaddr_type);
 	if (!dev) {
 		if (!discoverable) {
-			eir_data_free(&eir_data);
+			eir_view_clear(&eir);
+			return;
+		}
+
+		/* Drop the report if no temporary device can make room */
+		if (main_opts.tmpmax && adapter->temporary_lru->length >=
+							main_opts.tmpmax &&
+						!temporary_evict(adapter)) {
+			DBG("Temporary device limit reached, ignoring %s",
+									addr);
+			eir_view_clear(&eir);
 			return;
 		}
 
@@ -6636,27 +6875,40 @@ static void update_found_devices(struct btd_adapter *adapter,
 	if (!dev) {
 		btd_error(adapter->dev_id,
 			"Unable to create object for found device %s", addr);
-		eir_data_free(&eir_data);
+		eir_view_clear(&eir);
 		return;
 	}
 
 	device_update_last_seen(dev, bdaddr_type);
 
+	if (device_is_temporary(dev))
+		temporary_touch(adapter, dev);
+
 	/*
 	 * FIXME: We need to check for non-zero flags first because
 	 * older kernels send separate adv_ind and scan_rsp. Newer
 	 * kernels send them merged, so once we know which mgmt version
 	 * supports this we can make the non-zero check conditional.
 	 */
-	if (bdaddr_type != BDADDR_BREDR && eir_data.flags &&
-					!(eir_data.flags & EIR_BREDR_UNSUP)) {
+	flags = eir_view_get_flags(&eir);
+	if (bdaddr_type != BDADDR_BREDR && flags &&
+					!(flags & EIR_BREDR_UNSUP)) {
 		device_set_bredr_support(dev);
 		/* Update last seen for BR/EDR in case its flag is set */
 		device_update_last_seen(dev, BDADDR_BREDR);
 	}
 
-	if (eir_data.name != NULL && eir_data.name_complete)
-		device_store_cached_name(dev, eir_data.name);
+	/*
+	 * Most reports repeat the previous one of the same device, in
+	 * which case there is nothing new to decode or store.
+	 */
+	unchanged = device_get_eir_fingerprint(dev) == eir.fingerprint;
+
+	if (!unchanged) {
+		eir_data = eir_view_get_data(&eir);
+		if (eir_data->name != NULL && eir_data->name_complete)
+			device_store_cached_name(dev, eir_data->name);
+	}
 
 	/*
 	 * Only skip devices that are not connected, are temporary and there
@@ -6664,14 +6916,14 @@ static void update_found_devices(struct btd_adapter *adapter,
 	 */
 	if (!btd_device_is_connected(dev) && (device_is_temporary(dev) &&
 						 !adapter->discovery_list)) {
-		eir_data_free(&eir_data);
+		eir_view_clear(&eir);
 		return;
 	}
 
 	/* Don't continue if not discoverable or if filter don't match */
 	if (!discoverable || (adapter->filtered_discovery &&
-	    !is_filter_match(adapter->discovery_list, &eir_data, rssi))) {
-		eir_data_free(&eir_data);
+	    !is_filter_match(adapter->discovery_list, &eir, rssi))) {
+		eir_view_clear(&eir);
 		return;
 	}
 
@@ -6682,50 +6934,60 @@ static void update_found_devices(struct btd_adapter *adapter,
 	else
 		device_set_rssi(dev, rssi);
 
-	if (eir_data.tx_power != 127)
-		device_set_tx_power(dev, eir_data.tx_power);
-
-	if (eir_data.appearance != 0)
-		device_set_appearance(dev, eir_data.appearance);
+	tx_power = eir_view_get_tx_power(&eir);
+	if (tx_power != 127)
+		device_set_tx_power(dev, tx_power);
 
 	/* Report an unknown name to the kernel even if there is a short name
 	 * known, but still update the name with the known short name. */
 	name_known = device_name_known(dev);
 
-	if (eir_data.name && (eir_data.name_complete || !name_known))
-		btd_device_device_set_name(dev, eir_data.name);
+	if (adapter->discovery_list)
+		g_slist_foreach(adapter->discovery_list, filter_duplicate_data,
+								&duplicate);
 
-	if (eir_data.class != 0)
-		device_set_class(dev, eir_data.class);
+	/* Clients asking for duplicate data get every report */
+	if (!unchanged || duplicate) {
+		eir_data = eir_view_get_data(&eir);
 
-	if (eir_data.did_source || eir_data.did_vendor ||
-			eir_data.did_product || eir_data.did_version)
-		btd_device_set_pnpid(dev, eir_data.did_source,
-							eir_data.did_vendor,
-							eir_data.did_product,
-							eir_data.did_version);
+		if (eir_data->appearance != 0)
+			device_set_appearance(dev, eir_data->appearance);
 
-	device_add_eir_uuids(dev, eir_data.services);
+		if (eir_data->name && (eir_data->name_complete || !name_known))
+			btd_device_device_set_name(dev, eir_data->name);
 
-	if (adapter->discovery_list)
-		g_slist_foreach(adapter->discovery_list, filter_duplicate_data,
-								&duplicate);
+		if (eir_data->class != 0)
+			device_set_class(dev, eir_data->class);
 
-	if (eir_data.msd_list) {
-		device_set_manufacturer_data(dev, eir_data.msd_list, duplicate);
-		adapter_msd_notify(adapter, dev, eir_data.msd_list);
-	}
+		if (eir_data->did_source || eir_data->did_vendor ||
+				eir_data->did_product || eir_data->did_version)
+			btd_device_set_pnpid(dev, eir_data->did_source,
+							eir_data->did_vendor,
+							eir_data->did_product,
+							eir_data->did_version);
 
-	if (eir_data.sd_list)
-		device_set_service_data(dev, eir_data.sd_list, duplicate);
+		device_add_eir_uuids(dev, eir_data->services);
 
-	if (eir_data.data_list)
-		device_set_data(dev, eir_data.data_list, duplicate);
+		if (eir_data->msd_list)
+			device_set_manufacturer_data(dev, eir_data->msd_list,
+								duplicate);
 
-	if (bdaddr_type != BDADDR_BREDR)
-		device_set_flags(dev, eir_data.flags);
+		if (eir_data->sd_list)
+			device_set_service_data(dev, eir_data->sd_list,
+								duplicate);
 
-	eir_data_free(&eir_data);
+		if (eir_data->data_list)
+			device_set_data(dev, eir_data->data_list, duplicate);
+
+		if (bdaddr_type != BDADDR_BREDR)
+			device_set_flags(dev, eir_data->flags);
+
+		device_set_eir_fingerprint(dev, eir.fingerprint);
+	}
+
+	adapter_msd_notify(adapter, dev, &eir);
+
+	eir_view_clear(&eir);
 
 	/*
 	 * Only if at least one client has requested discovery, maintain
@@ -6858,6 +7120,8 @@ static void adapter_stop(struct btd_adapter *adapter)
 	/* check pending requests */
 	reply_pending_requests(adapter);
 
+	g_slist_foreach(adapter->devices, device_powered_off, NULL);
+
 	cancel_passive_scanning(adapter);
 
 	remove_discovery_list(adapter);
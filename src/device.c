@@ -215,6 +215,7 @@ struct btd_device {
 	GSList		*eir_uuids;
 	struct bt_ad	*ad;
 	uint8_t         ad_flags[1];
+	uint32_t	eir_fingerprint;	/* Last applied report */
 	char		name[MAX_NAME_LENGTH + 1];
 	char		*alias;
 	uint32_t	class;
@@ -257,6 +258,13 @@ struct btd_device {
 	struct bt_gatt_client *client;		/* GATT client instance */
 	struct bt_gatt_server *server;		/* GATT server instance */
 	unsigned int gatt_ready_id;
+	struct timespec gatt_start;		/* GATT client started */
+	uint32_t gatt_ready_time;		/* Time to ready in ms */
+	bool gatt_ready_timed;
+	struct timespec reconnect_start;	/* Auto connect started */
+	bool reconnecting;
+	uint32_t reconnect_time;		/* Time to reconnect in ms */
+	bool reconnect_timed;
 
 	struct btd_gatt_client *client_dbus;
 
@@ -1023,6 +1031,48 @@ static gboolean dev_property_exists_tx_power(const GDBusPropertyTable *property,
 	return TRUE;
 }
 
+static gboolean
+dev_property_get_gatt_ready_time(const GDBusPropertyTable *property,
+					DBusMessageIter *iter, void *data)
+{
+	struct btd_device *device = data;
+
+	dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32,
+						&device->gatt_ready_time);
+
+	return TRUE;
+}
+
+static gboolean
+dev_property_exists_gatt_ready_time(const GDBusPropertyTable *property,
+								void *data)
+{
+	struct btd_device *device = data;
+
+	return device->gatt_ready_timed ? TRUE : FALSE;
+}
+
+static gboolean
+dev_property_get_reconnect_time(const GDBusPropertyTable *property,
+					DBusMessageIter *iter, void *data)
+{
+	struct btd_device *device = data;
+
+	dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32,
+						&device->reconnect_time);
+
+	return TRUE;
+}
+
+static gboolean
+dev_property_exists_reconnect_time(const GDBusPropertyTable *property,
+								void *data)
+{
+	struct btd_device *device = data;
+
+	return device->reconnect_timed ? TRUE : FALSE;
+}
+
 static gboolean
 dev_property_get_svc_resolved(const GDBusPropertyTable *property,
 					DBusMessageIter *iter, void *data)
@@ -1658,6 +1708,16 @@ bool device_is_disconnecting(struct btd_device *device)
 	return device->disconn_timer > 0;
 }
 
+bool device_is_connecting(struct btd_device *device, uint8_t bdaddr_type)
+{
+	if (bdaddr_type != BDADDR_BREDR)
+		return device->att_io != NULL;
+
+	/* Profile connections and SDP searches bring up the ACL link */
+	return device->pending || device->connect ||
+		(device->browse && device->browse->type == BROWSE_SDP);
+}
+
 void device_set_ltk_enc_size(struct btd_device *device, uint8_t enc_size)
 {
 	device->ltk_enc_size = enc_size;
@@ -1682,6 +1742,7 @@ static void device_set_auto_connect(struct btd_device *device, gboolean enable)
 
 	/* Disabling auto connect */
 	if (enable == FALSE) {
+		device->reconnecting = false;
 		adapter_connect_list_remove(device->adapter, device);
 		adapter_auto_connect_remove(device->adapter, device);
 		return;
@@ -2953,6 +3014,12 @@ static const GDBusPropertyTable device_properties[] = {
 	{ "WakeAllowed", "b", dev_property_get_wake_allowed,
 				dev_property_set_wake_allowed,
 				dev_property_wake_allowed_exist },
+	{ "GattReadyTime", "u", dev_property_get_gatt_ready_time, NULL,
+				dev_property_exists_gatt_ready_time,
+				G_DBUS_PROPERTY_FLAG_EXPERIMENTAL },
+	{ "ReconnectTime", "u", dev_property_get_reconnect_time, NULL,
+				dev_property_exists_reconnect_time,
+				G_DBUS_PROPERTY_FLAG_EXPERIMENTAL },
 	{ }
 };
 
@@ -5065,6 +5132,55 @@ static void disconnect_gatt_service(gpointer data, gpointer user_data)
 	btd_service_disconnect(service);
 }
 
+static void reconnect_start_timer(struct btd_device *device)
+{
+	/* Keep the original start time across failed attempts */
+	if (device->reconnecting)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &device->reconnect_start);
+	device->reconnecting = true;
+}
+
+static void reconnect_stop_timer(struct btd_device *device)
+{
+	struct timespec current;
+
+	if (!device->reconnecting)
+		return;
+
+	device->reconnecting = false;
+
+	clock_gettime(CLOCK_MONOTONIC, &current);
+
+	/* Compute the time difference in ms. */
+	device->reconnect_time =
+		(current.tv_sec - device->reconnect_start.tv_sec) * 1000L +
+		(current.tv_nsec - device->reconnect_start.tv_nsec) / 1000000L;
+	device->reconnect_timed = true;
+
+	DBG("%s reconnected in %u ms", device->path, device->reconnect_time);
+
+	g_dbus_emit_property_changed(dbus_conn, device->path,
+					DEVICE_INTERFACE, "ReconnectTime");
+}
+
+/*
+ * Auto connect devices have to be reconnected each time the adapter is
+ * powered on, e.g. when the whole hub was power cycled, and the time the
+ * adapter is powered off doesn't count towards reconnecting.
+ */
+void device_adapter_powered(struct btd_device *device, bool powered)
+{
+	device->reconnecting = false;
+
+	if (!powered || !device_get_auto_connect(device) ||
+					btd_device_is_connected(device))
+		return;
+
+	reconnect_start_timer(device);
+}
+
 static void att_disconnected_cb(int err, void *user_data)
 {
 	struct btd_device *device = user_data;
@@ -5090,8 +5206,10 @@ static void att_disconnected_cb(int err, void *user_data)
 	 * is connection timeout, remote user terminated connection or local
 	 * initiated disconnection.
 	 */
-	if (err == ETIMEDOUT || err == ECONNRESET || err == ECONNABORTED)
+	if (err == ETIMEDOUT || err == ECONNRESET || err == ECONNABORTED) {
+		reconnect_start_timer(device);
 		adapter_connect_list_add(device->adapter, device);
+	}
 
 done:
 	attio_cleanup(device);
@@ -5126,6 +5244,24 @@ static void register_gatt_services(struct btd_device *device)
 
 static void gatt_client_init(struct btd_device *device);
 
+static void gatt_ready_stop_timer(struct btd_device *device)
+{
+	struct timespec current;
+
+	clock_gettime(CLOCK_MONOTONIC, &current);
+
+	/* Compute the time difference in ms. */
+	device->gatt_ready_time =
+		(current.tv_sec - device->gatt_start.tv_sec) * 1000L +
+		(current.tv_nsec - device->gatt_start.tv_nsec) / 1000000L;
+	device->gatt_ready_timed = true;
+
+	DBG("GATT client ready in %u ms", device->gatt_ready_time);
+
+	g_dbus_emit_property_changed(dbus_conn, device->path,
+					DEVICE_INTERFACE, "GattReadyTime");
+}
+
 static void gatt_client_ready_cb(bool success, uint8_t att_ecode,
 								void *user_data)
 {
@@ -5139,6 +5275,8 @@ static void gatt_client_ready_cb(bool success, uint8_t att_ecode,
 		return;
 	}
 
+	gatt_ready_stop_timer(device);
+
 	register_gatt_services(device);
 
 	btd_gatt_client_ready(device->client_dbus);
@@ -5169,6 +5307,11 @@ static void gatt_client_init(struct btd_device *device)
 		return;
 	}
 
+	/* Marks the start time of the GATT client, the time it takes to be
+	 * ready is exposed in GattReadyTime.
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &device->gatt_start);
+
 	device->client = bt_gatt_client_new(device->db, device->att,
 							device->att_mtu, 0);
 	if (!device->client) {
@@ -5346,6 +5489,8 @@ bool device_attach_att(struct btd_device *dev, GIOChannel *io)
 	gatt_client_init(dev);
 	gatt_server_init(dev, database);
 
+	reconnect_stop_timer(dev);
+
 	/*
 	 * Remove the device from the connect_list and give the passive
 	 * scanning another chance to be restarted in case there are
@@ -5690,6 +5835,8 @@ void btd_device_set_temporary(struct btd_device *device, bool temporary)
 	if (device->bredr)
 		adapter_whitelist_add(device->adapter, device);
 
+	adapter_temporary_remove(device->adapter, device);
+
 	store_device_info(device);
 
 	/* attributes were not stored when resolved if device was temporary */
@@ -5872,6 +6019,11 @@ void device_set_rssi_with_delta(struct btd_device *device, int8_t rssi,
 						DEVICE_INTERFACE, "RSSI");
 }
 
+int8_t device_get_rssi(struct btd_device *device)
+{
+	return device->rssi;
+}
+
 void device_set_rssi(struct btd_device *device, int8_t rssi)
 {
 	device_set_rssi_with_delta(device, rssi, RSSI_THRESHOLD);
@@ -5893,6 +6045,17 @@ void device_set_tx_power(struct btd_device *device, int8_t tx_power)
 						DEVICE_INTERFACE, "TxPower");
 }
 
+uint32_t device_get_eir_fingerprint(struct btd_device *device)
+{
+	return device->eir_fingerprint;
+}
+
+void device_set_eir_fingerprint(struct btd_device *device,
+							uint32_t fingerprint)
+{
+	device->eir_fingerprint = fingerprint;
+}
+
 void device_set_flags(struct btd_device *device, uint8_t flags)
 {
 	if (!device)
@@ -6048,14 +6211,17 @@ void device_bonding_complete(struct btd_device *device, uint8_t bdaddr_type,
 
 	device_set_paired(device, bdaddr_type);
 
+	/* Attempt to store services for this device may have failed because
+	 * it was not paired. Now that we're paired retry, no matter which
+	 * side initiated pairing.
+	 */
+	if (state->svc_resolved)
+		store_gatt_db(device);
+
 	/* If services are already resolved just reply to the pairing
 	 * request
 	 */
 	if (state->svc_resolved && bonding) {
-		/* Attept to store services for this device failed because it
-		 * was not paired. Now that we're paired retry. */
-		store_gatt_db(device);
-
 		g_dbus_send_reply(dbus_conn, bonding->msg, DBUS_TYPE_INVALID);
 		bonding_request_free(bonding);
 		return;
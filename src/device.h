@@ -107,8 +107,12 @@ void device_set_legacy(struct btd_device *device, bool legacy);
 void device_set_rssi_with_delta(struct btd_device *device, int8_t rssi,
 							int8_t delta_threshold);
 void device_set_rssi(struct btd_device *device, int8_t rssi);
+int8_t device_get_rssi(struct btd_device *device);
 void device_set_tx_power(struct btd_device *device, int8_t tx_power);
 void device_set_flags(struct btd_device *device, uint8_t flags);
+uint32_t device_get_eir_fingerprint(struct btd_device *device);
+void device_set_eir_fingerprint(struct btd_device *device,
+							uint32_t fingerprint);
 bool btd_device_is_connected(struct btd_device *dev);
 uint8_t btd_device_get_bdaddr_type(struct btd_device *dev);
 bool device_is_retrying(struct btd_device *device);
@@ -135,6 +139,8 @@ void device_add_connection(struct btd_device *dev, uint8_t bdaddr_type);
 void device_remove_connection(struct btd_device *device, uint8_t bdaddr_type);
 void device_request_disconnect(struct btd_device *device, DBusMessage *msg);
 bool device_is_disconnecting(struct btd_device *device);
+bool device_is_connecting(struct btd_device *device, uint8_t bdaddr_type);
+void device_adapter_powered(struct btd_device *device, bool powered);
 void device_set_ltk_enc_size(struct btd_device *device, uint8_t enc_size);
 
 void device_store_svc_chng_ccc(struct btd_device *device, uint8_t bdaddr_type,
@@ -251,21 +251,163 @@ static void eir_parse_data(struct eir_data *eir, uint8_t type,
 	eir->data_list = g_slist_append(eir->data_list, ad);
 }
 
-void eir_parse(struct eir_data *eir, const uint8_t *eir_data, uint8_t eir_len)
+static void eir_parse_field(struct eir_data *eir, uint8_t type,
+					const uint8_t *data, uint8_t data_len)
 {
-	uint16_t len = 0;
+	switch (type) {
+	case EIR_UUID16_SOME:
+	case EIR_UUID16_ALL:
+		eir_parse_uuid16(eir, data, data_len);
+		break;
+
+	case EIR_UUID32_SOME:
+	case EIR_UUID32_ALL:
+		eir_parse_uuid32(eir, data, data_len);
+		break;
+
+	case EIR_UUID128_SOME:
+	case EIR_UUID128_ALL:
+		eir_parse_uuid128(eir, data, data_len);
+		break;
+
+	case EIR_FLAGS:
+		if (data_len > 0)
+			eir->flags = *data;
+		break;
+
+	case EIR_NAME_SHORT:
+	case EIR_NAME_COMPLETE:
+		/* Some vendors put a NUL byte terminator into
+		 * the name */
+		while (data_len > 0 && data[data_len - 1] == '\0')
+			data_len--;
+
+		g_free(eir->name);
+
+		eir->name = name2utf8(data, data_len);
+		eir->name_complete = type == EIR_NAME_COMPLETE;
+		break;
+
+	case EIR_TX_POWER:
+		if (data_len < 1)
+			break;
+		eir->tx_power = (int8_t) data[0];
+		break;
+
+	case EIR_CLASS_OF_DEV:
+		if (data_len < 3)
+			break;
+		eir->class = data[0] | (data[1] << 8) |
+						(data[2] << 16);
+		break;
+
+	case EIR_GAP_APPEARANCE:
+		if (data_len < 2)
+			break;
+		eir->appearance = get_le16(data);
+		break;
+
+	case EIR_SSP_HASH:
+		if (data_len < 16)
+			break;
+		eir->hash = g_memdup(data, 16);
+		break;
+
+	case EIR_SSP_RANDOMIZER:
+		if (data_len < 16)
+			break;
+		eir->randomizer = g_memdup(data, 16);
+		break;
+
+	case EIR_DEVICE_ID:
+		if (data_len < 8)
+			break;
+
+		eir->did_source = data[0] | (data[1] << 8);
+		eir->did_vendor = data[2] | (data[3] << 8);
+		eir->did_product = data[4] | (data[5] << 8);
+		eir->did_version = data[6] | (data[7] << 8);
+		break;
+
+	case EIR_SVC_DATA16:
+		eir_parse_uuid16_data(eir, data, data_len);
+		break;
+
+	case EIR_SVC_DATA32:
+		eir_parse_uuid32_data(eir, data, data_len);
+		break;
+
+	case EIR_SVC_DATA128:
+		eir_parse_uuid128_data(eir, data, data_len);
+		break;
+
+	case EIR_MANUFACTURER_DATA:
+		eir_parse_msd(eir, data, data_len);
+		break;
+
+	default:
+		eir_parse_data(eir, type, data, data_len);
+		break;
+	}
+}
+
+static void eir_view_parse(const struct eir_view *view, struct eir_data *eir)
+{
+	unsigned int i;
 
 	eir->flags = 0;
 	eir->tx_power = 127;
 
+	for (i = 0; i < view->num_fields; i++) {
+		const struct eir_field *field = &view->fields[i];
+
+		eir_parse_field(eir, field->type, view->data + field->offset,
+								field->len);
+	}
+}
+
+void eir_parse(struct eir_data *eir, const uint8_t *eir_data, uint8_t eir_len)
+{
+	struct eir_view view;
+
+	eir_view_init(&view, eir_data, eir_len);
+	eir_view_parse(&view, eir);
+}
+
+static uint32_t eir_fingerprint(const uint8_t *data, uint8_t len)
+{
+	uint32_t hash = 2166136261u;
+	unsigned int i;
+
+	/* FNV-1a over the length and the raw report */
+	hash = (hash ^ len) * 16777619u;
+
+	for (i = 0; data && i < len; i++)
+		hash = (hash ^ data[i]) * 16777619u;
+
+	/* Zero is reserved for "no report seen yet" */
+	return hash ? hash : 1;
+}
+
+void eir_view_init(struct eir_view *view, const uint8_t *eir_data,
+							uint8_t eir_len)
+{
+	const uint8_t *p = eir_data;
+	uint16_t len = 0;
+
+	view->data = eir_data;
+	view->fingerprint = eir_fingerprint(eir_data, eir_len);
+	view->num_fields = 0;
+	view->parsed = false;
+	memset(&view->eir, 0, sizeof(view->eir));
+
 	/* No EIR data to parse */
 	if (eir_data == NULL)
 		return;
 
 	while (len < eir_len - 1) {
-		uint8_t field_len = eir_data[0];
-		const uint8_t *data;
-		uint8_t data_len;
+		uint8_t field_len = p[0];
+		struct eir_field *field;
 
 		/* Check for the end of EIR */
 		if (field_len == 0)
@@ -277,107 +419,82 @@ void eir_parse(struct eir_data *eir, const uint8_t *eir_data, uint8_t eir_len)
 		if (len > eir_len)
 			break;
 
-		data = &eir_data[2];
-		data_len = field_len - 1;
-
-		switch (eir_data[1]) {
-		case EIR_UUID16_SOME:
-		case EIR_UUID16_ALL:
-			eir_parse_uuid16(eir, data, data_len);
-			break;
-
-		case EIR_UUID32_SOME:
-		case EIR_UUID32_ALL:
-			eir_parse_uuid32(eir, data, data_len);
-			break;
+		field = &view->fields[view->num_fields++];
+		field->type = p[1];
+		field->offset = p + 2 - eir_data;
+		field->len = field_len - 1;
 
-		case EIR_UUID128_SOME:
-		case EIR_UUID128_ALL:
-			eir_parse_uuid128(eir, data, data_len);
-			break;
+		p += field_len + 1;
+	}
+}
 
-		case EIR_FLAGS:
-			if (data_len > 0)
-				eir->flags = *data;
-			break;
+void eir_view_clear(struct eir_view *view)
+{
+	if (!view->parsed)
+		return;
 
-		case EIR_NAME_SHORT:
-		case EIR_NAME_COMPLETE:
-			/* Some vendors put a NUL byte terminator into
-			 * the name */
-			while (data_len > 0 && data[data_len - 1] == '\0')
-				data_len--;
+	eir_data_free(&view->eir);
+	view->parsed = false;
+}
 
-			g_free(eir->name);
+/* Decode the whole report, only done the first time it is needed */
+struct eir_data *eir_view_get_data(struct eir_view *view)
+{
+	if (!view->parsed) {
+		eir_view_parse(view, &view->eir);
+		view->parsed = true;
+	}
 
-			eir->name = name2utf8(data, data_len);
-			eir->name_complete = eir_data[1] == EIR_NAME_COMPLETE;
-			break;
+	return &view->eir;
+}
 
-		case EIR_TX_POWER:
-			if (data_len < 1)
-				break;
-			eir->tx_power = (int8_t) data[0];
-			break;
+/* Return the last AD structure of the given type, like eir_parse() does */
+const uint8_t *eir_view_find(const struct eir_view *view, uint8_t type,
+							uint8_t *len)
+{
+	int i;
 
-		case EIR_CLASS_OF_DEV:
-			if (data_len < 3)
-				break;
-			eir->class = data[0] | (data[1] << 8) |
-							(data[2] << 16);
-			break;
+	for (i = view->num_fields - 1; i >= 0; i--) {
+		const struct eir_field *field = &view->fields[i];
 
-		case EIR_GAP_APPEARANCE:
-			if (data_len < 2)
-				break;
-			eir->appearance = get_le16(data);
-			break;
+		if (field->type != type)
+			continue;
 
-		case EIR_SSP_HASH:
-			if (data_len < 16)
-				break;
-			eir->hash = g_memdup(data, 16);
-			break;
+		if (len)
+			*len = field->len;
 
-		case EIR_SSP_RANDOMIZER:
-			if (data_len < 16)
-				break;
-			eir->randomizer = g_memdup(data, 16);
-			break;
+		return view->data + field->offset;
+	}
 
-		case EIR_DEVICE_ID:
-			if (data_len < 8)
-				break;
+	return NULL;
+}
 
-			eir->did_source = data[0] | (data[1] << 8);
-			eir->did_vendor = data[2] | (data[3] << 8);
-			eir->did_product = data[4] | (data[5] << 8);
-			eir->did_version = data[6] | (data[7] << 8);
-			break;
+uint8_t eir_view_get_flags(const struct eir_view *view)
+{
+	int i;
 
-		case EIR_SVC_DATA16:
-			eir_parse_uuid16_data(eir, data, data_len);
-			break;
+	for (i = view->num_fields - 1; i >= 0; i--) {
+		const struct eir_field *field = &view->fields[i];
 
-		case EIR_SVC_DATA32:
-			eir_parse_uuid32_data(eir, data, data_len);
-			break;
+		if (field->type == EIR_FLAGS && field->len > 0)
+			return view->data[field->offset];
+	}
 
-		case EIR_SVC_DATA128:
-			eir_parse_uuid128_data(eir, data, data_len);
-			break;
+	return 0;
+}
 
-		case EIR_MANUFACTURER_DATA:
-			eir_parse_msd(eir, data, data_len);
-			break;
+int8_t eir_view_get_tx_power(const struct eir_view *view)
+{
+	int i;
 
-		default:
-			eir_parse_data(eir, eir_data[1], data, data_len);
-			break;
-		}
+	for (i = view->num_fields - 1; i >= 0; i--) {
+		const struct eir_field *field = &view->fields[i];
 
-		eir_data += field_len + 1;
+		if (field->type == EIR_TX_POWER && field->len > 0)
+			return (int8_t) view->data[field->offset];
 	}
+
+	return 127;
 }
 
 int eir_parse_oob(struct eir_data *eir, uint8_t *eir_data, uint16_t eir_len)
@@ -102,8 +102,37 @@ struct eir_data {
 	GSList *data_list;
 };
 
+#define EIR_VIEW_MAX_FIELDS         127  /* 255 / 2 (len & type) */
+
+struct eir_field {
+	uint8_t type;
+	uint8_t offset;
+	uint8_t len;
+};
+
+/*
+ * Index of the AD structures of a report, pointing into the original
+ * buffer. The decoded form is only built by eir_view_get_data().
+ */
+struct eir_view {
+	const uint8_t *data;
+	uint32_t fingerprint;
+	uint8_t num_fields;
+	struct eir_field fields[EIR_VIEW_MAX_FIELDS];
+	bool parsed;
+	struct eir_data eir;
+};
+
 void eir_data_free(struct eir_data *eir);
 void eir_parse(struct eir_data *eir, const uint8_t *eir_data, uint8_t eir_len);
+void eir_view_init(struct eir_view *view, const uint8_t *eir_data,
+							uint8_t eir_len);
+void eir_view_clear(struct eir_view *view);
+struct eir_data *eir_view_get_data(struct eir_view *view);
+const uint8_t *eir_view_find(const struct eir_view *view, uint8_t type,
+							uint8_t *len);
+uint8_t eir_view_get_flags(const struct eir_view *view);
+int8_t eir_view_get_tx_power(const struct eir_view *view);
 int eir_parse_oob(struct eir_data *eir, uint8_t *eir_data, uint16_t eir_len);
 int eir_create_oob(const bdaddr_t *addr, const char *name, uint32_t cod,
 			const uint8_t *hash, const uint8_t *randomizer,
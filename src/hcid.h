@@ -54,6 +54,7 @@ struct main_opts {
 	uint32_t	pairto;
 	uint32_t	discovto;
 	uint32_t	tmpto;
+	uint32_t	tmpmax;
 	uint8_t		privacy;
 
 	struct {
@@ -71,6 +71,9 @@
 
 #define SHUTDOWN_GRACE_SECONDS 10
 
+/* Objects whose pending signals are emitted per main loop iteration */
+#define DBUS_FLUSH_BUDGET 64
+
 struct main_opts main_opts;
 static GKeyFile *main_conf;
 static char *main_conf_file_path;
@@ -91,6 +94,7 @@ static const char *supported_options[] = {
 	"Privacy",
 	"JustWorksRepairing",
 	"TemporaryTimeout",
+	"MaxTemporaryDevices",
 	NULL
 };
 
@@ -543,6 +547,16 @@ static void parse_config(GKeyFile *config)
 		main_opts.tmpto = val;
 	}
 
+	val = g_key_file_get_integer(config, "General",
+						"MaxTemporaryDevices", &err);
+	if (err) {
+		DBG("%s", err->message);
+		g_clear_error(&err);
+	} else {
+		DBG("tmpmax=%d", val);
+		main_opts.tmpmax = val;
+	}
+
 	str = g_key_file_get_string(config, "General", "Name", &err);
 	if (err) {
 		DBG("%s", err->message);
@@ -827,6 +841,7 @@ static int connect_dbus(void)
 	set_dbus_connection(conn);
 
 	g_dbus_set_disconnect_function(conn, disconnected_dbus, NULL, NULL);
+	g_dbus_set_flush_budget(DBUS_FLUSH_BUDGET);
 	g_dbus_attach_object_manager(conn);
 
 	return 0;
@@ -29,6 +29,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
 #include "lib/bluetooth.h"
@@ -44,8 +45,18 @@ static sdp_list_t *access_db;
 typedef struct {
 	uint32_t handle;
 	bdaddr_t device;
+	sdp_pdu_cache_t *cache;
 } sdp_access_t;
 
+/*
+ * Inverted index of the record patterns, sorted by UUID and then by
+ * record handle. It is rebuilt on the first search after any change
+ * to the repository.
+ */
+static sdp_uuid_index_t *uuid_index;
+static int uuid_index_len;
+static bool uuid_index_valid;
+
 /*
  * Ordering function called when inserting a service record.
  * The service repository is a linked list in sorted order
@@ -77,9 +88,30 @@ static int access_sort(const void *r1, const void *r2)
 	return rec1->handle - rec2->handle;
 }
 
+static void cache_free(sdp_pdu_cache_t *cache)
+{
+	if (!cache)
+		return;
+
+	free(cache->pdu.data);
+	free(cache->attrs);
+	free(cache);
+}
+
 static void access_free(void *p)
 {
-	free(p);
+	sdp_access_t *a = p;
+
+	cache_free(a->cache);
+	free(a);
+}
+
+static void uuid_index_invalidate(void)
+{
+	free(uuid_index);
+	uuid_index = NULL;
+	uuid_index_len = 0;
+	uuid_index_valid = false;
 }
 
 /*
@@ -92,6 +124,8 @@ void sdp_svcdb_reset(void)
 
 	sdp_list_free(access_db, access_free);
 	access_db = NULL;
+
+	uuid_index_invalidate();
 }
 
 typedef struct _indexed {
@@ -187,6 +221,9 @@ void sdp_record_add(const bdaddr_t *device, sdp_record_t *rec)
 
 	bacpy(&dev->device, device);
 	dev->handle = rec->handle;
+	dev->cache = NULL;
+
+	uuid_index_invalidate();
 
 	access_db = sdp_list_insert_sorted(access_db, dev, access_sort);
 }
@@ -254,6 +291,8 @@ int sdp_record_remove(uint32_t handle)
 	if (r)
 		service_db = sdp_list_remove(service_db, r);
 
+	uuid_index_invalidate();
+
 	p = access_locate(handle);
 	if (p == NULL || p->data == NULL)
 		return 0;
@@ -294,6 +333,238 @@ int sdp_check_access(uint32_t handle, bdaddr_t *device)
 	return 1;
 }
 
+/*
+ * Drop the cached PDU of a record and the UUID index. Must be called
+ * whenever a record in the repository is modified.
+ */
+void sdp_record_changed(sdp_record_t *rec)
+{
+	sdp_list_t *p;
+	sdp_access_t *a;
+
+	uuid_index_invalidate();
+
+	if (!rec)
+		return;
+
+	p = access_locate(rec->handle);
+	if (!p || !p->data)
+		return;
+
+	a = p->data;
+	cache_free(a->cache);
+	a->cache = NULL;
+}
+
+static int seq_hdr_size(const sdp_buf_t *buf)
+{
+	if (!buf->data_size)
+		return 0;
+
+	switch (buf->data[0]) {
+	case SDP_SEQ8:
+		return sizeof(uint8_t) + sizeof(uint8_t);
+	case SDP_SEQ16:
+		return sizeof(uint8_t) + sizeof(uint16_t);
+	case SDP_SEQ32:
+		return sizeof(uint8_t) + sizeof(uint32_t);
+	}
+
+	return -1;
+}
+
+/*
+ * Locate every attribute inside the full record PDU so that single
+ * attributes and ranges can be copied without encoding them again.
+ */
+static void cache_index_attrs(sdp_pdu_cache_t *cache, sdp_record_t *rec)
+{
+	sdp_buf_t entry;
+	sdp_list_t *l;
+	int hdr, i;
+	uint32_t off;
+
+	hdr = seq_hdr_size(&cache->pdu);
+	if (hdr < 0)
+		return;
+
+	cache->attrs = calloc(sdp_list_len(rec->attrlist),
+						sizeof(*cache->attrs));
+	if (!cache->attrs)
+		return;
+
+	/* Leave room for the largest sequence header */
+	entry.buf_size = cache->pdu.buf_size + sizeof(uint8_t) +
+							sizeof(uint32_t);
+	entry.data = malloc(entry.buf_size);
+	if (!entry.data)
+		goto fail;
+
+	off = hdr;
+
+	for (l = rec->attrlist, i = 0; l; l = l->next, i++) {
+		sdp_data_t *d = l->data;
+		int len;
+
+		memset(entry.data, 0, entry.buf_size);
+		entry.data_size = 0;
+		sdp_append_to_pdu(&entry, d);
+
+		len = entry.data_size - seq_hdr_size(&entry);
+		if (len <= 0 || off + len > cache->pdu.data_size)
+			break;
+
+		cache->attrs[i].id = d->attrId;
+		cache->attrs[i].offset = off;
+		cache->attrs[i].len = len;
+		off += len;
+	}
+
+	free(entry.data);
+
+	/* Fall back to encoding attributes on demand if anything is off */
+	if (l || off != cache->pdu.data_size)
+		goto fail;
+
+	cache->num_attrs = i;
+
+	return;
+
+fail:
+	free(cache->attrs);
+	cache->attrs = NULL;
+}
+
+/*
+ * Return the cached attribute list PDU of a record, generating it on
+ * first use. The attribute index of the cache is only present if the
+ * record could be split into its attributes.
+ */
+const sdp_pdu_cache_t *sdp_record_get_cache(sdp_record_t *rec)
+{
+	sdp_list_t *p;
+	sdp_access_t *a;
+	sdp_pdu_cache_t *cache;
+
+	p = access_locate(rec->handle);
+	if (!p || !p->data)
+		return NULL;
+
+	a = p->data;
+	if (a->cache)
+		return a->cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	if (sdp_gen_record_pdu(rec, &cache->pdu) < 0) {
+		free(cache);
+		return NULL;
+	}
+
+	cache_index_attrs(cache, rec);
+
+	a->cache = cache;
+
+	return cache;
+}
+
+static int uuid_index_sort(const void *e1, const void *e2)
+{
+	const sdp_uuid_index_t *i1 = e1;
+	const sdp_uuid_index_t *i2 = e2;
+	int ret;
+
+	ret = memcmp(&i1->uuid.value.uuid128, &i2->uuid.value.uuid128,
+						sizeof(uint128_t));
+	if (ret)
+		return ret;
+
+	if (i1->rec->handle < i2->rec->handle)
+		return -1;
+
+	return i1->rec->handle > i2->rec->handle;
+}
+
+static void uuid_index_build(void)
+{
+	sdp_list_t *r, *l;
+	int count = 0;
+
+	uuid_index_invalidate();
+
+	for (r = service_db; r; r = r->next) {
+		sdp_record_t *rec = r->data;
+
+		count += sdp_list_len(rec->pattern);
+	}
+
+	if (count) {
+		uuid_index = malloc(count * sizeof(*uuid_index));
+		if (!uuid_index)
+			return;
+	}
+
+	for (r = service_db; r; r = r->next) {
+		sdp_record_t *rec = r->data;
+
+		for (l = rec->pattern; l; l = l->next) {
+			uuid_t *uuid = l->data;
+
+			if (!uuid)
+				continue;
+
+			/* Patterns are always stored in their 128-bit form */
+			uuid_index[uuid_index_len].uuid = *uuid;
+			uuid_index[uuid_index_len].rec = rec;
+			uuid_index_len++;
+		}
+	}
+
+	qsort(uuid_index, uuid_index_len, sizeof(*uuid_index),
+							uuid_index_sort);
+
+	uuid_index_valid = true;
+}
+
+/*
+ * Find the records whose pattern contains the given 128-bit UUID. On
+ * success entries points to a run of matches sorted by record handle.
+ */
+int sdp_uuid_index_find(const uuid_t *uuid128,
+					const sdp_uuid_index_t **entries)
+{
+	int low, high, first;
+
+	if (!uuid_index_valid)
+		uuid_index_build();
+
+	low = 0;
+	high = uuid_index_len;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (memcmp(&uuid_index[mid].uuid.value.uuid128,
+				&uuid128->value.uuid128, sizeof(uint128_t)) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	first = low;
+
+	while (high < uuid_index_len &&
+			!memcmp(&uuid_index[high].uuid.value.uuid128,
+				&uuid128->value.uuid128, sizeof(uint128_t)))
+		high++;
+
+	*entries = uuid_index + first;
+
+	return high - first;
+}
+
 uint32_t sdp_next_handle(void)
 {
 	uint32_t handle = 0x10000;
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include "lib/bluetooth.h"
 #include "lib/l2cap.h"
@@ -55,50 +56,246 @@ typedef struct {
 
 #define MIN(x, y) ((x) < (y)) ? (x): (y)
 
+/*
+ * Responses that do not fit into a single PDU are kept until the client
+ * has fetched all fragments. Entries belong to the connection they were
+ * created on, are looked up through a small hash table and are dropped
+ * once the last fragment has been sent, when the connection goes away,
+ * after CSTATE_TIMEOUT seconds without use or, least recently used
+ * first, when the cache grows beyond its limits.
+ */
+#define CSTATE_HASH_SIZE	64
+#define CSTATE_MEM_MAX		(256 * 1024)
+#define CSTATE_CONN_MAX		4
+#define CSTATE_TIMEOUT		30
+
 typedef struct _sdp_cstate_list sdp_cstate_list_t;
 
 struct _sdp_cstate_list {
 	sdp_cstate_list_t *next;
+	sdp_cstate_list_t *lru_prev;
+	sdp_cstate_list_t *lru_next;
+	int sock;
 	uint32_t timestamp;
+	time_t last_used;
 	sdp_buf_t buf;
 };
 
-static sdp_cstate_list_t *cstates;
+static sdp_cstate_list_t *cstates[CSTATE_HASH_SIZE];
+static sdp_cstate_list_t *lru_head;
+static sdp_cstate_list_t *lru_tail;
+static size_t cstate_mem;
+static uint32_t cstate_next_id;
+
+static struct {
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evicted;
+	unsigned int expired;
+	size_t mem_peak;
+} cstate_stats;
+
+static time_t cstate_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
-/* FIXME: should probably remove it when it's found */
-static sdp_buf_t *sdp_get_cached_rsp(sdp_cont_state_t *cstate)
+	return ts.tv_sec;
+}
+
+static sdp_cstate_list_t **cstate_bucket(int sock, uint32_t id)
+{
+	return &cstates[(id + sock) % CSTATE_HASH_SIZE];
+}
+
+static void cstate_lru_unlink(sdp_cstate_list_t *p)
+{
+	if (p->lru_prev)
+		p->lru_prev->lru_next = p->lru_next;
+	else
+		lru_head = p->lru_next;
+
+	if (p->lru_next)
+		p->lru_next->lru_prev = p->lru_prev;
+	else
+		lru_tail = p->lru_prev;
+
+	p->lru_prev = NULL;
+	p->lru_next = NULL;
+}
+
+static void cstate_lru_push(sdp_cstate_list_t *p)
+{
+	p->lru_next = lru_head;
+	if (lru_head)
+		lru_head->lru_prev = p;
+	else
+		lru_tail = p;
+
+	lru_head = p;
+}
+
+static void cstate_free(sdp_cstate_list_t *cstate)
+{
+	sdp_cstate_list_t **p;
+
+	for (p = cstate_bucket(cstate->sock, cstate->timestamp); *p;
+							p = &(*p)->next) {
+		if (*p == cstate) {
+			*p = cstate->next;
+			break;
+		}
+	}
+
+	cstate_lru_unlink(cstate);
+
+	cstate_mem -= cstate->buf.buf_size;
+	free(cstate->buf.data);
+	free(cstate);
+}
+
+/* Drop expired entries and make room for size more bytes on sock */
+static void cstate_reclaim(int sock, size_t size)
+{
+	sdp_cstate_list_t *p, *prev, *next;
+	time_t now = cstate_now();
+	int conn = 0;
+
+	for (p = lru_tail; p; p = prev) {
+		prev = p->lru_prev;
+
+		if (now - p->last_used > CSTATE_TIMEOUT) {
+			cstate_stats.expired++;
+			cstate_free(p);
+		} else if (cstate_mem + size > CSTATE_MEM_MAX) {
+			cstate_stats.evicted++;
+			cstate_free(p);
+		}
+	}
+
+	/* Keep only the most recent entries of the connection */
+	for (p = lru_head; p; p = next) {
+		next = p->lru_next;
+
+		if (p->sock != sock)
+			continue;
+
+		if (++conn < CSTATE_CONN_MAX)
+			continue;
+
+		cstate_stats.evicted++;
+		cstate_free(p);
+	}
+}
+
+static sdp_buf_t *sdp_get_cached_rsp(int sock, sdp_cont_state_t *cstate)
 {
 	sdp_cstate_list_t *p;
 
-	for (p = cstates; p; p = p->next) {
-		/* Check timestamp */
-		if (p->timestamp != cstate->timestamp)
+	for (p = *cstate_bucket(sock, cstate->timestamp); p; p = p->next) {
+		if (p->sock != sock || p->timestamp != cstate->timestamp)
 			continue;
 
 		/* Check if requesting more than available */
-		if (cstate->cStateValue.maxBytesSent < p->buf.data_size)
-			return &p->buf;
+		if (cstate->cStateValue.maxBytesSent >= p->buf.data_size)
+			break;
+
+		cstate_stats.hits++;
+		p->last_used = cstate_now();
+		cstate_lru_unlink(p);
+		cstate_lru_push(p);
+
+		return &p->buf;
 	}
 
-	return 0;
+	cstate_stats.misses++;
+
+	return NULL;
+}
+
+/* Release a cached response once its last fragment has been sent */
+static void sdp_cstate_done(int sock, sdp_cont_state_t *cstate)
+{
+	sdp_cstate_list_t *p;
+
+	for (p = *cstate_bucket(sock, cstate->timestamp); p; p = p->next) {
+		if (p->sock == sock && p->timestamp == cstate->timestamp) {
+			cstate_free(p);
+			return;
+		}
+	}
 }
 
-static uint32_t sdp_cstate_alloc_buf(sdp_buf_t *buf)
+static uint32_t sdp_cstate_alloc_buf(int sock, sdp_buf_t *buf)
 {
-	sdp_cstate_list_t *cstate = malloc(sizeof(sdp_cstate_list_t));
-	uint8_t *data = malloc(buf->data_size);
+	sdp_cstate_list_t *cstate, **bucket;
+
+	if (buf->data_size > CSTATE_MEM_MAX)
+		return 0;
+
+	cstate_reclaim(sock, buf->data_size);
+
+	cstate = malloc(sizeof(sdp_cstate_list_t));
+	if (!cstate)
+		return 0;
+
+	memset(cstate, 0, sizeof(sdp_cstate_list_t));
+
+	cstate->buf.data = malloc(buf->data_size);
+	if (!cstate->buf.data) {
+		free(cstate);
+		return 0;
+	}
 
-	memcpy(data, buf->data, buf->data_size);
-	memset((char *)cstate, 0, sizeof(sdp_cstate_list_t));
-	cstate->buf.data = data;
+	memcpy(cstate->buf.data, buf->data, buf->data_size);
 	cstate->buf.data_size = buf->data_size;
 	cstate->buf.buf_size = buf->data_size;
-	cstate->timestamp = sdp_get_time();
-	cstate->next = cstates;
-	cstates = cstate;
+
+	/* Identifiers only need to be unique, zero means no state */
+	if (!cstate_next_id)
+		cstate_next_id = sdp_get_time();
+
+	do {
+		cstate->timestamp = cstate_next_id++;
+	} while (!cstate->timestamp);
+
+	cstate->sock = sock;
+	cstate->last_used = cstate_now();
+
+	bucket = cstate_bucket(sock, cstate->timestamp);
+	cstate->next = *bucket;
+	*bucket = cstate;
+	cstate_lru_push(cstate);
+
+	cstate_mem += cstate->buf.buf_size;
+	if (cstate_mem > cstate_stats.mem_peak)
+		cstate_stats.mem_peak = cstate_mem;
+
 	return cstate->timestamp;
 }
 
+/*
+ * Drop all cached responses of a connection that has been closed
+ */
+void sdp_cstate_cleanup(int sock)
+{
+	sdp_cstate_list_t *p, *next;
+
+	for (p = lru_head; p; p = next) {
+		next = p->lru_next;
+
+		if (p->sock == sock)
+			cstate_free(p);
+	}
+
+	DBG("cstate cache: %zu bytes, peak %zu, hits %u, misses %u, "
+			"evicted %u, expired %u", cstate_mem,
+			cstate_stats.mem_peak, cstate_stats.hits,
+			cstate_stats.misses, cstate_stats.evicted,
+			cstate_stats.expired);
+}
+
 /* Additional values for checking datatype (not in spec) */
 #define SDP_TYPE_UUID	0xfe
 #define SDP_TYPE_ATTRID	0xff
@@ -329,36 +526,115 @@ static int sdp_cstate_get(uint8_t *buffer, size_t len,
  * specified by the service discovery client and "target pattern"
  * is the set of UUIDs present in a service record.
  *
- * Return 1 if each and every UUID in the search
- * pattern exists in the target pattern, 0 if the
- * match succeeds and -1 on error.
+ * Candidates are taken from the UUID index entry with the fewest
+ * records, so only records containing at least one of the search
+ * UUIDs are ever looked at. Matches are returned in handle order.
  */
-static int sdp_match_uuid(sdp_list_t *search, sdp_list_t *pattern)
+struct uuid_match {
+	uuid_t *search;
+	int count;
+	int skip;
+	const sdp_uuid_index_t *cand;
+	int num_cand;
+	sdp_list_t *all;
+};
+
+static void uuid_to_uuid128(const uuid_t *uuid, uuid_t *uuid128)
 {
-	/*
-	 * The target is a sorted list, so we need not look
-	 * at all elements to confirm existence of an element
-	 * from the search pattern
-	 */
-	int patlen = sdp_list_len(pattern);
+	memset(uuid128, 0, sizeof(*uuid128));
 
-	if (patlen < sdp_list_len(search))
-		return -1;
-	for (; search; search = search->next) {
-		uuid_t *uuid128;
-		void *data = search->data;
-		sdp_list_t *list;
-		if (data == NULL)
-			return -1;
+	switch (uuid->type) {
+	case SDP_UUID128:
+		*uuid128 = *uuid;
+		break;
+	case SDP_UUID32:
+		sdp_uuid32_to_uuid128(uuid128, uuid);
+		break;
+	case SDP_UUID16:
+		sdp_uuid16_to_uuid128(uuid128, uuid);
+		break;
+	}
+}
 
-		/* create 128-bit form of the search UUID */
-		uuid128 = sdp_uuid_to_uuid128((uuid_t *)data);
-		list = sdp_list_find(pattern, uuid128, sdp_uuid128_cmp);
-		bt_free(uuid128);
-		if (!list)
-			return 0;
+static void sdp_match_init(struct uuid_match *m, sdp_list_t *search)
+{
+	int i;
+
+	memset(m, 0, sizeof(*m));
+
+	m->count = sdp_list_len(search);
+	if (!m->count) {
+		m->all = sdp_get_record_list();
+		return;
 	}
-	return 1;
+
+	m->search = malloc(m->count * sizeof(*m->search));
+	if (!m->search)
+		return;
+
+	for (i = 0; search; search = search->next, i++) {
+		const sdp_uuid_index_t *cand;
+		int n;
+
+		if (search->data == NULL) {
+			m->num_cand = 0;
+			return;
+		}
+
+		uuid_to_uuid128(search->data, &m->search[i]);
+
+		n = sdp_uuid_index_find(&m->search[i], &cand);
+		if (i == 0 || n < m->num_cand) {
+			m->cand = cand;
+			m->num_cand = n;
+			m->skip = i;
+		}
+	}
+}
+
+static sdp_record_t *sdp_match_next(struct uuid_match *m)
+{
+	if (!m->count) {
+		sdp_record_t *rec;
+
+		if (!m->all)
+			return NULL;
+
+		rec = m->all->data;
+		m->all = m->all->next;
+
+		return rec;
+	}
+
+	while (m->num_cand > 0) {
+		sdp_record_t *rec = m->cand->rec;
+		int i;
+
+		m->cand++;
+		m->num_cand--;
+
+		if (sdp_list_len(rec->pattern) < m->count)
+			continue;
+
+		for (i = 0; i < m->count; i++) {
+			if (i == m->skip)
+				continue;
+
+			if (!sdp_list_find(rec->pattern, &m->search[i],
+							sdp_uuid128_cmp))
+				break;
+		}
+
+		if (i == m->count)
+			return rec;
+	}
+
+	return NULL;
+}
+
+static void sdp_match_clear(struct uuid_match *m)
+{
+	free(m->search);
 }
 
 /*
@@ -438,17 +714,18 @@ static int service_search_req(sdp_req_t *req, sdp_buf_t *buf)
 	buf->data_size += sizeof(uint16_t);
 
 	if (cstate == NULL) {
-		/* for every record in the DB, do a pattern search */
-		sdp_list_t *list = sdp_get_record_list();
+		/* for every record matching the search pattern */
+		struct uuid_match match;
+		sdp_record_t *rec;
 
-		handleSize = 0;
-		for (; list && rsp_count < expected; list = list->next) {
-			sdp_record_t *rec = list->data;
+		sdp_match_init(&match, pattern);
 
+		handleSize = 0;
+		while (rsp_count < expected &&
+				(rec = sdp_match_next(&match))) {
 			SDPDBG("Checking svcRec : 0x%x", rec->handle);
 
-			if (sdp_match_uuid(pattern, rec->pattern) > 0 &&
-					sdp_check_access(rec->handle, &req->device)) {
+			if (sdp_check_access(rec->handle, &req->device)) {
 				rsp_count++;
 				put_be32(rec->handle, pdata);
 				pdata += sizeof(uint32_t);
@@ -456,6 +733,8 @@ static int service_search_req(sdp_req_t *req, sdp_buf_t *buf)
 			}
 		}
 
+		sdp_match_clear(&match);
+
 		SDPDBG("Match count: %d", rsp_count);
 
 		buf->data_size += handleSize;
@@ -464,7 +743,12 @@ static int service_search_req(sdp_req_t *req, sdp_buf_t *buf)
 
 		if (rsp_count > actual) {
 			/* cache the rsp and generate a continuation state */
-			cStateId = sdp_cstate_alloc_buf(buf);
+			cStateId = sdp_cstate_alloc_buf(req->sock, buf);
+			if (!cStateId) {
+				error("Unable to cache response");
+				status = SDP_INVALID_SYNTAX;
+				goto done;
+			}
 			/*
 			 * subtract handleSize since we now send only
 			 * a subset of handles
@@ -485,7 +769,8 @@ static int service_search_req(sdp_req_t *req, sdp_buf_t *buf)
 			 * Get the previous sdp_cont_state_t and obtain
 			 * the cached rsp
 			 */
-			sdp_buf_t *pCache = sdp_get_cached_rsp(cstate);
+			sdp_buf_t *pCache = sdp_get_cached_rsp(req->sock,
+								cstate);
 			if (pCache) {
 				pCacheBuffer = pCache->data;
 				/* get the rsp_count from the cached buffer */
@@ -531,6 +816,9 @@ static int service_search_req(sdp_req_t *req, sdp_buf_t *buf)
 		if (i == rsp_count) {
 			/* set "null" continuationState */
 			sdp_set_cstate_pdu(buf, NULL);
+
+			if (cstate)
+				sdp_cstate_done(req->sock, cstate);
 		} else {
 			/*
 			 * there's more: set lastIndexSent to
@@ -566,8 +854,52 @@ done:
  * requested identifiers are present in the PDU form of
  * the request
  */
+static int cache_find_attr(const sdp_pdu_cache_t *cache, uint16_t attr)
+{
+	int low = 0, high = cache->num_attrs;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (cache->attrs[mid].id < attr)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static void append_attr_range(sdp_record_t *rec, const sdp_pdu_cache_t *cache,
+				uint16_t low, uint16_t high, sdp_buf_t *buf)
+{
+	sdp_data_t *data;
+	uint16_t attr;
+	int i;
+
+	if (cache && cache->attrs) {
+		/* Copy the attributes straight out of the cached PDU */
+		for (i = cache_find_attr(cache, low); i < cache->num_attrs &&
+					cache->attrs[i].id <= high; i++)
+			sdp_append_to_buf(buf, cache->pdu.data +
+						cache->attrs[i].offset,
+						cache->attrs[i].len);
+		return;
+	}
+
+	for (attr = low; attr < high; attr++) {
+		data = sdp_data_get(rec, attr);
+		if (data)
+			sdp_append_to_pdu(buf, data);
+	}
+	data = sdp_data_get(rec, high);
+	if (data)
+		sdp_append_to_pdu(buf, data);
+}
+
 static int extract_attrs(sdp_record_t *rec, sdp_list_t *seq, sdp_buf_t *buf)
 {
+	const sdp_pdu_cache_t *cache;
 	sdp_buf_t pdu;
 
 	if (!rec)
@@ -580,7 +912,11 @@ static int extract_attrs(sdp_record_t *rec, sdp_list_t *seq, sdp_buf_t *buf)
 
 	SDPDBG("Entries in attr seq : %d", sdp_list_len(seq));
 
-	sdp_gen_record_pdu(rec, &pdu);
+	cache = sdp_record_get_cache(rec);
+	if (cache)
+		pdu = cache->pdu;
+	else
+		sdp_gen_record_pdu(rec, &pdu);
 
 	for (; seq; seq = seq->next) {
 		struct attrid *aid = seq->data;
@@ -589,15 +925,12 @@ static int extract_attrs(sdp_record_t *rec, sdp_list_t *seq, sdp_buf_t *buf)
 
 		if (aid->dtd == SDP_UINT16) {
 			uint16_t attr = aid->uint16;
-			sdp_data_t *a = sdp_data_get(rec, attr);
-			if (a)
-				sdp_append_to_pdu(buf, a);
+
+			append_attr_range(rec, cache, attr, attr, buf);
 		} else if (aid->dtd == SDP_UINT32) {
 			uint32_t range = aid->uint32;
-			uint16_t attr;
 			uint16_t low = (0xffff0000 & range) >> 16;
 			uint16_t high = 0x0000ffff & range;
-			sdp_data_t *data;
 
 			SDPDBG("attr range : 0x%x", range);
 			SDPDBG("Low id : 0x%x", low);
@@ -609,34 +942,33 @@ static int extract_attrs(sdp_record_t *rec, sdp_list_t *seq, sdp_buf_t *buf)
 				buf->data_size = pdu.data_size;
 				break;
 			}
+
 			/* (else) sub-range of attributes */
-			for (attr = low; attr < high; attr++) {
-				data = sdp_data_get(rec, attr);
-				if (data)
-					sdp_append_to_pdu(buf, data);
-			}
-			data = sdp_data_get(rec, high);
-			if (data)
-				sdp_append_to_pdu(buf, data);
+			if (low > high)
+				low = high;
+
+			append_attr_range(rec, cache, low, high, buf);
 		} else {
 			error("Unexpected data type : 0x%x", aid->dtd);
 			error("Expect uint16_t or uint32_t");
-			free(pdu.data);
+			if (!cache)
+				free(pdu.data);
 			return SDP_INVALID_SYNTAX;
 		}
 	}
 
-	free(pdu.data);
+	if (!cache)
+		free(pdu.data);
 
 	return 0;
 }
 
 /* Build cstate response */
-static int sdp_cstate_rsp(sdp_cont_state_t *cstate, sdp_buf_t *buf,
-							uint16_t max)
+static int sdp_cstate_rsp(int sock, sdp_cont_state_t *cstate,
+					sdp_buf_t *buf, uint16_t max)
 {
 	/* continuation State exists -> get from cache */
-	sdp_buf_t *cache = sdp_get_cached_rsp(cstate);
+	sdp_buf_t *cache = sdp_get_cached_rsp(sock, cstate);
 	uint16_t sent;
 
 	if (!cache)
@@ -650,8 +982,10 @@ static int sdp_cstate_rsp(sdp_cont_state_t *cstate, sdp_buf_t *buf,
 	SDPDBG("Response size : %d sending now : %d bytes sent so far : %d",
 		cache->data_size, sent, cstate->cStateValue.maxBytesSent);
 
-	if (cstate->cStateValue.maxBytesSent == cache->data_size)
+	if (cstate->cStateValue.maxBytesSent == cache->data_size) {
+		sdp_cstate_done(sock, cstate);
 		return sdp_set_cstate_pdu(buf, NULL);
+	}
 
 	return sdp_set_cstate_pdu(buf, cstate);
 }
@@ -750,7 +1084,8 @@ static int service_attr_req(sdp_req_t *req, sdp_buf_t *buf)
 	buf->buf_size -= sizeof(uint16_t);
 
 	if (cstate) {
-		cstate_size = sdp_cstate_rsp(cstate, buf, max_rsp_size);
+		cstate_size = sdp_cstate_rsp(req->sock, cstate, buf,
+								max_rsp_size);
 		if (!cstate_size) {
 			status = SDP_INVALID_CSTATE;
 			error("NULL cache buffer and non-NULL continuation state");
@@ -762,15 +1097,21 @@ static int service_attr_req(sdp_req_t *req, sdp_buf_t *buf)
 			sdp_cont_state_t newState;
 
 			memset((char *)&newState, 0, sizeof(sdp_cont_state_t));
-			newState.timestamp = sdp_cstate_alloc_buf(buf);
-			/*
-			 * Reset the buffer size to the maximum expected and
-			 * set the sdp_cont_state_t
-			 */
-			SDPDBG("Creating continuation state of size : %d", buf->data_size);
-			buf->data_size = max_rsp_size;
-			newState.cStateValue.maxBytesSent = max_rsp_size;
-			cstate_size = sdp_set_cstate_pdu(buf, &newState);
+			newState.timestamp = sdp_cstate_alloc_buf(req->sock, buf);
+			if (!newState.timestamp) {
+				error("Unable to cache response");
+				status = SDP_INVALID_SYNTAX;
+			} else {
+				/*
+				 * Reset the buffer size to the maximum expected
+				 * and set the sdp_cont_state_t
+				 */
+				SDPDBG("Creating continuation state of size : %d",
+								buf->data_size);
+				buf->data_size = max_rsp_size;
+				newState.cStateValue.maxBytesSent = max_rsp_size;
+				cstate_size = sdp_set_cstate_pdu(buf, &newState);
+			}
 		} else {
 			if (buf->data_size == 0)
 				sdp_append_to_buf(buf, NULL, 0);
@@ -804,7 +1145,7 @@ static int service_search_attr_req(sdp_req_t *req, sdp_buf_t *buf)
 	uint8_t *pdata;
 	unsigned int max;
 	int scanned, rsp_count = 0;
-	sdp_list_t *pattern = NULL, *seq = NULL, *svcList;
+	sdp_list_t *pattern = NULL, *seq = NULL;
 	sdp_cont_state_t *cstate = NULL;
 	short cstate_size = 0;
 	uint8_t dtd = 0;
@@ -870,8 +1211,6 @@ static int service_search_attr_req(sdp_req_t *req, sdp_buf_t *buf)
 		goto done;
 	}
 
-	svcList = sdp_get_record_list();
-
 	tmpbuf.data = malloc(USHRT_MAX);
 	tmpbuf.data_size = 0;
 	tmpbuf.buf_size = USHRT_MAX;
@@ -889,11 +1228,13 @@ static int service_search_attr_req(sdp_req_t *req, sdp_buf_t *buf)
 
 	if (cstate == NULL) {
 		/* no continuation state -> create new response */
-		sdp_list_t *p;
-		for (p = svcList; p; p = p->next) {
-			sdp_record_t *rec = p->data;
-			if (sdp_match_uuid(pattern, rec->pattern) > 0 &&
-					sdp_check_access(rec->handle, &req->device)) {
+		struct uuid_match match;
+		sdp_record_t *rec;
+
+		sdp_match_init(&match, pattern);
+
+		while ((rec = sdp_match_next(&match))) {
+			if (sdp_check_access(rec->handle, &req->device)) {
 				rsp_count++;
 				status = extract_attrs(rec, seq, &tmpbuf);
 
@@ -915,22 +1256,30 @@ static int service_search_attr_req(sdp_req_t *req, sdp_buf_t *buf)
 				SDPDBG("Net PDU size : %d", buf->data_size);
 			}
 		}
+
+		sdp_match_clear(&match);
+
 		if (buf->data_size > max) {
 			sdp_cont_state_t newState;
 
 			memset((char *)&newState, 0, sizeof(sdp_cont_state_t));
-			newState.timestamp = sdp_cstate_alloc_buf(buf);
-			/*
-			 * Reset the buffer size to the maximum expected and
-			 * set the sdp_cont_state_t
-			 */
-			buf->data_size = max;
-			newState.cStateValue.maxBytesSent = max;
-			cstate_size = sdp_set_cstate_pdu(buf, &newState);
+			newState.timestamp = sdp_cstate_alloc_buf(req->sock, buf);
+			if (!newState.timestamp) {
+				error("Unable to cache response");
+				status = SDP_INVALID_SYNTAX;
+			} else {
+				/*
+				 * Reset the buffer size to the maximum expected
+				 * and set the sdp_cont_state_t
+				 */
+				buf->data_size = max;
+				newState.cStateValue.maxBytesSent = max;
+				cstate_size = sdp_set_cstate_pdu(buf, &newState);
+			}
 		} else
 			cstate_size = sdp_set_cstate_pdu(buf, NULL);
 	} else {
-		cstate_size = sdp_cstate_rsp(cstate, buf, max);
+		cstate_size = sdp_cstate_rsp(req->sock, cstate, buf, max);
 		if (!cstate_size) {
 			status = SDP_INVALID_CSTATE;
 			SDPDBG("Non-null continuation state, but null cache buffer");
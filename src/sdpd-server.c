@@ -161,12 +161,14 @@ static gboolean io_session_event(GIOChannel *chan, GIOCondition cond, gpointer d
 
 	if (cond & (G_IO_HUP | G_IO_ERR)) {
 		sdp_svcdb_collect_all(sk);
+		sdp_cstate_cleanup(sk);
 		return FALSE;
 	}
 
 	len = recv(sk, &hdr, sizeof(sdp_pdu_hdr_t), MSG_PEEK);
 	if (len < 0 || (unsigned int) len < sizeof(sdp_pdu_hdr_t)) {
 		sdp_svcdb_collect_all(sk);
+		sdp_cstate_cleanup(sk);
 		return FALSE;
 	}
 
@@ -182,6 +184,7 @@ static gboolean io_session_event(GIOChannel *chan, GIOCondition cond, gpointer d
 	 */
 	if (len <= 0) {
 		sdp_svcdb_collect_all(sk);
+		sdp_cstate_cleanup(sk);
 		free(buf);
 		return FALSE;
 	}
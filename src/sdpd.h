@@ -42,8 +42,26 @@ typedef struct request {
 	int      len;
 } sdp_req_t;
 
+typedef struct {
+	uint16_t id;
+	uint16_t len;
+	uint32_t offset;
+} sdp_attr_offset_t;
+
+typedef struct {
+	sdp_buf_t pdu;
+	sdp_attr_offset_t *attrs;
+	int num_attrs;
+} sdp_pdu_cache_t;
+
+typedef struct {
+	uuid_t uuid;
+	sdp_record_t *rec;
+} sdp_uuid_index_t;
+
 void handle_internal_request(int sk, int mtu, void *data, int len);
 void handle_request(int sk, uint8_t *data, int len);
+void sdp_cstate_cleanup(int sk);
 
 void set_fixed_db_timestamp(uint32_t dbts);
 
@@ -67,6 +85,10 @@ void sdp_record_add(const bdaddr_t *device, sdp_record_t *rec);
 int sdp_record_remove(uint32_t handle);
 sdp_list_t *sdp_get_record_list(void);
 int sdp_check_access(uint32_t handle, bdaddr_t *device);
+void sdp_record_changed(sdp_record_t *rec);
+const sdp_pdu_cache_t *sdp_record_get_cache(sdp_record_t *rec);
+int sdp_uuid_index_find(const uuid_t *uuid128,
+					const sdp_uuid_index_t **entries);
 uint32_t sdp_next_handle(void);
 
 uint32_t sdp_get_time(void);
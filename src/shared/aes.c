@@ -0,0 +1,357 @@
+/*
+ *
+ *  BlueZ - Bluetooth protocol stack for Linux
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <wmmintrin.h>
+#define HAVE_AESNI
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+#include <arm_neon.h>
+#define HAVE_ARMV8_CE
+#endif
+
+#include "src/shared/util.h"
+#include "src/shared/aes.h"
+
+/*
+ * The generic implementation works on eight state bytes packed into a
+ * 64-bit word and computes the S-box arithmetically instead of using
+ * lookup tables, so no memory access depends on key or data.
+ */
+#define LSB64	0x0101010101010101ULL
+
+/* Clear key material in a way that cannot be optimized away */
+static inline void clear_buf(void *buf, size_t len)
+{
+	memset(buf, 0, len);
+	__asm__ __volatile__("" : : "r"(buf) : "memory");
+}
+
+static inline uint64_t xtime64(uint64_t x)
+{
+	return ((x & 0x7f7f7f7f7f7f7f7fULL) << 1) ^
+					(((x >> 7) & LSB64) * 0x1b);
+}
+
+static uint64_t gf_mul64(uint64_t a, uint64_t b)
+{
+	uint64_t r = 0;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		r ^= a & (((b >> i) & LSB64) * 0xff);
+		a = xtime64(a);
+	}
+
+	return r;
+}
+
+static inline uint64_t rotl8(uint64_t x, int n)
+{
+	return ((x << n) & (((0xff << n) & 0xff) * LSB64)) |
+			((x >> (8 - n)) & ((0xff >> (8 - n)) * LSB64));
+}
+
+static uint64_t sub_bytes64(uint64_t x)
+{
+	uint64_t s, r;
+	int i;
+
+	/* Multiplicative inverse as x^254, zero maps to zero */
+	s = gf_mul64(x, x);
+	r = s;
+
+	for (i = 0; i < 6; i++) {
+		s = gf_mul64(s, s);
+		r = gf_mul64(r, s);
+	}
+
+	/* Affine transformation */
+	return r ^ rotl8(r, 1) ^ rotl8(r, 2) ^ rotl8(r, 3) ^ rotl8(r, 4) ^
+							(0x63 * LSB64);
+}
+
+/* Rotate the bytes of each column, row r takes the byte of row r + n */
+static inline uint64_t rotcol64(uint64_t x, int n)
+{
+	uint64_t lo = (0xffffffffULL >> (8 * n)) * 0x0000000100000001ULL;
+
+	return ((x >> (8 * n)) & lo) | ((x << (32 - 8 * n)) & ~lo);
+}
+
+static uint64_t mix_columns64(uint64_t x)
+{
+	uint64_t r1 = rotcol64(x, 1);
+
+	return xtime64(x ^ r1) ^ r1 ^ rotcol64(x, 2) ^ rotcol64(x, 3);
+}
+
+static void shift_rows(const uint8_t in[16], uint8_t out[16])
+{
+	int r, c;
+
+	for (c = 0; c < 4; c++)
+		for (r = 0; r < 4; r++)
+			out[4 * c + r] = in[4 * ((c + r) % 4) + r];
+}
+
+static void encrypt_generic(const struct bt_aes_key *key,
+					const uint8_t in[16], uint8_t out[16])
+{
+	uint8_t s[16], t[16];
+	int round;
+
+	memcpy(s, in, 16);
+
+	for (round = 0; round < 10; round++) {
+		put_le64(get_le64(s) ^ get_le64(key->rk[round]), s);
+		put_le64(get_le64(s + 8) ^ get_le64(key->rk[round] + 8),
+									s + 8);
+
+		put_le64(sub_bytes64(get_le64(s)), s);
+		put_le64(sub_bytes64(get_le64(s + 8)), s + 8);
+
+		shift_rows(s, t);
+
+		if (round == 9) {
+			memcpy(s, t, 16);
+			break;
+		}
+
+		put_le64(mix_columns64(get_le64(t)), s);
+		put_le64(mix_columns64(get_le64(t + 8)), s + 8);
+	}
+
+	put_le64(get_le64(s) ^ get_le64(key->rk[10]), out);
+	put_le64(get_le64(s + 8) ^ get_le64(key->rk[10] + 8), out + 8);
+}
+
+#ifdef HAVE_AESNI
+__attribute__((target("aes,sse2")))
+static void encrypt_aesni(const struct bt_aes_key *key,
+					const uint8_t in[16], uint8_t out[16])
+{
+	__m128i s;
+	int round;
+
+	s = _mm_loadu_si128((const __m128i *) in);
+	s = _mm_xor_si128(s, _mm_loadu_si128((const __m128i *) key->rk[0]));
+
+	for (round = 1; round < 10; round++)
+		s = _mm_aesenc_si128(s,
+			_mm_loadu_si128((const __m128i *) key->rk[round]));
+
+	s = _mm_aesenclast_si128(s,
+			_mm_loadu_si128((const __m128i *) key->rk[10]));
+
+	_mm_storeu_si128((__m128i *) out, s);
+}
+#endif
+
+#ifdef HAVE_ARMV8_CE
+static void encrypt_armv8(const struct bt_aes_key *key,
+					const uint8_t in[16], uint8_t out[16])
+{
+	uint8x16_t s;
+	int round;
+
+	s = vld1q_u8(in);
+
+	for (round = 0; round < 9; round++)
+		s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(key->rk[round])));
+
+	s = vaeseq_u8(s, vld1q_u8(key->rk[9]));
+	s = veorq_u8(s, vld1q_u8(key->rk[10]));
+
+	vst1q_u8(out, s);
+}
+#endif
+
+static void (*encrypt_block)(const struct bt_aes_key *key,
+				const uint8_t in[16], uint8_t out[16]);
+static const char *encrypt_name;
+
+static void select_impl(void)
+{
+	if (encrypt_block)
+		return;
+
+	encrypt_block = encrypt_generic;
+	encrypt_name = "generic";
+
+#ifdef HAVE_AESNI
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("aes")) {
+		encrypt_block = encrypt_aesni;
+		encrypt_name = "aes-ni";
+	}
+#endif
+
+#ifdef HAVE_ARMV8_CE
+	encrypt_block = encrypt_armv8;
+	encrypt_name = "armv8-ce";
+#endif
+}
+
+const char *bt_aes_impl(void)
+{
+	select_impl();
+
+	return encrypt_name;
+}
+
+/* Left shift by one bit of a 128-bit value as used for CMAC subkeys */
+static void cmac_shift(const uint8_t in[16], uint8_t out[16])
+{
+	uint8_t msb = in[0] >> 7;
+	int i;
+
+	for (i = 0; i < 15; i++)
+		out[i] = (in[i] << 1) | (in[i + 1] >> 7);
+
+	out[15] = (in[15] << 1) ^ (0x87 & -msb);
+}
+
+void bt_aes_set_key(struct bt_aes_key *key, const uint8_t k[16])
+{
+	const uint8_t zero[16] = { };
+	uint8_t rcon = 0x01;
+	uint8_t l[16];
+	int i;
+
+	select_impl();
+
+	memcpy(key->rk[0], k, 16);
+
+	for (i = 1; i < 11; i++) {
+		const uint8_t *prev = key->rk[i - 1];
+		uint8_t *rk = key->rk[i];
+		uint8_t t[8] = { };
+		int j;
+
+		/* SubWord(RotWord(w)) xor Rcon */
+		t[0] = prev[13];
+		t[1] = prev[14];
+		t[2] = prev[15];
+		t[3] = prev[12];
+		put_le64(sub_bytes64(get_le64(t)), t);
+		t[0] ^= rcon;
+
+		for (j = 0; j < 4; j++)
+			rk[j] = prev[j] ^ t[j];
+
+		for (j = 4; j < 16; j++)
+			rk[j] = prev[j] ^ rk[j - 4];
+
+		rcon = (rcon << 1) ^ (0x1b & -(rcon >> 7));
+	}
+
+	encrypt_block(key, zero, l);
+	cmac_shift(l, key->k1);
+	cmac_shift(key->k1, key->k2);
+
+	clear_buf(l, sizeof(l));
+}
+
+void bt_aes_clear_key(struct bt_aes_key *key)
+{
+	clear_buf(key, sizeof(*key));
+}
+
+void bt_aes_encrypt(const struct bt_aes_key *key, const uint8_t in[16],
+							uint8_t out[16])
+{
+	encrypt_block(key, in, out);
+}
+
+static inline void xor_block(uint8_t *dst, const uint8_t *src, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		dst[i] ^= src[i];
+}
+
+void bt_aes_cmac_iov(const struct bt_aes_key *key, const struct iovec *iov,
+					size_t iov_len, uint8_t res[16])
+{
+	uint8_t x[16] = { }, buf[16];
+	size_t used = 0, i;
+
+	/*
+	 * A full block is only processed once more data follows it since
+	 * the last block is treated differently.
+	 */
+	for (i = 0; i < iov_len; i++) {
+		const uint8_t *data = iov[i].iov_base;
+		size_t len = iov[i].iov_len;
+
+		while (len) {
+			size_t n;
+
+			if (used == 16) {
+				xor_block(x, buf, 16);
+				encrypt_block(key, x, x);
+				used = 0;
+			}
+
+			n = len < 16 - used ? len : 16 - used;
+			memcpy(buf + used, data, n);
+			used += n;
+			data += n;
+			len -= n;
+		}
+	}
+
+	if (used == 16) {
+		xor_block(x, key->k1, 16);
+	} else {
+		buf[used] = 0x80;
+		memset(buf + used + 1, 0, 15 - used);
+		xor_block(x, key->k2, 16);
+	}
+
+	xor_block(x, buf, 16);
+	encrypt_block(key, x, res);
+
+	clear_buf(x, sizeof(x));
+}
+
+void bt_aes_cmac(const struct bt_aes_key *key, const uint8_t *msg,
+					size_t msg_len, uint8_t res[16])
+{
+	struct iovec iov = {
+		.iov_base = (void *) msg,
+		.iov_len = msg_len,
+	};
+
+	bt_aes_cmac_iov(key, &iov, 1, res);
+}
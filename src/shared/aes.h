@@ -0,0 +1,51 @@
+/*
+ *
+ *  BlueZ - Bluetooth protocol stack for Linux
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/*
+ * AES-128 key schedule together with the CMAC subkeys derived from it.
+ * All values are in the byte order of FIPS-197, i.e. the most significant
+ * octet first, and can be kept around to encrypt with the same key again.
+ */
+struct bt_aes_key {
+	uint8_t rk[11][16];
+	uint8_t k1[16];
+	uint8_t k2[16];
+};
+
+const char *bt_aes_impl(void);
+
+void bt_aes_set_key(struct bt_aes_key *key, const uint8_t k[16]);
+void bt_aes_clear_key(struct bt_aes_key *key);
+
+void bt_aes_encrypt(const struct bt_aes_key *key, const uint8_t in[16],
+							uint8_t out[16]);
+
+void bt_aes_cmac(const struct bt_aes_key *key, const uint8_t *msg,
+					size_t msg_len, uint8_t res[16]);
+void bt_aes_cmac_iov(const struct bt_aes_key *key, const struct iovec *iov,
+					size_t iov_len, uint8_t res[16]);
@@ -42,7 +42,7 @@
 #define ATT_MIN_PDU_LEN			1  /* At least 1 byte for the opcode. */
 #define ATT_OP_CMD_MASK			0x40
 #define ATT_OP_SIGNED_MASK		0x80
-#define ATT_TIMEOUT_INTERVAL		30000  /* 30000 ms */
+#define ATT_TIMEOUT_INTERVAL		30  /* 30 seconds */
 
 /* Length of signature in write signed packet */
 #define BT_ATT_SIGNATURE_LEN		12
@@ -76,6 +76,7 @@ struct bt_att {
 	uint16_t mtu;			/* Biggest possible MTU */
 
 	struct queue *notify_list;	/* List of registered callbacks */
+	struct queue *notify_ops[256];	/* Callbacks indexed by opcode */
 	struct queue *disconn_list;	/* List of disconnect handlers */
 
 	unsigned int next_send_id;	/* IDs for "send" ops */
@@ -214,7 +215,7 @@ static void destroy_att_send_op(void *data)
 	struct att_send_op *op = data;
 
 	if (op->timeout_id)
-		timeout_remove(op->timeout_id);
+		timeout_remove_seconds(op->timeout_id);
 
 	if (op->destroy)
 		op->destroy(op->user_data);
@@ -545,8 +546,8 @@ static bool can_write_data(struct io *io, void *user_data)
 	timeout = new0(struct timeout_data, 1);
 	timeout->chan = chan;
 	timeout->id = op->id;
-	op->timeout_id = timeout_add(ATT_TIMEOUT_INTERVAL, timeout_cb,
-								timeout, free);
+	op->timeout_id = timeout_add_seconds(ATT_TIMEOUT_INTERVAL, timeout_cb,
+							timeout, free);
 
 	/* Return true as there may be more operations ready to write. */
 	return true;
@@ -754,7 +755,7 @@ static bool handle_error_rsp(struct bt_att_chan *chan, uint8_t *pdu,
 
 	/* Remove timeout_id if outstanding */
 	if (op->timeout_id) {
-		timeout_remove(op->timeout_id);
+		timeout_remove_seconds(op->timeout_id);
 		op->timeout_id = 0;
 	}
 
@@ -865,17 +866,6 @@ struct notify_data {
 	bool handler_found;
 };
 
-static bool opcode_match(uint8_t opcode, uint8_t test_opcode)
-{
-	enum att_op_type op_type = get_op_type(test_opcode);
-
-	if (opcode == BT_ATT_ALL_REQUESTS && (op_type == ATT_OP_TYPE_REQ ||
-						op_type == ATT_OP_TYPE_CMD))
-		return true;
-
-	return opcode == test_opcode;
-}
-
 static void respond_not_supported(struct bt_att *att, uint8_t opcode)
 {
 	struct bt_att_pdu_error_rsp pdu;
@@ -927,22 +917,37 @@ static void handle_notify(struct bt_att_chan *chan, uint8_t *pdu,
 							ssize_t pdu_len)
 {
 	struct bt_att *att = chan->att;
-	const struct queue_entry *entry;
+	const struct queue_entry *entry, *all;
 	bool found;
 	uint8_t opcode = pdu[0];
+	enum att_op_type op_type = get_op_type(opcode);
 
 	bt_att_ref(att);
 
 	found = false;
-	entry = queue_get_entries(att->notify_list);
-
-	while (entry) {
-		struct att_notify *notify = entry->data;
+	entry = queue_get_entries(att->notify_ops[opcode]);
 
-		entry = entry->next;
-
-		if (!opcode_match(notify->opcode, opcode))
-			continue;
+	/*
+	 * Handlers registered for all requests are merged in by ID so they
+	 * keep being called in registration order.
+	 */
+	if (opcode != BT_ATT_ALL_REQUESTS && (op_type == ATT_OP_TYPE_REQ ||
+						op_type == ATT_OP_TYPE_CMD))
+		all = queue_get_entries(att->notify_ops[BT_ATT_ALL_REQUESTS]);
+	else
+		all = NULL;
+
+	while (entry || all) {
+		struct att_notify *notify;
+
+		if (entry && (!all || ((struct att_notify *) entry->data)->id <
+				((struct att_notify *) all->data)->id)) {
+			notify = entry->data;
+			entry = entry->next;
+		} else {
+			notify = all->data;
+			all = all->next;
+		}
 
 		if ((opcode & ATT_OP_SIGNED_MASK) && att->crypto) {
 			if (!handle_signed(att, pdu, pdu_len))
@@ -982,7 +987,7 @@ not_supported:
 	 * If this was not a command and no handler was registered for it,
 	 * respond with "Not Supported"
 	 */
-	if (!found && get_op_type(opcode) != ATT_OP_TYPE_CMD)
+	if (!found && op_type != ATT_OP_TYPE_CMD)
 		respond_not_supported(att, opcode);
 
 	bt_att_unref(att);
@@ -1096,6 +1101,8 @@ static bool is_io_l2cap_based(int fd)
 
 static void bt_att_free(struct bt_att *att)
 {
+	unsigned int i;
+
 	bt_crypto_unref(att->crypto);
 
 	if (att->timeout_destroy)
@@ -1111,6 +1118,10 @@ static void bt_att_free(struct bt_att *att)
 	queue_destroy(att->ind_queue, NULL);
 	queue_destroy(att->write_queue, NULL);
 	queue_destroy(att->notify_list, NULL);
+
+	for (i = 0; i < ARRAY_SIZE(att->notify_ops); i++)
+		queue_destroy(att->notify_ops[i], NULL);
+
 	queue_destroy(att->disconn_list, NULL);
 	queue_destroy(att->chans, bt_att_chan_free);
 
@@ -1749,11 +1760,16 @@ unsigned int bt_att_register(struct bt_att *att, uint8_t opcode,
 
 	notify->id = att->next_reg_id++;
 
+	if (!att->notify_ops[opcode])
+		att->notify_ops[opcode] = queue_new();
+
 	if (!queue_push_tail(att->notify_list, notify)) {
 		free(notify);
 		return 0;
 	}
 
+	queue_push_tail(att->notify_ops[opcode], notify);
+
 	return notify->id;
 }
 
@@ -1769,15 +1785,22 @@ bool bt_att_unregister(struct bt_att *att, unsigned int id)
 	if (!notify)
 		return false;
 
+	queue_remove(att->notify_ops[notify->opcode], notify);
+
 	destroy_att_notify(notify);
 	return true;
 }
 
 bool bt_att_unregister_all(struct bt_att *att)
 {
+	unsigned int i;
+
 	if (!att)
 		return false;
 
+	for (i = 0; i < ARRAY_SIZE(att->notify_ops); i++)
+		queue_remove_all(att->notify_ops[i], NULL, NULL, NULL);
+
 	queue_remove_all(att->notify_list, NULL, NULL, destroy_att_notify);
 	queue_remove_all(att->disconn_list, NULL, NULL, destroy_att_disconn);
 
@@ -31,6 +31,7 @@
 #include <sys/socket.h>
 
 #include "src/shared/util.h"
+#include "src/shared/aes.h"
 #include "src/shared/crypto.h"
 
 #ifndef HAVE_LINUX_IF_ALG_H
@@ -77,24 +78,24 @@ struct af_alg_iv {
 
 #define ATT_SIGN_LEN	12
 
+/* Number of expanded keys kept around by the user space backend */
+#define KEY_CACHE_SIZE	4
+
+struct key_cache {
+	bool valid;
+	uint8_t key[16];
+	struct bt_aes_key aes;
+};
+
 struct bt_crypto {
 	int ref_count;
+	enum bt_crypto_backend backend;
 	int ecb_aes;
-	int urandom;
 	int cmac_aes;
+	struct key_cache keys[KEY_CACHE_SIZE];
+	unsigned int key_next;
 };
 
-static int urandom_setup(void)
-{
-	int fd;
-
-	fd = open("/dev/urandom", O_RDONLY);
-	if (fd < 0)
-		return -1;
-
-	return fd;
-}
-
 static int ecb_aes_setup(void)
 {
 	struct sockaddr_alg salg;
@@ -139,29 +140,40 @@ static int cmac_aes_setup(void)
 	return fd;
 }
 
-struct bt_crypto *bt_crypto_new(void)
+static bool alg_setup(struct bt_crypto *crypto)
 {
-	struct bt_crypto *crypto;
-
-	crypto = new0(struct bt_crypto, 1);
-
 	crypto->ecb_aes = ecb_aes_setup();
-	if (crypto->ecb_aes < 0) {
-		free(crypto);
-		return NULL;
-	}
-
-	crypto->urandom = urandom_setup();
-	if (crypto->urandom < 0) {
-		close(crypto->ecb_aes);
-		free(crypto);
-		return NULL;
-	}
+	if (crypto->ecb_aes < 0)
+		return false;
 
 	crypto->cmac_aes = cmac_aes_setup();
 	if (crypto->cmac_aes < 0) {
-		close(crypto->urandom);
 		close(crypto->ecb_aes);
+		return false;
+	}
+
+	return true;
+}
+
+struct bt_crypto *bt_crypto_new_backend(enum bt_crypto_backend backend)
+{
+	struct bt_crypto *crypto;
+
+	crypto = new0(struct bt_crypto, 1);
+	crypto->backend = backend;
+	crypto->ecb_aes = -1;
+	crypto->cmac_aes = -1;
+
+	switch (backend) {
+	case BT_CRYPTO_BACKEND_USER:
+		break;
+	case BT_CRYPTO_BACKEND_AF_ALG:
+		if (!alg_setup(crypto)) {
+			free(crypto);
+			return NULL;
+		}
+		break;
+	default:
 		free(crypto);
 		return NULL;
 	}
@@ -169,6 +181,11 @@ struct bt_crypto *bt_crypto_new(void)
 	return bt_crypto_ref(crypto);
 }
 
+struct bt_crypto *bt_crypto_new(void)
+{
+	return bt_crypto_new_backend(BT_CRYPTO_BACKEND_USER);
+}
+
 struct bt_crypto *bt_crypto_ref(struct bt_crypto *crypto)
 {
 	if (!crypto)
@@ -187,9 +204,15 @@ void bt_crypto_unref(struct bt_crypto *crypto)
 	if (__sync_sub_and_fetch(&crypto->ref_count, 1))
 		return;
 
-	close(crypto->urandom);
-	close(crypto->ecb_aes);
-	close(crypto->cmac_aes);
+	if (crypto->ecb_aes >= 0)
+		close(crypto->ecb_aes);
+
+	if (crypto->cmac_aes >= 0)
+		close(crypto->cmac_aes);
+
+	/* Clear raw keys and schedules in a way that cannot be optimized away */
+	memset(crypto->keys, 0, sizeof(crypto->keys));
+	__asm__ __volatile__("" : : "r"(crypto->keys) : "memory");
 
 	free(crypto);
 }
@@ -198,11 +221,22 @@ bool bt_crypto_random_bytes(struct bt_crypto *crypto,
 					void *buf, uint8_t num_bytes)
 {
 	ssize_t len;
+	int fd;
 
 	if (!crypto)
 		return false;
 
-	len = read(crypto->urandom, buf, num_bytes);
+	/*
+	 * Random bytes are only needed while pairing, so do not keep a
+	 * descriptor open for every instance; emulators create thousands.
+	 */
+	fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	len = read(fd, buf, num_bytes);
+	close(fd);
+
 	if (len < num_bytes)
 		return false;
 
@@ -265,13 +299,111 @@ static inline void swap_buf(const uint8_t *src, uint8_t *dst, uint16_t len)
 		dst[len - 1 - i] = src[i];
 }
 
+static const struct bt_aes_key *get_key(struct bt_crypto *crypto,
+						const uint8_t key[16])
+{
+	struct key_cache *entry;
+	int i, j;
+
+	for (i = 0; i < KEY_CACHE_SIZE; i++) {
+		uint8_t diff = 0;
+
+		entry = &crypto->keys[i];
+		if (!entry->valid)
+			continue;
+
+		/* Don't leak through timing how much of a key matched */
+		for (j = 0; j < 16; j++)
+			diff |= entry->key[j] ^ key[j];
+
+		if (!diff)
+			return &entry->aes;
+	}
+
+	entry = &crypto->keys[crypto->key_next];
+	crypto->key_next = (crypto->key_next + 1) % KEY_CACHE_SIZE;
+
+	memcpy(entry->key, key, 16);
+	bt_aes_set_key(&entry->aes, key);
+	entry->valid = true;
+
+	return &entry->aes;
+}
+
+/* Encrypt one block, key and data with the most significant octet first */
+static bool ecb_encrypt(struct bt_crypto *crypto, const uint8_t key[16],
+				const uint8_t in[16], uint8_t out[16])
+{
+	int fd;
+	bool ret;
+
+	if (crypto->backend == BT_CRYPTO_BACKEND_USER) {
+		bt_aes_encrypt(get_key(crypto, key), in, out);
+		return true;
+	}
+
+	fd = alg_new(crypto->ecb_aes, key, 16);
+	if (fd < 0)
+		return false;
+
+	ret = alg_encrypt(fd, in, 16, out, 16);
+
+	close(fd);
+
+	return ret;
+}
+
+/* AES-CMAC with key, message and result most significant octet first */
+static bool cmac_iov(struct bt_crypto *crypto, const uint8_t key[16],
+				const struct iovec *iov, size_t iov_len,
+				uint8_t res[16])
+{
+	ssize_t len;
+	int fd;
+
+	if (crypto->backend == BT_CRYPTO_BACKEND_USER) {
+		bt_aes_cmac_iov(get_key(crypto, key), iov, iov_len, res);
+		return true;
+	}
+
+	fd = alg_new(crypto->cmac_aes, key, 16);
+	if (fd < 0)
+		return false;
+
+	len = writev(fd, iov, iov_len);
+	if (len < 0) {
+		close(fd);
+		return false;
+	}
+
+	len = read(fd, res, 16);
+	if (len < 0) {
+		close(fd);
+		return false;
+	}
+
+	close(fd);
+
+	return true;
+}
+
+static bool cmac(struct bt_crypto *crypto, const uint8_t key[16],
+				const uint8_t *msg, size_t msg_len,
+				uint8_t res[16])
+{
+	struct iovec iov = {
+		.iov_base = (void *) msg,
+		.iov_len = msg_len,
+	};
+
+	return cmac_iov(crypto, key, &iov, 1, res);
+}
+
 bool bt_crypto_sign_att(struct bt_crypto *crypto, const uint8_t key[16],
 				const uint8_t *m, uint16_t m_len,
 				uint32_t sign_cnt,
 				uint8_t signature[ATT_SIGN_LEN])
 {
-	int fd;
-	int len;
 	uint8_t tmp[16], out[16];
 	uint16_t msg_len = m_len + sizeof(uint32_t);
 	uint8_t msg[msg_len];
@@ -289,26 +421,11 @@ bool bt_crypto_sign_att(struct bt_crypto *crypto, const uint8_t key[16],
 	/* The most significant octet of key corresponds to key[0] */
 	swap_buf(key, tmp, 16);
 
-	fd = alg_new(crypto->cmac_aes, tmp, 16);
-	if (fd < 0)
-		return false;
-
 	/* Swap msg before signing */
 	swap_buf(msg, msg_s, msg_len);
 
-	len = send(fd, msg_s, msg_len, 0);
-	if (len < 0) {
-		close(fd);
-		return false;
-	}
-
-	len = read(fd, out, 16);
-	if (len < 0) {
-		close(fd);
+	if (!cmac(crypto, tmp, msg_s, msg_len, out))
 		return false;
-	}
-
-	close(fd);
 
 	/*
 	 * As to BT spec. 4.1 Vol[3], Part C, chapter 10.4.1 sign counter should
@@ -364,7 +481,6 @@ bool bt_crypto_e(struct bt_crypto *crypto, const uint8_t key[16],
 			const uint8_t plaintext[16], uint8_t encrypted[16])
 {
 	uint8_t tmp[16], in[16], out[16];
-	int fd;
 
 	if (!crypto)
 		return false;
@@ -372,24 +488,15 @@ bool bt_crypto_e(struct bt_crypto *crypto, const uint8_t key[16],
 	/* The most significant octet of key corresponds to key[0] */
 	swap_buf(key, tmp, 16);
 
-	fd = alg_new(crypto->ecb_aes, tmp, 16);
-	if (fd < 0)
-		return false;
-
-
 	/* Most significant octet of plaintextData corresponds to in[0] */
 	swap_buf(plaintext, in, 16);
 
-	if (!alg_encrypt(fd, in, 16, out, 16)) {
-		close(fd);
+	if (!ecb_encrypt(crypto, tmp, in, out))
 		return false;
-	}
 
 	/* Most significant octet of encryptedData corresponds to out[0] */
 	swap_buf(out, encrypted, 16);
 
-	close(fd);
-
 	return true;
 }
 
@@ -596,34 +703,18 @@ static bool aes_cmac(struct bt_crypto *crypto, const uint8_t key[16],
 			const uint8_t *msg, size_t msg_len, uint8_t res[16])
 {
 	uint8_t key_msb[16], out[16], msg_msb[CMAC_MSG_MAX];
-	ssize_t len;
-	int fd;
 
 	if (msg_len > CMAC_MSG_MAX)
 		return false;
 
 	swap_buf(key, key_msb, 16);
-	fd = alg_new(crypto->cmac_aes, key_msb, 16);
-	if (fd < 0)
-		return false;
-
 	swap_buf(msg, msg_msb, msg_len);
-	len = send(fd, msg_msb, msg_len, 0);
-	if (len < 0) {
-		close(fd);
-		return false;
-	}
 
-	len = read(fd, out, 16);
-	if (len < 0) {
-		close(fd);
+	if (!cmac(crypto, key_msb, msg_msb, msg_len, out))
 		return false;
-	}
 
 	swap_buf(out, res, 16);
 
-	close(fd);
-
 	return true;
 }
 
@@ -717,29 +808,9 @@ bool bt_crypto_gatt_hash(struct bt_crypto *crypto, struct iovec *iov,
 				size_t iov_len, uint8_t res[16])
 {
 	const uint8_t key[16] = {};
-	ssize_t len;
-	int fd;
 
 	if (!crypto)
 		return false;
 
-	fd = alg_new(crypto->cmac_aes, key, 16);
-	if (fd < 0)
-		return false;
-
-	len = writev(fd, iov, iov_len);
-	if (len < 0) {
-		close(fd);
-		return false;
-	}
-
-	len = read(fd, res, 16);
-	if (len < 0) {
-		close(fd);
-		return false;
-	}
-
-	close(fd);
-
-	return true;
+	return cmac_iov(crypto, key, iov, iov_len, res);
 }
@@ -27,7 +27,13 @@
 
 struct bt_crypto;
 
+enum bt_crypto_backend {
+	BT_CRYPTO_BACKEND_USER,		/* AES in user space */
+	BT_CRYPTO_BACKEND_AF_ALG,	/* Kernel crypto API sockets */
+};
+
 struct bt_crypto *bt_crypto_new(void);
+struct bt_crypto *bt_crypto_new_backend(enum bt_crypto_backend backend);
 
 struct bt_crypto *bt_crypto_ref(struct bt_crypto *crypto);
 void bt_crypto_unref(struct bt_crypto *crypto);
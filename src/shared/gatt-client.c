@@ -94,6 +94,9 @@ struct bt_gatt_client {
 	/* List of registered disconnect/notification/indication callbacks */
 	struct queue *notify_list;
 	struct queue *notify_chrcs;
+	struct notify_chrc **chrc_index;	/* Sorted by value handle */
+	unsigned int chrc_index_len;
+	unsigned int chrc_index_size;
 	int next_reg_id;
 	unsigned int disc_id, nfy_id, nfy_mult_id, ind_id;
 
@@ -181,6 +184,7 @@ struct notify_chrc {
 	uint16_t properties;
 	unsigned int notify_id;
 	int notify_count;  /* Reference count of registered notify callbacks */
+	struct queue *notify_list;  /* Registered callbacks for value_handle */
 
 	/* Pending calls to register_notify are queued here so that they can be
 	 * processed after a write that modifies the CCC descriptor.
@@ -264,9 +268,87 @@ static void notify_chrc_free(void *data)
 		gatt_db_attribute_unregister(chrc->attr, chrc->notify_id);
 
 	queue_destroy(chrc->reg_notify_queue, notify_data_unref);
+	queue_destroy(chrc->notify_list, NULL);
 	free(chrc);
 }
 
+/*
+ * Returns the position of value_handle in the characteristic index, or where
+ * it would have to be inserted.
+ */
+static unsigned int chrc_index_search(struct bt_gatt_client *client,
+							uint16_t value_handle)
+{
+	unsigned int lo = 0, hi = client->chrc_index_len;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (client->chrc_index[mid]->value_handle < value_handle)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static struct notify_chrc *chrc_index_find(struct bt_gatt_client *client,
+							uint16_t value_handle)
+{
+	unsigned int i = chrc_index_search(client, value_handle);
+
+	if (i < client->chrc_index_len &&
+			client->chrc_index[i]->value_handle == value_handle)
+		return client->chrc_index[i];
+
+	return NULL;
+}
+
+static bool chrc_index_add(struct bt_gatt_client *client,
+						struct notify_chrc *chrc)
+{
+	unsigned int i;
+
+	if (client->chrc_index_len == client->chrc_index_size) {
+		struct notify_chrc **index;
+		unsigned int size;
+
+		size = client->chrc_index_size ? client->chrc_index_size * 2 : 8;
+
+		index = realloc(client->chrc_index, size * sizeof(*index));
+		if (!index)
+			return false;
+
+		client->chrc_index = index;
+		client->chrc_index_size = size;
+	}
+
+	i = chrc_index_search(client, chrc->value_handle);
+
+	memmove(&client->chrc_index[i + 1], &client->chrc_index[i],
+			(client->chrc_index_len - i) *
+			sizeof(*client->chrc_index));
+	client->chrc_index[i] = chrc;
+	client->chrc_index_len++;
+
+	return true;
+}
+
+static void chrc_index_remove(struct bt_gatt_client *client,
+						struct notify_chrc *chrc)
+{
+	unsigned int i = chrc_index_search(client, chrc->value_handle);
+
+	if (i == client->chrc_index_len || client->chrc_index[i] != chrc)
+		return;
+
+	client->chrc_index_len--;
+	memmove(&client->chrc_index[i], &client->chrc_index[i + 1],
+			(client->chrc_index_len - i) *
+			sizeof(*client->chrc_index));
+}
+
 static void chrc_removed(struct gatt_db_attribute *attr, void *user_data)
 {
 	struct notify_chrc *chrc = user_data;
@@ -280,6 +362,7 @@ static void chrc_removed(struct gatt_db_attribute *attr, void *user_data)
 		notify_data_cleanup(data);
 
 	queue_remove(client->notify_chrcs, chrc);
+	chrc_index_remove(client, chrc);
 	notify_chrc_free(chrc);
 }
 
@@ -312,6 +395,8 @@ static struct notify_chrc *notify_chrc_create(struct bt_gatt_client *client,
 		return NULL;
 	}
 
+	chrc->notify_list = queue_new();
+
 	/*
 	 * Find the CCC characteristic. Some characteristics that allow
 	 * notifications may not have a CCC descriptor. We treat these as
@@ -329,6 +414,11 @@ static struct notify_chrc *notify_chrc_create(struct bt_gatt_client *client,
 	chrc->notify_id = gatt_db_attribute_register(attr, chrc_removed, chrc,
 									NULL);
 
+	if (!chrc_index_add(client, chrc)) {
+		notify_chrc_free(chrc);
+		return NULL;
+	}
+
 	queue_push_tail(client->notify_chrcs, chrc);
 
 	return chrc;
@@ -363,6 +453,7 @@ struct discovery_op {
 	struct gatt_db_attribute *cur_svc;
 	struct gatt_db_attribute *hash;
 	uint8_t server_feat;
+	bool cached;
 	bool success;
 	uint16_t start;
 	uint16_t end;
@@ -1352,6 +1443,8 @@ static void discover_all(struct discovery_op *op)
 	discovery_op_unref(op);
 }
 
+static void read_server_feat(struct discovery_op *op);
+
 static void db_hash_write_value_cb(struct gatt_db_attribute *attrib,
 						int err, void *user_data)
 {
@@ -1420,6 +1513,10 @@ static void db_hash_read_cb(bool success, uint8_t att_ecode,
 
 discover:
 	if (!op->success) {
+		/* Server Features were not read when taking the fast path */
+		if (op->cached)
+			read_server_feat(op);
+
 		discover_all(op);
 		return;
 	}
@@ -1455,10 +1552,15 @@ static bool read_db_hash(struct discovery_op *op)
 	if (!op->hash)
 		return false;
 
-	if (!bt_gatt_read_by_type(client->att, 0x0001, 0xffff, &uuid,
-							db_hash_read_cb,
-							discovery_op_ref(op),
-							discovery_op_unref)) {
+	/* Stop the range at the known hash handle so that a single response
+	 * completes the read, if the hash has moved the value won't match or
+	 * it won't be found either way causing a new discovery.
+	 */
+	if (!bt_gatt_read_by_type(client->att, 0x0001,
+					gatt_db_attribute_get_handle(op->hash),
+					&uuid, db_hash_read_cb,
+					discovery_op_ref(op),
+					discovery_op_unref)) {
 		discovery_op_unref(op);
 		return false;
 	}
@@ -1466,6 +1568,25 @@ static bool read_db_hash(struct discovery_op *op)
 	return true;
 }
 
+static bool db_hash_cached(struct bt_gatt_client *client)
+{
+	struct gatt_db_attribute *attr = NULL;
+	const uint8_t *hash = NULL;
+	bt_uuid_t uuid;
+
+	bt_uuid16_create(&uuid, GATT_CHARAC_DB_HASH);
+	gatt_db_find_by_type(client->db, 0x0001, 0xffff, &uuid,
+						get_first_attribute, &attr);
+	if (!attr)
+		return false;
+
+	/* Read stored value in the db */
+	gatt_db_attribute_read(attr, 0, BT_ATT_OP_READ_REQ, NULL,
+					db_hash_read_value_cb, &hash);
+
+	return hash != NULL;
+}
+
 static void db_server_feat_read(bool success, uint8_t att_ecode,
 				struct bt_gatt_result *result, void *user_data)
 {
@@ -1570,6 +1691,27 @@ discover:
 	discover_all(op);
 }
 
+static void cached_mtu_cb(bool success, uint8_t att_ecode, void *user_data)
+{
+	struct bt_gatt_client *client = user_data;
+
+	client->mtu_req_id = 0;
+
+	/* The cache has already been validated, or is being rediscovered, so
+	 * a failure just means the default MTU stays in use.
+	 */
+	if (!success) {
+		util_debug(client->debug_callback, client->debug_data,
+				"MTU Exchange failed. ATT ECODE: 0x%02x",
+				att_ecode);
+		return;
+	}
+
+	util_debug(client->debug_callback, client->debug_data,
+					"MTU exchange complete, with MTU: %u",
+					bt_att_get_mtu(client->att));
+}
+
 struct service_changed_op {
 	struct bt_gatt_client *client;
 	uint16_t start_handle;
@@ -1671,14 +1813,6 @@ static void enable_ccc_callback(uint8_t opcode, const void *pdu,
 	bt_gatt_client_unref(notify_data->client);
 }
 
-static bool match_notify_chrc_value_handle(const void *a, const void *b)
-{
-	const struct notify_chrc *chrc = a;
-	uint16_t value_handle = PTR_TO_UINT(b);
-
-	return chrc->value_handle == value_handle;
-}
-
 static unsigned int register_notify(struct bt_gatt_client *client,
 				uint16_t handle,
 				bt_gatt_client_register_callback_t callback,
@@ -1690,8 +1824,7 @@ static unsigned int register_notify(struct bt_gatt_client *client,
 	struct notify_chrc *chrc = NULL;
 
 	/* Check if a characteristic ref count has been started already */
-	chrc = queue_find(client->notify_chrcs, match_notify_chrc_value_handle,
-						UINT_TO_PTR(handle));
+	chrc = chrc_index_find(client, handle);
 
 	if (!chrc) {
 		/*
@@ -1718,6 +1851,7 @@ static unsigned int register_notify(struct bt_gatt_client *client,
 
 	/* Add the handler to the bt_gatt_client's general list */
 	queue_push_tail(client->notify_list, notify_data);
+	queue_push_tail(chrc->notify_list, notify_data);
 
 	/* Assign an ID to the handler. */
 	if (client->next_reg_id < 1)
@@ -1748,6 +1882,7 @@ static unsigned int register_notify(struct bt_gatt_client *client,
 	/* Write to the CCC descriptor */
 	if (!notify_data_write_ccc(notify_data, true, enable_ccc_callback)) {
 		queue_remove(client->notify_list, notify_data);
+		queue_remove(chrc->notify_list, notify_data);
 		free(notify_data);
 		return 0;
 	}
@@ -2043,6 +2178,42 @@ static bool gatt_client_init(struct bt_gatt_client *client, uint16_t mtu)
 	if (!op)
 		return false;
 
+	/*
+	 * If there is a cached Database Hash read it before anything else: the
+	 * Read By Type response fits in the default MTU and on a match the
+	 * client is ready after a single round trip. The Server Features are
+	 * then taken from the cache and the MTU exchange is queued behind the
+	 * read so it completes in the background.
+	 */
+	if (db_hash_cached(client)) {
+		/* Hold a reference so the op outlives a failed request */
+		discovery_op_ref(op);
+
+		if (!read_db_hash(op)) {
+			discovery_op_free(op);
+			return false;
+		}
+
+		discovery_op_unref(op);
+
+		op->cached = true;
+		op->success = false;
+		client->in_init = true;
+
+		if (bt_att_get_link_type(client->att) == BT_ATT_BREDR)
+			return true;
+
+		mtu = MAX(BT_ATT_DEFAULT_LE_MTU, mtu);
+		if (mtu == BT_ATT_DEFAULT_LE_MTU)
+			return true;
+
+		client->mtu_req_id = bt_gatt_exchange_mtu(client->att, mtu,
+							cached_mtu_cb, client,
+							NULL);
+
+		return true;
+	}
+
 	/*
 	 * BLUETOOTH SPECIFICATION Version 4.2 [Vol 3, Part G] page 546:
 	 *
@@ -2153,9 +2324,6 @@ static void notify_handler(void *data, void *user_data)
 	struct notify_data *notify_data = data;
 	struct value_data *value_data = user_data;
 
-	if (notify_data->chrc->value_handle != value_data->handle)
-		return;
-
 	/*
 	 * Even if the notify data has a pending ATT request to write to the
 	 * CCC, there is really no reason not to notify the handlers.
@@ -2165,6 +2333,18 @@ static void notify_handler(void *data, void *user_data)
 				value_data->len, notify_data->user_data);
 }
 
+static void notify_value(struct bt_gatt_client *client,
+						struct value_data *value_data)
+{
+	struct notify_chrc *chrc;
+
+	chrc = chrc_index_find(client, value_data->handle);
+	if (!chrc)
+		return;
+
+	queue_foreach(chrc->notify_list, notify_handler, value_data);
+}
+
 static void notify_cb(struct bt_att_chan *chan, uint8_t opcode,
 					const void *pdu, uint16_t length,
 					void *user_data)
@@ -2188,8 +2368,7 @@ static void notify_cb(struct bt_att_chan *chan, uint8_t opcode,
 
 			data.data = pdu;
 
-			queue_foreach(client->notify_list, notify_handler,
-								&data);
+			notify_value(client, &data);
 
 			length -= data.len;
 		}
@@ -2201,7 +2380,7 @@ static void notify_cb(struct bt_att_chan *chan, uint8_t opcode,
 		data.len = length;
 		data.data = pdu;
 
-		queue_foreach(client->notify_list, notify_handler, &data);
+		notify_value(client, &data);
 	}
 
 	if (opcode == BT_ATT_OP_HANDLE_IND && !client->parent)
@@ -2217,6 +2396,7 @@ static void bt_gatt_client_free(struct bt_gatt_client *client)
 
 	queue_destroy(client->notify_chrcs, notify_chrc_free);
 	queue_destroy(client->notify_list, notify_data_cleanup);
+	free(client->chrc_index);
 
 	queue_destroy(client->ready_cbs, ready_destroy);
 
@@ -3681,6 +3861,8 @@ bool bt_gatt_client_unregister_notify(struct bt_gatt_client *client,
 	if (!notify_data)
 		return false;
 
+	queue_remove(notify_data->chrc->notify_list, notify_data);
+
 	/* Remove data if it has been queued */
 	queue_remove(notify_data->chrc->reg_notify_queue, notify_data);
 
@@ -45,7 +45,7 @@ struct hfp_gw {
 	struct io *io;
 	struct ringbuf *read_buf;
 	struct ringbuf *write_buf;
-	struct queue *cmd_handlers;
+	struct prefix_node *cmd_handlers;
 	bool writer_active;
 	bool result_pending;
 	hfp_command_func_t command_callback;
@@ -74,7 +74,7 @@ struct hfp_hf {
 	bool writer_active;
 	struct queue *cmd_queue;
 
-	struct queue *event_handlers;
+	struct prefix_node *event_handlers;
 
 	hfp_debug_func_t debug_callback;
 	hfp_destroy_func_t debug_destroy;
@@ -126,17 +126,113 @@ static void destroy_cmd_handler(void *data)
 	free(handler);
 }
 
-static bool match_handler_prefix(const void *a, const void *b)
+/*
+ * Command and result handlers are looked up by their prefix for every line
+ * received, so keep them in a trie with one node per character. Siblings
+ * are chained, which keeps nodes small given the limited fan-out of AT
+ * command names.
+ */
+struct prefix_node {
+	char c;
+	struct prefix_node *child;
+	struct prefix_node *next;
+	void *handler;
+};
+
+static struct prefix_node **prefix_find(struct prefix_node **node, char c)
+{
+	while (*node && (*node)->c != c)
+		node = &(*node)->next;
+
+	return node;
+}
+
+static void *prefix_lookup(struct prefix_node *root, const char *prefix)
+{
+	struct prefix_node *node = NULL;
+
+	for (; *prefix; prefix++) {
+		node = *prefix_find(&root, *prefix);
+		if (!node)
+			return NULL;
+
+		root = node->child;
+	}
+
+	return node ? node->handler : NULL;
+}
+
+static bool prefix_insert(struct prefix_node **root, const char *prefix,
+								void *handler)
 {
-	const struct cmd_handler *handler = a;
-	const char *prefix = b;
+	struct prefix_node **node = NULL;
 
-	if (strcmp(handler->prefix, prefix) != 0)
+	if (!*prefix)
 		return false;
 
+	for (; *prefix; prefix++) {
+		node = prefix_find(root, *prefix);
+		if (!*node) {
+			*node = new0(struct prefix_node, 1);
+			(*node)->c = *prefix;
+		}
+
+		root = &(*node)->child;
+	}
+
+	if ((*node)->handler)
+		return false;
+
+	(*node)->handler = handler;
+
 	return true;
 }
 
+static void *prefix_remove(struct prefix_node **root, const char *prefix)
+{
+	struct prefix_node **node, *tmp;
+	void *handler;
+
+	if (!*prefix)
+		return NULL;
+
+	node = prefix_find(root, *prefix);
+	if (!*node)
+		return NULL;
+
+	if (prefix[1]) {
+		handler = prefix_remove(&(*node)->child, prefix + 1);
+	} else {
+		handler = (*node)->handler;
+		(*node)->handler = NULL;
+	}
+
+	/* Prune nodes that no longer lead to any handler */
+	if (handler && !(*node)->handler && !(*node)->child) {
+		tmp = *node;
+		*node = tmp->next;
+		free(tmp);
+	}
+
+	return handler;
+}
+
+static void prefix_destroy(struct prefix_node *root,
+					void (*destroy)(void *handler))
+{
+	while (root) {
+		struct prefix_node *next = root->next;
+
+		prefix_destroy(root->child, destroy);
+
+		if (root->handler)
+			destroy(root->handler);
+
+		free(root);
+		root = next;
+	}
+}
+
 static void write_watch_destroy(void *user_data)
 {
 	struct hfp_gw *hfp = user_data;
@@ -257,8 +353,7 @@ static bool handle_at_command(struct hfp_gw *hfp, const char *data)
 
 done:
 
-	handler = queue_find(hfp->cmd_handlers, match_handler_prefix,
-								lookup_prefix);
+	handler = prefix_lookup(hfp->cmd_handlers, lookup_prefix);
 	if (!handler) {
 		handle_unknown_at_command(hfp, data);
 		return true;
@@ -600,11 +695,8 @@ struct hfp_gw *hfp_gw_new(int fd)
 		return NULL;
 	}
 
-	hfp->cmd_handlers = queue_new();
-
 	if (!io_set_read_handler(hfp->io, can_read_data, hfp,
 							read_watch_destroy)) {
-		queue_destroy(hfp->cmd_handlers, destroy_cmd_handler);
 		io_destroy(hfp->io);
 		ringbuf_free(hfp->write_buf);
 		ringbuf_free(hfp->read_buf);
@@ -656,7 +748,7 @@ void hfp_gw_unref(struct hfp_gw *hfp)
 	ringbuf_free(hfp->write_buf);
 	hfp->write_buf = NULL;
 
-	queue_destroy(hfp->cmd_handlers, destroy_cmd_handler);
+	prefix_destroy(hfp->cmd_handlers, destroy_cmd_handler);
 	hfp->cmd_handlers = NULL;
 
 	if (!hfp->in_disconnect) {
@@ -790,15 +882,13 @@ bool hfp_gw_send_info(struct hfp_gw *hfp, const char *format, ...)
 	if (!hfp || !format)
 		return false;
 
-	if (asprintf(&fmt, "\r\n%s\r\n", format) < 0)
-		return false;
+	fmt = newa(char, strlen(format) + 5);
+	sprintf(fmt, "\r\n%s\r\n", format);
 
 	va_start(ap, format);
 	len = ringbuf_vprintf(hfp->write_buf, fmt, ap);
 	va_end(ap);
 
-	free(fmt);
-
 	if (len < 0)
 		return false;
 
@@ -844,30 +934,21 @@ bool hfp_gw_register(struct hfp_gw *hfp, hfp_result_func_t callback,
 		return false;
 	}
 
-	if (queue_find(hfp->cmd_handlers, match_handler_prefix,
-							handler->prefix)) {
+	if (!prefix_insert(&hfp->cmd_handlers, handler->prefix, handler)) {
 		destroy_cmd_handler(handler);
 		return false;
 	}
 
 	handler->destroy = destroy;
 
-	return queue_push_tail(hfp->cmd_handlers, handler);
+	return true;
 }
 
 bool hfp_gw_unregister(struct hfp_gw *hfp, const char *prefix)
 {
 	struct cmd_handler *handler;
-	char *lookup_prefix;
-
-	lookup_prefix = strdup(prefix);
-	if (!lookup_prefix)
-		return false;
-
-	handler = queue_remove_if(hfp->cmd_handlers, match_handler_prefix,
-								lookup_prefix);
-	free(lookup_prefix);
 
+	handler = prefix_remove(&hfp->cmd_handlers, prefix);
 	if (!handler)
 		return false;
 
@@ -935,17 +1016,6 @@ bool hfp_gw_disconnect(struct hfp_gw *hfp)
 	return io_shutdown(hfp->io);
 }
 
-static bool match_handler_event_prefix(const void *a, const void *b)
-{
-	const struct event_handler *handler = a;
-	const char *prefix = b;
-
-	if (strcmp(handler->prefix, prefix) != 0)
-		return false;
-
-	return true;
-}
-
 static void destroy_event_handler(void *data)
 {
 	struct event_handler *handler = data;
@@ -1116,8 +1186,7 @@ static void hf_call_prefix_handler(struct hfp_hf *hfp, const char *data)
 		return;
 	}
 
-	handler = queue_find(hfp->event_handlers, match_handler_event_prefix,
-								lookup_prefix);
+	handler = prefix_lookup(hfp->event_handlers, lookup_prefix);
 	if (!handler)
 		return;
 
@@ -1274,14 +1343,12 @@ struct hfp_hf *hfp_hf_new(int fd)
 		return NULL;
 	}
 
-	hfp->event_handlers = queue_new();
 	hfp->cmd_queue = queue_new();
 	hfp->writer_active = false;
 
 	if (!io_set_read_handler(hfp->io, hf_can_read_data, hfp,
 							read_watch_destroy)) {
-		queue_destroy(hfp->event_handlers,
-						destroy_event_handler);
+		queue_destroy(hfp->cmd_queue, NULL);
 		io_destroy(hfp->io);
 		ringbuf_free(hfp->write_buf);
 		ringbuf_free(hfp->read_buf);
@@ -1328,7 +1395,7 @@ void hfp_hf_unref(struct hfp_hf *hfp)
 	ringbuf_free(hfp->write_buf);
 	hfp->write_buf = NULL;
 
-	queue_destroy(hfp->event_handlers, destroy_event_handler);
+	prefix_destroy(hfp->event_handlers, destroy_event_handler);
 	hfp->event_handlers = NULL;
 
 	queue_destroy(hfp->cmd_queue, free);
@@ -1404,8 +1471,8 @@ bool hfp_hf_send_command(struct hfp_hf *hfp, hfp_response_func_t resp_cb,
 	if (!hfp || !format || !resp_cb)
 		return false;
 
-	if (asprintf(&fmt, "%s\r", format) < 0)
-		return false;
+	fmt = newa(char, strlen(format) + 2);
+	sprintf(fmt, "%s\r", format);
 
 	cmd = new0(struct cmd_response, 1);
 
@@ -1413,8 +1480,6 @@ bool hfp_hf_send_command(struct hfp_hf *hfp, hfp_response_func_t resp_cb,
 	len = ringbuf_vprintf(hfp->write_buf, fmt, ap);
 	va_end(ap);
 
-	free(fmt);
-
 	if (len < 0) {
 		free(cmd);
 		return false;
@@ -1454,26 +1519,21 @@ bool hfp_hf_register(struct hfp_hf *hfp, hfp_hf_result_func_t callback,
 		return false;
 	}
 
-	if (queue_find(hfp->event_handlers, match_handler_event_prefix,
-							handler->prefix)) {
+	if (!prefix_insert(&hfp->event_handlers, handler->prefix, handler)) {
 		destroy_event_handler(handler);
 		return false;
 	}
 
 	handler->destroy = destroy;
 
-	return queue_push_tail(hfp->event_handlers, handler);
+	return true;
 }
 
 bool hfp_hf_unregister(struct hfp_hf *hfp, const char *prefix)
 {
-	struct cmd_handler *handler;
-
-	/* Cast to void as queue_remove needs that */
-	handler = queue_remove_if(hfp->event_handlers,
-						match_handler_event_prefix,
-						(void *) prefix);
+	struct event_handler *handler;
 
+	handler = prefix_remove(&hfp->event_handlers, prefix);
 	if (!handler)
 		return false;
 
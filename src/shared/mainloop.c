@@ -32,8 +32,10 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <string.h>
 #include <signal.h>
+#include <time.h>
 #include <sys/signalfd.h>
 #include <sys/timerfd.h>
 #include <sys/epoll.h>
@@ -43,12 +45,18 @@
 #include "mainloop.h"
 #include "mainloop-notify.h"
 
-#define MAX_EPOLL_EVENTS 10
+#define MIN_EPOLL_EVENTS 16
+#define MAX_EPOLL_EVENTS 1024
 
 static int epoll_fd;
 static int epoll_terminate;
 static int exit_status = EXIT_SUCCESS;
 
+static struct epoll_event *epoll_events;
+static int epoll_events_size;
+static int epoll_events_count;
+static int epoll_events_index;
+
 struct mainloop_data {
 	int fd;
 	uint32_t events;
@@ -57,25 +65,89 @@ struct mainloop_data {
 	void *user_data;
 };
 
-#define MAX_MAINLOOP_ENTRIES 128
+#define MIN_MAINLOOP_ENTRIES 128
+
+static struct mainloop_data **mainloop_list;
+static unsigned int mainloop_list_size;
+
+/*
+ * All timeouts share a single timerfd driving a hierarchical timer wheel
+ * with a resolution of one millisecond. Each level has 64 slots and every
+ * level covers 64 times the range of the previous one, which gives a range
+ * of about 12 days before timeouts need to be cascaded more than once.
+ */
+#define TIMER_WHEEL_BITS	6
+#define TIMER_WHEEL_SIZE	(1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS	5
+#define TIMER_WHEEL_RANGE	(1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+#define TIMER_WHEEL_NONE	UINT64_MAX
 
-static struct mainloop_data *mainloop_list[MAX_MAINLOOP_ENTRIES];
+#define MIN_TIMEOUT_ENTRIES 64
 
 struct timeout_data {
-	int fd;
+	int id;
+	bool pending;
+	uint8_t level;
+	uint8_t slot;
+	uint64_t expires;
+	struct timeout_data *next;
+	struct timeout_data **pprev;
 	mainloop_timeout_func callback;
 	mainloop_destroy_func destroy;
 	void *user_data;
 };
 
-void mainloop_init(void)
+struct timer_wheel {
+	int fd;
+	uint64_t base;
+	uint64_t clock;
+	uint64_t armed;
+	unsigned int pending;
+	uint64_t bitmap[TIMER_WHEEL_LEVELS];
+	struct timeout_data *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+};
+
+static struct timer_wheel wheel;
+
+static struct timeout_data **timeout_list;
+static unsigned int timeout_list_size;
+static unsigned int timeout_list_count;
+static unsigned int timeout_list_hint;
+
+static uint64_t get_monotonic_nsec(void)
 {
-	unsigned int i;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void wheel_init(void)
+{
+	memset(&wheel, 0, sizeof(wheel));
+	wheel.fd = -1;
+	wheel.base = get_monotonic_nsec();
+	wheel.armed = TIMER_WHEEL_NONE;
+
+	timeout_list = NULL;
+	timeout_list_size = 0;
+	timeout_list_count = 0;
+	timeout_list_hint = 0;
+}
+
+void mainloop_init(void)
+{
 	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
 
-	for (i = 0; i < MAX_MAINLOOP_ENTRIES; i++)
-		mainloop_list[i] = NULL;
+	mainloop_list = NULL;
+	mainloop_list_size = 0;
+
+	epoll_events_size = MIN_EPOLL_EVENTS;
+	epoll_events = malloc(epoll_events_size * sizeof(*epoll_events));
+
+	wheel_init();
 
 	epoll_terminate = 0;
 
@@ -101,27 +173,60 @@ void mainloop_exit_failure(void)
 	epoll_terminate = 1;
 }
 
+static void grow_epoll_events(void)
+{
+	struct epoll_event *events;
+	int size = epoll_events_size * 2;
+
+	if (size > MAX_EPOLL_EVENTS)
+		return;
+
+	events = realloc(epoll_events, size * sizeof(*events));
+	if (!events)
+		return;
+
+	epoll_events = events;
+	epoll_events_size = size;
+}
+
+static void destroy_timeouts(void);
+
 int mainloop_run(void)
 {
 	unsigned int i;
 
 	while (!epoll_terminate) {
-		struct epoll_event events[MAX_EPOLL_EVENTS];
-		int n, nfds;
+		int nfds;
 
-		nfds = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+		nfds = epoll_wait(epoll_fd, epoll_events, epoll_events_size, -1);
 		if (nfds < 0)
 			continue;
 
-		for (n = 0; n < nfds; n++) {
-			struct mainloop_data *data = events[n].data.ptr;
+		epoll_events_count = nfds;
 
-			data->callback(data->fd, events[n].events,
-							data->user_data);
+		for (epoll_events_index = 0; epoll_events_index < nfds;
+							epoll_events_index++) {
+			struct epoll_event *ev;
+			struct mainloop_data *data;
+
+			ev = &epoll_events[epoll_events_index];
+			data = ev->data.ptr;
+
+			/* Removed by a previous callback of this batch */
+			if (!data)
+				continue;
+
+			data->callback(data->fd, ev->events, data->user_data);
 		}
+
+		epoll_events_count = 0;
+
+		/* Batch was full so more events are likely to be pending */
+		if (nfds == epoll_events_size)
+			grow_epoll_events();
 	}
 
-	for (i = 0; i < MAX_MAINLOOP_ENTRIES; i++) {
+	for (i = 0; i < mainloop_list_size; i++) {
 		struct mainloop_data *data = mainloop_list[i];
 
 		mainloop_list[i] = NULL;
@@ -136,6 +241,16 @@ int mainloop_run(void)
 		}
 	}
 
+	destroy_timeouts();
+
+	free(mainloop_list);
+	mainloop_list = NULL;
+	mainloop_list_size = 0;
+
+	free(epoll_events);
+	epoll_events = NULL;
+	epoll_events_size = 0;
+
 	close(epoll_fd);
 	epoll_fd = 0;
 
@@ -144,6 +259,38 @@ int mainloop_run(void)
 	return exit_status;
 }
 
+static int grow_mainloop_list(int fd)
+{
+	struct mainloop_data **list;
+	unsigned int size = mainloop_list_size;
+
+	if (!size)
+		size = MIN_MAINLOOP_ENTRIES;
+
+	while (size <= (unsigned int) fd)
+		size *= 2;
+
+	list = realloc(mainloop_list, size * sizeof(*list));
+	if (!list)
+		return -ENOMEM;
+
+	memset(list + mainloop_list_size, 0,
+			(size - mainloop_list_size) * sizeof(*list));
+
+	mainloop_list = list;
+	mainloop_list_size = size;
+
+	return 0;
+}
+
+static struct mainloop_data *find_mainloop_data(int fd)
+{
+	if (fd < 0 || (unsigned int) fd >= mainloop_list_size)
+		return NULL;
+
+	return mainloop_list[fd];
+}
+
 int mainloop_add_fd(int fd, uint32_t events, mainloop_event_func callback,
 				void *user_data, mainloop_destroy_func destroy)
 {
@@ -151,9 +298,15 @@ int mainloop_add_fd(int fd, uint32_t events, mainloop_event_func callback,
 	struct epoll_event ev;
 	int err;
 
-	if (fd < 0 || fd > MAX_MAINLOOP_ENTRIES - 1 || !callback)
+	if (fd < 0 || !callback)
 		return -EINVAL;
 
+	if ((unsigned int) fd >= mainloop_list_size) {
+		err = grow_mainloop_list(fd);
+		if (err < 0)
+			return err;
+	}
+
 	data = malloc(sizeof(*data));
 	if (!data)
 		return -ENOMEM;
@@ -186,10 +339,10 @@ int mainloop_modify_fd(int fd, uint32_t events)
 	struct epoll_event ev;
 	int err;
 
-	if (fd < 0 || fd > MAX_MAINLOOP_ENTRIES - 1)
+	if (fd < 0)
 		return -EINVAL;
 
-	data = mainloop_list[fd];
+	data = find_mainloop_data(fd);
 	if (!data)
 		return -ENXIO;
 
@@ -209,17 +362,23 @@ int mainloop_modify_fd(int fd, uint32_t events)
 int mainloop_remove_fd(int fd)
 {
 	struct mainloop_data *data;
-	int err;
+	int i, err;
 
-	if (fd < 0 || fd > MAX_MAINLOOP_ENTRIES - 1)
+	if (fd < 0)
 		return -EINVAL;
 
-	data = mainloop_list[fd];
+	data = find_mainloop_data(fd);
 	if (!data)
 		return -ENXIO;
 
 	mainloop_list[fd] = NULL;
 
+	/* Drop events of the current batch that have not been dispatched */
+	for (i = epoll_events_index + 1; i < epoll_events_count; i++) {
+		if (epoll_events[i].data.ptr == data)
+			epoll_events[i].data.ptr = NULL;
+	}
+
 	err = epoll_ctl(epoll_fd, EPOLL_CTL_DEL, data->fd, NULL);
 
 	if (data->destroy)
@@ -230,48 +389,355 @@ int mainloop_remove_fd(int fd)
 	return err;
 }
 
-static void timeout_destroy(void *user_data)
+static uint64_t wheel_now(bool round_up)
 {
-	struct timeout_data *data = user_data;
+	uint64_t nsec = get_monotonic_nsec() - wheel.base;
 
-	close(data->fd);
-	data->fd = -1;
+	if (round_up)
+		nsec += 999999;
 
-	if (data->destroy)
-		data->destroy(data->user_data);
+	return nsec / 1000000;
+}
 
-	free(data);
+static inline uint64_t rotate_right(uint64_t bits, unsigned int shift)
+{
+	if (!shift)
+		return bits;
+
+	return (bits >> shift) | (bits << (64 - shift));
 }
 
-static void timeout_callback(int fd, uint32_t events, void *user_data)
+static void timeout_link(struct timeout_data **head, struct timeout_data *data)
 {
-	struct timeout_data *data = user_data;
-	uint64_t expired;
-	ssize_t result;
+	data->next = *head;
+	if (data->next)
+		data->next->pprev = &data->next;
 
-	if (events & (EPOLLERR | EPOLLHUP))
+	*head = data;
+	data->pprev = head;
+}
+
+static void timeout_unlink(struct timeout_data *data)
+{
+	struct timeout_data **head;
+
+	if (!data->pprev)
 		return;
 
-	result = read(data->fd, &expired, sizeof(expired));
-	if (result != sizeof(expired))
+	*data->pprev = data->next;
+	if (data->next)
+		data->next->pprev = data->pprev;
+
+	data->next = NULL;
+	data->pprev = NULL;
+
+	if (!data->pending)
+		return;
+
+	data->pending = false;
+	wheel.pending--;
+
+	head = &wheel.slots[data->level][data->slot];
+	if (!*head)
+		wheel.bitmap[data->level] &= ~(1ULL << data->slot);
+}
+
+static void wheel_insert(struct timeout_data *data)
+{
+	uint64_t expires = data->expires;
+	uint64_t delta;
+	unsigned int level = 0;
+
+	if (expires < wheel.clock)
+		expires = wheel.clock;
+
+	delta = expires - wheel.clock;
+
+	/* Cascaded again with the real expiry once the range is reached */
+	if (delta >= TIMER_WHEEL_RANGE) {
+		delta = TIMER_WHEEL_RANGE - 1;
+		expires = wheel.clock + delta;
+	}
+
+	while (delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1))))
+		level++;
+
+	data->level = level;
+	data->slot = (expires >> (TIMER_WHEEL_BITS * level)) &
+							TIMER_WHEEL_MASK;
+
+	timeout_link(&wheel.slots[level][data->slot], data);
+	wheel.bitmap[level] |= 1ULL << data->slot;
+
+	data->pending = true;
+	wheel.pending++;
+}
+
+/* Take a slot out of the wheel keeping its entries linked to head */
+static void wheel_detach_slot(unsigned int level, unsigned int slot,
+						struct timeout_data **head)
+{
+	struct timeout_data *data;
+
+	*head = wheel.slots[level][slot];
+	if (!*head)
 		return;
 
-	if (data->callback)
-		data->callback(data->fd, data->user_data);
+	(*head)->pprev = head;
+
+	wheel.slots[level][slot] = NULL;
+	wheel.bitmap[level] &= ~(1ULL << slot);
+
+	for (data = *head; data; data = data->next) {
+		data->pending = false;
+		wheel.pending--;
+	}
 }
 
-static inline int timeout_set(int fd, unsigned int msec)
+static uint64_t wheel_next_tick(void)
+{
+	uint64_t next = TIMER_WHEEL_NONE;
+	unsigned int level;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		unsigned int shift = TIMER_WHEEL_BITS * level;
+		uint64_t block = wheel.clock >> shift;
+		unsigned int index = block & TIMER_WHEEL_MASK;
+		unsigned int slot, delta;
+		bool aligned;
+		uint64_t tick;
+
+		if (!wheel.bitmap[level])
+			continue;
+
+		/* Slot of the current block is only due if not cascaded yet */
+		aligned = !(wheel.clock & ((1ULL << shift) - 1));
+
+		slot = (index + !aligned) & TIMER_WHEEL_MASK;
+		slot = (slot + __builtin_ctzll(rotate_right(wheel.bitmap[level],
+						slot))) & TIMER_WHEEL_MASK;
+
+		delta = (slot - index) & TIMER_WHEEL_MASK;
+		if (!delta && !aligned)
+			delta = TIMER_WHEEL_SIZE;
+
+		tick = (block + delta) << shift;
+		if (tick < next)
+			next = tick;
+	}
+
+	return next;
+}
+
+static void wheel_arm(uint64_t tick)
 {
 	struct itimerspec itimer;
-	unsigned int sec = msec / 1000;
+	uint64_t nsec;
+
+	if (wheel.fd < 0 || tick == wheel.armed)
+		return;
 
 	memset(&itimer, 0, sizeof(itimer));
-	itimer.it_interval.tv_sec = 0;
-	itimer.it_interval.tv_nsec = 0;
-	itimer.it_value.tv_sec = sec;
-	itimer.it_value.tv_nsec = (msec - (sec * 1000)) * 1000 * 1000;
 
-	return timerfd_settime(fd, 0, &itimer, NULL);
+	if (tick != TIMER_WHEEL_NONE) {
+		nsec = wheel.base + tick * 1000000;
+		itimer.it_value.tv_sec = nsec / 1000000000;
+		itimer.it_value.tv_nsec = nsec % 1000000000;
+
+		/* An absolute value of zero would disarm the timer */
+		if (!nsec)
+			itimer.it_value.tv_nsec = 1;
+	}
+
+	if (timerfd_settime(wheel.fd, TFD_TIMER_ABSTIME, &itimer, NULL) < 0)
+		return;
+
+	wheel.armed = tick;
+}
+
+static void wheel_expire(uint64_t tick)
+{
+	struct timeout_data *expired, *data;
+	unsigned int level;
+
+	wheel.clock = tick;
+
+	for (level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+		unsigned int shift = TIMER_WHEEL_BITS * level;
+		struct timeout_data *cascade;
+
+		if (tick & ((1ULL << shift) - 1))
+			continue;
+
+		wheel_detach_slot(level, (tick >> shift) & TIMER_WHEEL_MASK,
+								&cascade);
+
+		while (cascade) {
+			data = cascade;
+			timeout_unlink(data);
+			wheel_insert(data);
+		}
+	}
+
+	wheel_detach_slot(0, tick & TIMER_WHEEL_MASK, &expired);
+
+	wheel.clock = tick + 1;
+
+	/* Callbacks are free to modify or remove any timeout */
+	while (expired) {
+		data = expired;
+		timeout_unlink(data);
+
+		data->callback(data->id, data->user_data);
+	}
+}
+
+static void wheel_callback(int fd, uint32_t events, void *user_data)
+{
+	uint64_t expired, now, tick;
+
+	if (events & (EPOLLERR | EPOLLHUP))
+		return;
+
+	if (read(wheel.fd, &expired, sizeof(expired)) < 0 && errno != EAGAIN)
+		return;
+
+	wheel.armed = TIMER_WHEEL_NONE;
+
+	now = wheel_now(false);
+
+	while (wheel.pending) {
+		tick = wheel_next_tick();
+		if (tick > now)
+			break;
+
+		wheel_expire(tick);
+	}
+
+	if (!wheel.pending && wheel.clock < now)
+		wheel.clock = now;
+
+	wheel_arm(wheel.pending ? wheel_next_tick() : TIMER_WHEEL_NONE);
+}
+
+static int wheel_setup(void)
+{
+	int fd;
+
+	if (wheel.fd >= 0)
+		return 0;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0)
+		return -EIO;
+
+	if (mainloop_add_fd(fd, EPOLLIN, wheel_callback, NULL, NULL) < 0) {
+		close(fd);
+		return -EIO;
+	}
+
+	wheel.fd = fd;
+
+	return 0;
+}
+
+static void timeout_schedule(struct timeout_data *data, unsigned int msec)
+{
+	uint64_t now = wheel_now(true);
+
+	timeout_unlink(data);
+
+	/* Nothing is pending, so there is nothing to cascade either */
+	if (!wheel.pending && wheel.clock < now)
+		wheel.clock = now;
+
+	data->expires = now + msec;
+	wheel_insert(data);
+
+	if (data->expires < wheel.armed)
+		wheel_arm(wheel_next_tick());
+}
+
+static int timeout_list_add(struct timeout_data *data)
+{
+	unsigned int i;
+
+	/* Keep the table sparse so that free entries are found quickly */
+	if (timeout_list_count * 2 >= timeout_list_size) {
+		struct timeout_data **list;
+		unsigned int size = timeout_list_size * 2;
+
+		if (!size)
+			size = MIN_TIMEOUT_ENTRIES;
+
+		list = realloc(timeout_list, size * sizeof(*list));
+		if (!list)
+			return -ENOMEM;
+
+		memset(list + timeout_list_size, 0,
+				(size - timeout_list_size) * sizeof(*list));
+
+		timeout_list = list;
+		timeout_list_size = size;
+	}
+
+	/* Cycle through the table to avoid quick reuse of identifiers */
+	for (i = timeout_list_hint; timeout_list[i];
+					i = (i + 1) % timeout_list_size);
+
+	timeout_list[i] = data;
+	timeout_list_count++;
+	timeout_list_hint = (i + 1) % timeout_list_size;
+
+	data->id = i + 1;
+
+	return data->id;
+}
+
+static struct timeout_data *timeout_list_remove(int id)
+{
+	struct timeout_data *data;
+
+	if (id <= 0 || (unsigned int) id > timeout_list_size)
+		return NULL;
+
+	data = timeout_list[id - 1];
+	if (!data)
+		return NULL;
+
+	timeout_list[id - 1] = NULL;
+	timeout_list_count--;
+
+	return data;
+}
+
+static void timeout_destroy(struct timeout_data *data)
+{
+	timeout_unlink(data);
+
+	if (data->destroy)
+		data->destroy(data->user_data);
+
+	free(data);
+}
+
+static void destroy_timeouts(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < timeout_list_size; i++) {
+		struct timeout_data *data = timeout_list_remove(i + 1);
+
+		if (data)
+			timeout_destroy(data);
+	}
+
+	free(timeout_list);
+
+	if (wheel.fd >= 0)
+		close(wheel.fd);
+
+	wheel_init();
 }
 
 int mainloop_add_timeout(unsigned int msec, mainloop_timeout_func callback,
@@ -282,6 +748,9 @@ int mainloop_add_timeout(unsigned int msec, mainloop_timeout_func callback,
 	if (!callback)
 		return -EINVAL;
 
+	if (wheel_setup() < 0)
+		return -EIO;
+
 	data = malloc(sizeof(*data));
 	if (!data)
 		return -ENOMEM;
@@ -291,44 +760,46 @@ int mainloop_add_timeout(unsigned int msec, mainloop_timeout_func callback,
 	data->destroy = destroy;
 	data->user_data = user_data;
 
-	data->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
-	if (data->fd < 0) {
+	if (timeout_list_add(data) < 0) {
 		free(data);
-		return -EIO;
-	}
-
-	if (msec > 0) {
-		if (timeout_set(data->fd, msec) < 0) {
-			close(data->fd);
-			free(data);
-			return -EIO;
-		}
+		return -ENOMEM;
 	}
 
-	if (mainloop_add_fd(data->fd, EPOLLIN | EPOLLONESHOT,
-				timeout_callback, data, timeout_destroy) < 0) {
-		close(data->fd);
-		free(data);
-		return -EIO;
-	}
+	if (msec > 0)
+		timeout_schedule(data, msec);
 
-	return data->fd;
+	return data->id;
 }
 
 int mainloop_modify_timeout(int id, unsigned int msec)
 {
-	if (msec > 0) {
-		if (timeout_set(id, msec) < 0)
-			return -EIO;
-	}
+	struct timeout_data *data;
+
+	if (id <= 0 || (unsigned int) id > timeout_list_size)
+		return -EIO;
 
-	if (mainloop_modify_fd(id, EPOLLIN | EPOLLONESHOT) < 0)
+	data = timeout_list[id - 1];
+	if (!data)
 		return -EIO;
 
+	if (msec > 0)
+		timeout_schedule(data, msec);
+
 	return 0;
 }
 
 int mainloop_remove_timeout(int id)
 {
-	return mainloop_remove_fd(id);
+	struct timeout_data *data;
+
+	if (id <= 0)
+		return -EINVAL;
+
+	data = timeout_list_remove(id);
+	if (!data)
+		return -ENXIO;
+
+	timeout_destroy(data);
+
+	return 0;
 }
@@ -28,6 +28,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
+#include <alloca.h>
 #include <sys/uio.h>
 #include <sys/param.h>
 
@@ -221,6 +222,7 @@ int ringbuf_printf(struct ringbuf *ringbuf, const char *format, ...)
 int ringbuf_vprintf(struct ringbuf *ringbuf, const char *format, va_list ap)
 {
 	size_t avail, offset, end;
+	va_list aq;
 	char *str;
 	int len;
 
@@ -232,17 +234,33 @@ int ringbuf_vprintf(struct ringbuf *ringbuf, const char *format, va_list ap)
 	if (!avail)
 		return -1;
 
-	len = vasprintf(&str, format, ap);
-	if (len < 0)
-		return -1;
+	/* Determine possible length of string before wrapping */
+	offset = ringbuf->in & (ringbuf->size - 1);
+	end = MIN(avail, ringbuf->size - offset);
 
-	if ((size_t) len > avail) {
-		free(str);
+	/* Try to format directly into the buffer first */
+	va_copy(aq, ap);
+	len = vsnprintf(ringbuf->buffer + offset, end, format, aq);
+	va_end(aq);
+
+	if (len < 0 || (size_t) len > avail)
 		return -1;
+
+	/* The terminating nul needs to fit as well */
+	if ((size_t) len < end) {
+		if (ringbuf->in_tracing)
+			ringbuf->in_tracing(ringbuf->buffer + offset, len,
+							ringbuf->in_data);
+
+		ringbuf->in += len;
+
+		return len;
 	}
 
-	/* Determine possible length of string before wrapping */
-	offset = ringbuf->in & (ringbuf->size - 1);
+	/* String wraps around, so format it on the stack and split it */
+	str = alloca(len + 1);
+	vsnprintf(str, len + 1, format, ap);
+
 	end = MIN((size_t) len, ringbuf->size - offset);
 	memcpy(ringbuf->buffer + offset, str, end);
 
@@ -259,8 +277,6 @@ int ringbuf_vprintf(struct ringbuf *ringbuf, const char *format, va_list ap)
 							ringbuf->in_data);
 	}
 
-	free(str);
-
 	ringbuf->in += len;
 
 	return len;
@@ -28,6 +28,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <syslog.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -118,6 +119,7 @@ static gboolean option_quiet = FALSE;
 static gboolean option_debug = FALSE;
 static gboolean option_monitor = FALSE;
 static gboolean option_list = FALSE;
+static gboolean option_benchmark = FALSE;
 static const char *option_prefix = NULL;
 
 struct monitor_hdr {
@@ -187,6 +189,12 @@ void tester_print(const char *format, ...)
 	va_end(ap);
 }
 
+void tester_print_rate(const char *what, unsigned int count, uint64_t usec)
+{
+	tester_print("%u %s in %" PRIu64 " us (%.0f/s)", count, what, usec,
+					count * 1000000.0 / (usec ? usec : 1));
+}
+
 void tester_debug(const char *format, ...)
 {
 	va_list ap;
@@ -804,6 +812,11 @@ bool tester_use_debug(void)
 	return option_debug == TRUE ? true : false;
 }
 
+bool tester_use_benchmark(void)
+{
+	return option_benchmark == TRUE ? true : false;
+}
+
 static GOptionEntry options[] = {
 	{ "version", 'v', 0, G_OPTION_ARG_NONE, &option_version,
 				"Show version information and exit" },
@@ -815,6 +828,8 @@ static GOptionEntry options[] = {
 				"Enable monitor output" },
 	{ "list", 'l', 0, G_OPTION_ARG_NONE, &option_list,
 				"Only list the tests to be run" },
+	{ "benchmark", 'b', 0, G_OPTION_ARG_NONE, &option_benchmark,
+				"Run benchmarks and report their rates" },
 	{ "prefix", 'p', 0, G_OPTION_ARG_STRING, &option_prefix,
 				"Run tests matching provided prefix" },
 	{ NULL },
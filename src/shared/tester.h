@@ -30,9 +30,11 @@ int tester_run(void);
 
 bool tester_use_quiet(void);
 bool tester_use_debug(void);
+bool tester_use_benchmark(void);
 
 void tester_print(const char *format, ...)
 				__attribute__((format(printf, 1, 2)));
+void tester_print_rate(const char *what, unsigned int count, uint64_t usec);
 void tester_warn(const char *format, ...)
 				__attribute__((format(printf, 1, 2)));
 void tester_debug(const char *format, ...)
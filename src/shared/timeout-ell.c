@@ -32,10 +32,12 @@ static void timeout_callback(struct l_timeout *timeout, void *user_data)
 {
 	struct timeout_data *data = user_data;
 
-	if (data->func)
-		data->func(data->user_data);
+	if (data->func && data->func(data->user_data)) {
+		l_timeout_modify_ms(timeout, data->timeout);
+		return;
+	}
 
-	l_timeout_modify(timeout, data->timeout);
+	l_timeout_remove(timeout);
 }
 
 static void timeout_destroy(void *user_data)
@@ -61,8 +63,11 @@ unsigned int timeout_add(unsigned int timeout, timeout_func_t func,
 	data->user_data = user_data;
 	data->timeout = timeout;
 
-	id = L_PTR_TO_UINT(l_timeout_create(timeout, timeout_callback,
-						user_data, timeout_destroy));
+	id = L_PTR_TO_UINT(l_timeout_create_ms(timeout, timeout_callback,
+						data, timeout_destroy));
+	if (!id)
+		l_free(data);
+
 	return id;
 }
 
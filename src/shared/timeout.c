@@ -0,0 +1,241 @@
+/*
+ *
+ *  BlueZ - Bluetooth protocol stack for Linux
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "src/shared/util.h"
+#include "src/shared/queue.h"
+#include "src/shared/timeout.h"
+
+/*
+ * Hashed timer wheel with one slot per second. Timeouts longer than a full
+ * turn of the wheel stay in their slot for the remaining number of rounds.
+ * The slot a timeout was first added to is encoded in its identifier so that
+ * removing it, which is the common case for request timeouts, only needs to
+ * look at a single slot.
+ */
+#define WHEEL_BITS	6
+#define WHEEL_SIZE	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SIZE - 1)
+
+#define WHEEL_TICK	1000  /* 1000 ms */
+
+struct wheel_timeout {
+	unsigned int id;
+	unsigned int timeout;
+	unsigned int rounds;
+	bool expired;
+	timeout_func_t func;
+	timeout_destroy_func_t destroy;
+	void *user_data;
+};
+
+static struct queue *wheel_slots[WHEEL_SIZE];
+static unsigned int wheel_current;
+static unsigned int wheel_count;
+static unsigned int wheel_tick_id;
+static unsigned int wheel_next_id = 1;
+
+static uint64_t wheel_tick_time;
+static bool wheel_ticking;
+static struct wheel_timeout *wheel_firing;
+static bool wheel_firing_removed;
+
+static bool wheel_tick(void *user_data);
+
+static uint64_t get_msec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int wheel_insert(struct wheel_timeout *data)
+{
+	unsigned int ticks = data->timeout;
+	unsigned int slot;
+
+	if (!wheel_tick_id) {
+		wheel_tick_id = timeout_add(WHEEL_TICK, wheel_tick, NULL, NULL);
+		if (!wheel_tick_id)
+			return -1;
+
+		wheel_tick_time = get_msec();
+	} else if (!wheel_ticking && get_msec() > wheel_tick_time) {
+		/*
+		 * Round up if part of the current tick is over, so timeouts
+		 * may fire late but never early.
+		 */
+		ticks++;
+	}
+
+	if (!ticks)
+		ticks = 1;
+
+	slot = (wheel_current + ticks) & WHEEL_MASK;
+	data->rounds = (ticks - 1) >> WHEEL_BITS;
+	data->expired = false;
+
+	if (!wheel_slots[slot])
+		wheel_slots[slot] = queue_new();
+
+	queue_push_tail(wheel_slots[slot], data);
+	wheel_count++;
+
+	return slot;
+}
+
+static void wheel_destroy(void *user_data)
+{
+	struct wheel_timeout *data = user_data;
+
+	if (data->destroy)
+		data->destroy(data->user_data);
+
+	free(data);
+}
+
+static void age_timeout(void *data, void *user_data)
+{
+	struct wheel_timeout *timeout = data;
+
+	if (timeout->rounds)
+		timeout->rounds--;
+	else
+		timeout->expired = true;
+}
+
+static bool match_expired(const void *data, const void *match_data)
+{
+	const struct wheel_timeout *timeout = data;
+
+	return timeout->expired;
+}
+
+static bool wheel_tick(void *user_data)
+{
+	struct queue *slot;
+	struct wheel_timeout *data;
+
+	wheel_current++;
+	wheel_ticking = true;
+	wheel_tick_time = get_msec();
+
+	slot = wheel_slots[wheel_current & WHEEL_MASK];
+
+	/* Mark first since callbacks may add timeouts to the same slot */
+	queue_foreach(slot, age_timeout, NULL);
+
+	while ((data = queue_remove_if(slot, match_expired, NULL))) {
+		bool repeat;
+
+		wheel_count--;
+
+		wheel_firing = data;
+		wheel_firing_removed = false;
+
+		repeat = data->func(data->user_data);
+
+		wheel_firing = NULL;
+
+		if (!repeat || wheel_firing_removed || wheel_insert(data) < 0)
+			wheel_destroy(data);
+	}
+
+	wheel_ticking = false;
+
+	if (wheel_count)
+		return true;
+
+	wheel_tick_id = 0;
+
+	return false;
+}
+
+unsigned int timeout_add_seconds(unsigned int timeout, timeout_func_t func,
+			void *user_data, timeout_destroy_func_t destroy)
+{
+	struct wheel_timeout *data;
+	int slot;
+
+	if (!func)
+		return 0;
+
+	data = new0(struct wheel_timeout, 1);
+	data->timeout = timeout;
+	data->func = func;
+	data->destroy = destroy;
+	data->user_data = user_data;
+
+	slot = wheel_insert(data);
+	if (slot < 0) {
+		free(data);
+		return 0;
+	}
+
+	if (!(wheel_next_id << WHEEL_BITS))
+		wheel_next_id = 1;
+
+	data->id = (wheel_next_id++ << WHEEL_BITS) | slot;
+
+	return data->id;
+}
+
+static bool match_id(const void *data, const void *match_data)
+{
+	const struct wheel_timeout *timeout = data;
+
+	return timeout->id == PTR_TO_UINT(match_data);
+}
+
+void timeout_remove_seconds(unsigned int id)
+{
+	struct wheel_timeout *data;
+	unsigned int i;
+
+	if (!id)
+		return;
+
+	if (wheel_firing && wheel_firing->id == id) {
+		wheel_firing_removed = true;
+		return;
+	}
+
+	data = queue_remove_if(wheel_slots[id & WHEEL_MASK], match_id,
+							UINT_TO_PTR(id));
+
+	/* Repeating timeouts move to other slots */
+	for (i = 0; !data && i < WHEEL_SIZE; i++)
+		data = queue_remove_if(wheel_slots[i], match_id,
+							UINT_TO_PTR(id));
+
+	if (!data)
+		return;
+
+	wheel_count--;
+	wheel_destroy(data);
+}
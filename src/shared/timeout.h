@@ -25,3 +25,13 @@ typedef void (*timeout_destroy_func_t)(void *user_data);
 unsigned int timeout_add(unsigned int timeout, timeout_func_t func,
 			void *user_data, timeout_destroy_func_t destroy);
 void timeout_remove(unsigned int id);
+
+/*
+ * Coarse timeouts with a resolution of one second, which never fire early but
+ * may fire up to a second late. All of them share a single timeout of the main
+ * loop backend, which makes them suitable for protocol timeouts that are added
+ * and removed for every request.
+ */
+unsigned int timeout_add_seconds(unsigned int timeout, timeout_func_t func,
+			void *user_data, timeout_destroy_func_t destroy);
+void timeout_remove_seconds(unsigned int id);
@@ -27,6 +27,7 @@
 
 #define _GNU_SOURCE
 #include <stdio.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
@@ -246,3 +247,48 @@ int bt_uhid_send(struct bt_uhid *uhid, const struct uhid_event *ev)
 	/* uHID kernel driver does not handle partial writes */
 	return len != sizeof(*ev) ? -EIO : 0;
 }
+
+/*
+ * Send an input report using UHID_INPUT2.  The kernel accepts events cut
+ * right after the report data, so only the bytes actually used are written
+ * (and initialized) instead of the whole 4 KiB event.  A non-zero number is
+ * prepended to the data as the report ID.
+ */
+int bt_uhid_input(struct bt_uhid *uhid, uint8_t number, const void *data,
+								size_t size)
+{
+	struct uhid_event ev;
+	struct uhid_input2_req *req = &ev.u.input2;
+	size_t hdr = offsetof(struct uhid_event, u.input2.data);
+	ssize_t len;
+	struct iovec iov;
+
+	if (!uhid->io)
+		return -ENOTCONN;
+
+	if (number) {
+		if (size > sizeof(req->data) - 1)
+			size = sizeof(req->data) - 1;
+
+		req->data[0] = number;
+		memcpy(req->data + 1, data, size);
+		size++;
+	} else {
+		if (size > sizeof(req->data))
+			size = sizeof(req->data);
+
+		memcpy(req->data, data, size);
+	}
+
+	ev.type = UHID_INPUT2;
+	req->size = size;
+
+	iov.iov_base = &ev;
+	iov.iov_len = hdr + size;
+
+	len = io_send(uhid->io, &iov, 1);
+	if (len < 0)
+		return len;
+
+	return (size_t) len != iov.iov_len ? -EIO : 0;
+}
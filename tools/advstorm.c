@@ -0,0 +1,807 @@
+/*
+ *
+ *  BlueZ - Bluetooth protocol stack for Linux
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Advertising storm benchmark.
+ *
+ * A virtual LE controller is created through /dev/vhci and handed to the
+ * running bluetoothd, which is asked to power it and start discovery.
+ * While the controller is scanning it reports advertising from a pool of
+ * random static addresses at the requested rate.  A share of the reports
+ * carry new manufacturer data with a sequence number, so the D-Bus signal
+ * bluetoothd emits for them can be matched to measure end-to-end latency.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/uio.h>
+
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include "lib/bluetooth.h"
+#include "lib/hci.h"
+
+#include "gdbus/gdbus.h"
+#include "src/shared/util.h"
+#include "monitor/bt.h"
+#include "emulator/btdev.h"
+
+#define BLUEZ_BUS_NAME		"org.bluez"
+#define ADAPTER_INTERFACE	"org.bluez.Adapter1"
+#define DEVICE_INTERFACE	"org.bluez.Device1"
+
+#define COMPANY_ID		0x05f1
+#define TICK_MS			10
+#define SEQ_RING_SIZE		65536
+#define RETRY_MS		100
+#define MAX_RETRIES		50
+
+struct advertiser {
+	uint8_t addr[6];
+	int8_t rssi;
+	uint32_t seq;
+};
+
+struct seq_entry {
+	uint32_t seq;
+	uint64_t usec;
+};
+
+static GMainLoop *main_loop;
+static DBusConnection *dbus_conn;
+static char *bluez_owner;
+static unsigned int bluez_pid;
+
+static struct btdev *btdev;
+static int vhci_fd = -1;
+static int hci_index = -1;
+static char adapter_path[32];
+static unsigned int retries;
+
+static gint option_rate = 1000;
+static gint option_addresses = 100;
+static gint option_churn = 10;
+static gint option_duration = 10;
+static gboolean option_version = FALSE;
+
+static struct advertiser *advertisers;
+static struct seq_entry *seq_ring;
+static uint32_t last_seq;
+
+static bool storming;
+static uint64_t start_usec;
+static uint64_t stop_usec;
+static uint64_t start_ticks;
+static uint64_t stop_ticks;
+
+static uint64_t reports_sent;
+static uint64_t reports_skipped;
+static uint64_t reports_changed;
+static uint64_t signals;
+
+static uint32_t *latency;
+static size_t latency_count;
+static size_t latency_size;
+
+static uint64_t get_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* User and system time of bluetoothd in clock ticks */
+static uint64_t get_bluez_ticks(void)
+{
+	char path[64], buf[1024];
+	unsigned long utime, stime;
+	char *ptr;
+	ssize_t len;
+	int fd;
+
+	if (!bluez_pid)
+		return 0;
+
+	snprintf(path, sizeof(path), "/proc/%u/stat", bluez_pid);
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+
+	if (len <= 0)
+		return 0;
+
+	buf[len] = '\0';
+
+	/* Skip pid and command name, which may contain spaces */
+	ptr = strrchr(buf, ')');
+	if (!ptr)
+		return 0;
+
+	if (sscanf(ptr + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+					"%lu %lu", &utime, &stime) != 2)
+		return 0;
+
+	return utime + stime;
+}
+
+static void record_latency(uint32_t seq)
+{
+	struct seq_entry *entry = &seq_ring[seq % SEQ_RING_SIZE];
+	uint32_t *samples;
+
+	/* Only the first signal carrying a sequence number counts */
+	if (entry->seq != seq || !entry->usec)
+		return;
+
+	if (latency_count == latency_size) {
+		latency_size = latency_size ? latency_size * 2 : 1024;
+		samples = realloc(latency, latency_size * sizeof(*latency));
+		if (!samples)
+			return;
+
+		latency = samples;
+	}
+
+	latency[latency_count++] = get_usec() - entry->usec;
+	entry->usec = 0;
+}
+
+static void parse_manufacturer_data(DBusMessageIter *iter)
+{
+	DBusMessageIter array;
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY)
+		return;
+
+	dbus_message_iter_recurse(iter, &array);
+
+	while (dbus_message_iter_get_arg_type(&array) ==
+						DBUS_TYPE_DICT_ENTRY) {
+		DBusMessageIter entry, value, bytes;
+		const uint8_t *data;
+		uint16_t id;
+		int len;
+
+		dbus_message_iter_recurse(&array, &entry);
+		dbus_message_iter_get_basic(&entry, &id);
+		dbus_message_iter_next(&entry);
+		dbus_message_iter_recurse(&entry, &value);
+
+		if (id == COMPANY_ID && dbus_message_iter_get_arg_type(&value)
+							== DBUS_TYPE_ARRAY) {
+			dbus_message_iter_recurse(&value, &bytes);
+			dbus_message_iter_get_fixed_array(&bytes, &data, &len);
+
+			if (len >= 4)
+				record_latency(get_le32(data));
+		}
+
+		dbus_message_iter_next(&array);
+	}
+}
+
+static void parse_properties(DBusMessageIter *iter)
+{
+	DBusMessageIter array;
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY)
+		return;
+
+	dbus_message_iter_recurse(iter, &array);
+
+	while (dbus_message_iter_get_arg_type(&array) ==
+						DBUS_TYPE_DICT_ENTRY) {
+		DBusMessageIter entry, value;
+		const char *key;
+
+		dbus_message_iter_recurse(&array, &entry);
+		dbus_message_iter_get_basic(&entry, &key);
+		dbus_message_iter_next(&entry);
+		dbus_message_iter_recurse(&entry, &value);
+
+		if (!strcmp(key, "ManufacturerData"))
+			parse_manufacturer_data(&value);
+
+		dbus_message_iter_next(&array);
+	}
+}
+
+static void parse_interfaces(DBusMessageIter *iter)
+{
+	DBusMessageIter array;
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY)
+		return;
+
+	dbus_message_iter_recurse(iter, &array);
+
+	while (dbus_message_iter_get_arg_type(&array) ==
+						DBUS_TYPE_DICT_ENTRY) {
+		DBusMessageIter entry;
+		const char *interface;
+
+		dbus_message_iter_recurse(&array, &entry);
+		dbus_message_iter_get_basic(&entry, &interface);
+		dbus_message_iter_next(&entry);
+
+		if (!strcmp(interface, DEVICE_INTERFACE))
+			parse_properties(&entry);
+
+		dbus_message_iter_next(&array);
+	}
+}
+
+static DBusHandlerResult signal_filter(DBusConnection *conn,
+					DBusMessage *msg, void *user_data)
+{
+	DBusMessageIter iter;
+	const char *interface;
+
+	if (dbus_message_get_type(msg) != DBUS_MESSAGE_TYPE_SIGNAL)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (!storming || !bluez_owner ||
+			g_strcmp0(dbus_message_get_sender(msg), bluez_owner))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	signals++;
+
+	if (!dbus_message_iter_init(msg, &iter))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (dbus_message_is_signal(msg, DBUS_INTERFACE_PROPERTIES,
+						"PropertiesChanged")) {
+		if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_STRING)
+			return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+		dbus_message_iter_get_basic(&iter, &interface);
+		if (strcmp(interface, DEVICE_INTERFACE))
+			return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+		dbus_message_iter_next(&iter);
+		parse_properties(&iter);
+	} else if (dbus_message_is_signal(msg, DBUS_INTERFACE_OBJECT_MANAGER,
+						"InterfacesAdded")) {
+		dbus_message_iter_next(&iter);
+		parse_interfaces(&iter);
+	}
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+static bool send_adv_report(void)
+{
+	struct advertiser *adv;
+	uint8_t data[13];
+
+	adv = &advertisers[g_random_int_range(0, option_addresses)];
+
+	if (g_random_int_range(0, 100) < option_churn) {
+		struct seq_entry *entry;
+
+		adv->seq = ++last_seq;
+
+		entry = &seq_ring[adv->seq % SEQ_RING_SIZE];
+		entry->seq = adv->seq;
+		entry->usec = get_usec();
+
+		reports_changed++;
+	}
+
+	/* Flags */
+	data[0] = 0x02;
+	data[1] = 0x01;
+	data[2] = 0x06;
+
+	/* Manufacturer Specific Data with the sequence number */
+	data[3] = 0x07;
+	data[4] = 0xff;
+	put_le16(COMPANY_ID, data + 5);
+	put_le32(adv->seq, data + 7);
+
+	return btdev_send_adv_report(btdev, 0x03, 0x01, adv->addr, data, 11,
+								adv->rssi);
+}
+
+static gboolean tick_callback(gpointer user_data)
+{
+	uint64_t target;
+
+	if (!storming)
+		return FALSE;
+
+	target = (get_usec() - start_usec) * option_rate / 1000000;
+
+	while (reports_sent + reports_skipped < target) {
+		if (send_adv_report())
+			reports_sent++;
+		else
+			reports_skipped++;
+	}
+
+	return TRUE;
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+	uint32_t val_a = *(const uint32_t *) a;
+	uint32_t val_b = *(const uint32_t *) b;
+
+	return val_a < val_b ? -1 : val_a > val_b;
+}
+
+static void print_results(void)
+{
+	double secs = (stop_usec - start_usec) / 1000000.0;
+	long hz = sysconf(_SC_CLK_TCK);
+	uint64_t total = 0;
+	size_t i;
+
+	printf("Addresses:      %d\n", option_addresses);
+	printf("Duration:       %.2f s\n", secs);
+	printf("Reports:        %" PRIu64 " (%.0f/s), %" PRIu64
+				" while not scanning\n", reports_sent,
+				reports_sent / secs, reports_skipped);
+	printf("Data changes:   %" PRIu64 ", %zu signalled, %" PRIu64
+				" missed\n", reports_changed, latency_count,
+				reports_changed - latency_count);
+	printf("D-Bus signals:  %" PRIu64 " (%.0f/s)\n", signals,
+							signals / secs);
+
+	if (latency_count) {
+		qsort(latency, latency_count, sizeof(*latency),
+							latency_cmp);
+
+		for (i = 0; i < latency_count; i++)
+			total += latency[i];
+
+		printf("Latency:        avg %" PRIu64 " us, 50%% %u us, "
+				"99%% %u us, max %u us\n",
+				total / latency_count,
+				latency[latency_count / 2],
+				latency[latency_count * 99 / 100],
+				latency[latency_count - 1]);
+	}
+
+	if (bluez_pid && hz > 0)
+		printf("bluetoothd CPU: %.2f s (%.1f%%)\n",
+			(double) (stop_ticks - start_ticks) / hz,
+			(stop_ticks - start_ticks) * 100.0 / hz / secs);
+}
+
+static gboolean stop_callback(gpointer user_data)
+{
+	storming = false;
+	stop_usec = get_usec();
+	stop_ticks = get_bluez_ticks();
+
+	print_results();
+
+	g_main_loop_quit(main_loop);
+
+	return FALSE;
+}
+
+static void send_method_call(DBusMessage *msg,
+					DBusPendingCallNotifyFunction function)
+{
+	DBusPendingCall *call;
+
+	if (!dbus_connection_send_with_reply(dbus_conn, msg, &call, -1)) {
+		dbus_message_unref(msg);
+		return;
+	}
+
+	dbus_pending_call_set_notify(call, function, NULL, NULL);
+	dbus_pending_call_unref(call);
+	dbus_message_unref(msg);
+}
+
+static bool reply_failed(DBusPendingCall *call, const char *what)
+{
+	DBusMessage *reply = dbus_pending_call_steal_reply(call);
+	DBusError err;
+	bool failed = false;
+
+	dbus_error_init(&err);
+
+	if (dbus_set_error_from_message(&err, reply)) {
+		fprintf(stderr, "%s failed: %s\n", what, err.message);
+		dbus_error_free(&err);
+		failed = true;
+	}
+
+	dbus_message_unref(reply);
+
+	return failed;
+}
+
+static void start_discovery_reply(DBusPendingCall *call, void *user_data)
+{
+	if (reply_failed(call, "StartDiscovery")) {
+		g_main_loop_quit(main_loop);
+		return;
+	}
+
+	printf("Discovery started on %s\n", adapter_path);
+
+	storming = true;
+	start_usec = get_usec();
+	start_ticks = get_bluez_ticks();
+
+	g_timeout_add(TICK_MS, tick_callback, NULL);
+	g_timeout_add_seconds(option_duration, stop_callback, NULL);
+}
+
+static void set_filter_reply(DBusPendingCall *call, void *user_data)
+{
+	DBusMessage *msg;
+
+	if (reply_failed(call, "SetDiscoveryFilter")) {
+		g_main_loop_quit(main_loop);
+		return;
+	}
+
+	msg = dbus_message_new_method_call(BLUEZ_BUS_NAME, adapter_path,
+					ADAPTER_INTERFACE, "StartDiscovery");
+
+	send_method_call(msg, start_discovery_reply);
+}
+
+static void append_dict_entry(DBusMessageIter *dict, const char *key,
+						int type, const void *value)
+{
+	DBusMessageIter entry, variant;
+	char sig[2] = { type, '\0' };
+
+	dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, NULL,
+								&entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, sig,
+								&variant);
+	dbus_message_iter_append_basic(&variant, type, value);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(dict, &entry);
+}
+
+static gboolean setup_adapter(gpointer user_data);
+
+static void set_powered_reply(DBusPendingCall *call, void *user_data)
+{
+	DBusMessageIter iter, dict;
+	DBusMessage *reply, *msg;
+	const char *transport = "le";
+	dbus_bool_t duplicate = TRUE;
+
+	reply = dbus_pending_call_steal_reply(call);
+
+	/* The adapter may not be registered by bluetoothd yet */
+	if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR) {
+		dbus_message_unref(reply);
+
+		if (++retries > MAX_RETRIES) {
+			fprintf(stderr, "Failed to power %s\n", adapter_path);
+			g_main_loop_quit(main_loop);
+			return;
+		}
+
+		g_timeout_add(RETRY_MS, setup_adapter, NULL);
+		return;
+	}
+
+	dbus_message_unref(reply);
+
+	msg = dbus_message_new_method_call(BLUEZ_BUS_NAME, adapter_path,
+				ADAPTER_INTERFACE, "SetDiscoveryFilter");
+
+	dbus_message_iter_init_append(msg, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					&dict);
+	append_dict_entry(&dict, "Transport", DBUS_TYPE_STRING, &transport);
+	append_dict_entry(&dict, "DuplicateData", DBUS_TYPE_BOOLEAN,
+								&duplicate);
+	dbus_message_iter_close_container(&iter, &dict);
+
+	send_method_call(msg, set_filter_reply);
+}
+
+static gboolean setup_adapter(gpointer user_data)
+{
+	DBusMessageIter iter, variant;
+	DBusMessage *msg;
+	const char *interface = ADAPTER_INTERFACE;
+	const char *name = "Powered";
+	dbus_bool_t powered = TRUE;
+
+	msg = dbus_message_new_method_call(BLUEZ_BUS_NAME, adapter_path,
+					DBUS_INTERFACE_PROPERTIES, "Set");
+
+	dbus_message_iter_init_append(msg, &iter);
+	dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &interface);
+	dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &name);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_VARIANT,
+					DBUS_TYPE_BOOLEAN_AS_STRING, &variant);
+	dbus_message_iter_append_basic(&variant, DBUS_TYPE_BOOLEAN, &powered);
+	dbus_message_iter_close_container(&iter, &variant);
+
+	send_method_call(msg, set_powered_reply);
+
+	return FALSE;
+}
+
+static void vhci_write_callback(const struct iovec *iov, int iovlen,
+							void *user_data)
+{
+	ssize_t written;
+
+	written = writev(vhci_fd, iov, iovlen);
+	if (written < 0)
+		return;
+}
+
+static gboolean vhci_read_callback(GIOChannel *channel, GIOCondition cond,
+							gpointer user_data)
+{
+	unsigned char buf[4096];
+	ssize_t len;
+
+	if (cond & (G_IO_NVAL | G_IO_ERR | G_IO_HUP))
+		return FALSE;
+
+	len = read(vhci_fd, buf, sizeof(buf));
+	if (len < 1)
+		return TRUE;
+
+	switch (buf[0]) {
+	case HCI_VENDOR_PKT:
+		/* Response to the device creation request */
+		if (len < 4 || hci_index >= 0)
+			break;
+
+		hci_index = get_le16(buf + 2);
+		snprintf(adapter_path, sizeof(adapter_path),
+					"/org/bluez/hci%d", hci_index);
+
+		printf("Created hci%d\n", hci_index);
+		setup_adapter(NULL);
+		break;
+	case BT_H4_CMD_PKT:
+	case BT_H4_ACL_PKT:
+	case BT_H4_SCO_PKT:
+	case BT_H4_ISO_PKT:
+		btdev_receive_h4(btdev, buf, len);
+		break;
+	}
+
+	return TRUE;
+}
+
+static bool setup_vhci(void)
+{
+	uint8_t create_req[2] = { HCI_VENDOR_PKT, HCI_PRIMARY };
+	GIOChannel *channel;
+
+	btdev = btdev_create(BTDEV_TYPE_LE, 0x42);
+	if (!btdev)
+		return false;
+
+	btdev_set_send_handler(btdev, vhci_write_callback, NULL);
+
+	vhci_fd = open("/dev/vhci", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (vhci_fd < 0) {
+		perror("Failed to open /dev/vhci");
+		return false;
+	}
+
+	if (write(vhci_fd, create_req, sizeof(create_req)) < 0) {
+		perror("Failed to create virtual controller");
+		return false;
+	}
+
+	channel = g_io_channel_unix_new(vhci_fd);
+	g_io_channel_set_encoding(channel, NULL, NULL);
+	g_io_channel_set_buffered(channel, FALSE);
+	g_io_add_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR | G_IO_NVAL,
+						vhci_read_callback, NULL);
+	g_io_channel_unref(channel);
+
+	return true;
+}
+
+static bool setup_dbus(void)
+{
+	DBusMessage *msg, *reply;
+	const char *name = BLUEZ_BUS_NAME;
+	const char *owner;
+	DBusError err;
+
+	dbus_error_init(&err);
+
+	dbus_conn = g_dbus_setup_bus(DBUS_BUS_SYSTEM, NULL, &err);
+	if (!dbus_conn) {
+		fprintf(stderr, "Failed to connect to D-Bus: %s\n",
+							err.message);
+		dbus_error_free(&err);
+		return false;
+	}
+
+	msg = dbus_message_new_method_call(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+					DBUS_INTERFACE_DBUS, "GetNameOwner");
+	dbus_message_append_args(msg, DBUS_TYPE_STRING, &name,
+							DBUS_TYPE_INVALID);
+
+	reply = dbus_connection_send_with_reply_and_block(dbus_conn, msg, -1,
+									&err);
+	dbus_message_unref(msg);
+
+	if (!reply) {
+		fprintf(stderr, "bluetoothd is not running: %s\n",
+							err.message);
+		dbus_error_free(&err);
+		return false;
+	}
+
+	if (dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &owner,
+							DBUS_TYPE_INVALID))
+		bluez_owner = g_strdup(owner);
+
+	dbus_message_unref(reply);
+
+	msg = dbus_message_new_method_call(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+				DBUS_INTERFACE_DBUS,
+				"GetConnectionUnixProcessID");
+	dbus_message_append_args(msg, DBUS_TYPE_STRING, &name,
+							DBUS_TYPE_INVALID);
+
+	reply = dbus_connection_send_with_reply_and_block(dbus_conn, msg, -1,
+									NULL);
+	dbus_message_unref(msg);
+
+	if (reply) {
+		dbus_message_get_args(reply, NULL, DBUS_TYPE_UINT32,
+						&bluez_pid, DBUS_TYPE_INVALID);
+		dbus_message_unref(reply);
+	}
+
+	dbus_connection_add_filter(dbus_conn, signal_filter, NULL, NULL);
+	dbus_bus_add_match(dbus_conn, "type='signal',sender='"
+						BLUEZ_BUS_NAME "'", NULL);
+
+	return true;
+}
+
+static void setup_advertisers(void)
+{
+	int i;
+
+	advertisers = g_new0(struct advertiser, option_addresses);
+	seq_ring = g_new0(struct seq_entry, SEQ_RING_SIZE);
+
+	for (i = 0; i < option_addresses; i++) {
+		struct advertiser *adv = &advertisers[i];
+
+		/* Random static address */
+		put_le32(g_random_int(), adv->addr);
+		put_le16(i, adv->addr + 4);
+		adv->addr[5] |= 0xc0;
+
+		adv->rssi = -40 - (i % 50);
+	}
+}
+
+static GOptionEntry options[] = {
+	{ "rate", 'r', 0, G_OPTION_ARG_INT, &option_rate,
+				"Advertising reports per second", "NUM" },
+	{ "addresses", 'a', 0, G_OPTION_ARG_INT, &option_addresses,
+				"Number of advertising addresses", "NUM" },
+	{ "churn", 'c', 0, G_OPTION_ARG_INT, &option_churn,
+				"Percentage of reports with new data", "PCT" },
+	{ "duration", 'd', 0, G_OPTION_ARG_INT, &option_duration,
+				"Duration of the benchmark in seconds", "SEC" },
+	{ "version", 'v', 0, G_OPTION_ARG_NONE, &option_version,
+				"Show version information and exit" },
+	{ NULL },
+};
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	int exit_status = EXIT_FAILURE;
+
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, options, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error)) {
+		if (error) {
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		} else
+			g_printerr("An unknown error occurred\n");
+		exit(1);
+	}
+
+	g_option_context_free(context);
+
+	if (option_version) {
+		printf("%s\n", VERSION);
+		exit(0);
+	}
+
+	if (option_rate < 1 || option_addresses < 1 ||
+			option_addresses > 0xffff || option_churn < 0 ||
+			option_churn > 100 || option_duration < 1) {
+		fprintf(stderr, "Invalid benchmark parameters\n");
+		exit(1);
+	}
+
+	main_loop = g_main_loop_new(NULL, FALSE);
+
+	setup_advertisers();
+
+	if (!setup_dbus() || !setup_vhci())
+		goto done;
+
+	g_main_loop_run(main_loop);
+
+	exit_status = EXIT_SUCCESS;
+
+done:
+	if (vhci_fd >= 0)
+		close(vhci_fd);
+
+	btdev_destroy(btdev);
+
+	if (dbus_conn)
+		dbus_connection_unref(dbus_conn);
+
+	g_main_loop_unref(main_loop);
+
+	g_free(bluez_owner);
+	g_free(advertisers);
+	g_free(seq_ring);
+	free(latency);
+
+	return exit_status;
+}
@@ -0,0 +1,1676 @@
+/*
+ *
+ *  BlueZ - Bluetooth protocol stack for Linux
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include "lib/bluetooth.h"
+#include "lib/hci.h"
+#include "lib/hci_lib.h"
+#include "lib/l2cap.h"
+#include "lib/uuid.h"
+
+#include "src/shared/mainloop.h"
+#include "src/shared/util.h"
+#include "src/shared/att.h"
+#include "src/shared/queue.h"
+#include "src/shared/gatt-db.h"
+#include "src/shared/gatt-server.h"
+#include "src/shared/gatt-client.h"
+
+#define ATT_CID 4
+
+#define BENCH_SERVICE_UUID	"a6c60000-3b6e-4c4f-9b0e-5d6c2e1f0a01"
+#define BENCH_CONTROL_UUID	"a6c60001-3b6e-4c4f-9b0e-5d6c2e1f0a01"
+#define BENCH_DATA_UUID		"a6c60002-3b6e-4c4f-9b0e-5d6c2e1f0a01"
+#define BENCH_MULTI_UUID	"a6c60003-3b6e-4c4f-9b0e-5d6c2e1f0a01"
+
+#define BENCH_MULTI_COUNT	4
+#define BENCH_MAX_VALUE		512
+
+/*
+ * Control point commands written by the client.  Setup carries the
+ * payload size and optionally the size of the data value, read by
+ * read-long, which otherwise follows the payload size.
+ */
+#define BENCH_CMD_SETUP		0x00
+#define BENCH_CMD_NOTIFY	0x01
+#define BENCH_CMD_RESET		0x02
+
+/*
+ * Data PDUs carry a sequence number and the send time in microseconds.
+ * The send time is only compared with the receiver's clock in local mode,
+ * where both ends share it; otherwise notifications and commands report
+ * no latency, while requests report their round-trip time.
+ */
+#define BENCH_HDR_SIZE		12
+#define LATENCY_NONE		UINT64_MAX
+
+#define DEFAULT_DURATION	5
+#define DEFAULT_PAYLOAD		244
+#define DEFAULT_WINDOW		32
+
+static bool verbose = false;
+static bool one_way_latency = false;
+
+enum bench_mode {
+	MODE_NOTIFY,
+	MODE_WRITE_CMD,
+	MODE_WRITE,
+	MODE_READ_LONG,
+	MODE_READ_MULTIPLE,
+	MODE_COUNT
+};
+
+static const char *mode_names[MODE_COUNT] = {
+	"notify", "write-without-response", "write", "read-long",
+	"read-multiple"
+};
+
+struct stats {
+	uint64_t start;
+	uint64_t end;
+	unsigned int ops;
+	uint64_t bytes;
+	uint32_t *latency;
+	unsigned int latency_len;
+	unsigned int latency_size;
+};
+
+struct server {
+	struct bt_att *att;
+	struct gatt_db *db;
+	struct bt_gatt_server *gatt;
+
+	uint16_t control_handle;
+	uint16_t data_handle;
+	bool control_notify;
+	bool data_notify;
+
+	uint16_t data_size;
+	uint16_t multi_size;
+	uint8_t value[BENCH_MAX_VALUE];
+
+	struct stats rx;
+
+	/* Notification run requested through the control point */
+	uint16_t notify_size;
+	uint64_t notify_deadline;
+	unsigned int notify_window;
+	unsigned int notify_pending;
+	unsigned int notify_sent;
+	bool notify_done;
+};
+
+struct client {
+	struct bt_att *att;
+	struct gatt_db *db;
+	struct bt_gatt_client *gatt;
+
+	uint16_t mtu;
+	unsigned int channels;
+	uint16_t payload;
+	uint16_t read_size;
+	unsigned int duration;
+	unsigned int window;
+	bool modes[MODE_COUNT];
+	const char *transport;
+
+	uint16_t control_handle;
+	uint16_t data_handle;
+	uint16_t multi_handles[BENCH_MULTI_COUNT];
+	unsigned int registered;
+
+	enum bench_mode mode;
+	uint64_t deadline;
+	unsigned int outstanding;
+	uint32_t seq;
+	struct stats stats;
+	unsigned int sent;
+	bool started;
+	bool first_result;
+	int status;
+};
+
+static void bench_log(const char *format, ...)
+	__attribute__((format(printf, 1, 2)));
+
+static void bench_log(const char *format, ...)
+{
+	va_list ap;
+
+	if (!verbose)
+		return;
+
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+}
+
+static uint64_t get_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void stats_reset(struct stats *stats)
+{
+	free(stats->latency);
+	memset(stats, 0, sizeof(*stats));
+}
+
+static void stats_add(struct stats *stats, size_t bytes, uint64_t latency)
+{
+	uint64_t now = get_usec();
+
+	if (!stats->start)
+		stats->start = now;
+
+	stats->end = now;
+	stats->ops++;
+	stats->bytes += bytes;
+
+	if (latency == LATENCY_NONE)
+		return;
+
+	if (stats->latency_len == stats->latency_size) {
+		unsigned int size = stats->latency_size ?
+					stats->latency_size * 2 : 1024;
+		uint32_t *latency;
+
+		latency = realloc(stats->latency, size * sizeof(*latency));
+		if (!latency)
+			return;
+
+		stats->latency = latency;
+		stats->latency_size = size;
+	}
+
+	stats->latency[stats->latency_len++] = latency > UINT32_MAX ?
+						UINT32_MAX : latency;
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+	uint32_t la = *(const uint32_t *) a;
+	uint32_t lb = *(const uint32_t *) b;
+
+	return la < lb ? -1 : la > lb;
+}
+
+static uint32_t stats_percentile(const struct stats *stats, unsigned int pct)
+{
+	unsigned int i;
+
+	if (!stats->latency_len)
+		return 0;
+
+	i = (stats->latency_len - 1) * pct / 100;
+
+	return stats->latency[i];
+}
+
+static void stats_sort(struct stats *stats)
+{
+	qsort(stats->latency, stats->latency_len, sizeof(uint32_t),
+								latency_cmp);
+}
+
+static void put_header(uint8_t *pdu, uint16_t len, uint32_t seq)
+{
+	if (len < BENCH_HDR_SIZE)
+		return;
+
+	put_le32(seq, pdu);
+	put_le64(get_usec(), pdu + 4);
+}
+
+static uint64_t get_latency(const uint8_t *pdu, uint16_t len)
+{
+	uint64_t sent, now = get_usec();
+
+	if (!one_way_latency || len < BENCH_HDR_SIZE)
+		return LATENCY_NONE;
+
+	sent = get_le64(pdu + 4);
+
+	return now > sent ? now - sent : 0;
+}
+
+static void att_disconnect_cb(int err, void *user_data)
+{
+	bench_log("Device disconnected: %s\n", strerror(err));
+
+	mainloop_quit();
+}
+
+/* Server side */
+
+static void server_notify_next(struct server *server);
+
+static void notify_sent(void *user_data)
+{
+	struct server *server = user_data;
+
+	server->notify_pending--;
+	server_notify_next(server);
+}
+
+static void server_notify_done(struct server *server)
+{
+	uint8_t pdu[2 + 4];
+
+	server->notify_done = true;
+
+	if (!server->control_notify)
+		return;
+
+	/* Tell the client how many notifications were sent in total */
+	put_le16(server->control_handle, pdu);
+	put_le32(server->notify_sent, pdu + 2);
+
+	bt_att_send(server->att, BT_ATT_OP_HANDLE_NFY, pdu, sizeof(pdu),
+							NULL, NULL, NULL);
+}
+
+static void server_notify_next(struct server *server)
+{
+	uint8_t pdu[2 + BENCH_MAX_VALUE];
+
+	if (server->notify_done)
+		return;
+
+	while (server->notify_pending < server->notify_window) {
+		if (!server->data_notify ||
+				get_usec() >= server->notify_deadline) {
+			if (!server->notify_pending)
+				server_notify_done(server);
+			return;
+		}
+
+		put_le16(server->data_handle, pdu);
+		memcpy(pdu + 2, server->value, server->notify_size);
+		put_header(pdu + 2, server->notify_size, server->notify_sent);
+
+		/* Written PDUs are destroyed, which paces the next ones */
+		if (!bt_att_send(server->att, BT_ATT_OP_HANDLE_NFY, pdu,
+					2 + server->notify_size, NULL, server,
+					notify_sent)) {
+			server->notify_deadline = 0;
+			continue;
+		}
+
+		server->notify_pending++;
+		server->notify_sent++;
+	}
+}
+
+static void control_read_cb(struct gatt_db_attribute *attrib,
+					unsigned int id, uint16_t offset,
+					uint8_t opcode, struct bt_att *att,
+					void *user_data)
+{
+	struct server *server = user_data;
+	struct stats *rx = &server->rx;
+	uint8_t value[4 + 8 + 4 * 5];
+
+	stats_sort(rx);
+
+	put_le32(rx->ops, value);
+	put_le64(rx->bytes, value + 4);
+	put_le32(rx->end - rx->start, value + 12);
+	put_le32(stats_percentile(rx, 50), value + 16);
+	put_le32(stats_percentile(rx, 90), value + 20);
+	put_le32(stats_percentile(rx, 99), value + 24);
+	put_le32(stats_percentile(rx, 100), value + 28);
+
+	if (offset > sizeof(value)) {
+		gatt_db_attribute_read_result(attrib, id,
+					BT_ATT_ERROR_INVALID_OFFSET, NULL, 0);
+		return;
+	}
+
+	gatt_db_attribute_read_result(attrib, id, 0, value + offset,
+						sizeof(value) - offset);
+}
+
+static void control_write_cb(struct gatt_db_attribute *attrib,
+					unsigned int id, uint16_t offset,
+					const uint8_t *value, size_t len,
+					uint8_t opcode, struct bt_att *att,
+					void *user_data)
+{
+	struct server *server = user_data;
+	uint8_t ecode = 0;
+	uint16_t size;
+
+	if (offset || !len) {
+		ecode = BT_ATT_ERROR_INVALID_ATTRIBUTE_VALUE_LEN;
+		goto done;
+	}
+
+	switch (value[0]) {
+	case BENCH_CMD_SETUP:
+		if (len < 3) {
+			ecode = BT_ATT_ERROR_INVALID_ATTRIBUTE_VALUE_LEN;
+			break;
+		}
+
+		size = get_le16(value + 1);
+		if (size > BENCH_MAX_VALUE)
+			size = BENCH_MAX_VALUE;
+
+		server->multi_size = size / BENCH_MULTI_COUNT ? : 1;
+
+		if (len >= 5) {
+			size = get_le16(value + 3);
+			if (size > BENCH_MAX_VALUE)
+				size = BENCH_MAX_VALUE;
+		}
+
+		server->data_size = size;
+		bench_log("Value size set to %u\n", size);
+		break;
+	case BENCH_CMD_NOTIFY:
+		if (len < 8) {
+			ecode = BT_ATT_ERROR_INVALID_ATTRIBUTE_VALUE_LEN;
+			break;
+		}
+
+		size = get_le16(value + 1);
+		if (size > bt_att_get_mtu(server->att) - 3)
+			size = bt_att_get_mtu(server->att) - 3;
+
+		server->notify_size = size;
+		server->notify_deadline = get_usec() +
+					get_le32(value + 3) * 1000ULL;
+		server->notify_window = value[7] ? : 1;
+		server->notify_sent = 0;
+		server->notify_done = false;
+
+		bench_log("Sending %u byte notifications for %u ms\n", size,
+							get_le32(value + 3));
+		break;
+	case BENCH_CMD_RESET:
+		stats_reset(&server->rx);
+		break;
+	default:
+		ecode = BT_ATT_ERROR_REQUEST_NOT_SUPPORTED;
+		break;
+	}
+
+done:
+	gatt_db_attribute_write_result(attrib, id, ecode);
+
+	/* Start sending once the write response is on its way */
+	if (!ecode && value[0] == BENCH_CMD_NOTIFY)
+		server_notify_next(server);
+}
+
+static void data_read_cb(struct gatt_db_attribute *attrib,
+					unsigned int id, uint16_t offset,
+					uint8_t opcode, struct bt_att *att,
+					void *user_data)
+{
+	struct server *server = user_data;
+
+	if (offset > server->data_size) {
+		gatt_db_attribute_read_result(attrib, id,
+					BT_ATT_ERROR_INVALID_OFFSET, NULL, 0);
+		return;
+	}
+
+	gatt_db_attribute_read_result(attrib, id, 0, server->value + offset,
+						server->data_size - offset);
+}
+
+static void data_write_cb(struct gatt_db_attribute *attrib,
+					unsigned int id, uint16_t offset,
+					const uint8_t *value, size_t len,
+					uint8_t opcode, struct bt_att *att,
+					void *user_data)
+{
+	struct server *server = user_data;
+
+	stats_add(&server->rx, len, get_latency(value, len));
+
+	gatt_db_attribute_write_result(attrib, id, 0);
+}
+
+static void multi_read_cb(struct gatt_db_attribute *attrib,
+					unsigned int id, uint16_t offset,
+					uint8_t opcode, struct bt_att *att,
+					void *user_data)
+{
+	struct server *server = user_data;
+
+	if (offset > server->multi_size) {
+		gatt_db_attribute_read_result(attrib, id,
+					BT_ATT_ERROR_INVALID_OFFSET, NULL, 0);
+		return;
+	}
+
+	gatt_db_attribute_read_result(attrib, id, 0, server->value + offset,
+						server->multi_size - offset);
+}
+
+static void ccc_read_cb(struct gatt_db_attribute *attrib, unsigned int id,
+					uint16_t offset, uint8_t opcode,
+					struct bt_att *att, void *user_data)
+{
+	bool *enabled = user_data;
+	uint8_t value[2];
+
+	put_le16(*enabled ? 0x0001 : 0x0000, value);
+
+	gatt_db_attribute_read_result(attrib, id, 0, value, sizeof(value));
+}
+
+static void ccc_write_cb(struct gatt_db_attribute *attrib,
+					unsigned int id, uint16_t offset,
+					const uint8_t *value, size_t len,
+					uint8_t opcode, struct bt_att *att,
+					void *user_data)
+{
+	bool *enabled = user_data;
+	uint8_t ecode = 0;
+
+	if (offset || len != 2)
+		ecode = BT_ATT_ERROR_INVALID_ATTRIBUTE_VALUE_LEN;
+	else
+		*enabled = get_le16(value) & 0x0001;
+
+	gatt_db_attribute_write_result(attrib, id, ecode);
+}
+
+static void populate_bench_service(struct server *server)
+{
+	struct gatt_db_attribute *service, *attr;
+	bt_uuid_t uuid;
+	int i;
+
+	bt_string_to_uuid(&uuid, BENCH_SERVICE_UUID);
+	service = gatt_db_add_service(server->db, &uuid, true,
+					1 + 3 + 3 + 2 * BENCH_MULTI_COUNT);
+
+	bt_string_to_uuid(&uuid, BENCH_CONTROL_UUID);
+	attr = gatt_db_service_add_characteristic(service, &uuid,
+					BT_ATT_PERM_READ | BT_ATT_PERM_WRITE,
+					BT_GATT_CHRC_PROP_READ |
+					BT_GATT_CHRC_PROP_WRITE |
+					BT_GATT_CHRC_PROP_NOTIFY,
+					control_read_cb, control_write_cb,
+					server);
+	server->control_handle = gatt_db_attribute_get_handle(attr);
+
+	bt_uuid16_create(&uuid, GATT_CLIENT_CHARAC_CFG_UUID);
+	gatt_db_service_add_descriptor(service, &uuid,
+					BT_ATT_PERM_READ | BT_ATT_PERM_WRITE,
+					ccc_read_cb, ccc_write_cb,
+					&server->control_notify);
+
+	bt_string_to_uuid(&uuid, BENCH_DATA_UUID);
+	attr = gatt_db_service_add_characteristic(service, &uuid,
+					BT_ATT_PERM_READ | BT_ATT_PERM_WRITE,
+					BT_GATT_CHRC_PROP_READ |
+					BT_GATT_CHRC_PROP_WRITE |
+					BT_GATT_CHRC_PROP_WRITE_WITHOUT_RESP |
+					BT_GATT_CHRC_PROP_NOTIFY,
+					data_read_cb, data_write_cb, server);
+	server->data_handle = gatt_db_attribute_get_handle(attr);
+
+	bt_uuid16_create(&uuid, GATT_CLIENT_CHARAC_CFG_UUID);
+	gatt_db_service_add_descriptor(service, &uuid,
+					BT_ATT_PERM_READ | BT_ATT_PERM_WRITE,
+					ccc_read_cb, ccc_write_cb,
+					&server->data_notify);
+
+	bt_string_to_uuid(&uuid, BENCH_MULTI_UUID);
+	for (i = 0; i < BENCH_MULTI_COUNT; i++)
+		gatt_db_service_add_characteristic(service, &uuid,
+						BT_ATT_PERM_READ,
+						BT_GATT_CHRC_PROP_READ,
+						multi_read_cb, NULL, server);
+
+	gatt_db_service_set_active(service, true);
+}
+
+static struct server *server_create(int fd, uint16_t mtu)
+{
+	struct server *server;
+	int i;
+
+	server = new0(struct server, 1);
+
+	server->att = bt_att_new(fd, false);
+	if (!server->att) {
+		fprintf(stderr, "Failed to initialize ATT transport layer\n");
+		goto fail;
+	}
+
+	if (!bt_att_set_close_on_unref(server->att, true)) {
+		fprintf(stderr, "Failed to set up ATT transport layer\n");
+		goto fail;
+	}
+
+	server->db = gatt_db_new();
+	if (!server->db) {
+		fprintf(stderr, "Failed to create GATT database\n");
+		goto fail;
+	}
+
+	server->gatt = bt_gatt_server_new(server->db, server->att, mtu, 0);
+	if (!server->gatt) {
+		fprintf(stderr, "Failed to create GATT server\n");
+		goto fail;
+	}
+
+	for (i = 0; i < BENCH_MAX_VALUE; i++)
+		server->value[i] = i;
+
+	server->data_size = DEFAULT_PAYLOAD;
+	server->multi_size = DEFAULT_PAYLOAD / BENCH_MULTI_COUNT;
+
+	populate_bench_service(server);
+
+	return server;
+
+fail:
+	gatt_db_unref(server->db);
+	bt_att_unref(server->att);
+	free(server);
+
+	return NULL;
+}
+
+static void server_destroy(struct server *server)
+{
+	if (!server)
+		return;
+
+	/* Pending notifications are released along with the transport */
+	server->notify_done = true;
+
+	bt_gatt_server_unref(server->gatt);
+	gatt_db_unref(server->db);
+	bt_att_unref(server->att);
+	stats_reset(&server->rx);
+	free(server);
+}
+
+/* Client side */
+
+static void client_next_mode(struct client *cli);
+static void client_issue(struct client *cli);
+
+static void print_result(struct client *cli, const struct stats *stats,
+					uint64_t elapsed, int lost,
+					const uint32_t *latency)
+{
+	double seconds = elapsed / 1000000.0;
+	double ops = 0, kbps = 0;
+
+	if (seconds > 0) {
+		ops = stats->ops / seconds;
+		kbps = stats->bytes * 8 / seconds / 1000;
+	}
+
+	printf("%s\n    {\n", cli->first_result ? "" : ",");
+	cli->first_result = false;
+
+	printf("      \"mode\": \"%s\",\n", mode_names[cli->mode]);
+	printf("      \"operations\": %u,\n", stats->ops);
+	printf("      \"bytes\": %" PRIu64 ",\n", stats->bytes);
+	printf("      \"elapsed_us\": %" PRIu64 ",\n", elapsed);
+	printf("      \"ops_per_sec\": %.1f,\n", ops);
+	printf("      \"throughput_kbps\": %.1f,\n", kbps);
+
+	if (lost >= 0)
+		printf("      \"lost\": %d,\n", lost);
+
+	if (!latency) {
+		printf("      \"latency_us\": null\n");
+		printf("    }");
+		fflush(stdout);
+		return;
+	}
+
+	printf("      \"latency_us\": { \"p50\": %u, \"p90\": %u, "
+				"\"p99\": %u, \"max\": %u }\n",
+				latency[0], latency[1], latency[2], latency[3]);
+	printf("    }");
+	fflush(stdout);
+}
+
+static void finish_mode(struct client *cli)
+{
+	struct stats *stats = &cli->stats;
+	uint32_t latency[4];
+	int lost = -1;
+
+	stats_sort(stats);
+
+	latency[0] = stats_percentile(stats, 50);
+	latency[1] = stats_percentile(stats, 90);
+	latency[2] = stats_percentile(stats, 99);
+	latency[3] = stats_percentile(stats, 100);
+
+	if (cli->mode == MODE_NOTIFY)
+		lost = cli->sent - stats->ops;
+
+	/* Notification latency is one-way, see BENCH_HDR_SIZE */
+	print_result(cli, stats, stats->end - stats->start, lost,
+			cli->mode != MODE_NOTIFY || one_way_latency ?
+							latency : NULL);
+
+	cli->mode++;
+	client_next_mode(cli);
+}
+
+static void server_stats_cb(bool success, uint8_t att_ecode,
+					const uint8_t *value, uint16_t length,
+					void *user_data)
+{
+	struct client *cli = user_data;
+	struct stats rx;
+	uint32_t latency[4];
+	int i;
+
+	if (!success || length < 32) {
+		fprintf(stderr, "Failed to read server statistics\n");
+		cli->status = EXIT_FAILURE;
+		mainloop_quit();
+		return;
+	}
+
+	/* Goodput and latency as seen by the receiving server */
+	memset(&rx, 0, sizeof(rx));
+	rx.ops = get_le32(value);
+	rx.bytes = get_le64(value + 4);
+
+	for (i = 0; i < 4; i++)
+		latency[i] = get_le32(value + 16 + i * 4);
+
+	print_result(cli, &rx, get_le32(value + 12),
+					(int) (cli->sent - rx.ops),
+					one_way_latency ? latency : NULL);
+
+	cli->mode++;
+	client_next_mode(cli);
+}
+
+static void client_done(struct client *cli)
+{
+	if (cli->mode == MODE_COUNT)
+		return;
+
+	if (cli->outstanding || get_usec() < cli->deadline)
+		return;
+
+	if (cli->mode == MODE_WRITE_CMD) {
+		/* Collect what actually made it to the server */
+		if (!bt_gatt_client_read_long_value(cli->gatt,
+						cli->control_handle, 0,
+						server_stats_cb, cli, NULL)) {
+			cli->status = EXIT_FAILURE;
+			mainloop_quit();
+		}
+
+		return;
+	}
+
+	finish_mode(cli);
+}
+
+static void write_cmd_sent(void *user_data)
+{
+	struct client *cli = user_data;
+
+	cli->outstanding--;
+	client_issue(cli);
+}
+
+static void write_cb(bool success, uint8_t att_ecode, void *user_data)
+{
+	struct client *cli = user_data;
+
+	cli->outstanding--;
+
+	if (!success) {
+		fprintf(stderr, "Write failed: 0x%02x\n", att_ecode);
+		cli->deadline = 0;
+	}
+
+	client_issue(cli);
+}
+
+static void read_cb(bool success, uint8_t att_ecode, const uint8_t *value,
+					uint16_t length, void *user_data)
+{
+	struct client *cli = user_data;
+
+	cli->outstanding--;
+
+	if (!success) {
+		fprintf(stderr, "Read failed: 0x%02x\n", att_ecode);
+		cli->deadline = 0;
+	}
+
+	client_issue(cli);
+}
+
+struct request {
+	struct client *cli;
+	uint64_t start;
+	uint16_t len;
+};
+
+static void request_write_cb(bool success, uint8_t att_ecode,
+							void *user_data)
+{
+	struct request *req = user_data;
+
+	if (success)
+		stats_add(&req->cli->stats, req->len,
+						get_usec() - req->start);
+
+	write_cb(success, att_ecode, req->cli);
+}
+
+static void request_read_cb(bool success, uint8_t att_ecode,
+					const uint8_t *value, uint16_t length,
+					void *user_data)
+{
+	struct request *req = user_data;
+
+	if (success)
+		stats_add(&req->cli->stats, length, get_usec() - req->start);
+
+	read_cb(success, att_ecode, value, length, req->cli);
+}
+
+static struct request *request_new(struct client *cli, uint16_t len)
+{
+	struct request *req;
+
+	req = new0(struct request, 1);
+	req->cli = cli;
+	req->start = get_usec();
+	req->len = len;
+
+	return req;
+}
+
+static bool client_issue_one(struct client *cli)
+{
+	uint8_t pdu[2 + BENCH_MAX_VALUE];
+	uint16_t len = cli->payload;
+	struct request *req;
+	unsigned int id = 0;
+
+	switch (cli->mode) {
+	case MODE_WRITE_CMD:
+		put_le16(cli->data_handle, pdu);
+		memset(pdu + 2, 0, len);
+		put_header(pdu + 2, len, cli->seq++);
+
+		/*
+		 * Go through bt_att directly so the PDU being written out
+		 * to the socket paces the next one.
+		 */
+		id = bt_att_send(cli->att, BT_ATT_OP_WRITE_CMD, pdu, 2 + len,
+						NULL, cli, write_cmd_sent);
+		if (id) {
+			cli->sent++;
+			cli->stats.bytes += len;
+		}
+
+		return id;
+	case MODE_WRITE:
+		memset(pdu, 0, len);
+		put_header(pdu, len, cli->seq++);
+
+		req = request_new(cli, len);
+		id = bt_gatt_client_write_value(cli->gatt, cli->data_handle,
+						pdu, len, request_write_cb,
+						req, free);
+		break;
+	case MODE_READ_LONG:
+		req = request_new(cli, 0);
+		id = bt_gatt_client_read_long_value(cli->gatt,
+						cli->data_handle, 0,
+						request_read_cb, req, free);
+		break;
+	case MODE_READ_MULTIPLE:
+		req = request_new(cli, 0);
+		id = bt_gatt_client_read_multiple(cli->gatt,
+						cli->multi_handles,
+						BENCH_MULTI_COUNT,
+						request_read_cb, req, free);
+		break;
+	case MODE_NOTIFY:
+	case MODE_COUNT:
+	default:
+		return false;
+	}
+
+	if (!id)
+		free(req);
+
+	return id;
+}
+
+static void client_issue(struct client *cli)
+{
+	while (cli->outstanding < cli->window && get_usec() < cli->deadline) {
+		if (!client_issue_one(cli)) {
+			fprintf(stderr, "Failed to send %s request\n",
+						mode_names[cli->mode]);
+			cli->status = EXIT_FAILURE;
+			cli->deadline = 0;
+			break;
+		}
+
+		cli->outstanding++;
+	}
+
+	client_done(cli);
+}
+
+static void mode_start_cb(bool success, uint8_t att_ecode, void *user_data)
+{
+	struct client *cli = user_data;
+
+	if (!success) {
+		fprintf(stderr, "Control point write failed: 0x%02x\n",
+								att_ecode);
+		cli->status = EXIT_FAILURE;
+		mainloop_quit();
+		return;
+	}
+
+	if (cli->mode == MODE_NOTIFY)
+		return;
+
+	cli->deadline = get_usec() + cli->duration * 1000000ULL;
+	cli->stats.start = get_usec();
+
+	/* Requests use every channel, commands keep the queue filled */
+	cli->window = cli->mode == MODE_WRITE_CMD ? DEFAULT_WINDOW :
+								cli->channels;
+
+	client_issue(cli);
+}
+
+static void client_next_mode(struct client *cli)
+{
+	uint8_t cmd[8];
+
+	while (cli->mode < MODE_COUNT && !cli->modes[cli->mode])
+		cli->mode++;
+
+	if (cli->mode == MODE_COUNT) {
+		mainloop_quit();
+		return;
+	}
+
+	bench_log("Running %s for %u s\n", mode_names[cli->mode],
+								cli->duration);
+
+	stats_reset(&cli->stats);
+	cli->outstanding = 0;
+	cli->sent = 0;
+	cli->seq = 0;
+
+	if (cli->mode == MODE_NOTIFY) {
+		cmd[0] = BENCH_CMD_NOTIFY;
+		put_le16(cli->payload, cmd + 1);
+		put_le32(cli->duration * 1000, cmd + 3);
+		cmd[7] = DEFAULT_WINDOW;
+	} else
+		cmd[0] = BENCH_CMD_RESET;
+
+	if (!bt_gatt_client_write_value(cli->gatt, cli->control_handle, cmd,
+					cli->mode == MODE_NOTIFY ? 8 : 1,
+					mode_start_cb, cli, NULL)) {
+		cli->status = EXIT_FAILURE;
+		mainloop_quit();
+	}
+}
+
+static void setup_cb(bool success, uint8_t att_ecode, void *user_data)
+{
+	struct client *cli = user_data;
+
+	if (!success) {
+		fprintf(stderr, "Benchmark setup failed: 0x%02x\n", att_ecode);
+		cli->status = EXIT_FAILURE;
+		mainloop_quit();
+		return;
+	}
+
+	printf("{\n  \"transport\": \"%s\",\n", cli->transport);
+	printf("  \"mtu\": %u,\n", bt_gatt_client_get_mtu(cli->gatt));
+	printf("  \"channels\": %u,\n", cli->channels);
+	printf("  \"payload\": %u,\n", cli->payload);
+	printf("  \"read_long_size\": %u,\n", cli->read_size);
+	printf("  \"duration_s\": %u,\n", cli->duration);
+	printf("  \"results\": [");
+
+	cli->started = true;
+	cli->first_result = true;
+	cli->mode = 0;
+	client_next_mode(cli);
+}
+
+static void notify_cb(uint16_t value_handle, const uint8_t *value,
+					uint16_t length, void *user_data)
+{
+	struct client *cli = user_data;
+
+	if (cli->mode != MODE_NOTIFY)
+		return;
+
+	if (value_handle == cli->data_handle) {
+		stats_add(&cli->stats, length, get_latency(value, length));
+		return;
+	}
+
+	if (value_handle == cli->control_handle && length >= 4) {
+		cli->sent = get_le32(value);
+		finish_mode(cli);
+	}
+}
+
+static void register_notify_cb(uint16_t att_ecode, void *user_data)
+{
+	struct client *cli = user_data;
+	uint16_t mtu;
+	uint8_t cmd[5];
+
+	if (att_ecode) {
+		fprintf(stderr, "Failed to enable notifications: 0x%02x\n",
+								att_ecode);
+		cli->status = EXIT_FAILURE;
+		mainloop_quit();
+		return;
+	}
+
+	if (++cli->registered < 2)
+		return;
+
+	mtu = bt_gatt_client_get_mtu(cli->gatt);
+
+	/*
+	 * The read-long value must not fit a single Read Response or no Read
+	 * Blob Request is ever sent, so it is sized apart from the payload.
+	 */
+	cli->read_size = cli->payload;
+	if (cli->read_size <= mtu - 1)
+		cli->read_size = BENCH_MAX_VALUE;
+
+	if (cli->modes[MODE_READ_LONG] && cli->read_size <= mtu - 1)
+		bench_log("Value fits in MTU %u, read-long uses a single Read\n",
+									mtu);
+
+	/* Payloads cannot exceed what a single PDU carries */
+	if (cli->payload > mtu - 3 && (cli->modes[MODE_NOTIFY] ||
+					cli->modes[MODE_WRITE_CMD] ||
+					cli->modes[MODE_WRITE])) {
+		cli->payload = mtu - 3;
+		bench_log("Payload limited to %u by MTU\n", cli->payload);
+	}
+
+	cmd[0] = BENCH_CMD_SETUP;
+	put_le16(cli->payload, cmd + 1);
+	put_le16(cli->read_size, cmd + 3);
+
+	if (!bt_gatt_client_write_value(cli->gatt, cli->control_handle, cmd,
+					sizeof(cmd), setup_cb, cli, NULL)) {
+		cli->status = EXIT_FAILURE;
+		mainloop_quit();
+	}
+}
+
+static void find_chrc(struct gatt_db_attribute *attr, void *user_data)
+{
+	struct client *cli = user_data;
+	uint16_t handle, value_handle;
+	bt_uuid_t uuid, control, data, multi;
+	int i;
+
+	if (!gatt_db_attribute_get_char_data(attr, &handle, &value_handle,
+							NULL, NULL, &uuid))
+		return;
+
+	bt_string_to_uuid(&control, BENCH_CONTROL_UUID);
+	bt_string_to_uuid(&data, BENCH_DATA_UUID);
+	bt_string_to_uuid(&multi, BENCH_MULTI_UUID);
+
+	if (!bt_uuid_cmp(&uuid, &control))
+		cli->control_handle = value_handle;
+	else if (!bt_uuid_cmp(&uuid, &data))
+		cli->data_handle = value_handle;
+	else if (!bt_uuid_cmp(&uuid, &multi)) {
+		for (i = 0; i < BENCH_MULTI_COUNT; i++) {
+			if (!cli->multi_handles[i]) {
+				cli->multi_handles[i] = value_handle;
+				break;
+			}
+		}
+	}
+}
+
+static void find_service(struct gatt_db_attribute *attr, void *user_data)
+{
+	gatt_db_service_foreach_char(attr, find_chrc, user_data);
+}
+
+static void ready_cb(bool success, uint8_t att_ecode, void *user_data)
+{
+	struct client *cli = user_data;
+	bt_uuid_t uuid;
+
+	if (!success) {
+		fprintf(stderr, "GATT discovery failed: 0x%02x\n", att_ecode);
+		cli->status = EXIT_FAILURE;
+		mainloop_quit();
+		return;
+	}
+
+	bt_string_to_uuid(&uuid, BENCH_SERVICE_UUID);
+	gatt_db_foreach_service(cli->db, &uuid, find_service, cli);
+
+	if (!cli->control_handle || !cli->data_handle ||
+			!cli->multi_handles[BENCH_MULTI_COUNT - 1]) {
+		fprintf(stderr, "Benchmark service not found\n");
+		cli->status = EXIT_FAILURE;
+		mainloop_quit();
+		return;
+	}
+
+	bench_log("Benchmark service found, MTU %u, %d channels\n",
+					bt_gatt_client_get_mtu(cli->gatt),
+					bt_att_get_channels(cli->att));
+
+	bt_gatt_client_register_notify(cli->gatt, cli->control_handle,
+					register_notify_cb, notify_cb, cli,
+					NULL);
+	bt_gatt_client_register_notify(cli->gatt, cli->data_handle,
+					register_notify_cb, notify_cb, cli,
+					NULL);
+}
+
+static struct client *client_create(int fd, uint16_t mtu)
+{
+	struct client *cli;
+
+	cli = new0(struct client, 1);
+	cli->status = EXIT_SUCCESS;
+
+	cli->att = bt_att_new(fd, false);
+	if (!cli->att) {
+		fprintf(stderr, "Failed to initialize ATT transport layer\n");
+		goto fail;
+	}
+
+	if (!bt_att_set_close_on_unref(cli->att, true)) {
+		fprintf(stderr, "Failed to set up ATT transport layer\n");
+		goto fail;
+	}
+
+	if (!bt_att_register_disconnect(cli->att, att_disconnect_cb, NULL,
+								NULL)) {
+		fprintf(stderr, "Failed to set ATT disconnect handler\n");
+		goto fail;
+	}
+
+	cli->db = gatt_db_new();
+	cli->mtu = mtu;
+
+	return cli;
+
+fail:
+	bt_att_unref(cli->att);
+	free(cli);
+
+	return NULL;
+}
+
+static bool client_start(struct client *cli)
+{
+	cli->gatt = bt_gatt_client_new(cli->db, cli->att, cli->mtu, 0);
+	if (!cli->gatt) {
+		fprintf(stderr, "Failed to create GATT client\n");
+		return false;
+	}
+
+	cli->channels = bt_att_get_channels(cli->att);
+
+	bt_gatt_client_ready_register(cli->gatt, ready_cb, cli, NULL);
+
+	return true;
+}
+
+static void client_destroy(struct client *cli)
+{
+	/* Commands still queued are released along with the transport */
+	cli->mode = MODE_COUNT;
+	cli->deadline = 0;
+
+	bt_gatt_client_unref(cli->gatt);
+	gatt_db_unref(cli->db);
+	bt_att_unref(cli->att);
+	stats_reset(&cli->stats);
+	free(cli);
+}
+
+/* Transports */
+
+static int l2cap_le_socket(bdaddr_t *src, uint16_t psm, uint16_t cid,
+						int sec, uint16_t mtu)
+{
+	struct sockaddr_l2 addr;
+	struct bt_security btsec;
+	int sk;
+
+	sk = socket(PF_BLUETOOTH, SOCK_SEQPACKET, BTPROTO_L2CAP);
+	if (sk < 0) {
+		perror("Failed to create L2CAP socket");
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.l2_family = AF_BLUETOOTH;
+	addr.l2_psm = htobs(psm);
+	addr.l2_cid = htobs(cid);
+	addr.l2_bdaddr_type = BDADDR_LE_PUBLIC;
+	bacpy(&addr.l2_bdaddr, src);
+
+	if (bind(sk, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		perror("Failed to bind L2CAP socket");
+		goto fail;
+	}
+
+	memset(&btsec, 0, sizeof(btsec));
+	btsec.level = sec;
+	if (setsockopt(sk, SOL_BLUETOOTH, BT_SECURITY, &btsec,
+							sizeof(btsec)) < 0) {
+		perror("Failed to set L2CAP security level");
+		goto fail;
+	}
+
+	if (psm) {
+		uint8_t mode = BT_MODE_EXT_FLOWCTL;
+
+		if (setsockopt(sk, SOL_BLUETOOTH, BT_MODE, &mode,
+							sizeof(mode)) < 0) {
+			perror("Failed to set enhanced credit based mode");
+			goto fail;
+		}
+
+		if (mtu && setsockopt(sk, SOL_BLUETOOTH, BT_RCVMTU, &mtu,
+							sizeof(mtu)) < 0) {
+			perror("Failed to set L2CAP MTU");
+			goto fail;
+		}
+	}
+
+	return sk;
+
+fail:
+	close(sk);
+	return -1;
+}
+
+static int l2cap_le_connect(bdaddr_t *src, bdaddr_t *dst, uint8_t dst_type,
+				uint16_t psm, uint16_t cid, int sec,
+				uint16_t mtu)
+{
+	struct sockaddr_l2 addr;
+	int sk;
+
+	sk = l2cap_le_socket(src, psm, cid, sec, mtu);
+	if (sk < 0)
+		return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.l2_family = AF_BLUETOOTH;
+	addr.l2_psm = htobs(psm);
+	addr.l2_cid = htobs(cid);
+	addr.l2_bdaddr_type = dst_type;
+	bacpy(&addr.l2_bdaddr, dst);
+
+	if (connect(sk, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		perror("Failed to connect");
+		close(sk);
+		return -1;
+	}
+
+	return sk;
+}
+
+static void eatt_accept_cb(int fd, uint32_t events, void *user_data)
+{
+	struct server *server = user_data;
+	int nsk;
+
+	if (events & (EPOLLERR | EPOLLHUP)) {
+		mainloop_remove_fd(fd);
+		return;
+	}
+
+	nsk = accept(fd, NULL, NULL);
+	if (nsk < 0) {
+		perror("Failed to accept EATT channel");
+		return;
+	}
+
+	if (bt_att_attach_fd(server->att, nsk) < 0) {
+		fprintf(stderr, "Failed to attach EATT channel\n");
+		close(nsk);
+		return;
+	}
+
+	bench_log("EATT channel attached, %d channels\n",
+					bt_att_get_channels(server->att));
+}
+
+static int run_server(bdaddr_t *src, int sec, uint16_t mtu)
+{
+	struct server *server;
+	int sk, eatt_sk, nsk;
+
+	sk = l2cap_le_socket(src, 0, ATT_CID, sec, 0);
+	if (sk < 0)
+		return EXIT_FAILURE;
+
+	eatt_sk = l2cap_le_socket(src, BT_ATT_EATT_PSM, 0, sec, mtu);
+
+	if (listen(sk, 1) < 0 || (eatt_sk >= 0 && listen(eatt_sk, 5) < 0)) {
+		perror("Failed to listen");
+		goto fail;
+	}
+
+	fprintf(stderr, "Waiting for benchmark client\n");
+
+	nsk = accept(sk, NULL, NULL);
+	if (nsk < 0) {
+		perror("Accept failed");
+		goto fail;
+	}
+
+	close(sk);
+	sk = -1;
+
+	server = server_create(nsk, mtu);
+	if (!server) {
+		close(nsk);
+		goto fail;
+	}
+
+	bt_att_register_disconnect(server->att, att_disconnect_cb, NULL, NULL);
+
+	if (eatt_sk >= 0)
+		mainloop_add_fd(eatt_sk, EPOLLIN, eatt_accept_cb, server,
+									NULL);
+
+	mainloop_run();
+
+	server_destroy(server);
+
+	if (eatt_sk >= 0)
+		close(eatt_sk);
+
+	return EXIT_SUCCESS;
+
+fail:
+	if (sk >= 0)
+		close(sk);
+
+	if (eatt_sk >= 0)
+		close(eatt_sk);
+
+	return EXIT_FAILURE;
+}
+
+static void signal_cb(int signum, void *user_data)
+{
+	switch (signum) {
+	case SIGINT:
+	case SIGTERM:
+		mainloop_quit();
+		break;
+	default:
+		break;
+	}
+}
+
+static bool parse_modes(const char *arg, bool *modes)
+{
+	char *str, *tok, *ptr = NULL;
+	bool result = true;
+	int i;
+
+	str = strdup(arg);
+	if (!str)
+		return false;
+
+	memset(modes, 0, sizeof(bool) * MODE_COUNT);
+
+	for (tok = strtok_r(str, ",", &ptr); tok;
+					tok = strtok_r(NULL, ",", &ptr)) {
+		if (!strcmp(tok, "all")) {
+			for (i = 0; i < MODE_COUNT; i++)
+				modes[i] = true;
+			continue;
+		}
+
+		if (!strcmp(tok, "wwr"))
+			tok = (char *) mode_names[MODE_WRITE_CMD];
+
+		for (i = 0; i < MODE_COUNT; i++) {
+			if (!strcmp(tok, mode_names[i])) {
+				modes[i] = true;
+				break;
+			}
+		}
+
+		if (i == MODE_COUNT) {
+			result = false;
+			break;
+		}
+	}
+
+	free(str);
+
+	return result;
+}
+
+static void usage(void)
+{
+	printf("btgatt-bench - GATT throughput and latency benchmark\n"
+		"Usage:\n");
+	printf("\tbtgatt-bench [options]\n");
+	printf("Options:\n"
+		"\t-l, --local\t\t\tRun client and server in one process,\n"
+		"\t\t\t\t\tthe only mode with one-way latency\n"
+		"\t-s, --server\t\t\tRun as benchmark server\n"
+		"\t-d, --dest <addr>\t\tConnect to benchmark server\n"
+		"\t-i, --index <id>\t\tSpecify adapter index, e.g. hci0\n"
+		"\t-t, --type [random|public] \tSpecify the LE address type\n"
+		"\t-m, --mtu <mtu>\t\t\tThe ATT MTU to use\n"
+		"\t-e, --eatt <count>\t\tNumber of EATT channels to add\n"
+		"\t-p, --payload <size>\t\tPayload size in octets\n"
+		"\t-o, --ops <list>\t\tComma separated operations: notify,\n"
+		"\t\t\t\t\twwr, write, read-long, read-multiple\n"
+		"\t\t\t\t\tor all (default)\n"
+		"\t-D, --duration <sec>\t\tDuration of each operation\n"
+		"\t-v, --verbose\t\t\tEnable extra logging\n"
+		"\t-h, --help\t\t\tDisplay help\n");
+	printf("\nResults are written to stdout as JSON.  One-way latencies\n"
+		"of notify and wwr need client and server on one host.\n");
+}
+
+static const struct option main_options[] = {
+	{ "local",	no_argument,		NULL, 'l' },
+	{ "server",	no_argument,		NULL, 's' },
+	{ "dest",	required_argument,	NULL, 'd' },
+	{ "index",	required_argument,	NULL, 'i' },
+	{ "type",	required_argument,	NULL, 't' },
+	{ "mtu",	required_argument,	NULL, 'm' },
+	{ "eatt",	required_argument,	NULL, 'e' },
+	{ "payload",	required_argument,	NULL, 'p' },
+	{ "ops",	required_argument,	NULL, 'o' },
+	{ "duration",	required_argument,	NULL, 'D' },
+	{ "verbose",	no_argument,		NULL, 'v' },
+	{ "help",	no_argument,		NULL, 'h' },
+	{ }
+};
+
+int main(int argc, char *argv[])
+{
+	bool local = false, server_mode = false, dst_given = false;
+	bool modes[MODE_COUNT] = { true, true, true, true, true };
+	uint8_t dst_type = BDADDR_LE_PUBLIC;
+	bdaddr_t src_addr, dst_addr;
+	unsigned int duration = DEFAULT_DURATION;
+	unsigned int payload = DEFAULT_PAYLOAD;
+	unsigned int eatt = 0;
+	unsigned int mtu = BT_ATT_MAX_LE_MTU;
+	int sec = BT_SECURITY_LOW;
+	int dev_id = -1;
+	struct client *cli;
+	struct server *server = NULL;
+	int status;
+	unsigned int i;
+
+	for (;;) {
+		int opt;
+
+		opt = getopt_long(argc, argv, "lsd:i:t:m:e:p:o:D:vh",
+						main_options, NULL);
+		if (opt < 0)
+			break;
+
+		switch (opt) {
+		case 'l':
+			local = true;
+			break;
+		case 's':
+			server_mode = true;
+			break;
+		case 'd':
+			if (str2ba(optarg, &dst_addr) < 0) {
+				fprintf(stderr, "Invalid remote address: %s\n",
+									optarg);
+				return EXIT_FAILURE;
+			}
+
+			dst_given = true;
+			break;
+		case 'i':
+			dev_id = hci_devid(optarg);
+			if (dev_id < 0) {
+				perror("Invalid adapter");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 't':
+			if (!strcmp(optarg, "random"))
+				dst_type = BDADDR_LE_RANDOM;
+			else if (!strcmp(optarg, "public"))
+				dst_type = BDADDR_LE_PUBLIC;
+			else {
+				fprintf(stderr,
+					"Allowed types: random, public\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'm':
+			mtu = atoi(optarg);
+			if (mtu < BT_ATT_DEFAULT_LE_MTU || mtu > UINT16_MAX) {
+				fprintf(stderr, "Invalid MTU: %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'e':
+			eatt = atoi(optarg);
+			break;
+		case 'p':
+			payload = atoi(optarg);
+			if (payload < BENCH_HDR_SIZE ||
+					payload > BENCH_MAX_VALUE) {
+				fprintf(stderr, "Payload must be %u to %u\n",
+					BENCH_HDR_SIZE, BENCH_MAX_VALUE);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'o':
+			if (!parse_modes(optarg, modes)) {
+				fprintf(stderr, "Invalid operations: %s\n",
+									optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'D':
+			duration = atoi(optarg);
+			if (!duration) {
+				fprintf(stderr, "Invalid duration: %s\n",
+									optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!local && !server_mode && !dst_given) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if (local && eatt) {
+		fprintf(stderr, "EATT channels need an L2CAP connection\n");
+		return EXIT_FAILURE;
+	}
+
+	if (dev_id == -1)
+		bacpy(&src_addr, BDADDR_ANY);
+	else if (hci_devba(dev_id, &src_addr) < 0) {
+		perror("Adapter not available");
+		return EXIT_FAILURE;
+	}
+
+	mainloop_init();
+
+	if (server_mode)
+		return run_server(&src_addr, sec, mtu);
+
+	if (local) {
+		int fds[2];
+
+		/* Both ends share the clock the send times are taken from */
+		one_way_latency = true;
+
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0,
+								fds) < 0) {
+			perror("Failed to create socket pair");
+			return EXIT_FAILURE;
+		}
+
+		server = server_create(fds[1], mtu);
+		if (!server) {
+			close(fds[0]);
+			close(fds[1]);
+			return EXIT_FAILURE;
+		}
+
+		cli = client_create(fds[0], mtu);
+		if (!cli) {
+			close(fds[0]);
+			server_destroy(server);
+			return EXIT_FAILURE;
+		}
+
+		cli->transport = "local";
+	} else {
+		int fd;
+
+		fd = l2cap_le_connect(&src_addr, &dst_addr, dst_type, 0,
+							ATT_CID, sec, 0);
+		if (fd < 0)
+			return EXIT_FAILURE;
+
+		cli = client_create(fd, mtu);
+		if (!cli) {
+			close(fd);
+			return EXIT_FAILURE;
+		}
+
+		for (i = 0; i < eatt; i++) {
+			fd = l2cap_le_connect(&src_addr, &dst_addr, dst_type,
+						BT_ATT_EATT_PSM, 0, sec, mtu);
+			if (fd < 0)
+				break;
+
+			if (bt_att_attach_fd(cli->att, fd) < 0) {
+				close(fd);
+				break;
+			}
+		}
+
+		if (i < eatt)
+			fprintf(stderr, "Only %u of %u EATT channels "
+						"connected\n", i, eatt);
+
+		cli->transport = "le";
+	}
+
+	memcpy(cli->modes, modes, sizeof(modes));
+	cli->payload = payload;
+	cli->duration = duration;
+
+	if (!client_start(cli)) {
+		client_destroy(cli);
+		server_destroy(server);
+		return EXIT_FAILURE;
+	}
+
+	mainloop_run_with_signal(signal_cb, NULL);
+
+	if (cli->started)
+		printf("\n  ]\n}\n");
+
+	status = cli->status;
+
+	client_destroy(cli);
+	server_destroy(server);
+
+	return status;
+}
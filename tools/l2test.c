@@ -39,6 +39,7 @@
 #include <syslog.h>
 #include <signal.h>
 #include <sys/time.h>
+#include <time.h>
 #include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
@@ -60,6 +61,10 @@
 #define SIOCGSTAMP_OLD SIOCGSTAMP
 #endif
 
+#ifndef SIOCOUTQ
+#define SIOCOUTQ TIOCOUTQ
+#endif
+
 /* Test modes */
 enum {
 	SEND,
@@ -76,6 +81,8 @@ enum {
 	CSENDRECV,
 	INFOREQ,
 	PAIRING,
+	STREAM,
+	LSTREAM,
 };
 
 static unsigned char *buf;
@@ -120,6 +127,12 @@ static unsigned long disc_delay = 0;
 /* Initial sequence value when sending frames */
 static int seq_start = 0;
 
+/* Number of parallel channels in stream mode */
+static int stream_channels = 1;
+
+/* Stream pacing in kB/s over all channels (0 = unlimited) */
+static unsigned long stream_rate = 0;
+
 static const char *filename = NULL;
 
 static int rfcmode = 0;
@@ -1048,6 +1061,332 @@ static void send_and_recv_mode(int sk)
 	return;
 }
 
+static uint64_t get_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct stream_chan {
+	int sk;
+	uint32_t seq;
+	int frames;
+	unsigned long bytes;
+	unsigned long long total;
+	uint64_t stall;
+	uint64_t stall_start;
+};
+
+static void stream_report(struct stream_chan *chans, unsigned int secs,
+						uint64_t now, uint64_t elapsed)
+{
+	unsigned long bytes = 0;
+	uint64_t stall = 0;
+	int i, outq;
+
+	for (i = 0; i < stream_channels; i++) {
+		struct stream_chan *chan = &chans[i];
+
+		if (chan->sk < 0)
+			continue;
+
+		/* Account the stall up to now and keep it running */
+		if (chan->stall_start) {
+			chan->stall += now - chan->stall_start;
+			chan->stall_start = now;
+		}
+
+		if (ioctl(chan->sk, SIOCOUTQ, &outq) < 0)
+			outq = -1;
+
+		syslog(LOG_INFO, "[%u s] chan %d: tx %.2f kB/s, outq %d bytes, "
+				"stall %llu ms", secs, i,
+				chan->bytes * 1000000.0 / elapsed / 1024.0,
+				outq, (unsigned long long) chan->stall / 1000);
+
+		bytes += chan->bytes;
+		stall += chan->stall;
+
+		chan->bytes = 0;
+		chan->stall = 0;
+	}
+
+	if (stream_channels > 1)
+		syslog(LOG_INFO, "[%u s] total: tx %.2f kB/s, stall %llu ms",
+				secs, bytes * 1000000.0 / elapsed / 1024.0,
+				(unsigned long long) stall / 1000);
+}
+
+static void stream_send(struct stream_chan *chan, int size, uint64_t now)
+{
+	int len;
+
+	put_le32(chan->seq, buf);
+	put_le16(size, buf + 4);
+
+	len = send(chan->sk, buf, size, MSG_DONTWAIT);
+	if (len < 0) {
+		/* Out of credits and socket buffer, wait for it to drain */
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			if (!chan->stall_start)
+				chan->stall_start = now;
+			return;
+		}
+
+		syslog(LOG_ERR, "Send failed: %s (%d)", strerror(errno),
+									errno);
+		close(chan->sk);
+		chan->sk = -1;
+		return;
+	}
+
+	chan->seq++;
+	chan->bytes += len;
+	chan->total += len;
+
+	if (chan->frames > 0 && !--chan->frames) {
+		syslog(LOG_INFO, "Channel done, %llu bytes sent", chan->total);
+		shutdown(chan->sk, SHUT_WR);
+	}
+}
+
+static void stream_mode(char *svr)
+{
+	struct stream_chan *chans;
+	struct pollfd *p;
+	uint64_t start, now, last, report, polled;
+	double tokens = 0;
+	unsigned int secs = 0;
+	int i, n, first = 0, size, active;
+
+	chans = calloc(stream_channels, sizeof(*chans));
+	p = calloc(stream_channels, sizeof(*p));
+	if (!chans || !p) {
+		syslog(LOG_ERR, "Can't allocate channels");
+		exit(1);
+	}
+
+	for (i = 0; i < stream_channels; i++) {
+		chans[i].sk = do_connect(svr);
+		if (chans[i].sk < 0)
+			exit(1);
+
+		chans[i].seq = seq_start;
+		chans[i].frames = num_frames;
+	}
+
+	/* One send is one SDU, so the SDU is bound by the outgoing MTU */
+	size = (data_size < 0 || data_size > omtu) ? omtu : data_size;
+	if (size < 6) {
+		syslog(LOG_ERR, "SDU size %d too small", size);
+		exit(1);
+	}
+
+	memset(buf + 6, 0x7f, size - 6);
+
+	syslog(LOG_INFO, "Streaming %d byte SDUs on %d channels ...", size,
+							stream_channels);
+
+	start = last = get_usec();
+	report = start + 1000000;
+	active = stream_channels;
+
+	while (active) {
+		int timeout;
+
+		now = get_usec();
+
+		if (stream_rate) {
+			tokens += (now - last) * stream_rate * 1024.0 / 1000000;
+			if (tokens > size * stream_channels)
+				tokens = size * stream_channels;
+		}
+
+		last = now;
+
+		timeout = (report - now + 999) / 1000;
+
+		for (i = 0; i < stream_channels; i++) {
+			p[i].fd = chans[i].sk;
+			p[i].events = POLLERR | POLLHUP;
+			p[i].revents = 0;
+
+			if (chans[i].sk < 0 || !chans[i].frames)
+				continue;
+
+			if (!stream_rate || tokens >= size)
+				p[i].events |= POLLOUT;
+		}
+
+		/* Wake up once enough tokens are there for the next SDU */
+		if (stream_rate && tokens < size) {
+			int wait = (size - tokens) * 1000 /
+						(stream_rate * 1024.0) + 1;
+
+			if (wait < timeout)
+				timeout = wait;
+		}
+
+		if (poll(p, stream_channels, timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		polled = now;
+		now = get_usec();
+
+		/* Rotate the first channel served so pacing stays fair */
+		first = (first + 1) % stream_channels;
+
+		for (n = 0; n < stream_channels; n++) {
+			struct stream_chan *chan;
+
+			i = (first + n) % stream_channels;
+			chan = &chans[i];
+
+			if (chan->sk < 0)
+				continue;
+
+			if (p[i].revents & (POLLERR | POLLHUP)) {
+				syslog(LOG_INFO, "Channel %d disconnected", i);
+				close(chan->sk);
+				chan->sk = -1;
+				active--;
+				continue;
+			}
+
+			if (!(p[i].events & POLLOUT))
+				continue;
+
+			/* Blocked for the whole poll, so stalled since then */
+			if (!(p[i].revents & POLLOUT)) {
+				if (!chan->stall_start)
+					chan->stall_start = polled;
+				continue;
+			}
+
+			if (chan->stall_start) {
+				chan->stall += now - chan->stall_start;
+				chan->stall_start = 0;
+			}
+
+			if (stream_rate && tokens < size)
+				continue;
+
+			stream_send(chan, size, now);
+
+			if (chan->sk < 0) {
+				active--;
+				continue;
+			}
+
+			if (stream_rate && !chan->stall_start)
+				tokens -= size;
+		}
+
+		if (now >= report) {
+			stream_report(chans, ++secs, now, now - report + 1000000);
+			report = now + 1000000;
+		}
+	}
+
+	now = get_usec();
+
+	syslog(LOG_INFO, "Stream finished after %.2f sec",
+					(now - start) / 1000000.0);
+
+	free(p);
+	free(chans);
+}
+
+static void stream_recv_mode(int sk)
+{
+	struct pollfd p;
+	uint64_t start, now, report;
+	unsigned long bytes = 0, sdus = 0, lost = 0;
+	unsigned long long total = 0;
+	unsigned int secs = 0;
+	uint32_t seq = seq_start;
+	int len;
+
+	if (data_size < 0)
+		data_size = imtu;
+
+	syslog(LOG_INFO, "Receiving stream ...");
+
+	p.fd = sk;
+	p.events = POLLIN | POLLERR | POLLHUP;
+
+	start = get_usec();
+	report = start + 1000000;
+
+	while (1) {
+		int timeout;
+
+		now = get_usec();
+		timeout = now < report ? (report - now + 999) / 1000 : 0;
+
+		p.revents = 0;
+		if (poll(&p, 1, timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (p.revents & POLLIN) {
+			len = recv(sk, buf, data_size, MSG_DONTWAIT);
+			if (len == 0)
+				break;
+
+			if (len < 0 && errno != EAGAIN) {
+				syslog(LOG_ERR, "Read failed: %s (%d)",
+							strerror(errno), errno);
+				break;
+			}
+
+			if (len >= 6) {
+				uint32_t sq = get_le32(buf);
+
+				/* Resync if the sender went backwards */
+				if (sq > seq)
+					lost += sq - seq;
+
+				seq = sq + 1;
+			}
+
+			if (len > 0) {
+				bytes += len;
+				total += len;
+				sdus++;
+			}
+		} else if (p.revents & (POLLERR | POLLHUP))
+			break;
+
+		now = get_usec();
+		if (now >= report) {
+			syslog(LOG_INFO, "[%u s] rx %.2f kB/s, %lu SDUs, "
+					"%lu lost", ++secs,
+					bytes * 1000000.0 /
+					(now - report + 1000000) / 1024.0,
+					sdus, lost);
+
+			bytes = 0;
+			sdus = 0;
+			lost = 0;
+			report = now + 1000000;
+		}
+	}
+
+	now = get_usec();
+
+	syslog(LOG_INFO, "%llu bytes in %.2f sec", total,
+					(now - start) / 1000000.0);
+}
+
 static void reconnect_mode(char *svr)
 {
 	while (1) {
@@ -1310,7 +1649,9 @@ static void usage(void)
 		"\t-c connect, disconnect, connect, ...\n"
 		"\t-m multiple connects\n"
 		"\t-p trigger dedicated bonding\n"
-		"\t-z information request\n");
+		"\t-z information request\n"
+		"\t-f connect and stream with per second statistics\n"
+		"\t-j listen and receive streams with per second statistics\n");
 
 	printf("Options:\n"
 		"\t[-b bytes] [-i device] [-P psm] [-J cid]\n"
@@ -1339,7 +1680,9 @@ static void usage(void)
 		"\t[-M] become master\n"
 		"\t[-T] enable timestamps\n"
 		"\t[-V type] address type (help for list, default = bredr)\n"
-		"\t[-e seq] initial sequence value (default = 0)\n");
+		"\t[-e seq] initial sequence value (default = 0)\n"
+		"\t[-k num] parallel channels in stream mode (default = 1)\n"
+		"\t[-l kB/s] pace stream over all channels (default = none)\n");
 }
 
 int main(int argc, char *argv[])
@@ -1349,7 +1692,7 @@ int main(int argc, char *argv[])
 
 	bacpy(&bdaddr, BDADDR_ANY);
 
-	while ((opt = getopt(argc, argv, "a:b:cde:g:i:mnpqrstuwxyz"
+	while ((opt = getopt(argc, argv, "a:b:cde:fg:i:jk:l:mnpqrstuwxyz"
 		"AB:C:D:EF:GH:I:J:K:L:MN:O:P:Q:RSTUV:W:X:Y:Z:")) != EOF) {
 		switch (opt) {
 		case 'r':
@@ -1416,6 +1759,25 @@ int main(int argc, char *argv[])
 			need_addr = 1;
 			break;
 
+		case 'f':
+			mode = STREAM;
+			need_addr = 1;
+			break;
+
+		case 'j':
+			mode = LSTREAM;
+			break;
+
+		case 'k':
+			stream_channels = atoi(optarg);
+			if (stream_channels < 1)
+				stream_channels = 1;
+			break;
+
+		case 'l':
+			stream_rate = atoi(optarg);
+			break;
+
 		case 'b':
 			data_size = atoi(optarg);
 			break;
@@ -1668,6 +2030,14 @@ int main(int argc, char *argv[])
 		case PAIRING:
 			do_pairing(argv[optind]);
 			exit(0);
+
+		case STREAM:
+			stream_mode(argv[optind]);
+			break;
+
+		case LSTREAM:
+			do_listen(stream_recv_mode);
+			break;
 	}
 
 	syslog(LOG_INFO, "Exit");
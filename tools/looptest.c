@@ -0,0 +1,359 @@
+/*
+ *
+ *  BlueZ - Bluetooth protocol stack for Linux
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "src/shared/mainloop.h"
+
+struct pair_data {
+	int fd[2];
+};
+
+struct timer_data {
+	int id;
+	unsigned int msec;
+	uint64_t expected;
+};
+
+static unsigned int num_pairs = 1000;
+static unsigned int num_timers = 5000;
+static unsigned int max_msec = 500;
+static unsigned int duration = 5;
+
+static struct pair_data *pairs;
+static struct timer_data *timers;
+
+static uint64_t start_usec;
+static uint64_t fd_events;
+static uint64_t timer_events;
+static uint64_t timer_late_total;
+static uint64_t timer_late_max;
+static uint64_t timer_early;
+
+static uint64_t get_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void pair_callback(int fd, uint32_t events, void *user_data)
+{
+	unsigned char buf[64];
+	ssize_t len;
+
+	if (events & (EPOLLERR | EPOLLHUP)) {
+		mainloop_remove_fd(fd);
+		return;
+	}
+
+	len = read(fd, buf, sizeof(buf));
+	if (len <= 0)
+		return;
+
+	fd_events++;
+
+	/* Bounce the data back to keep every descriptor busy */
+	if (write(fd, buf, len) < 0)
+		perror("Failed to write data");
+}
+
+static void timer_schedule(struct timer_data *timer)
+{
+	timer->msec = 1 + rand() % max_msec;
+	timer->expected = get_usec() + timer->msec * 1000;
+}
+
+static void timer_callback(int id, void *user_data)
+{
+	struct timer_data *timer = user_data;
+	uint64_t now = get_usec();
+
+	timer_events++;
+
+	if (now < timer->expected) {
+		timer_early++;
+	} else {
+		uint64_t late = now - timer->expected;
+
+		timer_late_total += late;
+		if (late > timer_late_max)
+			timer_late_max = late;
+	}
+
+	timer_schedule(timer);
+	mainloop_modify_timeout(id, timer->msec);
+}
+
+static void duration_callback(int id, void *user_data)
+{
+	mainloop_quit();
+}
+
+static void signal_callback(int signum, void *user_data)
+{
+	switch (signum) {
+	case SIGINT:
+	case SIGTERM:
+		mainloop_quit();
+		break;
+	}
+}
+
+static bool setup_limit(void)
+{
+	struct rlimit rlim;
+	rlim_t needed = num_pairs * 2 + 64;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+		return false;
+
+	if (rlim.rlim_cur >= needed)
+		return true;
+
+	rlim.rlim_cur = needed;
+	if (rlim.rlim_max < needed)
+		rlim.rlim_max = needed;
+
+	if (setrlimit(RLIMIT_NOFILE, &rlim) < 0) {
+		perror("Failed to raise file descriptor limit");
+		return false;
+	}
+
+	return true;
+}
+
+static bool setup_pairs(void)
+{
+	unsigned int i;
+
+	pairs = calloc(num_pairs, sizeof(*pairs));
+	if (!pairs)
+		return false;
+
+	for (i = 0; i < num_pairs; i++) {
+		struct pair_data *pair = &pairs[i];
+		unsigned char byte = i;
+
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK |
+					SOCK_CLOEXEC, 0, pair->fd) < 0) {
+			perror("Failed to create socket pair");
+			return false;
+		}
+
+		if (mainloop_add_fd(pair->fd[0], EPOLLIN, pair_callback,
+							NULL, NULL) < 0 ||
+				mainloop_add_fd(pair->fd[1], EPOLLIN,
+						pair_callback, NULL, NULL) < 0) {
+			fprintf(stderr, "Failed to add descriptor %d\n",
+								pair->fd[1]);
+			return false;
+		}
+
+		if (write(pair->fd[0], &byte, sizeof(byte)) < 0) {
+			perror("Failed to write data");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool setup_timers(void)
+{
+	unsigned int i;
+
+	timers = calloc(num_timers, sizeof(*timers));
+	if (!timers)
+		return false;
+
+	for (i = 0; i < num_timers; i++) {
+		struct timer_data *timer = &timers[i];
+
+		timer_schedule(timer);
+
+		timer->id = mainloop_add_timeout(timer->msec, timer_callback,
+								timer, NULL);
+		if (timer->id < 0) {
+			fprintf(stderr, "Failed to add timeout %u\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void cleanup_pairs(void)
+{
+	unsigned int i;
+
+	if (!pairs)
+		return;
+
+	for (i = 0; i < num_pairs; i++) {
+		if (pairs[i].fd[0] > 0)
+			close(pairs[i].fd[0]);
+		if (pairs[i].fd[1] > 0)
+			close(pairs[i].fd[1]);
+	}
+
+	free(pairs);
+}
+
+static void print_results(void)
+{
+	double secs = (get_usec() - start_usec) / 1000000.0;
+	struct rusage usage;
+
+	printf("Descriptors:  %u\n", num_pairs * 2);
+	printf("Timeouts:     %u\n", num_timers);
+	printf("Duration:     %.2f s\n", secs);
+	printf("I/O events:   %" PRIu64 " (%.0f/s)\n", fd_events,
+							fd_events / secs);
+	printf("Timer events: %" PRIu64 " (%.0f/s)\n", timer_events,
+							timer_events / secs);
+
+	if (timer_events > timer_early)
+		printf("Timer late:   avg %" PRIu64 " us max %" PRIu64 " us\n",
+			timer_late_total / (timer_events - timer_early),
+			timer_late_max);
+
+	printf("Timer early:  %" PRIu64 "\n", timer_early);
+
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return;
+
+	printf("CPU time:     user %ld.%06ld s system %ld.%06ld s\n",
+				usage.ru_utime.tv_sec, usage.ru_utime.tv_usec,
+				usage.ru_stime.tv_sec, usage.ru_stime.tv_usec);
+}
+
+static void usage(void)
+{
+	printf("looptest - Mainloop benchmark\n"
+		"Usage:\n");
+	printf("\tlooptest [options]\n");
+	printf("options:\n"
+		"\t-f, --fds <num>        Number of socket pairs\n"
+		"\t-t, --timeouts <num>   Number of timeouts\n"
+		"\t-m, --max-msec <msec>  Maximum timeout interval\n"
+		"\t-d, --duration <sec>   Duration of the benchmark\n"
+		"\t-h, --help             Show help options\n");
+}
+
+static const struct option main_options[] = {
+	{ "fds",       required_argument, NULL, 'f' },
+	{ "timeouts",  required_argument, NULL, 't' },
+	{ "max-msec",  required_argument, NULL, 'm' },
+	{ "duration",  required_argument, NULL, 'd' },
+	{ "version",   no_argument,       NULL, 'v' },
+	{ "help",      no_argument,       NULL, 'h' },
+	{ }
+};
+
+int main(int argc, char *argv[])
+{
+	int exit_status;
+
+	for (;;) {
+		int opt;
+
+		opt = getopt_long(argc, argv, "f:t:m:d:vh", main_options, NULL);
+		if (opt < 0)
+			break;
+
+		switch (opt) {
+		case 'f':
+			num_pairs = atoi(optarg);
+			break;
+		case 't':
+			num_timers = atoi(optarg);
+			break;
+		case 'm':
+			max_msec = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'v':
+			printf("%s\n", VERSION);
+			return EXIT_SUCCESS;
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argc - optind > 0) {
+		fprintf(stderr, "Invalid command line parameters\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!max_msec || !duration) {
+		fprintf(stderr, "Invalid timeout interval or duration\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!setup_limit())
+		return EXIT_FAILURE;
+
+	mainloop_init();
+
+	if (!setup_pairs() || !setup_timers()) {
+		cleanup_pairs();
+		free(timers);
+		return EXIT_FAILURE;
+	}
+
+	mainloop_add_timeout(duration * 1000, duration_callback, NULL, NULL);
+
+	start_usec = get_usec();
+
+	exit_status = mainloop_run_with_signal(signal_callback, NULL);
+
+	print_results();
+
+	cleanup_pairs();
+	free(timers);
+
+	return exit_status;
+}
@@ -324,6 +324,80 @@ static void test_verify_sign(gconstpointer data)
 	tester_test_passed();
 }
 
+#define BENCH_ITERATIONS 20000
+
+struct bench_data {
+	const char *name;
+	enum bt_crypto_backend backend;
+};
+
+static const struct bench_data bench_user = {
+	.name = "user space",
+	.backend = BT_CRYPTO_BACKEND_USER,
+};
+
+static const struct bench_data bench_af_alg = {
+	.name = "AF_ALG",
+	.backend = BT_CRYPTO_BACKEND_AF_ALG,
+};
+
+static void test_bench(gconstpointer data)
+{
+	const struct bench_data *d = data;
+	struct bt_crypto *bench;
+	uint8_t k[16] = { }, in[16] = { }, res[16], ref[16];
+	uint8_t t[12], t_ref[12];
+	gint64 start;
+	int i;
+
+	bench = bt_crypto_new_backend(d->backend);
+	if (!bench) {
+		tester_print("%s backend not available", d->name);
+		tester_test_passed();
+		return;
+	}
+
+	/* Both backends have to agree with the default one */
+	g_assert(bt_crypto_e(crypto, key, msg_2, ref));
+	g_assert(bt_crypto_e(bench, key, msg_2, res));
+	g_assert(!memcmp(res, ref, 16));
+
+	g_assert(bt_crypto_sign_att(crypto, key, msg_3, sizeof(msg_3), 0,
+									t_ref));
+	g_assert(bt_crypto_sign_att(bench, key, msg_3, sizeof(msg_3), 0, t));
+	g_assert(!memcmp(t, t_ref, 12));
+
+	if (!tester_use_benchmark())
+		goto done;
+
+	tester_print("%s backend", d->name);
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		k[0] = i % 4;
+		in[0] = i;
+		g_assert(bt_crypto_e(bench, k, in, res));
+	}
+
+	tester_print_rate("e blocks", BENCH_ITERATIONS,
+					g_get_monotonic_time() - start);
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		g_assert(bt_crypto_sign_att(bench, key, msg_3, sizeof(msg_3),
+								i, t));
+
+	tester_print_rate("sign_att signatures", BENCH_ITERATIONS,
+					g_get_monotonic_time() - start);
+
+done:
+	bt_crypto_unref(bench);
+
+	tester_test_passed();
+}
+
 int main(int argc, char *argv[])
 {
 	int exit_status;
@@ -351,6 +425,10 @@ int main(int argc, char *argv[])
 	tester_add("/crypto/verify_sign_too_short", &verify_sign_too_short_data,
 						NULL, test_verify_sign, NULL);
 
+	tester_add("/crypto/bench_user", &bench_user, NULL, test_bench, NULL);
+	tester_add("/crypto/bench_af_alg", &bench_af_alg, NULL, test_bench,
+									NULL);
+
 	exit_status = tester_run();
 
 	bt_crypto_unref(crypto);
@@ -654,6 +654,138 @@ static const struct test_data uri_beacon_test = {
 	.uuid = uri_beacon_uuid,
 };
 
+static const struct test_data *captured_data[] = {
+	&macbookair_test,
+	&iphone5_test,
+	&ipadmini_test,
+	&gigaset_sl400h_test,
+	&gigaset_sl910_test,
+	&nokia_bh907_test,
+	&fuelband_test,
+	&bluesc_test,
+	&wahoo_scale_test,
+	&mio_alpha_test,
+	&cookoo_test,
+	&citizen_adv_test,
+	&citizen_scan_test,
+	&gigaset_gtag_test,
+	&uri_beacon_test,
+};
+
+static void test_view(gconstpointer data)
+{
+	const struct test_data *test = data;
+	struct eir_view view, other;
+	struct eir_data eir, *view_eir;
+	uint8_t buf[UINT8_MAX];
+	GSList *a, *b;
+
+	g_assert(test->eir_size <= sizeof(buf));
+
+	memset(&eir, 0, sizeof(eir));
+	eir_parse(&eir, test->eir_data, test->eir_size);
+
+	eir_view_init(&view, test->eir_data, test->eir_size);
+
+	/* Simple fields come straight from the AD structures */
+	g_assert_cmpint(eir_view_get_flags(&view), ==, test->flags);
+	g_assert(eir_view_get_tx_power(&view) == test->tx_power);
+	g_assert(!view.parsed);
+
+	view_eir = eir_view_get_data(&view);
+	g_assert(view.parsed);
+	g_assert_cmpstr(view_eir->name, ==, eir.name);
+
+	for (a = eir.services, b = view_eir->services; a && b;
+					a = a->next, b = b->next)
+		g_assert_cmpstr(a->data, ==, b->data);
+
+	g_assert(a == NULL && b == NULL);
+
+	g_assert_cmpint(g_slist_length(view_eir->msd_list), ==,
+					g_slist_length(eir.msd_list));
+	g_assert_cmpint(g_slist_length(view_eir->sd_list), ==,
+					g_slist_length(eir.sd_list));
+
+	/* Repeated reports share a fingerprint, modified ones do not */
+	memcpy(buf, test->eir_data, test->eir_size);
+	eir_view_init(&other, buf, test->eir_size);
+	g_assert(other.fingerprint == view.fingerprint);
+
+	buf[test->eir_size - 1] ^= 0x01;
+	eir_view_init(&other, buf, test->eir_size);
+	g_assert(other.fingerprint != view.fingerprint);
+
+	eir_view_clear(&view);
+	eir_data_free(&eir);
+
+	tester_test_passed();
+}
+
+#define BENCH_ITERATIONS 10000
+
+static void test_view_bench(gconstpointer data)
+{
+	struct eir_data eir;
+	struct eir_view view;
+	gint64 start;
+	unsigned int i, j, iterations, count = 0;
+	uint32_t last[G_N_ELEMENTS(captured_data)];
+
+	memset(last, 0, sizeof(last));
+
+	/* A repeat of each report is enough to check it isn't decoded */
+	iterations = tester_use_benchmark() ? BENCH_ITERATIONS : 2;
+
+	if (tester_use_benchmark()) {
+		start = g_get_monotonic_time();
+
+		for (i = 0; i < iterations; i++) {
+			for (j = 0; j < G_N_ELEMENTS(captured_data); j++) {
+				const struct test_data *test =
+							captured_data[j];
+
+				memset(&eir, 0, sizeof(eir));
+				eir_parse(&eir, test->eir_data,
+							test->eir_size);
+				eir_data_free(&eir);
+			}
+		}
+
+		tester_print_rate("eir_parse reports",
+				iterations * G_N_ELEMENTS(captured_data),
+				g_get_monotonic_time() - start);
+	}
+
+	/* Repeated reports as update_found_devices() sees them */
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < G_N_ELEMENTS(captured_data); j++) {
+			const struct test_data *test = captured_data[j];
+
+			eir_view_init(&view, test->eir_data, test->eir_size);
+
+			if (view.fingerprint != last[j]) {
+				eir_view_get_data(&view);
+				last[j] = view.fingerprint;
+				count++;
+			}
+
+			eir_view_clear(&view);
+		}
+	}
+
+	if (tester_use_benchmark())
+		tester_print_rate("eir_view reports",
+				iterations * G_N_ELEMENTS(captured_data),
+				g_get_monotonic_time() - start);
+
+	g_assert_cmpint(count, ==, G_N_ELEMENTS(captured_data));
+
+	tester_test_passed();
+}
+
 int main(int argc, char *argv[])
 {
 	tester_init(&argc, &argv);
@@ -680,5 +812,16 @@ int main(int argc, char *argv[])
 	tester_add("ad/g-tag", &gigaset_gtag_test, NULL, test_parsing, NULL);
 	tester_add("ad/uri-beacon", &uri_beacon_test, NULL, test_parsing, NULL);
 
+	tester_add("/eir/view/macbookair", &macbookair_test, NULL, test_view,
+									NULL);
+	tester_add("/eir/view/iphone5", &iphone5_test, NULL, test_view, NULL);
+	tester_add("/eir/view/bh907", &nokia_bh907_test, NULL, test_view, NULL);
+	tester_add("ad/view/bluesc", &bluesc_test, NULL, test_view, NULL);
+	tester_add("ad/view/citizen2", &citizen_scan_test, NULL, test_view,
+									NULL);
+	tester_add("ad/view/uri-beacon", &uri_beacon_test, NULL, test_view,
+									NULL);
+	tester_add("/eir/view/bench", NULL, NULL, test_view_bench, NULL);
+
 	return tester_run();
 }
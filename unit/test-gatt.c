@@ -55,6 +55,7 @@ struct test_pdu {
 enum context_type {
 	ATT,
 	CLIENT,
+	CLIENT_CACHE,
 	SERVER
 };
 
@@ -117,6 +118,11 @@ struct context {
 #define define_test_client(name, function, source_db, test_step, args...)\
 	define_test(name, function, CLIENT, NULL, source_db, test_step, args)
 
+#define define_test_client_cache(name, function, cache_db, test_step,	\
+								args...)	\
+	define_test(name, function, CLIENT_CACHE, NULL, cache_db, test_step,	\
+									args)
+
 #define define_test_server(name, function, source_db, test_step, args...)\
 	define_test(name, function, SERVER, NULL, source_db, test_step, args)
 
@@ -687,7 +693,12 @@ static struct context *create_context(uint16_t mtu, gconstpointer data)
 						"bt_gatt_server:", NULL);
 		break;
 	case CLIENT:
-		context->client_db = gatt_db_new();
+	case CLIENT_CACHE:
+		/* Cache tests start the client with the source db loaded */
+		if (test_data->context_type == CLIENT_CACHE)
+			context->client_db = gatt_db_ref(test_data->source_db);
+		else
+			context->client_db = gatt_db_new();
 		g_assert(context->client_db);
 
 		context->client = bt_gatt_client_new(context->client_db,
@@ -1560,6 +1571,19 @@ static struct gatt_db *make_service_data_3_db(void)
  *     (although not in scrambled order)
  */
 
+static struct gatt_db *make_db_hash_db(void)
+{
+	const struct att_handle_spec specs[] = {
+		PRIMARY_SERVICE(0x0001, GATT_UUID, 3),
+		CHARACTERISTIC_STR(GATT_CHARAC_DB_HASH, BT_ATT_PERM_READ,
+					BT_GATT_CHRC_PROP_READ,
+					"0123456789abcdef"),
+		{ }
+	};
+
+	return make_db(specs);
+}
+
 static struct gatt_db *make_test_spec_small_db(void)
 {
 	const struct att_handle_spec specs[] = {
@@ -2345,10 +2369,172 @@ static const struct test_step test_indication_server_1 = {
 	.length = 0x03,
 };
 
+#define BENCH_CHRCS 64
+#define BENCH_ITERATIONS 20000
+
+struct notify_bench {
+	struct gatt_db *server_db;
+	struct gatt_db *client_db;
+	struct bt_att *server_att;
+	struct bt_att *client_att;
+	struct bt_gatt_server *server;
+	struct bt_gatt_client *client;
+	uint16_t handles[BENCH_CHRCS];
+	unsigned int num_handles;
+	unsigned int registered;
+	unsigned int received;
+	unsigned int total;
+	gint64 start;
+};
+
+static void bench_collect_handle(struct gatt_db_attribute *attr,
+								void *user_data)
+{
+	struct notify_bench *bench = user_data;
+	uint16_t value_handle;
+
+	gatt_db_attribute_get_char_data(attr, NULL, &value_handle, NULL, NULL,
+									NULL);
+	bench->handles[bench->num_handles++] = value_handle;
+}
+
+static void bench_free(struct notify_bench *bench)
+{
+	bt_gatt_client_unref(bench->client);
+	bt_gatt_server_unref(bench->server);
+	bt_att_unref(bench->client_att);
+	bt_att_unref(bench->server_att);
+	gatt_db_unref(bench->client_db);
+	gatt_db_unref(bench->server_db);
+	g_free(bench);
+}
+
+static gboolean bench_done(gpointer user_data)
+{
+	bench_free(user_data);
+
+	tester_test_passed();
+
+	return FALSE;
+}
+
+static void bench_notify_cb(uint16_t value_handle, const uint8_t *value,
+					uint16_t length, void *user_data)
+{
+	struct notify_bench *bench = user_data;
+	unsigned int i = bench->received;
+
+	/* Each notification reaches the handler of its characteristic */
+	g_assert_cmpuint(value_handle, ==,
+				bench->handles[i % bench->num_handles]);
+	g_assert_cmpuint(length, ==, 2);
+	g_assert_cmpuint(get_le16(value), ==, i & 0xffff);
+
+	if (++bench->received < bench->total)
+		return;
+
+	if (tester_use_benchmark())
+		tester_print_rate("notifications", bench->received,
+				g_get_monotonic_time() - bench->start);
+
+	/* Not safe to free the client from within its own callback */
+	g_idle_add(bench_done, bench);
+}
+
+static void bench_register_cb(uint16_t att_ecode, void *user_data)
+{
+	struct notify_bench *bench = user_data;
+	uint8_t value[2] = { };
+	unsigned int i;
+
+	g_assert(!att_ecode);
+
+	if (++bench->registered < bench->num_handles)
+		return;
+
+	/* Two rounds over every characteristic, unless benchmarking */
+	if (tester_use_benchmark())
+		bench->total = BENCH_ITERATIONS;
+	else
+		bench->total = bench->num_handles * 2;
+
+	bench->start = g_get_monotonic_time();
+
+	for (i = 0; i < bench->total; i++) {
+		put_le16(i, value);
+		g_assert(bt_gatt_server_send_notification(bench->server,
+					bench->handles[i % bench->num_handles],
+					value, sizeof(value), false));
+	}
+}
+
+static void bench_ready_cb(bool success, uint8_t att_ecode, void *user_data)
+{
+	struct notify_bench *bench = user_data;
+	unsigned int i;
+
+	g_assert(success);
+
+	for (i = 0; i < bench->num_handles; i++)
+		g_assert(bt_gatt_client_register_notify(bench->client,
+						bench->handles[i],
+						bench_register_cb,
+						bench_notify_cb, bench, NULL));
+}
+
+static void test_bench_notification(gconstpointer data)
+{
+	struct notify_bench *bench = g_new0(struct notify_bench, 1);
+	struct gatt_db_attribute *service;
+	bt_uuid_t uuid;
+	int err, sv[2], i;
+
+	bench->server_db = gatt_db_new();
+
+	bt_uuid16_create(&uuid, 0x180f);
+	service = gatt_db_add_service(bench->server_db, &uuid, true,
+							1 + BENCH_CHRCS * 3);
+
+	for (i = 0; i < BENCH_CHRCS; i++) {
+		bt_uuid16_create(&uuid, 0x2a19);
+		gatt_db_service_add_characteristic(service, &uuid,
+						BT_ATT_PERM_READ,
+						BT_GATT_CHRC_PROP_NOTIFY,
+						NULL, NULL, NULL);
+
+		bt_uuid16_create(&uuid, GATT_CLIENT_CHARAC_CFG_UUID);
+		gatt_db_service_add_descriptor(service, &uuid,
+					BT_ATT_PERM_READ | BT_ATT_PERM_WRITE,
+					NULL, NULL, NULL);
+	}
+
+	gatt_db_service_set_active(service, true);
+	gatt_db_service_foreach_char(service, bench_collect_handle, bench);
+
+	err = socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv);
+	g_assert(err == 0);
+
+	bench->server_att = bt_att_new(sv[0], false);
+	bt_att_set_close_on_unref(bench->server_att, true);
+	bench->server = bt_gatt_server_new(bench->server_db,
+						bench->server_att, 512, 0);
+	g_assert(bench->server);
+
+	bench->client_att = bt_att_new(sv[1], false);
+	bt_att_set_close_on_unref(bench->client_att, true);
+	bench->client_db = gatt_db_new();
+	bench->client = bt_gatt_client_new(bench->client_db,
+						bench->client_att, 512, 0);
+	g_assert(bench->client);
+
+	bt_gatt_client_ready_register(bench->client, bench_ready_cb, bench,
+									NULL);
+}
+
 int main(int argc, char *argv[])
 {
 	struct gatt_db *service_db_1, *service_db_2, *service_db_3;
-	struct gatt_db *ts_small_db, *ts_large_db_1;
+	struct gatt_db *ts_small_db, *ts_large_db_1, *db_hash_db;
 
 	tester_init(&argc, &argv);
 
@@ -2357,6 +2543,7 @@ int main(int argc, char *argv[])
 	service_db_3 = make_service_data_3_db();
 	ts_small_db = make_test_spec_small_db();
 	ts_large_db_1 = make_test_spec_large_db_1();
+	db_hash_db = make_db_hash_db();
 
 	/*
 	 * Server Configuration
@@ -4459,6 +4646,36 @@ int main(int argc, char *argv[])
 				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
 			raw_pdu(0x01, 0x16, 0x04, 0x00, 0x03));
 
+	/*
+	 * Robust Caching
+	 *
+	 * With a cached Database Hash the client reads it before anything
+	 * else, MTU exchange included, and is ready as soon as it matches.
+	 */
+	define_test_client_cache("/robust-caching/hash-match", test_client,
+			db_hash_db, NULL,
+			raw_pdu(0x08, 0x01, 0x00, 0x03, 0x00, 0x2a, 0x2b),
+			raw_pdu(0x09, 0x12, 0x03, 0x00, 0x30, 0x31, 0x32, 0x33,
+				0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 0x62,
+				0x63, 0x64, 0x65, 0x66));
+
+	/*
+	 * If the hash doesn't match the MTU exchange queued behind the read
+	 * goes out first, then the server features are read and the services
+	 * are rediscovered.
+	 */
+	define_test_client_cache("/robust-caching/hash-mismatch", test_client,
+			db_hash_db, NULL,
+			raw_pdu(0x08, 0x01, 0x00, 0x03, 0x00, 0x2a, 0x2b),
+			raw_pdu(0x09, 0x12, 0x03, 0x00, 0x66, 0x65, 0x64, 0x63,
+				0x62, 0x61, 0x39, 0x38, 0x37, 0x36, 0x35, 0x34,
+				0x33, 0x32, 0x31, 0x30),
+			CLIENT_INIT_PDUS,
+			raw_pdu(0x10, 0x01, 0x00, 0xff, 0xff, 0x00, 0x28),
+			raw_pdu(0x11, 0x06, 0x01, 0x00, 0x03, 0x00, 0x01, 0x18),
+			raw_pdu(0x10, 0x04, 0x00, 0xff, 0xff, 0x00, 0x28),
+			raw_pdu(0x01, 0x10, 0x04, 0x00, 0x0a));
+
 	define_test_server("/robustness/no-reliable-characteristic",
 			test_server, ts_large_db_1, NULL,
 			raw_pdu(0x03, 0x00, 0x02),
@@ -4485,5 +4702,8 @@ int main(int argc, char *argv[])
 			raw_pdu(0xff, 0x00),
 			raw_pdu());
 
+	tester_add("/benchmark/notification", NULL, NULL,
+					test_bench_notification, NULL);
+
 	return tester_run();
 }
@@ -917,6 +917,303 @@ static void client_ready(const void *data)
 						proxy_added, NULL, NULL, context);
 }
 
+#define MANY_OBJECTS 2000
+
+/* Objects flushed per main loop iteration while the test runs */
+#define MANY_OBJECTS_BUDGET 8
+
+enum {
+	MANY_OBJECTS_PLAIN,
+	MANY_OBJECTS_CHANGED,
+	MANY_OBJECTS_REMOVED,
+};
+
+struct many_objects {
+	struct context *context;
+	int mode;
+	unsigned int added;
+	unsigned int removed;
+	unsigned int changed;
+	GHashTable *stale;
+	gboolean ready;
+	unsigned int iterations;
+	guint idle_id;
+	gint64 start;
+};
+
+static const GDBusPropertyTable many_properties[] = {
+	{ "String", "s", get_string, NULL, string_exists },
+	{ },
+};
+
+static char *many_objects_path(unsigned int i)
+{
+	return g_strdup_printf("%s/obj%u", SERVICE_PATH, i);
+}
+
+static void many_objects_unregister(struct context *context)
+{
+	unsigned int i;
+
+	for (i = 0; i < MANY_OBJECTS; i++) {
+		char *path = many_objects_path(i);
+
+		g_dbus_unregister_interface(context->dbus_conn, path,
+								SERVICE_NAME);
+		g_free(path);
+	}
+}
+
+static void many_objects_emit_all(struct context *context)
+{
+	unsigned int i;
+
+	for (i = 0; i < MANY_OBJECTS; i++) {
+		char *path = many_objects_path(i);
+
+		g_dbus_emit_property_changed(context->dbus_conn, path,
+						SERVICE_NAME, "String");
+		g_free(path);
+	}
+}
+
+static const char *many_objects_get_string(GDBusProxy *proxy)
+{
+	DBusMessageIter iter;
+	const char *string;
+
+	g_assert(g_dbus_proxy_get_property(proxy, "String", &iter));
+	g_assert(dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_STRING);
+
+	dbus_message_iter_get_basic(&iter, &string);
+
+	return string;
+}
+
+static gboolean many_objects_interfere(gpointer user_data)
+{
+	struct many_objects *many = user_data;
+	struct context *context = many->context;
+	char *path;
+
+	/*
+	 * Let a few chunks of the GetManagedObjects reply be appended first,
+	 * there are still plenty left to go afterwards.
+	 */
+	if (++many->iterations < 4)
+		return TRUE;
+
+	many->idle_id = 0;
+
+	switch (many->mode) {
+	case MANY_OBJECTS_CHANGED:
+		/* Some objects are in the reply already, others are not */
+		g_free(context->data);
+		context->data = g_strdup("value1");
+
+		many_objects_emit_all(context);
+		break;
+	case MANY_OBJECTS_REMOVED:
+		/* One end of the tree is in the reply already */
+		path = many_objects_path(0);
+		g_dbus_unregister_interface(context->dbus_conn, path,
+								SERVICE_NAME);
+		g_free(path);
+
+		path = many_objects_path(MANY_OBJECTS - 1);
+		g_dbus_unregister_interface(context->dbus_conn, path,
+								SERVICE_NAME);
+		g_free(path);
+		break;
+	}
+
+	return FALSE;
+}
+
+static DBusHandlerResult many_objects_filter(DBusConnection *connection,
+						DBusMessage *message,
+						void *user_data)
+{
+	struct many_objects *many = user_data;
+
+	if (many->iterations == 0 && many->idle_id == 0 &&
+			dbus_message_is_method_call(message,
+					"org.freedesktop.DBus.ObjectManager",
+					"GetManagedObjects"))
+		many->idle_id = g_idle_add(many_objects_interfere, many);
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+static void many_objects_done(struct many_objects *many)
+{
+	struct context *context = many->context;
+
+	g_dbus_set_flush_budget(0);
+
+	if (many->mode != MANY_OBJECTS_PLAIN)
+		dbus_connection_remove_filter(context->dbus_conn,
+						many_objects_filter, many);
+
+	/* Freeing the client reports every proxy as removed */
+	g_dbus_client_set_proxy_handlers(context->dbus_client, NULL, NULL,
+								NULL, NULL);
+	g_dbus_client_unref(context->dbus_client);
+	many_objects_unregister(context);
+	g_hash_table_destroy(many->stale);
+	g_free(many);
+	destroy_context(context);
+}
+
+static void many_objects_changed(GDBusProxy *proxy, const char *name,
+					DBusMessageIter *iter, void *user_data)
+{
+	struct many_objects *many = user_data;
+	struct context *context = many->context;
+
+	/* Signals about objects in the reply must not get ahead of it */
+	g_assert(many->ready);
+
+	g_assert_cmpstr(many_objects_get_string(proxy), ==, context->data);
+
+	if (many->mode == MANY_OBJECTS_CHANGED) {
+		g_hash_table_remove(many->stale, g_dbus_proxy_get_path(proxy));
+
+		if (g_hash_table_size(many->stale) == 0)
+			many_objects_done(many);
+
+		return;
+	}
+
+	if (++many->changed < many->added)
+		return;
+
+	if (tester_use_benchmark())
+		tester_print_rate("property changes", many->changed,
+					g_get_monotonic_time() - many->start);
+
+	many_objects_done(many);
+}
+
+static void many_objects_proxy_added(GDBusProxy *proxy, void *user_data)
+{
+	struct many_objects *many = user_data;
+	struct context *context = many->context;
+	const char *string = many_objects_get_string(proxy);
+
+	many->added++;
+
+	if (g_strcmp0(string, context->data) == 0)
+		return;
+
+	/* Only objects appended before they changed may lag behind */
+	g_assert(many->mode == MANY_OBJECTS_CHANGED);
+	g_assert_cmpstr(string, ==, "value");
+
+	g_hash_table_add(many->stale, g_strdup(g_dbus_proxy_get_path(proxy)));
+}
+
+static gboolean many_objects_removed_done(gpointer user_data)
+{
+	many_objects_done(user_data);
+
+	return FALSE;
+}
+
+static void many_objects_proxy_removed(GDBusProxy *proxy, void *user_data)
+{
+	struct many_objects *many = user_data;
+
+	g_assert(many->ready);
+	g_assert(many->mode == MANY_OBJECTS_REMOVED);
+	g_assert_cmpuint(++many->removed, ==, 1);
+
+	/* Not safe to free the client from within its own callback */
+	g_idle_add(many_objects_removed_done, many);
+}
+
+static void many_objects_ready(GDBusClient *client, void *user_data)
+{
+	struct many_objects *many = user_data;
+	struct context *context = many->context;
+
+	g_assert_cmpuint(many->idle_id, ==, 0);
+
+	many->ready = TRUE;
+
+	switch (many->mode) {
+	case MANY_OBJECTS_PLAIN:
+		g_assert_cmpuint(many->added, ==, MANY_OBJECTS);
+		break;
+	case MANY_OBJECTS_CHANGED:
+		/* The changes to these still have to follow the reply */
+		g_assert_cmpuint(many->added, ==, MANY_OBJECTS);
+		g_assert_cmpuint(g_hash_table_size(many->stale), >, 0);
+		return;
+	case MANY_OBJECTS_REMOVED:
+		/* Removal of the object in the reply has to follow it */
+		g_assert_cmpuint(many->added, ==, MANY_OBJECTS - 1);
+		return;
+	}
+
+	if (tester_use_benchmark())
+		tester_print_rate("objects managed", many->added,
+					g_get_monotonic_time() - many->start);
+
+	g_free(context->data);
+	context->data = g_strdup("value2");
+
+	many->start = g_get_monotonic_time();
+
+	many_objects_emit_all(context);
+}
+
+static void client_many_objects(const void *data)
+{
+	struct context *context = create_context();
+	struct many_objects *many;
+	unsigned int i;
+
+	if (context == NULL)
+		return;
+
+	context->data = g_strdup("value");
+
+	for (i = 0; i < MANY_OBJECTS; i++) {
+		char *path = many_objects_path(i);
+
+		g_dbus_register_interface(context->dbus_conn, path,
+					SERVICE_NAME, methods, signals,
+					many_properties, context, NULL);
+		g_free(path);
+	}
+
+	many = g_new0(struct many_objects, 1);
+	many->context = context;
+	many->mode = GPOINTER_TO_INT(data);
+	many->stale = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+									NULL);
+
+	g_dbus_set_flush_budget(MANY_OBJECTS_BUDGET);
+
+	if (many->mode != MANY_OBJECTS_PLAIN)
+		dbus_connection_add_filter(context->dbus_conn,
+						many_objects_filter, many,
+						NULL);
+
+	many->start = g_get_monotonic_time();
+
+	context->dbus_client = g_dbus_client_new(context->dbus_conn,
+						SERVICE_NAME, SERVICE_PATH);
+
+	g_dbus_client_set_ready_watch(context->dbus_client,
+						many_objects_ready, many);
+	g_dbus_client_set_proxy_handlers(context->dbus_client,
+						many_objects_proxy_added,
+						many_objects_proxy_removed,
+						many_objects_changed, many);
+}
+
 int main(int argc, char *argv[])
 {
 	tester_init(&argc, &argv);
@@ -961,5 +1258,16 @@ int main(int argc, char *argv[])
 
 	tester_add("/gdbus/client_ready", NULL, NULL, client_ready, NULL);
 
+	tester_add("/gdbus/client_many_objects", NULL, NULL,
+					client_many_objects, NULL);
+
+	tester_add("/gdbus/client_many_objects_changed",
+					GINT_TO_POINTER(MANY_OBJECTS_CHANGED),
+					NULL, client_many_objects, NULL);
+
+	tester_add("/gdbus/client_many_objects_removed",
+					GINT_TO_POINTER(MANY_OBJECTS_REMOVED),
+					NULL, client_many_objects, NULL);
+
 	return tester_run();
 }
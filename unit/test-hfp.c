@@ -39,6 +39,9 @@ struct context {
 	struct hfp_hf *hfp_hf;
 	const struct test_data *data;
 	unsigned int pdu_offset;
+	unsigned int bench_count;
+	unsigned int bench_total;
+	gint64 bench_start;
 };
 
 struct test_pdu {
@@ -116,6 +119,18 @@ struct test_data {
 		data.test_handler = test_hf_handler;			\
 	} while (0)
 
+#define define_bench_test(name, function)				\
+	do {								\
+		const struct test_pdu pdus[] = {			\
+			{ }						\
+		};							\
+		static struct test_data data;				\
+		data.test_name = g_strdup(name);			\
+		data.pdu_list = g_memdup(pdus, sizeof(pdus));		\
+		tester_add(name, &data, NULL, function, NULL);		\
+		data.test_handler = test_bench_handler;			\
+	} while (0)
+
 static void test_free(gconstpointer user_data)
 {
 	const struct test_data *data = user_data;
@@ -692,6 +707,101 @@ static void test_hf_robustness(gconstpointer data)
 	context_quit(context);
 }
 
+#define BENCH_COMMANDS 20000
+
+static const char *bench_prefixes[] = {
+	"+BRSF", "+BAC", "+CIND", "+CMER", "+CHLD", "+CMEE", "+CLIP",
+	"+CCWA", "+NREC", "+VGS", "+VGM", "+BIA", "+BIND", "+BIEV",
+	"+BCC", "+BCS", "+BTRH", "+BVRA", "+BINP", "+BLDN", "+CHUP",
+	"+CLCC", "+COPS", "+CNUM", "+VTS", "+CKPD", "+BSIR", "A", "D",
+	NULL
+};
+
+static const char *bench_commands[] = {
+	"AT+CIND?\r", "AT+CLCC\r", "AT+VGS=9\r", "AT+BIA=1,1,0,0\r",
+	"AT+COPS?\r", "AT+BIEV=2,50\r", "ATD0123456789;\r", "AT+VTS=5\r",
+	"AT+CHLD=?\r", "AT+BCS=2\r", "ATA\r", "AT+CHUP\r",
+};
+
+static void bench_send(struct context *context)
+{
+	const char *cmd;
+	ssize_t len;
+
+	cmd = bench_commands[context->bench_count %
+						G_N_ELEMENTS(bench_commands)];
+
+	len = write(context->fd_server, cmd, strlen(cmd));
+	g_assert_cmpint(len, ==, strlen(cmd));
+}
+
+static gboolean test_bench_handler(GIOChannel *channel, GIOCondition cond,
+							gpointer user_data)
+{
+	struct context *context = user_data;
+	char buf[64];
+	ssize_t len;
+
+	if (cond & (G_IO_HUP | G_IO_ERR | G_IO_NVAL))
+		goto done;
+
+	len = read(context->fd_server, buf, sizeof(buf));
+	g_assert(len == 6 && !memcmp(buf, "\r\nOK\r\n", 6));
+
+	if (++context->bench_count < context->bench_total) {
+		bench_send(context);
+		return TRUE;
+	}
+
+	if (tester_use_benchmark())
+		tester_print_rate("commands", context->bench_count,
+				g_get_monotonic_time() - context->bench_start);
+
+done:
+	context->watch_id = 0;
+
+	context_quit(context);
+
+	return FALSE;
+}
+
+static void bench_result_handler(struct hfp_context *result,
+				enum hfp_gw_cmd_type type, void *user_data)
+{
+	struct context *context = user_data;
+
+	hfp_gw_send_result(context->hfp, HFP_RESULT_OK);
+}
+
+static void test_bench_commands(gconstpointer data)
+{
+	struct context *context = create_context(data);
+	bool ret;
+	int i;
+
+	context->hfp = hfp_gw_new(context->fd_client);
+	g_assert(context->hfp);
+
+	ret = hfp_gw_set_close_on_unref(context->hfp, true);
+	g_assert(ret);
+
+	for (i = 0; bench_prefixes[i]; i++) {
+		ret = hfp_gw_register(context->hfp, bench_result_handler,
+						bench_prefixes[i], context, NULL);
+		g_assert(ret);
+	}
+
+	/* Every command once, unless running as a benchmark */
+	if (tester_use_benchmark())
+		context->bench_total = BENCH_COMMANDS;
+	else
+		context->bench_total = G_N_ELEMENTS(bench_commands);
+
+	context->bench_start = g_get_monotonic_time();
+
+	bench_send(context);
+}
+
 int main(int argc, char *argv[])
 {
 	tester_init(&argc, &argv);
@@ -837,6 +947,8 @@ int main(int argc, char *argv[])
 			raw_pdu('\r', '\n', 'B', 'R', '\r', '\n'),
 			data_end());
 
+	define_bench_test("/hfp/bench_commands", test_bench_commands);
+
 	define_hf_test("/hfp_hf/test_context_parser_1", test_hf_unsolicited,
 			hf_clcc_result_handler, NULL,
 			raw_pdu('+', 'C', 'L', 'C', 'C', '\0'),
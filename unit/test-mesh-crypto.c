@@ -23,6 +23,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
 
 #include "client/display.h"
 
@@ -792,6 +794,69 @@ static void show_uint32(const char *label, unsigned int indent, uint32_t data)
 }
 
 
+/* Raw key front ends to the cipher context based packet primitives */
+static bool packet_encrypt(uint8_t *packet, uint8_t packet_len,
+				const uint8_t network_key[16],
+				uint32_t iv_index, bool proxy,
+				bool ctl, uint8_t ttl, uint32_t seq,
+				uint16_t src)
+{
+	struct mesh_crypto_ccm *network = mesh_crypto_ccm_new(network_key);
+	bool result;
+
+	result = mesh_crypto_packet_encrypt(packet, packet_len, network,
+						iv_index, proxy, ctl, ttl, seq,
+						src);
+	mesh_crypto_ccm_free(network);
+
+	return result;
+}
+
+static bool packet_decrypt(uint8_t *packet, uint8_t packet_len,
+				const uint8_t network_key[16],
+				uint32_t iv_index, bool proxy,
+				bool ctl, uint8_t ttl, uint32_t seq,
+				uint16_t src)
+{
+	struct mesh_crypto_ccm *network = mesh_crypto_ccm_new(network_key);
+	bool result;
+
+	result = mesh_crypto_packet_decrypt(packet, packet_len, network,
+						iv_index, proxy, ctl, ttl, seq,
+						src);
+	mesh_crypto_ccm_free(network);
+
+	return result;
+}
+
+static bool network_obfuscate(uint8_t *packet, const uint8_t privacy_key[16],
+				uint32_t iv_index, bool ctl, uint8_t ttl,
+				uint32_t seq, uint16_t src)
+{
+	struct l_cipher *privacy = l_cipher_new(L_CIPHER_AES, privacy_key, 16);
+	bool result;
+
+	result = mesh_crypto_network_obfuscate(packet, privacy, iv_index,
+							ctl, ttl, seq, src);
+	l_cipher_free(privacy);
+
+	return result;
+}
+
+static bool network_clarify(uint8_t *packet, const uint8_t privacy_key[16],
+				uint32_t iv_index, bool *ctl, uint8_t *ttl,
+				uint32_t *seq, uint16_t *src)
+{
+	struct l_cipher *privacy = l_cipher_new(L_CIPHER_AES, privacy_key, 16);
+	bool result;
+
+	result = mesh_crypto_network_clarify(packet, privacy, iv_index,
+							ctl, ttl, seq, src);
+	l_cipher_free(privacy);
+
+	return result;
+}
+
 static void check_encrypt_segment(const struct mesh_crypto_test *keys,
 				uint16_t seg, uint16_t seg_max,
 				uint8_t *enc_msg, size_t len,
@@ -879,7 +944,7 @@ static void check_encrypt_segment(const struct mesh_crypto_test *keys,
 	net_msg_len = len + 2;
 	show_data("TransportPayload", 7, packet + 7, net_msg_len);
 
-	mesh_crypto_packet_encrypt(packet, packet_len,
+	packet_encrypt(packet, packet_len,
 						enc_key,
 						keys->iv_index, false,
 						keys->ctl, keys->net_ttl,
@@ -916,7 +981,7 @@ static void check_encrypt_segment(const struct mesh_crypto_test *keys,
 	}
 
 	show_data("PreObsPayload", 1, packet + 1, 6 + net_msg_len);
-	mesh_crypto_network_obfuscate(packet, priv_key,
+	network_obfuscate(packet, priv_key,
 					keys->iv_index,
 					keys->ctl, keys->net_ttl,
 					keys->net_seq[0], keys->net_src);
@@ -1202,7 +1267,7 @@ static void check_encrypt(const struct mesh_crypto_test *keys)
 		net_msg_len = seg_len + 2;
 		show_data("TransportPayload", 7, packet + 7, net_msg_len);
 
-		mesh_crypto_packet_encrypt(packet, packet_len, enc_key,
+		packet_encrypt(packet, packet_len, enc_key,
 						keys->iv_index, false,
 						keys->ctl, keys->net_ttl,
 						keys->net_seq[i],
@@ -1241,7 +1306,7 @@ static void check_encrypt(const struct mesh_crypto_test *keys)
 		}
 
 		show_data("PreObsPayload", 1, packet + 1, 6 + net_msg_len);
-		mesh_crypto_network_obfuscate(packet, priv_key,
+		network_obfuscate(packet, priv_key,
 					keys->iv_index,
 					keys->ctl, keys->net_ttl,
 					keys->net_seq[i], keys->net_src);
@@ -1299,7 +1364,7 @@ static void check_decrypt_segment(const struct mesh_crypto_test *keys,
 		net_mic64 = l_get_be64(pkt + pkt_len - 8);
 		show_data("EncryptedPayload", 7, pkt + 7, pkt_len - 7 - 8);
 
-		mesh_crypto_packet_decrypt(pkt, pkt_len,
+		packet_decrypt(pkt, pkt_len,
 							enc_key,
 							keys->iv_index, false,
 							ctl, ttl, seq,
@@ -1313,7 +1378,7 @@ static void check_decrypt_segment(const struct mesh_crypto_test *keys,
 		net_mic32 = l_get_be32(pkt + pkt_len - 4);
 		show_data("EncryptedPayload", 7, pkt + 7, pkt_len - 7 - 4);
 
-		mesh_crypto_packet_decrypt(pkt, pkt_len,
+		packet_decrypt(pkt, pkt_len,
 							enc_key,
 							keys->iv_index, false,
 							ctl, ttl, seq,
@@ -1510,7 +1575,7 @@ static void check_decrypt(const struct mesh_crypto_test *keys)
 		net_msg = packet + 7;
 		net_msg_len = packet_len - 7;
 
-		mesh_crypto_network_clarify(packet, priv_key, keys->iv_index,
+		network_clarify(packet, priv_key, keys->iv_index,
 				&net_ctl, &net_ttl, &net_seq, &net_src);
 
 		show_str("Packet", 0, keys->packet[i]);
@@ -1519,7 +1584,7 @@ static void check_decrypt(const struct mesh_crypto_test *keys)
 			net_mic64 = l_get_be64(packet + packet_len - 8);
 			show_data("NetworkMessage", 7, net_msg,
 							net_msg_len - 8);
-			mesh_crypto_packet_decrypt(packet, packet_len,
+			packet_decrypt(packet, packet_len,
 						enc_key,
 						keys->iv_index, false,
 						net_ctl, net_ttl,
@@ -1534,7 +1599,7 @@ static void check_decrypt(const struct mesh_crypto_test *keys)
 			net_mic32 = l_get_be32(packet + packet_len - 4);
 			show_data("NetworkMessage", 7, net_msg,
 							net_msg_len - 4);
-			mesh_crypto_packet_decrypt(packet, packet_len,
+			packet_decrypt(packet, packet_len,
 						enc_key,
 						keys->iv_index, false,
 						net_ctl, net_ttl,
@@ -2032,8 +2097,87 @@ static void check_k4(const struct mesh_crypto_test *keys)
 	l_info("");
 }
 
+#define PACKET_RATE_COUNT	10000
+
+static void check_packet_rate(const struct mesh_crypto_test *keys)
+{
+	struct mesh_crypto_ccm *network;
+	struct l_cipher *privacy;
+	uint8_t *net_key, *packet;
+	uint8_t enc_key[16], priv_key[16], buf[29];
+	uint8_t p[] = { 0 };
+	size_t pkt_len;
+	uint8_t nid;
+	uint64_t start, usec;
+	bool result = true;
+	int i;
+
+	l_info(COLOR_BLUE "[%s packet rate]" COLOR_OFF, keys->name);
+
+	net_key = l_util_from_hexstring(keys->net_key, NULL);
+	packet = l_util_from_hexstring(keys->packet[0], &pkt_len);
+
+	mesh_crypto_k2(net_key, p, sizeof(p), &nid, enc_key, priv_key);
+
+	/* Cipher contexts set up for every packet */
+	start = l_time_now();
+
+	for (i = 0; i < PACKET_RATE_COUNT && result; i++) {
+		result = mesh_crypto_packet_decode(packet, pkt_len, false, buf,
+					keys->iv_index, enc_key, priv_key) &&
+			mesh_crypto_packet_encode(buf, pkt_len, keys->iv_index,
+							enc_key, priv_key) &&
+			mesh_crypto_packet_label(buf, pkt_len, keys->iv_index,
+									nid);
+	}
+
+	usec = l_time_now() - start;
+	verify_data("Per-packet keys", 0, keys->packet[0], buf, pkt_len);
+	l_info("%d packets in %" PRIu64 " usec (%" PRIu64 " packets/s)",
+				i, usec, usec ? i * 1000000ULL / usec : 0);
+
+	/* Cipher contexts kept as done for struct net_key */
+	network = mesh_crypto_ccm_new(enc_key);
+	privacy = l_cipher_new(L_CIPHER_AES, priv_key, 16);
+
+	start = l_time_now();
+
+	for (i = 0; i < PACKET_RATE_COUNT && result; i++) {
+		result = mesh_crypto_packet_decode_ccm(packet, pkt_len, false,
+						buf, keys->iv_index,
+						network, privacy) &&
+			mesh_crypto_packet_encode_ccm(buf, pkt_len,
+						keys->iv_index,
+						network, privacy) &&
+			mesh_crypto_packet_label(buf, pkt_len, keys->iv_index,
+									nid);
+	}
+
+	usec = l_time_now() - start;
+	verify_data("Persistent keys", 0, keys->packet[0], buf, pkt_len);
+	l_info("%d packets in %" PRIu64 " usec (%" PRIu64 " packets/s)",
+				i, usec, usec ? i * 1000000ULL / usec : 0);
+
+	l_cipher_free(privacy);
+	mesh_crypto_ccm_free(network);
+	l_free(packet);
+	l_free(net_key);
+
+	EXITNUM(result, true);
+
+	l_info("");
+}
+
 int main(int argc, char *argv[])
 {
+	bool benchmark = false;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--benchmark"))
+			benchmark = true;
+	}
+
 	l_log_set_stderr();
 
 	/* Section 8.1 Sample Data Tests */
@@ -2084,5 +2228,9 @@ int main(int argc, char *argv[])
 	/* Section 8.6 Mesh Proxy Service sample data */
 	check_id_beacon(&s8_6_2);
 
+	/* Network PDU throughput, same option as the tester based units */
+	if (benchmark)
+		check_packet_rate(&s8_3_1);
+
 	return 0;
 }
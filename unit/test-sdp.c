@@ -125,6 +125,7 @@ struct context {
 static void destroy_context(struct context *context)
 {
 	sdp_svcdb_collect_all(context->fd);
+	sdp_cstate_cleanup(context->fd);
 	sdp_svcdb_reset();
 
 	g_source_remove(context->server_source);
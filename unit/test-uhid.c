@@ -30,6 +30,7 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <string.h>
+#include <stddef.h>
 #include <fcntl.h>
 #include <sys/socket.h>
 
@@ -282,6 +283,100 @@ static void test_server(gconstpointer data)
 	g_idle_add(send_pdu, context);
 }
 
+static const uint8_t report_data[] = { 0x01, 0x02, 0x03, 0x04 };
+
+static void test_input(gconstpointer data)
+{
+	struct bt_uhid *uhid;
+	struct uhid_event ev;
+	size_t hdr = offsetof(struct uhid_event, u.input2.data);
+	ssize_t len;
+	int err, sv[2];
+
+	err = socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv);
+	g_assert(err == 0);
+
+	uhid = bt_uhid_new(sv[0]);
+	g_assert(uhid != NULL);
+	bt_uhid_set_close_on_unref(uhid, true);
+
+	/* Without report ID only the used part of the event is written */
+	err = bt_uhid_input(uhid, 0, report_data, sizeof(report_data));
+	g_assert_cmpint(err, ==, 0);
+
+	len = read(sv[1], &ev, sizeof(ev));
+	g_assert_cmpint(len, ==, hdr + sizeof(report_data));
+	g_assert_cmpint(ev.type, ==, UHID_INPUT2);
+	g_assert_cmpint(ev.u.input2.size, ==, sizeof(report_data));
+	g_assert(!memcmp(ev.u.input2.data, report_data, sizeof(report_data)));
+
+	/* Report ID is prepended to the data */
+	err = bt_uhid_input(uhid, 0x05, report_data, sizeof(report_data));
+	g_assert_cmpint(err, ==, 0);
+
+	len = read(sv[1], &ev, sizeof(ev));
+	g_assert_cmpint(len, ==, hdr + sizeof(report_data) + 1);
+	g_assert_cmpint(ev.u.input2.size, ==, sizeof(report_data) + 1);
+	g_assert_cmpint(ev.u.input2.data[0], ==, 0x05);
+	g_assert(!memcmp(ev.u.input2.data + 1, report_data,
+						sizeof(report_data)));
+
+	bt_uhid_unref(uhid);
+	close(sv[1]);
+
+	tester_test_passed();
+}
+
+#define BENCH_ITERATIONS 20000
+
+static void test_input_benchmark(gconstpointer data)
+{
+	struct bt_uhid *uhid;
+	struct uhid_event ev, buf;
+	gint64 start;
+	int i, err, sv[2];
+
+	err = socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv);
+	g_assert(err == 0);
+
+	uhid = bt_uhid_new(sv[0]);
+	g_assert(uhid != NULL);
+	bt_uhid_set_close_on_unref(uhid, true);
+
+	/* What report_value_cb used to do for every input report */
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		memset(&ev, 0, sizeof(ev));
+		ev.type = UHID_INPUT;
+		ev.u.input.data[0] = 0x05;
+		memcpy(ev.u.input.data + 1, report_data, sizeof(report_data));
+		ev.u.input.size = sizeof(report_data) + 1;
+
+		g_assert(bt_uhid_send(uhid, &ev) == 0);
+		g_assert(read(sv[1], &buf, sizeof(buf)) > 0);
+	}
+
+	tester_print_rate("UHID_INPUT reports", BENCH_ITERATIONS,
+					g_get_monotonic_time() - start);
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		g_assert(bt_uhid_input(uhid, 0x05, report_data,
+						sizeof(report_data)) == 0);
+		g_assert(read(sv[1], &buf, sizeof(buf)) > 0);
+	}
+
+	tester_print_rate("UHID_INPUT2 reports", BENCH_ITERATIONS,
+					g_get_monotonic_time() - start);
+
+	bt_uhid_unref(uhid);
+	close(sv[1]);
+
+	tester_test_passed();
+}
+
 int main(int argc, char *argv[])
 {
 	tester_init(&argc, &argv);
@@ -295,5 +390,12 @@ int main(int argc, char *argv[])
 	define_test("/uhid/event/output", test_server, event(&ev_output));
 	define_test("/uhid/event/feature", test_server, event(&ev_feature));
 
+	tester_add("/uhid/command/input2", NULL, NULL, test_input, NULL);
+
+	/* Behaviour is covered by /uhid/command/input2 already */
+	if (tester_use_benchmark())
+		tester_add("/uhid/benchmark/input", NULL, NULL,
+						test_input_benchmark, NULL);
+
 	return tester_run();
 }